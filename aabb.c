@@ -0,0 +1,130 @@
+/*
+ *  aabb.c
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#include "aabb.h"
+#include "parallel.h"
+#include "simd.h"
+
+#ifdef MATH_SIMD_R4
+/* columns of e and the absolute values of the first three */
+typedef struct aabb_columns_t {
+  r4_t c[4], a[3];
+} aabb_columns_t;
+
+r_inline void aabb_columns(aabb_columns_t *m, const mat44_t e) {
+  m->c[0] = r4_load(e), m->a[0] = r4_abs(m->c[0]);
+  m->c[1] = r4_load(e + 4), m->a[1] = r4_abs(m->c[1]);
+  m->c[2] = r4_load(e + 8), m->a[2] = r4_abs(m->c[2]);
+  m->c[3] = r4_load(e + 12);
+}
+
+r_inline void aabb_apply(aabb_t *r, const aabb_columns_t *m, const aabb_t *b) {
+  vec3_t c, x;
+  r4_t rc, rx;
+
+  aabb_center(c, *b);
+  aabb_extent(x, *b);
+
+  rc = r4_madd(m->c[0], r4_set1(vx(c)), m->c[3]);
+  rc = r4_madd(m->c[1], r4_set1(vy(c)), rc);
+  rc = r4_madd(m->c[2], r4_set1(vz(c)), rc);
+
+  rx = r4_mul(m->a[0], r4_set1(vx(x)));
+  rx = r4_madd(m->a[1], r4_set1(vy(x)), rx);
+  rx = r4_madd(m->a[2], r4_set1(vz(x)), rx);
+
+  r4_store3(r->min, r4_sub(rc, rx));
+  r4_store3(r->max, r4_add(rc, rx));
+}
+#endif
+
+void aabb_transform(aabb_t *r, const mat44_t e, const aabb_t *b) {
+#ifdef MATH_SIMD_R4
+  aabb_columns_t m;
+
+  aabb_columns(&m, e);
+  aabb_apply(r, &m, b);
+#else
+  vec3_t c, x, rc, rx;
+
+  aabb_center(c, *b);
+  aabb_extent(x, *b);
+
+  vx(rc) = e0(e) * vx(c) + e4(e) * vy(c) + e8(e) * vz(c) + e12(e);
+  vy(rc) = e1(e) * vx(c) + e5(e) * vy(c) + e9(e) * vz(c) + e13(e);
+  vz(rc) = e2(e) * vx(c) + e6(e) * vy(c) + e10(e) * vz(c) + e14(e);
+
+  vx(rx) = r_abs(e0(e)) * vx(x) + r_abs(e4(e)) * vy(x) + r_abs(e8(e)) * vz(x);
+  vy(rx) = r_abs(e1(e)) * vx(x) + r_abs(e5(e)) * vy(x) + r_abs(e9(e)) * vz(x);
+  vz(rx) = r_abs(e2(e)) * vx(x) + r_abs(e6(e)) * vy(x) + r_abs(e10(e)) * vz(x);
+
+  vec3_sub(r->min, rc, rx);
+  vec3_add(r->max, rc, rx);
+#endif
+}
+
+/* arguments of a batch split over math_parallel_for */
+typedef struct aabb_job_t {
+  aabb_t *r;
+  const real_t *e;
+  const mat44_t *each;
+  const aabb_t *b;
+} aabb_job_t;
+
+static void aabb_batch(aabb_t *r, const mat44_t e, const aabb_t *b,
+                       size_t count) {
+  size_t i;
+#ifdef MATH_SIMD_R4
+  aabb_columns_t m;
+
+  aabb_columns(&m, e);
+  for (i = 0; i < count; ++i)
+    aabb_apply(r + i, &m, b + i);
+#else
+  for (i = 0; i < count; ++i)
+    aabb_transform(r + i, e, b + i);
+#endif
+}
+
+static void aabb_batch_range(void *ctx, size_t begin, size_t end) {
+  const aabb_job_t *j = (const aabb_job_t *)ctx;
+  aabb_batch(j->r + begin, j->e, j->b + begin, end - begin);
+}
+
+static void aabb_each_range(void *ctx, size_t begin, size_t end) {
+  const aabb_job_t *j = (const aabb_job_t *)ctx;
+  size_t i;
+
+  for (i = begin; i < end; ++i)
+    aabb_transform(j->r + i, j->each[i], j->b + i);
+}
+
+void aabb_transform_batch(aabb_t *r, const mat44_t e, const aabb_t *b,
+                          size_t count) {
+  aabb_job_t j;
+
+  j.r = r, j.e = e, j.b = b;
+  if (count < math_parallel_min)
+    aabb_batch(r, e, b, count);
+  else
+    math_parallel_for(0, count, math_parallel_grain, aabb_batch_range, &j);
+}
+
+void aabb_transform_each(aabb_t *r, const mat44_t *e, const aabb_t *b,
+                         size_t count) {
+  aabb_job_t j;
+
+  j.r = r, j.each = e, j.b = b;
+  if (count < math_parallel_min)
+    aabb_each_range(&j, 0, count);
+  else
+    math_parallel_for(0, count, math_parallel_grain, aabb_each_range, &j);
+}
@@ -0,0 +1,62 @@
+/*
+ *  aabb.h
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#ifndef __AABB_H__
+#define __AABB_H__
+
+#include "matrix.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* axis aligned box, min <= max on every axis */
+typedef struct aabb_t {
+  vec3_t min, max;
+} aabb_t;
+
+/* rx,ry,rz = (min + max) / 2 */
+#define aabb_center(r, b)                                                      \
+  do {                                                                         \
+    vx(r) = (vx((b).min) + vx((b).max)) * r_half;                              \
+    vy(r) = (vy((b).min) + vy((b).max)) * r_half;                              \
+    vz(r) = (vz((b).min) + vz((b).max)) * r_half;                              \
+  } while (0)
+
+/* rx,ry,rz = (max - min) / 2 */
+#define aabb_extent(r, b)                                                      \
+  do {                                                                         \
+    vx(r) = (vx((b).max) - vx((b).min)) * r_half;                              \
+    vy(r) = (vy((b).max) - vy((b).min)) * r_half;                              \
+    vz(r) = (vz((b).max) - vz((b).min)) * r_half;                              \
+  } while (0)
+
+/**
+ * Tight box around e applied to b, for affine e (Arvo): the center goes
+ * through e, the extent through the absolute upper 3x3 of e. That is one
+ * point transform plus one 3x3 product instead of eight corner transforms.
+ * r may alias b.
+ **/
+void aabb_transform(aabb_t *r, const mat44_t e, const aabb_t *b);
+
+/* r[i] = aabb_transform(e, b[i]), pooled from math_parallel_min boxes */
+void aabb_transform_batch(aabb_t *r, const mat44_t e, const aabb_t *b,
+                          size_t count);
+
+/* r[i] = aabb_transform(e[i], b[i]), pooled like aabb_transform_batch */
+void aabb_transform_each(aabb_t *r, const mat44_t *e, const aabb_t *b,
+                         size_t count);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __AABB_H__ */
@@ -0,0 +1,1693 @@
+/*
+ *  bench.c
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+#endif
+
+#include "aabb.h"
+#include "bvh.h"
+#include "frustum.h"
+#include "hierarchy.h"
+#include "inline.h"
+#include "kdtree.h"
+#include "linalg.h"
+#include "mapfile.h"
+#include "matn.h"
+#include "pack.h"
+#include "parallel.h"
+#include "matrix.h"
+#include "quaternion.h"
+#include "simd.h"
+#include "skin.h"
+#include "stream.h"
+#include "transform.h"
+#include "vector.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/**
+ * math-bench: ns/op of the public API over several data sizes, with warm
+ * and cold caches. Every sample times one pass over size elements (repeated
+ * for tiny sizes so the timer resolution does not dominate); median and
+ * p99 are taken over the samples.
+ *
+ *   math-bench [--json] [--quick] [--filter text] [--threads n]
+ *
+ * --threads starts the math_parallel_for pool (0 = one per hardware
+ * thread) so the batch kernels run pooled from math_parallel_min items.
+ *
+ * Left out on purpose, their cost is that of a listed sibling or of a
+ * few stores:
+ *   - element accessors (vx, qx, e0 ..) and the r_* / rf_* libm wrappers;
+ *   - arithmetic macros: neg, div, zero, lensq, len, equal, conjugate,
+ *     add and sub on matrices and quaternions, transpose, transform2 and
+ *     determinant on mat22 / mat33, and the vecNf_len forms;
+ *   - constructors: identity, translate, scale, shear, rotatex/y/z,
+ *     ortho, frustum, transformation, tomat33 / tomat44 and their f
+ *     forms, transform_identity, translate3, scale3, lookat, perspective;
+ *   - helpers the setups call: allocs and frees, matn_view, matn_add, sub,
+ *     scale, zero and identity (one pass like matn_copy), transform_set,
+ *     hierarchy_set_* and hierarchy_mark, dualquat_set, mapfile_stride,
+ *     mapfile_array and the typed mapfile getters.
+ **/
+
+#define bench_max 131072          /* elements per buffer */
+#define bench_flush (32 << 20)    /* bytes written to evict the caches */
+#define bench_warm_samples 31
+#define bench_cold_samples 15
+#define bench_min_ops 4096        /* per warm sample */
+
+static const size_t bench_sizes[] = {1, 1024, 16384, bench_max};
+
+/* three buffers large enough for bench_max mat44_t each */
+static real_t *bench_a, *bench_b, *bench_r;
+
+/* bench_a and bench_b as float, for the *f functions of double builds */
+static realf_t *bench_af, *bench_bf;
+static unsigned char *bench_cache;
+
+static double bench_now(void) {
+#ifdef _WIN32
+  LARGE_INTEGER f, t;
+  QueryPerformanceFrequency(&f);
+  QueryPerformanceCounter(&t);
+  return (double)t.QuadPart * 1e9 / (double)f.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+#endif
+}
+
+static void bench_evict(void) {
+  size_t i;
+  for (i = 0; i < bench_flush; i += 64)
+    bench_cache[i] += 1;
+}
+
+typedef struct bench_t {
+  const char *group, *name;
+  void (*run)(size_t n);
+  int (*setup)(size_t n); /* optional, untimed */
+  void (*teardown)(void); /* optional */
+} bench_t;
+
+/**
+ *---------------------------------------------
+ *  Kernels
+ *---------------------------------------------
+ **/
+
+/* r[i] = stmt over a[i], b[i] viewed as T and r[i] viewed as R */
+#define bench_map(fn, T, R, stmt)                                              \
+  static void fn(size_t n) {                                                   \
+    T *a = (T *)bench_a, *b = (T *)bench_b;                                    \
+    R *r = (R *)bench_r;                                                       \
+    size_t i;                                                                  \
+    (void)a, (void)b, (void)r;                                                 \
+    for (i = 0; i < n; ++i) {                                                  \
+      stmt;                                                                    \
+    }                                                                          \
+  }
+
+/* bench_map over bench_af and bench_bf */
+#define bench_mapf(fn, T, R, stmt)                                             \
+  static void fn(size_t n) {                                                   \
+    T *a = (T *)bench_af, *b = (T *)bench_bf;                                  \
+    R *r = (R *)bench_r;                                                       \
+    size_t i;                                                                  \
+    (void)a, (void)b, (void)r;                                                 \
+    for (i = 0; i < n; ++i) {                                                  \
+      stmt;                                                                    \
+    }                                                                          \
+  }
+
+/**
+ * stmt updates r[i], refreshed from a first so repeated runs do not drift.
+ * The copy is timed too, one memcpy over the whole pass.
+ **/
+#define bench_inplace(fn, T, E, stmt)                                          \
+  static void fn(size_t n) {                                                   \
+    E *b = (E *)bench_b;                                                       \
+    T *r = (T *)bench_r;                                                       \
+    size_t i;                                                                  \
+    memcpy(r, bench_a, sizeof(T) * n);                                         \
+    (void)b;                                                                   \
+    for (i = 0; i < n; ++i) {                                                  \
+      stmt;                                                                    \
+    }                                                                          \
+  }
+
+bench_map(b_vec2_add, vec2_t, vec2_t, vec2_add(r[i], a[i], b[i]))
+bench_map(b_vec2_sub, vec2_t, vec2_t, vec2_sub(r[i], a[i], b[i]))
+bench_map(b_vec2_scale, vec2_t, vec2_t, vec2_scale(r[i], a[i], r_half))
+bench_map(b_vec2_dot, vec2_t, real_t, r[i] = vec2_dot(a[i], b[i]))
+bench_map(b_vec2_len, vec2_t, real_t, r[i] = vec2_len(a[i]))
+bench_map(b_vec2_normalize, vec2_t, real_t,
+          r[i] = vec2_normalize(a[i], r_one))
+bench_map(b_vec2_rotate, vec2_t, vec2_t, vec2_rotate(r[i], a[i], b[i][0]))
+bench_map(b_vec3_add, vec3_t, vec3_t, vec3_add(r[i], a[i], b[i]))
+bench_map(b_vec3_sub, vec3_t, vec3_t, vec3_sub(r[i], a[i], b[i]))
+bench_map(b_vec3_mul, vec3_t, vec3_t, vec3_mul(r[i], a[i], b[i]))
+bench_map(b_vec3_scale, vec3_t, vec3_t, vec3_scale(r[i], a[i], r_half))
+bench_map(b_vec3_dot, vec3_t, real_t, r[i] = vec3_dot(a[i], b[i]))
+bench_map(b_vec3_cross, vec3_t, vec3_t, vec3_cross(r[i], a[i], b[i]))
+bench_map(b_vec3_len, vec3_t, real_t, r[i] = vec3_len(a[i]))
+bench_map(b_vec3_normalize, vec3_t, real_t,
+          r[i] = vec3_normalize(a[i], r_one))
+bench_map(b_vec3_rotate_x, vec3_t, vec3_t,
+          vec3_rotate_x(r[i], a[i], b[i][0]))
+bench_map(b_vec3_rotate_y, vec3_t, vec3_t,
+          vec3_rotate_y(r[i], a[i], b[i][0]))
+bench_map(b_vec3_rotate_z, vec3_t, vec3_t,
+          vec3_rotate_z(r[i], a[i], b[i][0]))
+bench_map(b_vec4_add, vec4_t, vec4_t, vec4_add(r[i], a[i], b[i]))
+bench_map(b_vec4_sub, vec4_t, vec4_t, vec4_sub(r[i], a[i], b[i]))
+bench_map(b_vec4_dot, vec4_t, real_t, r[i] = vec4_dot(a[i], b[i]))
+bench_map(b_vec4_normalize, vec4_t, real_t,
+          r[i] = vec4_normalize(a[i], r_one))
+
+bench_mapf(b_vec2f_normalize, vec2f_t, realf_t,
+           r[i] = vec2f_normalize(a[i], rf_one))
+bench_mapf(b_vec2f_rotate, vec2f_t, vec2f_t,
+           vec2f_rotate(r[i], a[i], b[i][0]))
+bench_mapf(b_vec3f_normalize, vec3f_t, realf_t,
+           r[i] = vec3f_normalize(a[i], rf_one))
+bench_mapf(b_vec3f_rotate_x, vec3f_t, vec3f_t,
+           vec3f_rotate_x(r[i], a[i], b[i][0]))
+bench_mapf(b_vec3f_rotate_y, vec3f_t, vec3f_t,
+           vec3f_rotate_y(r[i], a[i], b[i][0]))
+bench_mapf(b_vec3f_rotate_z, vec3f_t, vec3f_t,
+           vec3f_rotate_z(r[i], a[i], b[i][0]))
+bench_mapf(b_vec4f_normalize, vec4f_t, realf_t,
+           r[i] = vec4f_normalize(a[i], rf_one))
+
+static void b_vec2_rotate_sweep(size_t n) {
+  vec2_rotate_sweep((vec2_t *)bench_r, bench_a, r_one, r_half / 64, n);
+}
+
+static void b_vec3_rotateaxis_sweep(size_t n) {
+  vec3_rotateaxis_sweep((vec3_t *)bench_r, bench_a, bench_b, r_one,
+                        r_half / 64, n);
+}
+
+bench_map(b_mat22_mul, mat22_t, mat22_t, mat22_mul(r[i], a[i], b[i]))
+bench_map(b_mat22_inverse, mat22_t, mat22_t, mat22_inverse(r[i], a[i]))
+bench_map(b_mat22_rotation, mat22_t, mat22_t, mat22_rotation(r[i], a[i][0]))
+bench_map(b_mat33_mul, mat33_t, mat33_t, mat33_mul(r[i], a[i], b[i]))
+bench_map(b_mat33_inverse, mat33_t, mat33_t, mat33_inverse(r[i], a[i]))
+bench_map(b_mat33_transform3, mat33_t, vec3_t,
+          mat33_transform3(r[i], a[i], b[i]))
+bench_map(b_mat33_rotateaxis, mat33_t, mat33_t,
+          mat33_rotateaxis(r[i], a[i][0], b[i]))
+bench_map(b_mat44_mul, mat44_t, mat44_t, mat44_mul(r[i], a[i], b[i]))
+bench_map(b_mat44_mul_simd, mat44_t, mat44_t,
+          mat44_mul_simd(r[i], a[i], b[i]))
+bench_map(b_mat44_mul_affine, mat44_t, mat44_t,
+          mat44_mul_affine(r[i], a[i], b[i]))
+bench_map(b_mat44_inverse, mat44_t, mat44_t, mat44_inverse(r[i], a[i]))
+bench_map(b_mat44_inverse_simd, mat44_t, mat44_t,
+          mat44_inverse_simd(r[i], a[i]))
+bench_map(b_mat44_inverse_affine, mat44_t, mat44_t,
+          mat44_inverse_affine(r[i], a[i]))
+bench_map(b_mat44_inverse_rigid, mat44_t, mat44_t,
+          mat44_inverse_rigid(r[i], a[i]))
+bench_map(b_mat44_transpose, mat44_t, mat44_t, mat44_transpose(r[i], a[i]))
+bench_map(b_mat44_transpose_simd, mat44_t, mat44_t,
+          mat44_transpose_simd(r[i], a[i]))
+bench_map(b_mat44_determinant, mat44_t, real_t,
+          r[i] = mat44_determinant(a[i]))
+bench_map(b_mat44_transform3, mat44_t, vec4_t,
+          mat44_transform3(r[i], a[i], b[i]))
+bench_map(b_mat44_transform4, mat44_t, vec4_t,
+          mat44_transform4(r[i], a[i], b[i]))
+bench_map(b_mat44_rotateaxis, mat44_t, mat44_t,
+          mat44_rotateaxis(r[i], a[i][0], b[i]))
+bench_map(b_mat44_perspective, mat44_t, mat44_t,
+          mat44_perspective(r[i], 60.0, 1.5, 0.1, 100.0))
+bench_map(b_mat44_lookat, mat44_t, mat44_t,
+          mat44_lookat(r[i], a[i], b[i], a[i] + 4))
+
+bench_mapf(b_mat22f_rotation, mat22f_t, mat22f_t,
+           mat22f_rotation(r[i], a[i][0]))
+bench_mapf(b_mat33f_rotateaxis, mat33f_t, mat33f_t,
+           mat33f_rotateaxis(r[i], a[i][0], b[i]))
+bench_mapf(b_mat44f_rotateaxis, mat44f_t, mat44f_t,
+           mat44f_rotateaxis(r[i], a[i][0], b[i]))
+bench_mapf(b_mat44f_perspective, mat44f_t, mat44f_t,
+           mat44f_perspective(r[i], 60.0f, 1.5f, 0.1f, 100.0f))
+bench_mapf(b_mat44f_lookat, mat44f_t, mat44f_t,
+           mat44f_lookat(r[i], a[i], b[i], a[i] + 4))
+
+static void b_mat44_mul_batch(size_t n) {
+  mat44_mul_batch((mat44_t *)bench_r, bench_a, (const mat44_t *)bench_b, n);
+}
+
+static void b_mat44_mul_batch_right(size_t n) {
+  mat44_mul_batch_right((mat44_t *)bench_r, (const mat44_t *)bench_a, bench_b,
+                        n);
+}
+
+static void b_mat44_mul_each(size_t n) {
+  mat44_mul_each((mat44_t *)bench_r, (const mat44_t *)bench_a,
+                 (const mat44_t *)bench_b, n);
+}
+
+/* a and b reread as packed blocks, the values do not matter */
+static void b_mat44_block_pack(size_t n) {
+  mat44_block_pack((mat44_block_t *)bench_r, (const mat44_t *)bench_a, n);
+}
+
+static void b_mat44_block_unpack(size_t n) {
+  mat44_block_unpack((mat44_t *)bench_r, (const mat44_block_t *)bench_a, n);
+}
+
+static void b_mat44_block_mul(size_t n) {
+  size_t blocks = (n + mat44_block_size - 1) / mat44_block_size;
+  mat44_block_mul((mat44_block_t *)bench_r, (const mat44_block_t *)bench_a,
+                  (const mat44_block_t *)bench_b, blocks);
+}
+
+static void b_mat44_block_mul_batch(size_t n) {
+  size_t blocks = (n + mat44_block_size - 1) / mat44_block_size;
+  mat44_block_mul_batch((mat44_block_t *)bench_r, bench_a,
+                        (const mat44_block_t *)bench_b, blocks);
+}
+
+static unsigned char bench_flags[bench_max];
+
+static void b_mat33_inverse_batch(size_t n) {
+  mat33_inverse_batch((mat33_t *)bench_r, (const mat33_t *)bench_a,
+                      bench_flags, n);
+}
+
+static void b_mat44_inverse_batch(size_t n) {
+  mat44_inverse_batch((mat44_t *)bench_r, (const mat44_t *)bench_a,
+                      bench_flags, n);
+}
+
+static void b_mat44_block_inverse(size_t n) {
+  size_t blocks = (n + mat44_block_size - 1) / mat44_block_size;
+  mat44_block_inverse((mat44_block_t *)bench_r, (const mat44_block_t *)bench_a,
+                      bench_flags, blocks);
+}
+
+static void b_mat44_transform2_batch(size_t n) {
+  mat44_transform2_batch((vec2_t *)bench_r, bench_b, bench_a, n, 0);
+}
+
+static void b_mat44_transform3_batch(size_t n) {
+  mat44_transform3_batch((vec3_t *)bench_r, bench_b, bench_a, n, 0);
+}
+
+static void b_mat44_transform4_batch(size_t n) {
+  mat44_transform4_batch((vec4_t *)bench_r, bench_b, bench_a, n, 0);
+}
+
+bench_map(b_quat_mul, quat_t, quat_t, quat_mul(r[i], a[i], b[i]))
+bench_map(b_quat_normalize, quat_t, real_t,
+          r[i] = quat_normalize(a[i], r_one))
+bench_map(b_quat_slerp, quat_t, quat_t,
+          quat_slerp(r[i], a[i], b[i], r_half))
+bench_map(b_quat_slerp_fast, quat_t, quat_t,
+          quat_slerp_fast(r[i], a[i], b[i], r_half))
+bench_map(b_quat_rotate, quat_t, vec3_t, quat_rotate(r[i], a[i], b[i]))
+
+static void b_quat_rotate_array(size_t n) {
+  quat_rotate_array((vec3_t *)bench_r, bench_a, (const vec3_t *)bench_b, n);
+}
+
+bench_map(b_quat_tomatrix, quat_t, mat33_t, quat_tomatrix(r[i], a[i]))
+bench_map(b_quat_toeuler, quat_t, vec3_t, quat_toeuler(r[i], a[i]))
+bench_map(b_quat_fromeuler, vec3_t, quat_t, quat_fromeuler(r[i], a[i]))
+bench_map(b_quat_fromangleaxis, vec3_t, quat_t,
+          quat_fromangleaxis(r[i], a[i], b[i][0]))
+
+static void b_quat_slerp_array(size_t n) {
+  quat_slerp_array((quat_t *)bench_r, (quat_t *)bench_a, (quat_t *)bench_b,
+                   bench_a, n);
+}
+
+static void b_quat_slerp_fast_array(size_t n) {
+  quat_slerp_fast_array((quat_t *)bench_r, (quat_t *)bench_a,
+                        (quat_t *)bench_b, bench_a, n);
+}
+
+bench_mapf(b_quatf_normalize, quatf_t, realf_t,
+           r[i] = quatf_normalize(a[i], rf_one))
+bench_mapf(b_quatf_slerp, quatf_t, quatf_t,
+           quatf_slerp(r[i], a[i], b[i], rf_half))
+bench_mapf(b_quatf_rotate, quatf_t, vec3f_t, quatf_rotate(r[i], a[i], b[i]))
+bench_mapf(b_quatf_tomatrix, quatf_t, mat33f_t, quatf_tomatrix(r[i], a[i]))
+bench_mapf(b_quatf_toeuler, quatf_t, vec3f_t, quatf_toeuler(r[i], a[i]))
+bench_mapf(b_quatf_fromeuler, vec3f_t, quatf_t, quatf_fromeuler(r[i], a[i]))
+bench_mapf(b_quatf_fromangleaxis, vec3f_t, quatf_t,
+           quatf_fromangleaxis(r[i], a[i], b[i][0]))
+
+/* the *_i forms, and the *_inplace forms on a fresh copy of a */
+bench_map(b_vec3_cross_i, vec3_t, vec3_t, vec3_cross_i(r[i], a[i], b[i]))
+bench_inplace(b_vec3_cross_inplace, vec3_t, vec3_t,
+              vec3_cross_inplace(r[i], b[i]))
+bench_map(b_mat22_mul_i, mat22_t, mat22_t, mat22_mul_i(r[i], a[i], b[i]))
+bench_map(b_mat22_inverse_i, mat22_t, mat22_t, mat22_inverse_i(r[i], a[i]))
+bench_map(b_mat22_transpose_i, mat22_t, mat22_t,
+          mat22_transpose_i(r[i], a[i]))
+bench_map(b_mat22_transform2_i, mat22_t, vec2_t,
+          mat22_transform2_i(r[i], a[i], b[i]))
+bench_inplace(b_mat22_mul_inplace, mat22_t, mat22_t,
+              mat22_mul_inplace(r[i], b[i]))
+bench_inplace(b_mat22_premul_inplace, mat22_t, mat22_t,
+              mat22_premul_inplace(b[i], r[i]))
+bench_inplace(b_mat22_inverse_inplace, mat22_t, mat22_t,
+              mat22_inverse_inplace(r[i]))
+bench_inplace(b_mat22_transpose_inplace, mat22_t, mat22_t,
+              mat22_transpose_inplace(r[i]))
+bench_inplace(b_mat22_transform2_inplace, vec2_t, mat22_t,
+              mat22_transform2_inplace(r[i], b[i]))
+bench_map(b_mat33_mul_i, mat33_t, mat33_t, mat33_mul_i(r[i], a[i], b[i]))
+bench_map(b_mat33_inverse_i, mat33_t, mat33_t, mat33_inverse_i(r[i], a[i]))
+bench_map(b_mat33_transpose_i, mat33_t, mat33_t,
+          mat33_transpose_i(r[i], a[i]))
+bench_map(b_mat33_transform3_i, mat33_t, vec3_t,
+          mat33_transform3_i(r[i], a[i], b[i]))
+bench_inplace(b_mat33_mul_inplace, mat33_t, mat33_t,
+              mat33_mul_inplace(r[i], b[i]))
+bench_inplace(b_mat33_premul_inplace, mat33_t, mat33_t,
+              mat33_premul_inplace(b[i], r[i]))
+bench_inplace(b_mat33_inverse_inplace, mat33_t, mat33_t,
+              mat33_inverse_inplace(r[i]))
+bench_inplace(b_mat33_transpose_inplace, mat33_t, mat33_t,
+              mat33_transpose_inplace(r[i]))
+bench_inplace(b_mat33_transform3_inplace, vec3_t, mat33_t,
+              mat33_transform3_inplace(r[i], b[i]))
+bench_map(b_mat44_mul_i, mat44_t, mat44_t, mat44_mul_i(r[i], a[i], b[i]))
+bench_map(b_mat44_inverse_i, mat44_t, mat44_t, mat44_inverse_i(r[i], a[i]))
+bench_map(b_mat44_transpose_i, mat44_t, mat44_t,
+          mat44_transpose_i(r[i], a[i]))
+bench_map(b_mat44_transform3_i, mat44_t, vec3_t,
+          mat44_transform3_i(r[i], a[i], b[i]))
+bench_map(b_mat44_transform4_i, mat44_t, vec4_t,
+          mat44_transform4_i(r[i], a[i], b[i]))
+bench_inplace(b_mat44_mul_inplace, mat44_t, mat44_t,
+              mat44_mul_inplace(r[i], b[i]))
+bench_inplace(b_mat44_premul_inplace, mat44_t, mat44_t,
+              mat44_premul_inplace(b[i], r[i]))
+bench_inplace(b_mat44_inverse_inplace, mat44_t, mat44_t,
+              mat44_inverse_inplace(r[i]))
+bench_inplace(b_mat44_transpose_inplace, mat44_t, mat44_t,
+              mat44_transpose_inplace(r[i]))
+bench_inplace(b_mat44_transform3_inplace, vec3_t, mat44_t,
+              mat44_transform3_inplace(r[i], b[i]))
+bench_inplace(b_mat44_transform4_inplace, vec4_t, mat44_t,
+              mat44_transform4_inplace(r[i], b[i]))
+bench_map(b_quat_mul_i, quat_t, quat_t, quat_mul_i(r[i], a[i], b[i]))
+bench_inplace(b_quat_mul_inplace, quat_t, quat_t,
+              quat_mul_inplace(r[i], b[i]))
+bench_inplace(b_quat_premul_inplace, quat_t, quat_t,
+              quat_premul_inplace(b[i], r[i]))
+
+bench_map(b_r_sincos, real_t, real_t, r_sincos(a[i], r + i, b + i))
+
+/* both precisions in every build, cos written n values after sin */
+bench_map(b_math_sincos, real_t, double,
+          math_sincos(a[i], r + i, r + n + i))
+bench_map(b_math_sincosf, real_t, float,
+          math_sincosf((float)a[i], r + i, r + n + i))
+bench_map(b_libm_sincos, real_t, real_t,
+          (r[i] = r_sin(a[i]), b[i] = r_cos(a[i])))
+bench_map(b_libm_atan2, real_t, real_t, r[i] = r_atan2(a[i], b[i]))
+bench_map(b_libm_acos, real_t, real_t, r[i] = r_acos(a[i]))
+
+static void b_sin_precise(size_t n) {
+  math_sin_array(bench_r, bench_a, n, MATH_PRECISE);
+}
+
+static void b_sin_fast(size_t n) {
+  math_sin_array(bench_r, bench_a, n, MATH_FAST);
+}
+
+static void b_cos_precise(size_t n) {
+  math_cos_array(bench_r, bench_a, n, MATH_PRECISE);
+}
+
+static void b_cos_fast(size_t n) {
+  math_cos_array(bench_r, bench_a, n, MATH_FAST);
+}
+
+static void b_sincos_precise(size_t n) {
+  math_sincos_array(bench_r, bench_b, bench_a, n, MATH_PRECISE);
+}
+
+static void b_sincos_fast(size_t n) {
+  math_sincos_array(bench_r, bench_b, bench_a, n, MATH_FAST);
+}
+
+static void b_atan2_precise(size_t n) {
+  math_atan2_array(bench_r, bench_a, bench_b, n, MATH_PRECISE);
+}
+
+static void b_atan2_fast(size_t n) {
+  math_atan2_array(bench_r, bench_a, bench_b, n, MATH_FAST);
+}
+
+static void b_acos_precise(size_t n) {
+  math_acos_array(bench_r, bench_a, n, MATH_PRECISE);
+}
+
+static void b_acos_fast(size_t n) {
+  math_acos_array(bench_r, bench_a, n, MATH_FAST);
+}
+
+/* SoA views over the three buffers */
+static vec3s_t bench_soa(real_t *p, size_t n) {
+  vec3s_t s;
+  s.x = p, s.y = p + n, s.z = p + n * 2;
+  return s;
+}
+
+static vec2s_t bench_soa2(real_t *p, size_t n) {
+  vec2s_t s;
+  s.x = p, s.y = p + n;
+  return s;
+}
+
+static vec4s_t bench_soa4(real_t *p, size_t n) {
+  vec4s_t s;
+  s.x = p, s.y = p + n, s.z = p + n * 2, s.w = p + n * 3;
+  return s;
+}
+
+static void b_vec2s_add(size_t n) {
+  vec2s_t a = bench_soa2(bench_a, n), b = bench_soa2(bench_b, n);
+  vec2s_t r = bench_soa2(bench_r, n);
+  vec2s_add(&r, &a, &b, n);
+}
+
+static void b_vec2s_sub(size_t n) {
+  vec2s_t a = bench_soa2(bench_a, n), b = bench_soa2(bench_b, n);
+  vec2s_t r = bench_soa2(bench_r, n);
+  vec2s_sub(&r, &a, &b, n);
+}
+
+static void b_vec2s_mul(size_t n) {
+  vec2s_t a = bench_soa2(bench_a, n), b = bench_soa2(bench_b, n);
+  vec2s_t r = bench_soa2(bench_r, n);
+  vec2s_mul(&r, &a, &b, n);
+}
+
+static void b_vec2s_scale(size_t n) {
+  vec2s_t a = bench_soa2(bench_a, n), r = bench_soa2(bench_r, n);
+  vec2s_scale(&r, &a, r_half, n);
+}
+
+static void b_vec2s_dot(size_t n) {
+  vec2s_t a = bench_soa2(bench_a, n), b = bench_soa2(bench_b, n);
+  vec2s_dot(bench_r, &a, &b, n);
+}
+
+static void b_vec2s_lensq(size_t n) {
+  vec2s_t a = bench_soa2(bench_a, n);
+  vec2s_lensq(bench_r, &a, n);
+}
+
+static void b_vec2s_normalize(size_t n) {
+  vec2s_t r = bench_soa2(bench_r, n);
+  memcpy(bench_r, bench_a, sizeof(real_t) * n * 2);
+  vec2s_normalize(NULL, &r, r_one, n);
+}
+
+static void b_vec2s_from_aos(size_t n) {
+  vec2s_t r = bench_soa2(bench_r, n);
+  vec2s_from_aos(&r, (const vec2_t *)bench_a, n);
+}
+
+static void b_vec2s_to_aos(size_t n) {
+  vec2s_t a = bench_soa2(bench_a, n);
+  vec2s_to_aos((vec2_t *)bench_r, &a, n);
+}
+
+static void b_vec3s_add(size_t n) {
+  vec3s_t a = bench_soa(bench_a, n), b = bench_soa(bench_b, n);
+  vec3s_t r = bench_soa(bench_r, n);
+  vec3s_add(&r, &a, &b, n);
+}
+
+static void b_vec3s_sub(size_t n) {
+  vec3s_t a = bench_soa(bench_a, n), b = bench_soa(bench_b, n);
+  vec3s_t r = bench_soa(bench_r, n);
+  vec3s_sub(&r, &a, &b, n);
+}
+
+static void b_vec3s_mul(size_t n) {
+  vec3s_t a = bench_soa(bench_a, n), b = bench_soa(bench_b, n);
+  vec3s_t r = bench_soa(bench_r, n);
+  vec3s_mul(&r, &a, &b, n);
+}
+
+static void b_vec3s_scale(size_t n) {
+  vec3s_t a = bench_soa(bench_a, n), r = bench_soa(bench_r, n);
+  vec3s_scale(&r, &a, r_half, n);
+}
+
+static void b_vec3s_dot(size_t n) {
+  vec3s_t a = bench_soa(bench_a, n), b = bench_soa(bench_b, n);
+  vec3s_dot(bench_r, &a, &b, n);
+}
+
+static void b_vec3s_lensq(size_t n) {
+  vec3s_t a = bench_soa(bench_a, n);
+  vec3s_lensq(bench_r, &a, n);
+}
+
+static void b_vec3s_cross(size_t n) {
+  vec3s_t a = bench_soa(bench_a, n), b = bench_soa(bench_b, n);
+  vec3s_t r = bench_soa(bench_r, n);
+  vec3s_cross(&r, &a, &b, n);
+}
+
+static void b_vec3s_normalize(size_t n) {
+  vec3s_t a = bench_soa(bench_a, n), r = bench_soa(bench_r, n);
+  memcpy(bench_r, bench_a, sizeof(real_t) * n * 3);
+  vec3s_normalize(NULL, &r, r_one, n);
+  (void)a;
+}
+
+static void b_vec3s_from_aos(size_t n) {
+  vec3s_t r = bench_soa(bench_r, n);
+  vec3s_from_aos(&r, (const vec3_t *)bench_a, n);
+}
+
+static void b_vec3s_to_aos(size_t n) {
+  vec3s_t a = bench_soa(bench_a, n);
+  vec3s_to_aos((vec3_t *)bench_r, &a, n);
+}
+
+static void b_vec4s_add(size_t n) {
+  vec4s_t a = bench_soa4(bench_a, n), b = bench_soa4(bench_b, n);
+  vec4s_t r = bench_soa4(bench_r, n);
+  vec4s_add(&r, &a, &b, n);
+}
+
+static void b_vec4s_sub(size_t n) {
+  vec4s_t a = bench_soa4(bench_a, n), b = bench_soa4(bench_b, n);
+  vec4s_t r = bench_soa4(bench_r, n);
+  vec4s_sub(&r, &a, &b, n);
+}
+
+static void b_vec4s_mul(size_t n) {
+  vec4s_t a = bench_soa4(bench_a, n), b = bench_soa4(bench_b, n);
+  vec4s_t r = bench_soa4(bench_r, n);
+  vec4s_mul(&r, &a, &b, n);
+}
+
+static void b_vec4s_scale(size_t n) {
+  vec4s_t a = bench_soa4(bench_a, n), r = bench_soa4(bench_r, n);
+  vec4s_scale(&r, &a, r_half, n);
+}
+
+static void b_vec4s_dot(size_t n) {
+  vec4s_t a = bench_soa4(bench_a, n), b = bench_soa4(bench_b, n);
+  vec4s_dot(bench_r, &a, &b, n);
+}
+
+static void b_vec4s_lensq(size_t n) {
+  vec4s_t a = bench_soa4(bench_a, n);
+  vec4s_lensq(bench_r, &a, n);
+}
+
+static void b_vec4s_normalize(size_t n) {
+  vec4s_t r = bench_soa4(bench_r, n);
+  memcpy(bench_r, bench_a, sizeof(real_t) * n * 4);
+  vec4s_normalize(NULL, &r, r_one, n);
+}
+
+static void b_vec4s_from_aos(size_t n) {
+  vec4s_t r = bench_soa4(bench_r, n);
+  vec4s_from_aos(&r, (const vec4_t *)bench_a, n);
+}
+
+static void b_vec4s_to_aos(size_t n) {
+  vec4s_t a = bench_soa4(bench_a, n);
+  vec4s_to_aos((vec4_t *)bench_r, &a, n);
+}
+
+/**
+ *---------------------------------------------
+ *  Structures
+ *---------------------------------------------
+ **/
+
+static transform_t *bench_transforms;
+
+static int s_transform(size_t n) {
+  size_t i;
+
+  bench_transforms = (transform_t *)malloc(sizeof(transform_t) * n * 2);
+  if (!bench_transforms)
+    return -1;
+  for (i = 0; i < n * 2; ++i)
+    transform_rotateaxis(bench_transforms + i, bench_a[i], bench_b + i * 3);
+  return 0;
+}
+
+static void t_transform(void) { free(bench_transforms); }
+
+static void b_transform_mul(size_t n) {
+  size_t i;
+  for (i = 0; i < n; ++i)
+    transform_mul(bench_transforms + i, bench_transforms + i,
+                  bench_transforms + n + i);
+}
+
+static void b_transform_inverse(size_t n) {
+  size_t i;
+  for (i = 0; i < n; ++i)
+    transform_inverse(bench_transforms + n + i, bench_transforms + i);
+}
+
+static void b_transform_point(size_t n) {
+  size_t i;
+  for (i = 0; i < n; ++i)
+    transform_point(bench_r + i * 3, bench_transforms + i, bench_a + i * 3);
+}
+
+static void b_transform_vector(size_t n) {
+  size_t i;
+  for (i = 0; i < n; ++i)
+    transform_vector(bench_r + i * 3, bench_transforms + i, bench_a + i * 3);
+}
+
+/* on the rigid matrices of s_transform, which take every test */
+static void b_mat44_classify(size_t n) {
+  transform_kind_t *r = (transform_kind_t *)bench_r;
+  size_t i;
+  for (i = 0; i < n; ++i)
+    r[i] = mat44_classify(bench_transforms[i].m);
+}
+
+static void b_aabb_transform(size_t n) {
+  size_t i;
+  for (i = 0; i < n; ++i)
+    aabb_transform((aabb_t *)bench_r + i, bench_b, (aabb_t *)bench_a + i);
+}
+
+static void b_aabb_transform_batch(size_t n) {
+  aabb_transform_batch((aabb_t *)bench_r, bench_b, (aabb_t *)bench_a, n);
+}
+
+static void b_aabb_transform_each(size_t n) {
+  aabb_transform_each((aabb_t *)bench_r, (mat44_t *)bench_b,
+                      (aabb_t *)bench_a, n);
+}
+
+static frustum_t bench_frustum;
+
+static int s_frustum(size_t n) {
+  mat44_t p;
+  (void)n;
+  mat44_perspective(p, 60.0, 1.5, 0.1, 2.0);
+  frustum_extract(&bench_frustum, p);
+  return 0;
+}
+
+static void b_frustum_spheres(size_t n) {
+  vec3s_t c = bench_soa(bench_a, n);
+  frustum_cull_spheres((unsigned char *)bench_r, &bench_frustum, &c, bench_b,
+                       n);
+}
+
+static void b_frustum_aabbs(size_t n) {
+  vec3s_t c = bench_soa(bench_a, n), e = bench_soa(bench_b, n);
+  frustum_cull_aabbs((unsigned char *)bench_r, &bench_frustum, &c, &e, n);
+}
+
+static hierarchy_t bench_hierarchy;
+
+static int s_hierarchy(size_t n) {
+  size_t i;
+
+  if (hierarchy_alloc(&bench_hierarchy, n) != 0)
+    return -1;
+  for (i = 0; i < n; ++i)
+    hierarchy_add(&bench_hierarchy, i ? (int)((i - 1) / 4) : -1);
+  return 0;
+}
+
+static void t_hierarchy(void) { hierarchy_free(&bench_hierarchy); }
+
+static void b_hierarchy_update(size_t n) {
+  (void)n;
+  hierarchy_set_translation(&bench_hierarchy, 0, bench_a);
+  hierarchy_update(&bench_hierarchy);
+}
+
+static bvh_t bench_bvh;
+static real_t *bench_vertices, *bench_rays;
+
+/* small triangles scattered in the unit cube, rays from z = -4 */
+static int s_bvh(size_t n) {
+  size_t i, j;
+
+  /* 3n vertices followed by n ray directions, aimed at the cube */
+  bench_vertices = (real_t *)malloc(sizeof(vec3_t) * n * 4);
+  if (!bench_vertices)
+    return -1;
+  for (i = 0; i < n; ++i)
+    for (j = 0; j < 9; ++j)
+      bench_vertices[i * 9 + j] =
+          bench_a[i * 3 + j % 3] + bench_b[i * 9 + j] / 32;
+  bench_rays = bench_vertices + n * 9;
+  for (i = 0; i < n; ++i) {
+    bench_rays[i * 3 + 0] = bench_b[i * 3 + 0];
+    bench_rays[i * 3 + 1] = bench_b[i * 3 + 1];
+    bench_rays[i * 3 + 2] = (real_t)4.0;
+  }
+
+  if (bvh_build(&bench_bvh, (const vec3_t *)bench_vertices, n) != 0) {
+    free(bench_vertices);
+    return -1;
+  }
+  return 0;
+}
+
+static void t_bvh(void) {
+  bvh_free(&bench_bvh);
+  free(bench_vertices);
+}
+
+static void b_bvh_build(size_t n) {
+  bvh_t b;
+  if (bvh_build(&b, (const vec3_t *)bench_vertices, n) == 0)
+    bvh_free(&b);
+}
+
+static void b_bvh_intersect(size_t n) {
+  vec3_t o = {0.0, 0.0, -4.0};
+  size_t i;
+  for (i = 0; i < n; ++i)
+    bvh_intersect(&bench_bvh, o, bench_rays + i * 3, 100.0, NULL);
+}
+
+static void b_bvh_occluded(size_t n) {
+  vec3_t o = {0.0, 0.0, -4.0};
+  size_t i;
+  for (i = 0; i < n; ++i)
+    bench_r[i] = (real_t)bvh_occluded(&bench_bvh, o, bench_rays + i * 3, 100.0);
+}
+
+static void b_bvh_refit(size_t n) {
+  (void)n;
+  bvh_refit(&bench_bvh);
+}
+
+static void b_bvh_intersect_packet(size_t n) {
+  vec3s_t o = bench_soa(bench_r, n), d = bench_soa(bench_r + n * 3, n);
+  int *tri = (int *)(bench_r + n * 7);
+  size_t i;
+
+  for (i = 0; i < n; ++i) {
+    o.x[i] = o.y[i] = r_zero, o.z[i] = -4.0;
+    d.x[i] = bench_rays[i * 3 + 0];
+    d.y[i] = bench_rays[i * 3 + 1];
+    d.z[i] = bench_rays[i * 3 + 2];
+    bench_r[n * 6 + i] = 100.0;
+  }
+  bvh_intersect_packet(&bench_bvh, &o, &d, bench_r + n * 6, tri, n);
+}
+
+static kdtree_t bench_kdtree;
+
+static int s_kdtree(size_t n) {
+  return kdtree_build(&bench_kdtree, (const vec3_t *)bench_a, n);
+}
+
+static void t_kdtree(void) { kdtree_free(&bench_kdtree); }
+
+static void b_kdtree_build(size_t n) {
+  kdtree_t t;
+  if (kdtree_build(&t, (const vec3_t *)bench_a, n) == 0)
+    kdtree_free(&t);
+}
+
+static void b_kdtree_knn(size_t n) {
+  const vec3_t *p = (const vec3_t *)bench_b;
+  unsigned int *index = (unsigned int *)bench_r;
+  size_t i;
+
+  for (i = 0; i < n; ++i)
+    kdtree_knn(&bench_kdtree, p[i], 4, index + i * 4, NULL);
+}
+
+static void b_kdtree_knn_batch(size_t n) {
+  kdtree_knn_batch(&bench_kdtree, (const vec3_t *)bench_b, n, 4,
+                   (unsigned int *)bench_r, NULL);
+}
+
+/* about 8 neighbours at bench_max points in the [-1, 1) cube */
+#define bench_radius ((real_t)0.05)
+#define bench_found 8
+
+static void b_kdtree_radius(size_t n) {
+  const vec3_t *p = (const vec3_t *)bench_b;
+  unsigned int *index = (unsigned int *)bench_r;
+  size_t i;
+
+  for (i = 0; i < n; ++i)
+    kdtree_radius(&bench_kdtree, p[i], bench_radius, index + i * bench_found,
+                  NULL, bench_found);
+}
+
+static void b_kdtree_radius_batch(size_t n) {
+  unsigned int *index = (unsigned int *)bench_r;
+
+  kdtree_radius_batch(&bench_kdtree, (const vec3_t *)bench_b, n, bench_radius,
+                      index, NULL, bench_found,
+                      (size_t *)(index + n * bench_found));
+}
+
+/* size n runs a side x side product with side = sqrt(n) */
+static matn_t bench_ma, bench_mb, bench_mr;
+
+static void t_matn(void) {
+  matn_free(&bench_ma);
+  matn_free(&bench_mb);
+  matn_free(&bench_mr);
+}
+
+static int s_matn(size_t n) {
+  size_t side = 1, i, j;
+
+  while ((side + 1) * (side + 1) <= n)
+    ++side;
+  if (matn_alloc(&bench_ma, side, side) || matn_alloc(&bench_mb, side, side) ||
+      matn_alloc(&bench_mr, side, side)) {
+    t_matn();
+    return -1;
+  }
+  for (j = 0; j < side; ++j)
+    for (i = 0; i < side; ++i) {
+      matn_at(&bench_ma, i, j) = bench_a[j * side + i];
+      matn_at(&bench_mb, i, j) = bench_b[j * side + i];
+    }
+  return 0;
+}
+
+static void b_matn_mul(size_t n) {
+  (void)n;
+  matn_mul(&bench_mr, &bench_ma, &bench_mb);
+}
+
+/* textbook i-j-p loop, the baseline matn_gemm is measured against */
+static void b_matn_mul_naive(size_t n) {
+  size_t i, j, p, side = bench_mr.rows;
+
+  (void)n;
+  for (i = 0; i < side; ++i)
+    for (j = 0; j < side; ++j) {
+      real_t s = r_zero;
+      for (p = 0; p < side; ++p)
+        s += matn_at(&bench_ma, i, p) * matn_at(&bench_mb, p, j);
+      matn_at(&bench_mr, i, j) = s;
+    }
+}
+
+static void b_matn_transpose(size_t n) {
+  (void)n;
+  matn_transpose(&bench_mr, &bench_ma);
+}
+
+/* factorizations copy bench_ma first, the sides stay below 512 */
+static size_t bench_piv[512];
+static real_t bench_tau[512];
+
+/* bench_ma made symmetric and diagonally dominant, so positive definite */
+static int s_matn_spd(size_t n) {
+  size_t i, j;
+
+  if (s_matn(n) != 0)
+    return -1;
+  for (j = 0; j < bench_ma.cols; ++j) {
+    for (i = 0; i < j; ++i)
+      matn_at(&bench_ma, i, j) = matn_at(&bench_ma, j, i);
+    matn_at(&bench_ma, j, j) += (real_t)bench_ma.cols;
+  }
+  return 0;
+}
+
+/* the solves reuse bench_ma factored once, untimed */
+static int s_matn_lu(size_t n) {
+  if (s_matn(n) != 0)
+    return -1;
+  matn_lu(&bench_ma, bench_piv);
+  return 0;
+}
+
+static int s_matn_qr(size_t n) {
+  if (s_matn(n) != 0)
+    return -1;
+  matn_qr(&bench_ma, bench_tau);
+  return 0;
+}
+
+static int s_matn_cholesky(size_t n) {
+  if (s_matn_spd(n) != 0)
+    return -1;
+  matn_cholesky(&bench_ma);
+  return 0;
+}
+
+static void b_matn_lu(size_t n) {
+  (void)n;
+  matn_copy(&bench_mr, &bench_ma);
+  matn_lu(&bench_mr, bench_piv);
+}
+
+static void b_matn_qr(size_t n) {
+  (void)n;
+  matn_copy(&bench_mr, &bench_ma);
+  matn_qr(&bench_mr, bench_r);
+}
+
+static void b_matn_cholesky(size_t n) {
+  (void)n;
+  matn_copy(&bench_mr, &bench_ma);
+  matn_cholesky(&bench_mr);
+}
+
+/* side right-hand sides, copied from bench_mb */
+static void b_matn_lu_solve(size_t n) {
+  (void)n;
+  matn_copy(&bench_mr, &bench_mb);
+  matn_lu_solve(&bench_ma, bench_piv, &bench_mr);
+}
+
+static void b_matn_qr_solve(size_t n) {
+  (void)n;
+  matn_copy(&bench_mr, &bench_mb);
+  matn_qr_solve(&bench_ma, bench_tau, &bench_mr);
+}
+
+static void b_matn_cholesky_solve(size_t n) {
+  (void)n;
+  matn_copy(&bench_mr, &bench_mb);
+  matn_cholesky_solve(&bench_ma, &bench_mr);
+}
+
+/* bench_a packed once, wide enough for every form */
+static quat64_t bench_packed[bench_max];
+
+static int s_pack(size_t n) {
+  quat_pack32_array((quat32_t *)bench_packed, (const quat_t *)bench_a, n);
+  return 0;
+}
+
+static int s_pack48(size_t n) {
+  quat_pack48_array((quat48_t *)bench_packed, (const quat_t *)bench_a, n);
+  return 0;
+}
+
+static int s_pack64(size_t n) {
+  quat_pack64_array(bench_packed, (const quat_t *)bench_a, n);
+  return 0;
+}
+
+bench_map(b_quat_pack32, quat_t, quat32_t, r[i] = quat_pack32(a[i]))
+bench_map(b_quat_pack48, quat_t, quat48_t, r[i] = quat_pack48(a[i]))
+bench_map(b_quat_pack64, quat_t, quat64_t, r[i] = quat_pack64(a[i]))
+bench_map(b_vec3_pack16, vec3_t, oct16_t, r[i] = vec3_pack16(a[i]))
+bench_map(b_vec3_pack24, vec3_t, oct24_t, r[i] = vec3_pack24(a[i]))
+bench_map(b_vec3_pack32, vec3_t, oct32_t, r[i] = vec3_pack32(a[i]))
+
+static void b_quat_pack32_array(size_t n) {
+  quat_pack32_array((quat32_t *)bench_r, (const quat_t *)bench_a, n);
+}
+
+static void b_quat_unpack32(size_t n) {
+  const quat32_t *p = (const quat32_t *)bench_packed;
+  quat_t *r = (quat_t *)bench_r;
+  size_t i;
+
+  for (i = 0; i < n; ++i)
+    quat_unpack32(r[i], p[i]);
+}
+
+static void b_quat_pack48_array(size_t n) {
+  quat_pack48_array((quat48_t *)bench_r, (const quat_t *)bench_a, n);
+}
+
+static void b_quat_pack64_array(size_t n) {
+  quat_pack64_array((quat64_t *)bench_r, (const quat_t *)bench_a, n);
+}
+
+static void b_quat_unpack48(size_t n) {
+  const quat48_t *p = (const quat48_t *)bench_packed;
+  quat_t *r = (quat_t *)bench_r;
+  size_t i;
+
+  for (i = 0; i < n; ++i)
+    quat_unpack48(r[i], p[i]);
+}
+
+static void b_quat_unpack64(size_t n) {
+  quat_t *r = (quat_t *)bench_r;
+  size_t i;
+
+  for (i = 0; i < n; ++i)
+    quat_unpack64(r[i], bench_packed[i]);
+}
+
+static void b_quat_unpack32_array(size_t n) {
+  quat_unpack32_array((quat_t *)bench_r, (const quat32_t *)bench_packed, n);
+}
+
+static void b_quat_unpack48_array(size_t n) {
+  quat_unpack48_array((quat_t *)bench_r, (const quat48_t *)bench_packed, n);
+}
+
+static void b_quat_unpack64_array(size_t n) {
+  quat_unpack64_array((quat_t *)bench_r, bench_packed, n);
+}
+
+static int s_oct16(size_t n) {
+  vec3_pack16_array((oct16_t *)bench_packed, (const vec3_t *)bench_a, n);
+  return 0;
+}
+
+static int s_oct24(size_t n) {
+  vec3_pack24_array((oct24_t *)bench_packed, (const vec3_t *)bench_a, n);
+  return 0;
+}
+
+static int s_oct32(size_t n) {
+  vec3_pack32_array((oct32_t *)bench_packed, (const vec3_t *)bench_a, n);
+  return 0;
+}
+
+static void b_vec3_pack16_array(size_t n) {
+  vec3_pack16_array((oct16_t *)bench_r, (const vec3_t *)bench_a, n);
+}
+
+static void b_vec3_unpack16(size_t n) {
+  const oct16_t *p = (const oct16_t *)bench_packed;
+  vec3_t *r = (vec3_t *)bench_r;
+  size_t i;
+
+  for (i = 0; i < n; ++i)
+    vec3_unpack16(r[i], p[i]);
+}
+
+static void b_vec3_pack24_array(size_t n) {
+  vec3_pack24_array((oct24_t *)bench_r, (const vec3_t *)bench_a, n);
+}
+
+static void b_vec3_pack32_array(size_t n) {
+  vec3_pack32_array((oct32_t *)bench_r, (const vec3_t *)bench_a, n);
+}
+
+static void b_vec3_unpack24(size_t n) {
+  const oct24_t *p = (const oct24_t *)bench_packed;
+  vec3_t *r = (vec3_t *)bench_r;
+  size_t i;
+
+  for (i = 0; i < n; ++i)
+    vec3_unpack24(r[i], p[i]);
+}
+
+static void b_vec3_unpack32(size_t n) {
+  const oct32_t *p = (const oct32_t *)bench_packed;
+  vec3_t *r = (vec3_t *)bench_r;
+  size_t i;
+
+  for (i = 0; i < n; ++i)
+    vec3_unpack32(r[i], p[i]);
+}
+
+static void b_vec3_unpack16_array(size_t n) {
+  vec3_unpack16_array((vec3_t *)bench_r, (const oct16_t *)bench_packed, n);
+}
+
+static void b_vec3_unpack24_array(size_t n) {
+  vec3_unpack24_array((vec3_t *)bench_r, (const oct24_t *)bench_packed, n);
+}
+
+static void b_vec3_unpack32_array(size_t n) {
+  vec3_unpack32_array((vec3_t *)bench_r, (const oct32_t *)bench_packed, n);
+}
+
+/* n matrices of bench_a on disk, loaded per run */
+static const char *bench_mapfile = "bench_mapfile.bin";
+
+static int s_mapfile(size_t n) {
+  mapfile_array_t a;
+
+  a.name = "world", a.type = MAPFILE_MAT44;
+  a.data = bench_a, a.count = n;
+  return mapfile_write(bench_mapfile, &a, 1) ? -1 : 0;
+}
+
+static void t_mapfile(void) { remove(bench_mapfile); }
+
+/* every element read once, so both loaders pay for the whole payload */
+static real_t mapfile_sum(const mat44_t *e, size_t n) {
+  real_t sum = r_zero;
+  size_t i;
+  int k;
+
+  for (i = 0; i < n; ++i)
+    for (k = 0; k < 16; ++k)
+      sum += e[i][k];
+  return sum;
+}
+
+static void b_mapfile_open(size_t n) {
+  const mat44_t *e;
+  size_t count = 0;
+  mapfile_t f;
+
+  if (mapfile_open(&f, bench_mapfile) != 0)
+    return;
+  e = mapfile_mat44(&f, "world", &count);
+  if (e)
+    bench_r[0] = mapfile_sum(e, count < n ? count : n);
+  mapfile_close(&f);
+}
+
+/* the same file read element by element */
+static void b_mapfile_read_naive(size_t n) {
+  mat44_t *r = (mat44_t *)bench_r;
+  FILE *fp = fopen(bench_mapfile, "rb");
+  size_t i;
+
+  if (!fp)
+    return;
+  fseek(fp, mapfile_alignment * 2, SEEK_SET);
+  for (i = 0; i < n; ++i)
+    if (fread(r[i], sizeof(mat44_t), 1, fp) != 1)
+      break;
+  fclose(fp);
+  r[0][0] = mapfile_sum((const mat44_t *)r, i);
+}
+
+#define bench_bones 64
+
+static skin_t bench_skin;
+static mat44_t bench_palette[bench_bones];
+static dualquat_t bench_dualquats[bench_bones];
+
+static int s_bones(size_t n) {
+  size_t i;
+
+  (void)n;
+  for (i = 0; i < bench_bones; ++i) {
+    quat_t q;
+    quat_fromangleaxis(q, bench_b + i * 3, bench_a[i]);
+    dualquat_set(&bench_dualquats[i], q, bench_a + i * 3);
+    mat44_rotateaxis(bench_palette[i], bench_a[i], bench_b + i * 3);
+  }
+  return 0;
+}
+
+/* 4 influences per vertex over a 64 bone palette */
+static int s_skin(size_t n) {
+  unsigned short *bones;
+  real_t *weights;
+  size_t i;
+
+  bones = (unsigned short *)malloc(sizeof(unsigned short) * n * 4);
+  weights = (real_t *)malloc(sizeof(real_t) * n * 4);
+  if (!bones || !weights) {
+    free(bones);
+    free(weights);
+    return -1;
+  }
+  for (i = 0; i < n * 4; ++i) {
+    bones[i] = (unsigned short)((i * 7 + i / 4) % bench_bones);
+    weights[i] = (real_t)0.25;
+  }
+  s_bones(n);
+
+  bench_skin.position = (const vec3_t *)bench_a;
+  bench_skin.normal = (const vec3_t *)bench_b;
+  bench_skin.bones = bones, bench_skin.weights = weights;
+  bench_skin.influences = 4;
+  return 0;
+}
+
+static void t_skin(void) {
+  free((void *)bench_skin.bones);
+  free((void *)bench_skin.weights);
+}
+
+static void b_dualquat_transform(size_t n) {
+  vec3_t *r = (vec3_t *)bench_r;
+  const vec3_t *v = (const vec3_t *)bench_a;
+  size_t i;
+
+  for (i = 0; i < n; ++i)
+    dualquat_transform(r[i], &bench_dualquats[i % bench_bones], v[i]);
+}
+
+static void b_skin_linear(size_t n) {
+  skin_linear((vec3_t *)bench_r, (vec3_t *)bench_r + n, &bench_skin,
+              (const mat44_t *)bench_palette, 0, n);
+}
+
+static void b_skin_dualquat(size_t n) {
+  skin_dualquat((vec3_t *)bench_r, (vec3_t *)bench_r + n, &bench_skin,
+                bench_dualquats, 0, n);
+}
+
+static void b_skin_linear_batch(size_t n) {
+  skin_linear_batch((vec3_t *)bench_r, (vec3_t *)bench_r + n, &bench_skin,
+                    (const mat44_t *)bench_palette, n);
+}
+
+static void b_skin_dualquat_batch(size_t n) {
+  skin_dualquat_batch((vec3_t *)bench_r, (vec3_t *)bench_r + n, &bench_skin,
+                      bench_dualquats, n);
+}
+
+static const bench_t bench_list[] = {
+    {"vector", "vec2_add", b_vec2_add, NULL, NULL},
+    {"vector", "vec2_sub", b_vec2_sub, NULL, NULL},
+    {"vector", "vec2_scale", b_vec2_scale, NULL, NULL},
+    {"vector", "vec2_dot", b_vec2_dot, NULL, NULL},
+    {"vector", "vec2_len", b_vec2_len, NULL, NULL},
+    {"vector", "vec2_normalize", b_vec2_normalize, NULL, NULL},
+    {"vector", "vec2_rotate", b_vec2_rotate, NULL, NULL},
+    {"vector", "vec2_rotate_sweep", b_vec2_rotate_sweep, NULL, NULL},
+    {"vector", "vec3_add", b_vec3_add, NULL, NULL},
+    {"vector", "vec3_sub", b_vec3_sub, NULL, NULL},
+    {"vector", "vec3_mul", b_vec3_mul, NULL, NULL},
+    {"vector", "vec3_scale", b_vec3_scale, NULL, NULL},
+    {"vector", "vec3_dot", b_vec3_dot, NULL, NULL},
+    {"vector", "vec3_cross", b_vec3_cross, NULL, NULL},
+    {"vector", "vec3_len", b_vec3_len, NULL, NULL},
+    {"vector", "vec3_normalize", b_vec3_normalize, NULL, NULL},
+    {"vector", "vec3_rotate_x", b_vec3_rotate_x, NULL, NULL},
+    {"vector", "vec3_rotate_y", b_vec3_rotate_y, NULL, NULL},
+    {"vector", "vec3_rotate_z", b_vec3_rotate_z, NULL, NULL},
+    {"vector", "vec3_rotateaxis_sweep", b_vec3_rotateaxis_sweep, NULL, NULL},
+    {"vector", "vec4_add", b_vec4_add, NULL, NULL},
+    {"vector", "vec4_sub", b_vec4_sub, NULL, NULL},
+    {"vector", "vec4_dot", b_vec4_dot, NULL, NULL},
+    {"vector", "vec4_normalize", b_vec4_normalize, NULL, NULL},
+    {"vector", "vec2f_normalize", b_vec2f_normalize, NULL, NULL},
+    {"vector", "vec2f_rotate", b_vec2f_rotate, NULL, NULL},
+    {"vector", "vec3f_normalize", b_vec3f_normalize, NULL, NULL},
+    {"vector", "vec3f_rotate_x", b_vec3f_rotate_x, NULL, NULL},
+    {"vector", "vec3f_rotate_y", b_vec3f_rotate_y, NULL, NULL},
+    {"vector", "vec3f_rotate_z", b_vec3f_rotate_z, NULL, NULL},
+    {"vector", "vec4f_normalize", b_vec4f_normalize, NULL, NULL},
+    {"matrix", "mat22_mul", b_mat22_mul, NULL, NULL},
+    {"matrix", "mat22_inverse", b_mat22_inverse, NULL, NULL},
+    {"matrix", "mat22_rotation", b_mat22_rotation, NULL, NULL},
+    {"matrix", "mat33_mul", b_mat33_mul, NULL, NULL},
+    {"matrix", "mat33_inverse", b_mat33_inverse, NULL, NULL},
+    {"matrix", "mat33_inverse_batch", b_mat33_inverse_batch, NULL, NULL},
+    {"matrix", "mat33_transform3", b_mat33_transform3, NULL, NULL},
+    {"matrix", "mat33_rotateaxis", b_mat33_rotateaxis, NULL, NULL},
+    {"matrix", "mat44_mul", b_mat44_mul, NULL, NULL},
+    {"matrix", "mat44_mul_simd", b_mat44_mul_simd, NULL, NULL},
+    {"matrix", "mat44_mul_affine", b_mat44_mul_affine, NULL, NULL},
+    {"matrix", "mat44_mul_batch", b_mat44_mul_batch, NULL, NULL},
+    {"matrix", "mat44_mul_batch_right", b_mat44_mul_batch_right, NULL, NULL},
+    {"matrix", "mat44_mul_each", b_mat44_mul_each, NULL, NULL},
+    {"matrix", "mat44_block_pack", b_mat44_block_pack, NULL, NULL},
+    {"matrix", "mat44_block_unpack", b_mat44_block_unpack, NULL, NULL},
+    {"matrix", "mat44_block_mul", b_mat44_block_mul, NULL, NULL},
+    {"matrix", "mat44_block_mul_batch", b_mat44_block_mul_batch, NULL, NULL},
+    {"matrix", "mat44_inverse", b_mat44_inverse, NULL, NULL},
+    {"matrix", "mat44_inverse_simd", b_mat44_inverse_simd, NULL, NULL},
+    {"matrix", "mat44_inverse_affine", b_mat44_inverse_affine, NULL, NULL},
+    {"matrix", "mat44_inverse_rigid", b_mat44_inverse_rigid, NULL, NULL},
+    {"matrix", "mat44_inverse_batch", b_mat44_inverse_batch, NULL, NULL},
+    {"matrix", "mat44_block_inverse", b_mat44_block_inverse, NULL, NULL},
+    {"matrix", "mat44_transpose", b_mat44_transpose, NULL, NULL},
+    {"matrix", "mat44_transpose_simd", b_mat44_transpose_simd, NULL, NULL},
+    {"matrix", "mat44_determinant", b_mat44_determinant, NULL, NULL},
+    {"matrix", "mat44_transform3", b_mat44_transform3, NULL, NULL},
+    {"matrix", "mat44_transform4", b_mat44_transform4, NULL, NULL},
+    {"matrix", "mat44_transform2_batch", b_mat44_transform2_batch, NULL,
+     NULL},
+    {"matrix", "mat44_transform3_batch", b_mat44_transform3_batch, NULL,
+     NULL},
+    {"matrix", "mat44_transform4_batch", b_mat44_transform4_batch, NULL,
+     NULL},
+    {"matrix", "mat44_rotateaxis", b_mat44_rotateaxis, NULL, NULL},
+    {"matrix", "mat44_perspective", b_mat44_perspective, NULL, NULL},
+    {"matrix", "mat44_lookat", b_mat44_lookat, NULL, NULL},
+    {"matrix", "mat22f_rotation", b_mat22f_rotation, NULL, NULL},
+    {"matrix", "mat33f_rotateaxis", b_mat33f_rotateaxis, NULL, NULL},
+    {"matrix", "mat44f_rotateaxis", b_mat44f_rotateaxis, NULL, NULL},
+    {"matrix", "mat44f_perspective", b_mat44f_perspective, NULL, NULL},
+    {"matrix", "mat44f_lookat", b_mat44f_lookat, NULL, NULL},
+    {"quaternion", "quat_mul", b_quat_mul, NULL, NULL},
+    {"quaternion", "quat_normalize", b_quat_normalize, NULL, NULL},
+    {"quaternion", "quat_slerp", b_quat_slerp, NULL, NULL},
+    {"quaternion", "quat_slerp_array", b_quat_slerp_array, NULL, NULL},
+    {"quaternion", "quat_slerp_fast", b_quat_slerp_fast, NULL, NULL},
+    {"quaternion", "quat_slerp_fast_array", b_quat_slerp_fast_array, NULL,
+     NULL},
+    {"quaternion", "quat_rotate", b_quat_rotate, NULL, NULL},
+    {"quaternion", "quat_rotate_array", b_quat_rotate_array, NULL, NULL},
+    {"quaternion", "quat_tomatrix", b_quat_tomatrix, NULL, NULL},
+    {"quaternion", "quat_toeuler", b_quat_toeuler, NULL, NULL},
+    {"quaternion", "quat_fromeuler", b_quat_fromeuler, NULL, NULL},
+    {"quaternion", "quat_fromangleaxis", b_quat_fromangleaxis, NULL, NULL},
+    {"quaternion", "quatf_normalize", b_quatf_normalize, NULL, NULL},
+    {"quaternion", "quatf_slerp", b_quatf_slerp, NULL, NULL},
+    {"quaternion", "quatf_rotate", b_quatf_rotate, NULL, NULL},
+    {"quaternion", "quatf_tomatrix", b_quatf_tomatrix, NULL, NULL},
+    {"quaternion", "quatf_toeuler", b_quatf_toeuler, NULL, NULL},
+    {"quaternion", "quatf_fromeuler", b_quatf_fromeuler, NULL, NULL},
+    {"quaternion", "quatf_fromangleaxis", b_quatf_fromangleaxis, NULL, NULL},
+    {"inline", "vec3_cross_i", b_vec3_cross_i, NULL, NULL},
+    {"inline", "vec3_cross_inplace", b_vec3_cross_inplace, NULL, NULL},
+    {"inline", "mat22_mul_i", b_mat22_mul_i, NULL, NULL},
+    {"inline", "mat22_inverse_i", b_mat22_inverse_i, NULL, NULL},
+    {"inline", "mat22_transpose_i", b_mat22_transpose_i, NULL, NULL},
+    {"inline", "mat22_transform2_i", b_mat22_transform2_i, NULL, NULL},
+    {"inline", "mat22_mul_inplace", b_mat22_mul_inplace, NULL, NULL},
+    {"inline", "mat22_premul_inplace", b_mat22_premul_inplace, NULL, NULL},
+    {"inline", "mat22_inverse_inplace", b_mat22_inverse_inplace, NULL, NULL},
+    {"inline", "mat22_transpose_inplace", b_mat22_transpose_inplace, NULL,
+     NULL},
+    {"inline", "mat22_transform2_inplace", b_mat22_transform2_inplace, NULL,
+     NULL},
+    {"inline", "mat33_mul_i", b_mat33_mul_i, NULL, NULL},
+    {"inline", "mat33_inverse_i", b_mat33_inverse_i, NULL, NULL},
+    {"inline", "mat33_transpose_i", b_mat33_transpose_i, NULL, NULL},
+    {"inline", "mat33_transform3_i", b_mat33_transform3_i, NULL, NULL},
+    {"inline", "mat33_mul_inplace", b_mat33_mul_inplace, NULL, NULL},
+    {"inline", "mat33_premul_inplace", b_mat33_premul_inplace, NULL, NULL},
+    {"inline", "mat33_inverse_inplace", b_mat33_inverse_inplace, NULL, NULL},
+    {"inline", "mat33_transpose_inplace", b_mat33_transpose_inplace, NULL,
+     NULL},
+    {"inline", "mat33_transform3_inplace", b_mat33_transform3_inplace, NULL,
+     NULL},
+    {"inline", "mat44_mul_i", b_mat44_mul_i, NULL, NULL},
+    {"inline", "mat44_inverse_i", b_mat44_inverse_i, NULL, NULL},
+    {"inline", "mat44_transpose_i", b_mat44_transpose_i, NULL, NULL},
+    {"inline", "mat44_transform3_i", b_mat44_transform3_i, NULL, NULL},
+    {"inline", "mat44_transform4_i", b_mat44_transform4_i, NULL, NULL},
+    {"inline", "mat44_mul_inplace", b_mat44_mul_inplace, NULL, NULL},
+    {"inline", "mat44_premul_inplace", b_mat44_premul_inplace, NULL, NULL},
+    {"inline", "mat44_inverse_inplace", b_mat44_inverse_inplace, NULL, NULL},
+    {"inline", "mat44_transpose_inplace", b_mat44_transpose_inplace, NULL,
+     NULL},
+    {"inline", "mat44_transform3_inplace", b_mat44_transform3_inplace, NULL,
+     NULL},
+    {"inline", "mat44_transform4_inplace", b_mat44_transform4_inplace, NULL,
+     NULL},
+    {"inline", "quat_mul_i", b_quat_mul_i, NULL, NULL},
+    {"inline", "quat_mul_inplace", b_quat_mul_inplace, NULL, NULL},
+    {"inline", "quat_premul_inplace", b_quat_premul_inplace, NULL, NULL},
+    {"trig", "r_sincos", b_r_sincos, NULL, NULL},
+    {"trig", "math_sincos", b_math_sincos, NULL, NULL},
+    {"trig", "math_sincosf", b_math_sincosf, NULL, NULL},
+    {"trig", "libm_sincos", b_libm_sincos, NULL, NULL},
+    {"trig", "libm_atan2", b_libm_atan2, NULL, NULL},
+    {"trig", "libm_acos", b_libm_acos, NULL, NULL},
+    {"trig", "math_sin_array_precise", b_sin_precise, NULL, NULL},
+    {"trig", "math_sin_array_fast", b_sin_fast, NULL, NULL},
+    {"trig", "math_cos_array_precise", b_cos_precise, NULL, NULL},
+    {"trig", "math_cos_array_fast", b_cos_fast, NULL, NULL},
+    {"trig", "math_sincos_array_precise", b_sincos_precise, NULL, NULL},
+    {"trig", "math_sincos_array_fast", b_sincos_fast, NULL, NULL},
+    {"trig", "math_atan2_array_precise", b_atan2_precise, NULL, NULL},
+    {"trig", "math_atan2_array_fast", b_atan2_fast, NULL, NULL},
+    {"trig", "math_acos_array_precise", b_acos_precise, NULL, NULL},
+    {"trig", "math_acos_array_fast", b_acos_fast, NULL, NULL},
+    {"stream", "vec2s_add", b_vec2s_add, NULL, NULL},
+    {"stream", "vec2s_sub", b_vec2s_sub, NULL, NULL},
+    {"stream", "vec2s_mul", b_vec2s_mul, NULL, NULL},
+    {"stream", "vec2s_scale", b_vec2s_scale, NULL, NULL},
+    {"stream", "vec2s_dot", b_vec2s_dot, NULL, NULL},
+    {"stream", "vec2s_lensq", b_vec2s_lensq, NULL, NULL},
+    {"stream", "vec2s_normalize", b_vec2s_normalize, NULL, NULL},
+    {"stream", "vec2s_from_aos", b_vec2s_from_aos, NULL, NULL},
+    {"stream", "vec2s_to_aos", b_vec2s_to_aos, NULL, NULL},
+    {"stream", "vec3s_add", b_vec3s_add, NULL, NULL},
+    {"stream", "vec3s_sub", b_vec3s_sub, NULL, NULL},
+    {"stream", "vec3s_mul", b_vec3s_mul, NULL, NULL},
+    {"stream", "vec3s_scale", b_vec3s_scale, NULL, NULL},
+    {"stream", "vec3s_dot", b_vec3s_dot, NULL, NULL},
+    {"stream", "vec3s_lensq", b_vec3s_lensq, NULL, NULL},
+    {"stream", "vec3s_cross", b_vec3s_cross, NULL, NULL},
+    {"stream", "vec3s_normalize", b_vec3s_normalize, NULL, NULL},
+    {"stream", "vec3s_from_aos", b_vec3s_from_aos, NULL, NULL},
+    {"stream", "vec3s_to_aos", b_vec3s_to_aos, NULL, NULL},
+    {"stream", "vec4s_add", b_vec4s_add, NULL, NULL},
+    {"stream", "vec4s_sub", b_vec4s_sub, NULL, NULL},
+    {"stream", "vec4s_mul", b_vec4s_mul, NULL, NULL},
+    {"stream", "vec4s_scale", b_vec4s_scale, NULL, NULL},
+    {"stream", "vec4s_dot", b_vec4s_dot, NULL, NULL},
+    {"stream", "vec4s_lensq", b_vec4s_lensq, NULL, NULL},
+    {"stream", "vec4s_normalize", b_vec4s_normalize, NULL, NULL},
+    {"stream", "vec4s_from_aos", b_vec4s_from_aos, NULL, NULL},
+    {"stream", "vec4s_to_aos", b_vec4s_to_aos, NULL, NULL},
+    {"transform", "transform_mul", b_transform_mul, s_transform,
+     t_transform},
+    {"transform", "transform_inverse", b_transform_inverse, s_transform,
+     t_transform},
+    {"transform", "transform_point", b_transform_point, s_transform,
+     t_transform},
+    {"transform", "transform_vector", b_transform_vector, s_transform,
+     t_transform},
+    {"transform", "mat44_classify", b_mat44_classify, s_transform,
+     t_transform},
+    {"aabb", "aabb_transform", b_aabb_transform, NULL, NULL},
+    {"aabb", "aabb_transform_batch", b_aabb_transform_batch, NULL, NULL},
+    {"aabb", "aabb_transform_each", b_aabb_transform_each, NULL, NULL},
+    {"frustum", "frustum_cull_spheres", b_frustum_spheres, s_frustum, NULL},
+    {"frustum", "frustum_cull_aabbs", b_frustum_aabbs, s_frustum, NULL},
+    {"hierarchy", "hierarchy_update", b_hierarchy_update, s_hierarchy,
+     t_hierarchy},
+    {"bvh", "bvh_build", b_bvh_build, s_bvh, t_bvh},
+    {"bvh", "bvh_intersect", b_bvh_intersect, s_bvh, t_bvh},
+    {"bvh", "bvh_occluded", b_bvh_occluded, s_bvh, t_bvh},
+    {"bvh", "bvh_intersect_packet", b_bvh_intersect_packet, s_bvh, t_bvh},
+    {"bvh", "bvh_refit", b_bvh_refit, s_bvh, t_bvh},
+    {"skin", "dualquat_transform", b_dualquat_transform, s_bones, NULL},
+    {"skin", "skin_linear", b_skin_linear, s_skin, t_skin},
+    {"skin", "skin_dualquat", b_skin_dualquat, s_skin, t_skin},
+    {"skin", "skin_linear_batch", b_skin_linear_batch, s_skin, t_skin},
+    {"skin", "skin_dualquat_batch", b_skin_dualquat_batch, s_skin, t_skin},
+    {"kdtree", "kdtree_build", b_kdtree_build, NULL, NULL},
+    {"kdtree", "kdtree_knn", b_kdtree_knn, s_kdtree, t_kdtree},
+    {"kdtree", "kdtree_knn_batch", b_kdtree_knn_batch, s_kdtree, t_kdtree},
+    {"kdtree", "kdtree_radius", b_kdtree_radius, s_kdtree, t_kdtree},
+    {"kdtree", "kdtree_radius_batch", b_kdtree_radius_batch, s_kdtree,
+     t_kdtree},
+    {"pack", "quat_pack32", b_quat_pack32, NULL, NULL},
+    {"pack", "quat_pack48", b_quat_pack48, NULL, NULL},
+    {"pack", "quat_pack64", b_quat_pack64, NULL, NULL},
+    {"pack", "quat_pack32_array", b_quat_pack32_array, NULL, NULL},
+    {"pack", "quat_pack48_array", b_quat_pack48_array, NULL, NULL},
+    {"pack", "quat_pack64_array", b_quat_pack64_array, NULL, NULL},
+    {"pack", "quat_unpack32", b_quat_unpack32, s_pack, NULL},
+    {"pack", "quat_unpack48", b_quat_unpack48, s_pack48, NULL},
+    {"pack", "quat_unpack64", b_quat_unpack64, s_pack64, NULL},
+    {"pack", "quat_unpack32_array", b_quat_unpack32_array, s_pack, NULL},
+    {"pack", "quat_unpack48_array", b_quat_unpack48_array, s_pack48, NULL},
+    {"pack", "quat_unpack64_array", b_quat_unpack64_array, s_pack64, NULL},
+    {"pack", "vec3_pack16", b_vec3_pack16, NULL, NULL},
+    {"pack", "vec3_pack24", b_vec3_pack24, NULL, NULL},
+    {"pack", "vec3_pack32", b_vec3_pack32, NULL, NULL},
+    {"pack", "vec3_pack16_array", b_vec3_pack16_array, NULL, NULL},
+    {"pack", "vec3_pack24_array", b_vec3_pack24_array, NULL, NULL},
+    {"pack", "vec3_pack32_array", b_vec3_pack32_array, NULL, NULL},
+    {"pack", "vec3_unpack16", b_vec3_unpack16, s_oct16, NULL},
+    {"pack", "vec3_unpack24", b_vec3_unpack24, s_oct24, NULL},
+    {"pack", "vec3_unpack32", b_vec3_unpack32, s_oct32, NULL},
+    {"pack", "vec3_unpack16_array", b_vec3_unpack16_array, s_oct16, NULL},
+    {"pack", "vec3_unpack24_array", b_vec3_unpack24_array, s_oct24, NULL},
+    {"pack", "vec3_unpack32_array", b_vec3_unpack32_array, s_oct32, NULL},
+    {"matn", "matn_mul", b_matn_mul, s_matn, t_matn},
+    {"matn", "matn_mul_naive", b_matn_mul_naive, s_matn, t_matn},
+    {"matn", "matn_lu", b_matn_lu, s_matn, t_matn},
+    {"matn", "matn_qr", b_matn_qr, s_matn, t_matn},
+    {"matn", "matn_cholesky", b_matn_cholesky, s_matn_spd, t_matn},
+    {"matn", "matn_lu_solve", b_matn_lu_solve, s_matn_lu, t_matn},
+    {"matn", "matn_qr_solve", b_matn_qr_solve, s_matn_qr, t_matn},
+    {"matn", "matn_cholesky_solve", b_matn_cholesky_solve, s_matn_cholesky,
+     t_matn},
+    {"matn", "matn_transpose", b_matn_transpose, s_matn, t_matn},
+    {"mapfile", "mapfile_open", b_mapfile_open, s_mapfile, t_mapfile},
+    {"mapfile", "mapfile_read_naive", b_mapfile_read_naive, s_mapfile,
+     t_mapfile},
+};
+
+/**
+ *---------------------------------------------
+ *  Driver
+ *---------------------------------------------
+ **/
+
+static int bench_compare(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return x < y ? -1 : x > y ? 1 : 0;
+}
+
+/* ns per element of each sample, sorted */
+static void bench_measure(const bench_t *b, size_t n, int cold, double *ns,
+                          int samples) {
+  size_t reps = cold ? 1 : (n < bench_min_ops ? bench_min_ops / n : 1), k;
+  int s;
+
+  if (!cold)
+    b->run(n); /* warm up the data and the code */
+
+  for (s = 0; s < samples; ++s) {
+    double t0;
+
+    if (cold)
+      bench_evict();
+
+    t0 = bench_now();
+    for (k = 0; k < reps; ++k)
+      b->run(n);
+    ns[s] = (bench_now() - t0) / (double)(reps * n);
+  }
+
+  qsort(ns, (size_t)samples, sizeof(double), bench_compare);
+}
+
+static const char *bench_isa(void) {
+#if defined(MATH_SIMD_AVX) && defined(__AVX2__)
+  return "avx2";
+#elif defined(MATH_SIMD_AVX)
+  return "avx";
+#elif defined(MATH_SIMD_SSE2)
+  return "sse2";
+#else
+  return "none";
+#endif
+}
+
+int main(int argc, char *argv[]) {
+  const char *filter = NULL;
+  size_t sizes = sizeof(bench_sizes) / sizeof(bench_sizes[0]), i, z;
+  double ns[bench_warm_samples];
+  int json = 0, first = 1, cold, k;
+  unsigned int seed = 1;
+
+  for (k = 1; k < argc; ++k) {
+    if (strcmp(argv[k], "--json") == 0)
+      json = 1;
+    else if (strcmp(argv[k], "--quick") == 0)
+      sizes = 2;
+    else if (strcmp(argv[k], "--filter") == 0 && k + 1 < argc)
+      filter = argv[++k];
+    else if (strcmp(argv[k], "--threads") == 0 && k + 1 < argc)
+      math_parallel_init(atoi(argv[++k]));
+    else {
+      fprintf(stderr,
+              "usage: %s [--json] [--quick] [--filter text] [--threads n]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  bench_a = (real_t *)math_alloc(sizeof(mat44_t) * bench_max);
+  bench_b = (real_t *)math_alloc(sizeof(mat44_t) * bench_max);
+  bench_r = (real_t *)math_alloc(sizeof(mat44_t) * bench_max);
+  bench_af = (realf_t *)math_alloc(sizeof(mat44f_t) * bench_max);
+  bench_bf = (realf_t *)math_alloc(sizeof(mat44f_t) * bench_max);
+  bench_cache = (unsigned char *)malloc(bench_flush);
+  if (!bench_a || !bench_b || !bench_r || !bench_af || !bench_bf ||
+      !bench_cache) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  /* values in [-1, 1), never exactly zero */
+  for (i = 0; i < bench_max * 16; ++i) {
+    seed = seed * 1664525u + 1013904223u;
+    bench_a[i] = (real_t)((seed >> 16) + 0.5) / 32768 - r_one;
+    seed = seed * 1664525u + 1013904223u;
+    bench_b[i] = (real_t)((seed >> 16) + 0.5) / 32768 - r_one;
+    bench_af[i] = (realf_t)bench_a[i], bench_bf[i] = (realf_t)bench_b[i];
+  }
+  memset(bench_r, 0, sizeof(mat44_t) * bench_max);
+
+  if (json)
+    printf("{\"precision\": \"%s\", \"isa\": \"%s\", \"lanes\": %d, "
+           "\"threads\": %d, \"results\": [\n",
+           sizeof(real_t) == sizeof(float) ? "single" : "double", bench_isa(),
+#ifdef MATH_SIMD
+           rv_lanes,
+#else
+           1,
+#endif
+           math_parallel_workers());
+  else
+    printf("%-28s %8s %5s %12s %12s %12s\n", "name", "size", "cache",
+           "median ns", "p99 ns", "Mop/s");
+
+  for (i = 0; i < sizeof(bench_list) / sizeof(bench_list[0]); ++i) {
+    const bench_t *b = &bench_list[i];
+
+    if (filter && !strstr(b->name, filter) && !strstr(b->group, filter))
+      continue;
+
+    for (z = 0; z < sizes; ++z) {
+      size_t n = bench_sizes[z];
+
+      if (b->setup && b->setup(n) != 0)
+        continue;
+
+      for (cold = 0; cold < 2; ++cold) {
+        int samples = cold ? bench_cold_samples : bench_warm_samples;
+        double median, p99;
+
+        bench_measure(b, n, cold, ns, samples);
+        median = ns[samples / 2];
+        p99 = ns[(samples * 99 + 99) / 100 - 1];
+
+        if (json) {
+          printf("%s  {\"group\": \"%s\", \"name\": \"%s\", \"size\": %u, "
+                 "\"cache\": \"%s\", \"median_ns\": %.3f, \"p99_ns\": %.3f, "
+                 "\"mops\": %.3f}",
+                 first ? "" : ",\n", b->group, b->name, (unsigned int)n,
+                 cold ? "cold" : "warm", median, p99, 1e3 / median);
+          first = 0;
+        } else
+          printf("%-28s %8u %5s %12.3f %12.3f %12.3f\n", b->name,
+                 (unsigned int)n, cold ? "cold" : "warm", median, p99,
+                 1e3 / median);
+      }
+
+      if (b->teardown)
+        b->teardown();
+    }
+  }
+
+  if (json)
+    printf("\n]}\n");
+
+  math_parallel_shutdown();
+  math_free(bench_a);
+  math_free(bench_b);
+  math_free(bench_r);
+  math_free(bench_af);
+  math_free(bench_bf);
+  free(bench_cache);
+  return 0;
+}
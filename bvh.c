@@ -0,0 +1,554 @@
+/*
+ *  bvh.c
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#include "bvh.h"
+#include "simd.h"
+
+#define bvh_bins 12
+#define bvh_leaf_min 2 /* never split below */
+#define bvh_leaf_max 8 /* always split above */
+#define bvh_depth 64   /* traversal stack */
+
+/**
+ * Slack on the barycentric bounds, so a ray through an edge shared by two
+ * triangles cannot miss both when FMA contraction rounds u and w apart.
+ **/
+#define bvh_edge (r_epsilon * 16)
+
+/* triangle indices a float lane holds exactly */
+#define bvh_float_max ((size_t)1 << 24)
+
+#define bvh_min(a, b) ((a) < (b) ? (a) : (b))
+#define bvh_max(a, b) ((a) > (b) ? (a) : (b))
+
+#define aabb_empty(b)                                                          \
+  do {                                                                         \
+    vx((b).min) = vy((b).min) = vz((b).min) = r_max;                           \
+    vx((b).max) = vy((b).max) = vz((b).max) = -r_max;                          \
+  } while (0)
+
+#define aabb_grow(b, p)                                                        \
+  do {                                                                         \
+    vx((b).min) = bvh_min(vx((b).min), vx(p));                                 \
+    vy((b).min) = bvh_min(vy((b).min), vy(p));                                 \
+    vz((b).min) = bvh_min(vz((b).min), vz(p));                                 \
+    vx((b).max) = bvh_max(vx((b).max), vx(p));                                 \
+    vy((b).max) = bvh_max(vy((b).max), vy(p));                                 \
+    vz((b).max) = bvh_max(vz((b).max), vz(p));                                 \
+  } while (0)
+
+#define aabb_merge(r, b)                                                       \
+  do {                                                                         \
+    aabb_grow(r, (b).min);                                                     \
+    aabb_grow(r, (b).max);                                                     \
+  } while (0)
+
+/* half the surface area */
+static real_t aabb_area(const aabb_t *b) {
+  real_t dx = vx(b->max) - vx(b->min);
+  real_t dy = vy(b->max) - vy(b->min);
+  real_t dz = vz(b->max) - vz(b->min);
+
+  if (dx < r_zero)
+    return r_zero;
+  return dx * dy + dy * dz + dz * dx;
+}
+
+static void bvh_triangle_box(aabb_t *r, const vec3_t *v) {
+  aabb_empty(*r);
+  aabb_grow(*r, v[0]);
+  aabb_grow(*r, v[1]);
+  aabb_grow(*r, v[2]);
+}
+
+typedef struct bvh_bin_t {
+  aabb_t box;
+  size_t count;
+} bvh_bin_t;
+
+typedef struct bvh_task_t {
+  unsigned int node, first, count, depth;
+} bvh_task_t;
+
+/* split axis and bin index of the cheapest split, -1 to make a leaf */
+static int bvh_split(const bvh_t *b, const aabb_t *boxes,
+                     const vec3_t *centers, const aabb_t *bounds,
+                     const bvh_task_t *t, int *split) {
+  real_t best = aabb_area(&b->nodes[t->node].box) * t->count;
+  int axis, k, best_axis = -1;
+  unsigned int i;
+
+  for (axis = 0; axis < 3; ++axis) {
+    real_t lo = bounds->min[axis], span = bounds->max[axis] - lo;
+    real_t left_area[bvh_bins];
+    size_t left_count[bvh_bins];
+    bvh_bin_t bins[bvh_bins];
+    aabb_t acc;
+    size_t n;
+
+    if (span <= r_zero)
+      continue;
+
+    for (k = 0; k < bvh_bins; ++k) {
+      aabb_empty(bins[k].box);
+      bins[k].count = 0;
+    }
+
+    for (i = t->first; i < t->first + t->count; ++i) {
+      unsigned int tri = b->indices[i];
+      k = (int)((centers[tri][axis] - lo) * bvh_bins / span);
+      k = bvh_min(k, bvh_bins - 1);
+      aabb_merge(bins[k].box, boxes[tri]);
+      bins[k].count += 1;
+    }
+
+    /* sweep from the left, then score while sweeping from the right */
+    aabb_empty(acc);
+    for (n = 0, k = 0; k < bvh_bins - 1; ++k) {
+      aabb_merge(acc, bins[k].box);
+      n += bins[k].count;
+      left_area[k] = aabb_area(&acc);
+      left_count[k] = n;
+    }
+
+    aabb_empty(acc);
+    for (n = 0, k = bvh_bins - 1; k > 0; --k) {
+      real_t cost;
+
+      aabb_merge(acc, bins[k].box);
+      n += bins[k].count;
+      if (n == 0 || left_count[k - 1] == 0)
+        continue;
+
+      cost = left_area[k - 1] * left_count[k - 1] + aabb_area(&acc) * n;
+      if (cost < best) {
+        best = cost;
+        best_axis = axis;
+        *split = k;
+      }
+    }
+  }
+
+  /* large leaves are split even when SAH prefers not to */
+  if (best_axis < 0 && t->count > bvh_leaf_max) {
+    int widest = 0;
+    for (axis = 1; axis < 3; ++axis)
+      if (bounds->max[axis] - bounds->min[axis] >
+          bounds->max[widest] - bounds->min[widest])
+        widest = axis;
+    if (bounds->max[widest] > bounds->min[widest]) {
+      best_axis = widest;
+      *split = bvh_bins / 2;
+    }
+  }
+
+  return best_axis;
+}
+
+int bvh_build(bvh_t *b, const vec3_t *vertices, size_t count) {
+  size_t capacity = count ? count * 2 - 1 : 1;
+  bvh_task_t stack[bvh_depth + 1];
+  aabb_t *boxes;
+  vec3_t *centers;
+  int top = 0;
+  size_t i;
+
+  memset(b, 0, sizeof(bvh_t));
+#ifdef MATH_SINGLE_PRECISION
+  if (count > bvh_float_max)
+    return 1;
+#endif
+
+  b->nodes = (bvh_node_t *)math_alloc(sizeof(bvh_node_t) * capacity);
+  b->indices = (unsigned int *)malloc(sizeof(unsigned int) * (count + 1));
+  boxes = (aabb_t *)malloc(sizeof(aabb_t) * (count + 1));
+  centers = (vec3_t *)malloc(sizeof(vec3_t) * (count + 1));
+
+  if (!b->nodes || !b->indices || !boxes || !centers) {
+    free(boxes);
+    free(centers);
+    bvh_free(b);
+    return -1;
+  }
+
+  b->vertices = vertices;
+  b->count = count;
+
+  for (i = 0; i < count; ++i) {
+    b->indices[i] = (unsigned int)i;
+    bvh_triangle_box(&boxes[i], vertices + i * 3);
+    aabb_center(centers[i], boxes[i]);
+  }
+
+  memset(&b->nodes[0], 0, sizeof(bvh_node_t));
+  b->nodes[0].count = (unsigned int)count;
+  b->node_count = 1;
+
+  stack[top].node = 0, stack[top].first = 0, stack[top].depth = 0;
+  stack[top++].count = (unsigned int)count;
+
+  while (top > 0) {
+    bvh_task_t t = stack[--top];
+    bvh_node_t *node = &b->nodes[t.node];
+    unsigned int lo = t.first, hi = t.first + t.count;
+    aabb_t bounds;
+    int axis = -1, split = 0;
+
+    aabb_empty(node->box);
+    aabb_empty(bounds);
+    for (i = t.first; i < t.first + t.count; ++i) {
+      aabb_merge(node->box, boxes[b->indices[i]]);
+      aabb_grow(bounds, centers[b->indices[i]]);
+    }
+
+    node->first = t.first;
+    node->count = t.count;
+
+    /* bounded depth keeps the traversal stacks fixed size */
+    if (t.count > bvh_leaf_min && t.depth + 1 < bvh_depth)
+      axis = bvh_split(b, boxes, centers, &bounds, &t, &split);
+    if (axis < 0)
+      continue;
+
+    /* partition by bin, same formula as bvh_split */
+    while (lo < hi) {
+      unsigned int tri = b->indices[lo];
+      real_t span = bounds.max[axis] - bounds.min[axis];
+      int k = (int)((centers[tri][axis] - bounds.min[axis]) * bvh_bins / span);
+
+      if (bvh_min(k, bvh_bins - 1) < split)
+        ++lo;
+      else {
+        b->indices[lo] = b->indices[--hi];
+        b->indices[hi] = tri;
+      }
+    }
+    if (lo == t.first || lo == t.first + t.count)
+      continue;
+
+    node->first = (unsigned int)b->node_count;
+    node->count = 0;
+    b->node_count += 2;
+
+    stack[top].node = node->first, stack[top].first = t.first;
+    stack[top].depth = t.depth + 1, stack[top++].count = lo - t.first;
+    stack[top].node = node->first + 1, stack[top].first = lo;
+    stack[top].depth = t.depth + 1, stack[top++].count = t.first + t.count - lo;
+  }
+
+  free(boxes);
+  free(centers);
+  return 0;
+}
+
+void bvh_free(bvh_t *b) {
+  math_free(b->nodes);
+  free(b->indices);
+  memset(b, 0, sizeof(bvh_t));
+}
+
+void bvh_refit(bvh_t *b) {
+  size_t i = b->node_count;
+  unsigned int k;
+
+  /* an empty tree has one node and no children to read */
+  if (b->count == 0)
+    return;
+
+  /* children always follow their parent */
+  while (i-- > 0) {
+    bvh_node_t *node = &b->nodes[i];
+
+    if (node->count == 0) {
+      node->box = b->nodes[node->first].box;
+      aabb_merge(node->box, b->nodes[node->first + 1].box);
+      continue;
+    }
+
+    aabb_empty(node->box);
+    for (k = node->first; k < node->first + node->count; ++k) {
+      aabb_t box;
+      bvh_triangle_box(&box, b->vertices + b->indices[k] * 3);
+      aabb_merge(node->box, box);
+    }
+  }
+}
+
+/**
+ *---------------------------------------------
+ *  Single Ray
+ *---------------------------------------------
+ **/
+
+/**
+ * Entry distance of the ray into box clipped to [0, tmax], or tmax when it
+ * misses. A ray parallel to a slab and lying in its plane gives 0 * inf =
+ * NaN there; the compares below keep the running interval in that case.
+ **/
+static real_t bvh_slab(const aabb_t *box, const vec3_t o, const vec3_t inv,
+                       real_t tmax) {
+  real_t tn = r_zero, tf = tmax, t0, t1;
+  int k;
+
+  for (k = 0; k < 3; ++k) {
+    t0 = (box->min[k] - o[k]) * inv[k];
+    t1 = (box->max[k] - o[k]) * inv[k];
+    if (t0 > t1) {
+      real_t t = t0;
+      t0 = t1, t1 = t;
+    }
+    tn = t0 > tn ? t0 : tn;
+    tf = t1 < tf ? t1 : tf;
+  }
+
+  return (tn <= tf && tn < tmax) ? tn : tmax;
+}
+
+/* Moller-Trumbore within bvh_edge, updates hit when closer than hit->t */
+static int bvh_triangle(const vec3_t *v, const vec3_t o, const vec3_t d,
+                        bvh_hit_t *hit) {
+  vec3_t e1, e2, p, s, q;
+  real_t det, inv, u, w, t;
+
+  vec3_sub(e1, v[1], v[0]);
+  vec3_sub(e2, v[2], v[0]);
+  vec3_cross(p, d, e2);
+  det = vec3_dot(e1, p);
+  if (det == r_zero)
+    return 0;
+
+  inv = r_one / det;
+  vec3_sub(s, o, v[0]);
+  u = vec3_dot(s, p) * inv;
+  if (u < -bvh_edge || u > r_one + bvh_edge)
+    return 0;
+
+  vec3_cross(q, s, e1);
+  w = vec3_dot(d, q) * inv;
+  if (w < -bvh_edge || u + w > r_one + bvh_edge)
+    return 0;
+
+  t = vec3_dot(e2, q) * inv;
+  if (t < r_zero || t >= hit->t)
+    return 0;
+
+  hit->t = t, hit->u = u, hit->v = w;
+  return 1;
+}
+
+static int bvh_trace(const bvh_t *b, const vec3_t o, const vec3_t d,
+                     bvh_hit_t *hit, int any) {
+  unsigned int stack[bvh_depth + 1];
+  vec3_t inv;
+  int top = 0;
+
+  hit->triangle = -1;
+  if (b->count == 0)
+    return -1;
+
+  vx(inv) = r_one / vx(d), vy(inv) = r_one / vy(d), vz(inv) = r_one / vz(d);
+  if (bvh_slab(&b->nodes[0].box, o, inv, hit->t) >= hit->t)
+    return -1;
+  stack[top++] = 0;
+
+  while (top > 0) {
+    const bvh_node_t *node = &b->nodes[stack[--top]];
+
+    if (node->count > 0) {
+      unsigned int k;
+      for (k = node->first; k < node->first + node->count; ++k)
+        if (bvh_triangle(b->vertices + b->indices[k] * 3, o, d, hit)) {
+          hit->triangle = (int)b->indices[k];
+          if (any)
+            return hit->triangle;
+        }
+    } else {
+      /* push the farther child first so the nearer one pops next */
+      real_t tl = bvh_slab(&b->nodes[node->first].box, o, inv, hit->t);
+      real_t tr = bvh_slab(&b->nodes[node->first + 1].box, o, inv, hit->t);
+      unsigned int near = node->first, far = node->first + 1;
+
+      if (tr < tl) {
+        real_t t = tl;
+        tl = tr, tr = t;
+        near = far, far = node->first;
+      }
+      if (tr < hit->t)
+        stack[top++] = far;
+      if (tl < hit->t)
+        stack[top++] = near;
+    }
+  }
+
+  return hit->triangle;
+}
+
+int bvh_intersect(const bvh_t *b, const vec3_t origin, const vec3_t dir,
+                  real_t tmax, bvh_hit_t *hit) {
+  bvh_hit_t h;
+
+  h.t = tmax, h.u = h.v = r_zero;
+  bvh_trace(b, origin, dir, &h, 0);
+  if (hit)
+    *hit = h;
+  return h.triangle;
+}
+
+int bvh_occluded(const bvh_t *b, const vec3_t origin, const vec3_t dir,
+                 real_t tmax) {
+  bvh_hit_t h;
+
+  h.t = tmax, h.u = h.v = r_zero;
+  return bvh_trace(b, origin, dir, &h, 1) >= 0;
+}
+
+/**
+ *---------------------------------------------
+ *  Ray Packet
+ *---------------------------------------------
+ **/
+
+#ifdef MATH_SIMD
+/* triangle indices ride in real_t lanes, see bvh_build for the limit */
+typedef struct bvh_packet_t {
+  rv_t ox, oy, oz, dx, dy, dz, ix, iy, iz;
+  rv_t t, tri;
+} bvh_packet_t;
+
+/* lanes whose rays enter box before their current t, NaN as in bvh_slab */
+r_inline rv_t bvh_packet_slab(const aabb_t *box, const bvh_packet_t *p) {
+  rv_t tn = rv_zero(), tf = p->t, t0, t1;
+
+  t0 = rv_mul(rv_sub(rv_set1(vx(box->min)), p->ox), p->ix);
+  t1 = rv_mul(rv_sub(rv_set1(vx(box->max)), p->ox), p->ix);
+  tn = rv_max(rv_min(t0, t1), tn), tf = rv_min(rv_max(t0, t1), tf);
+
+  t0 = rv_mul(rv_sub(rv_set1(vy(box->min)), p->oy), p->iy);
+  t1 = rv_mul(rv_sub(rv_set1(vy(box->max)), p->oy), p->iy);
+  tn = rv_max(rv_min(t0, t1), tn), tf = rv_min(rv_max(t0, t1), tf);
+
+  t0 = rv_mul(rv_sub(rv_set1(vz(box->min)), p->oz), p->iz);
+  t1 = rv_mul(rv_sub(rv_set1(vz(box->max)), p->oz), p->iz);
+  tn = rv_max(rv_min(t0, t1), tn), tf = rv_min(rv_max(t0, t1), tf);
+
+  /* the second operand wins when either is NaN */
+  return rv_and(rv_cmple(tn, tf), rv_cmplt(tn, p->t));
+}
+
+/* bvh_triangle across the lanes of p */
+r_inline void bvh_packet_triangle(bvh_packet_t *p, const vec3_t *v,
+                                  real_t index) {
+  rv_t zero = rv_zero(), lo = rv_set1(-bvh_edge);
+  rv_t hi = rv_set1(r_one + bvh_edge);
+  rv_t e1x = rv_set1(vx(v[1]) - vx(v[0]));
+  rv_t e1y = rv_set1(vy(v[1]) - vy(v[0]));
+  rv_t e1z = rv_set1(vz(v[1]) - vz(v[0]));
+  rv_t e2x = rv_set1(vx(v[2]) - vx(v[0]));
+  rv_t e2y = rv_set1(vy(v[2]) - vy(v[0]));
+  rv_t e2z = rv_set1(vz(v[2]) - vz(v[0]));
+  rv_t sx = rv_sub(p->ox, rv_set1(vx(v[0])));
+  rv_t sy = rv_sub(p->oy, rv_set1(vy(v[0])));
+  rv_t sz = rv_sub(p->oz, rv_set1(vz(v[0])));
+
+  /* p = d x e2, q = s x e1 */
+  rv_t px = rv_sub(rv_mul(p->dy, e2z), rv_mul(p->dz, e2y));
+  rv_t py = rv_sub(rv_mul(p->dz, e2x), rv_mul(p->dx, e2z));
+  rv_t pz = rv_sub(rv_mul(p->dx, e2y), rv_mul(p->dy, e2x));
+  rv_t qx = rv_sub(rv_mul(sy, e1z), rv_mul(sz, e1y));
+  rv_t qy = rv_sub(rv_mul(sz, e1x), rv_mul(sx, e1z));
+  rv_t qz = rv_sub(rv_mul(sx, e1y), rv_mul(sy, e1x));
+
+  rv_t det = rv_madd(e1x, px, rv_madd(e1y, py, rv_mul(e1z, pz)));
+  rv_t inv = rv_div(rv_set1(r_one), det);
+  rv_t u = rv_mul(rv_madd(sx, px, rv_madd(sy, py, rv_mul(sz, pz))), inv);
+  rv_t w = rv_mul(
+      rv_madd(p->dx, qx, rv_madd(p->dy, qy, rv_mul(p->dz, qz))), inv);
+  rv_t t = rv_mul(rv_madd(e2x, qx, rv_madd(e2y, qy, rv_mul(e2z, qz))), inv);
+
+  /* det == 0 gives inf or NaN and fails the compares below */
+  rv_t m = rv_and(rv_cmpge(u, lo), rv_cmpge(w, lo));
+  m = rv_and(m, rv_cmple(rv_add(u, w), hi));
+  m = rv_and(m, rv_and(rv_cmpge(t, zero), rv_cmplt(t, p->t)));
+  m = rv_andnot(rv_cmpeq(det, zero), m);
+
+  p->t = rv_select(m, t, p->t);
+  p->tri = rv_select(m, rv_set1(index), p->tri);
+}
+
+static void bvh_packet_trace(const bvh_t *b, bvh_packet_t *p) {
+  unsigned int stack[bvh_depth + 1];
+  int top = 0;
+
+  stack[top++] = 0;
+
+  while (top > 0) {
+    const bvh_node_t *node = &b->nodes[stack[--top]];
+
+    if (!rv_movemask(bvh_packet_slab(&node->box, p)))
+      continue;
+
+    if (node->count > 0) {
+      unsigned int k;
+      for (k = node->first; k < node->first + node->count; ++k)
+        bvh_packet_triangle(p, b->vertices + b->indices[k] * 3,
+                            (real_t)b->indices[k]);
+    } else {
+      stack[top++] = node->first + 1;
+      stack[top++] = node->first;
+    }
+  }
+}
+#endif
+
+void bvh_intersect_packet(const bvh_t *b, const vec3s_t *origin,
+                          const vec3s_t *dir, real_t *tmax, int *triangle,
+                          size_t count) {
+  size_t i = 0;
+
+#ifdef MATH_SIMD
+  if (b->count > 0)
+    for (; i + rv_lanes <= count; i += rv_lanes) {
+      real_t tri[rv_lanes];
+      bvh_packet_t p;
+      int k;
+
+      p.ox = rv_load(origin->x + i);
+      p.oy = rv_load(origin->y + i);
+      p.oz = rv_load(origin->z + i);
+      p.dx = rv_load(dir->x + i);
+      p.dy = rv_load(dir->y + i);
+      p.dz = rv_load(dir->z + i);
+      p.ix = rv_div(rv_set1(r_one), p.dx);
+      p.iy = rv_div(rv_set1(r_one), p.dy);
+      p.iz = rv_div(rv_set1(r_one), p.dz);
+      p.t = rv_load(tmax + i);
+      p.tri = rv_set1(r_negone);
+
+      bvh_packet_trace(b, &p);
+
+      rv_store(tmax + i, p.t);
+      rv_store(tri, p.tri);
+      for (k = 0; k < rv_lanes; ++k)
+        triangle[i + k] = (int)tri[k];
+    }
+#endif
+
+  for (; i < count; ++i) {
+    vec3_t o, d;
+    bvh_hit_t h;
+
+    vx(o) = origin->x[i], vy(o) = origin->y[i], vz(o) = origin->z[i];
+    vx(d) = dir->x[i], vy(d) = dir->y[i], vz(d) = dir->z[i];
+    h.t = tmax[i];
+    triangle[i] = bvh_trace(b, o, d, &h, 0);
+    tmax[i] = h.t;
+  }
+}
@@ -0,0 +1,98 @@
+/*
+ *  bvh.h
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#ifndef __BVH_H__
+#define __BVH_H__
+
+#include "aabb.h"
+#include "stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Bounding volume hierarchy over a triangle soup: triangle i is
+ * vertices[3 * i], vertices[3 * i + 1], vertices[3 * i + 2].
+ *
+ * Nodes are flattened into one array aligned to MATH_ALIGNMENT, each node
+ * filling half (float) or all (double) of a 64 byte cache line. Inner nodes
+ * keep their two children next to each other at index first and first + 1,
+ * always after the parent; leaves reference count entries of indices
+ * starting at first.
+ **/
+typedef struct bvh_node_t {
+  aabb_t box;
+  unsigned int first;
+  unsigned int count; /* 0 for inner nodes */
+#ifndef MATH_SINGLE_PRECISION
+  unsigned int pad[2];
+#endif
+} bvh_node_t;
+
+typedef struct bvh_t {
+  bvh_node_t *nodes;
+  unsigned int *indices; /* triangle order referenced by the leaves */
+  size_t node_count;
+  size_t count;
+  const vec3_t *vertices; /* not owned, read again by bvh_refit */
+} bvh_t;
+
+typedef struct bvh_hit_t {
+  real_t t, u, v; /* hit = origin + t * dir = (1-u-v) v0 + u v1 + v v2 */
+  int triangle;   /* -1 when nothing was hit */
+} bvh_hit_t;
+
+/**
+ * Builds the tree with binned SAH (12 bins on each axis). vertices must
+ * outlive the tree. Float builds take at most 2^24 triangles, the indices
+ * bvh_intersect_packet can carry exactly in real_t lanes. Returns 0 on
+ * success, 1 for too many triangles, -1 when out of memory.
+ **/
+int bvh_build(bvh_t *b, const vec3_t *vertices, size_t count);
+void bvh_free(bvh_t *b);
+
+/**
+ * Recomputes every bounding box from the current vertices, keeping the
+ * topology. Cheap enough for animated meshes, but the tree degrades when
+ * triangles move far from where they were at build time.
+ **/
+void bvh_refit(bvh_t *b);
+
+/**
+ * Nearest triangle hit by origin + t * dir with 0 <= t < tmax. Returns the
+ * triangle index or -1; hit may be NULL. dir needs not be normalized, t is
+ * in units of dir. Edges are widened by a few epsilon, so a ray through an
+ * edge shared by two triangles hits one of them in every build.
+ **/
+int bvh_intersect(const bvh_t *b, const vec3_t origin, const vec3_t dir,
+                  real_t tmax, bvh_hit_t *hit);
+
+/* 1 when any triangle is hit with 0 <= t < tmax, for line-of-sight tests */
+int bvh_occluded(const bvh_t *b, const vec3_t origin, const vec3_t dir,
+                 real_t tmax);
+
+/**
+ * Packet traversal of count rays: rv_lanes rays (4 or 8 floats, 2 or 4
+ * doubles, see simd.h) walk the tree together and share node visits. SSE2
+ * double builds trace pairs; wider packets visit more nodes per ray when
+ * the rays diverge. On entry tmax[i] bounds ray i, on return it holds the
+ * nearest hit distance and triangle[i] the triangle index or -1.
+ **/
+void bvh_intersect_packet(const bvh_t *b, const vec3s_t *origin,
+                          const vec3s_t *dir, real_t *tmax, int *triangle,
+                          size_t count);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __BVH_H__ */
@@ -0,0 +1,168 @@
+/*
+ *  frustum.c
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#include "frustum.h"
+#include "simd.h"
+
+/* plane = row 3 + sign * row k */
+static void frustum_plane(vec4_t p, const mat44_t e, int k, real_t sign) {
+  real_t ls;
+
+  vx(p) = e[3] + sign * e[k];
+  vy(p) = e[7] + sign * e[4 + k];
+  vz(p) = e[11] + sign * e[8 + k];
+  vw(p) = e[15] + sign * e[12 + k];
+
+  ls = vec3_len(p);
+  if (!r_equal(ls, r_zero))
+    vec4_scale(p, p, r_one / ls);
+}
+
+void frustum_extract(frustum_t *f, const mat44_t e) {
+  frustum_plane(f->planes[FRUSTUM_LEFT], e, 0, r_one);
+  frustum_plane(f->planes[FRUSTUM_RIGHT], e, 0, r_negone);
+  frustum_plane(f->planes[FRUSTUM_BOTTOM], e, 1, r_one);
+  frustum_plane(f->planes[FRUSTUM_TOP], e, 1, r_negone);
+  frustum_plane(f->planes[FRUSTUM_NEAR], e, 2, r_one);
+  frustum_plane(f->planes[FRUSTUM_FAR], e, 2, r_negone);
+}
+
+#ifdef MATH_SIMD
+/* planes broadcast once per call, the stores to visible may alias f */
+typedef struct frustum_lanes_t {
+  rv_t x[FRUSTUM_PLANES], y[FRUSTUM_PLANES], z[FRUSTUM_PLANES];
+  rv_t w[FRUSTUM_PLANES];
+  rv_t ax[FRUSTUM_PLANES], ay[FRUSTUM_PLANES], az[FRUSTUM_PLANES];
+} frustum_lanes_t;
+
+static void frustum_lanes(frustum_lanes_t *l, const frustum_t *f) {
+  int k;
+
+  for (k = 0; k < FRUSTUM_PLANES; ++k) {
+    l->x[k] = rv_set1(vx(f->planes[k]));
+    l->y[k] = rv_set1(vy(f->planes[k]));
+    l->z[k] = rv_set1(vz(f->planes[k]));
+    l->w[k] = rv_set1(vw(f->planes[k]));
+    l->ax[k] = rv_set1(r_abs(vx(f->planes[k])));
+    l->ay[k] = rv_set1(r_abs(vy(f->planes[k])));
+    l->az[k] = rv_set1(r_abs(vz(f->planes[k])));
+  }
+}
+#endif
+
+size_t frustum_cull_spheres(unsigned char *visible, const frustum_t *f,
+                            const vec3s_t *center, const real_t *radius,
+                            size_t count) {
+  size_t i = 0, n = 0;
+  int k;
+
+#ifdef MATH_SIMD
+  frustum_lanes_t l;
+
+  frustum_lanes(&l, f);
+  for (; i + rv_lanes <= count; i += rv_lanes) {
+    rv_t cx = rv_load(center->x + i);
+    rv_t cy = rv_load(center->y + i);
+    rv_t cz = rv_load(center->z + i);
+    rv_t nr = rv_sub(rv_zero(), rv_load(radius + i));
+    rv_t out = rv_zero();
+    int m, j;
+
+    for (k = 0; k < FRUSTUM_PLANES; ++k) {
+      rv_t d = rv_madd(cx, l.x[k], l.w[k]);
+      d = rv_madd(cy, l.y[k], d);
+      d = rv_madd(cz, l.z[k], d);
+      out = rv_or(out, rv_cmplt(d, nr));
+    }
+
+    m = rv_movemask(out);
+    for (j = 0; j < rv_lanes; ++j) {
+      visible[i + j] = !((m >> j) & 1);
+      n += visible[i + j];
+    }
+  }
+#endif
+
+  for (; i < count; ++i) {
+    visible[i] = 1;
+    for (k = 0; k < FRUSTUM_PLANES; ++k) {
+      const real_t *p = f->planes[k];
+      real_t d = vx(p) * center->x[i] + vy(p) * center->y[i] +
+                 vz(p) * center->z[i] + vw(p);
+      if (d < -radius[i]) {
+        visible[i] = 0;
+        break;
+      }
+    }
+    n += visible[i];
+  }
+
+  return n;
+}
+
+size_t frustum_cull_aabbs(unsigned char *visible, const frustum_t *f,
+                          const vec3s_t *center, const vec3s_t *extent,
+                          size_t count) {
+  size_t i = 0, n = 0;
+  int k;
+
+  /* a box reaches |n.x|*ex + |n.y|*ey + |n.z|*ez past its center */
+
+#ifdef MATH_SIMD
+  frustum_lanes_t l;
+
+  frustum_lanes(&l, f);
+  for (; i + rv_lanes <= count; i += rv_lanes) {
+    rv_t cx = rv_load(center->x + i);
+    rv_t cy = rv_load(center->y + i);
+    rv_t cz = rv_load(center->z + i);
+    rv_t ex = rv_load(extent->x + i);
+    rv_t ey = rv_load(extent->y + i);
+    rv_t ez = rv_load(extent->z + i);
+    rv_t out = rv_zero();
+    int m, j;
+
+    for (k = 0; k < FRUSTUM_PLANES; ++k) {
+      rv_t d = rv_madd(cx, l.x[k], l.w[k]);
+      rv_t r = rv_mul(ex, l.ax[k]);
+      d = rv_madd(cy, l.y[k], d);
+      d = rv_madd(cz, l.z[k], d);
+      r = rv_madd(ey, l.ay[k], r);
+      r = rv_madd(ez, l.az[k], r);
+      out = rv_or(out, rv_cmplt(rv_add(d, r), rv_zero()));
+    }
+
+    m = rv_movemask(out);
+    for (j = 0; j < rv_lanes; ++j) {
+      visible[i + j] = !((m >> j) & 1);
+      n += visible[i + j];
+    }
+  }
+#endif
+
+  for (; i < count; ++i) {
+    visible[i] = 1;
+    for (k = 0; k < FRUSTUM_PLANES; ++k) {
+      const real_t *p = f->planes[k];
+      real_t d = vx(p) * center->x[i] + vy(p) * center->y[i] +
+                 vz(p) * center->z[i] + vw(p);
+      real_t r = r_abs(vx(p)) * extent->x[i] + r_abs(vy(p)) * extent->y[i] +
+                 r_abs(vz(p)) * extent->z[i];
+      if (d + r < r_zero) {
+        visible[i] = 0;
+        break;
+      }
+    }
+    n += visible[i];
+  }
+
+  return n;
+}
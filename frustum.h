@@ -0,0 +1,68 @@
+/*
+ *  frustum.h
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#ifndef __FRUSTUM_H__
+#define __FRUSTUM_H__
+
+#include "matrix.h"
+#include "stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+  FRUSTUM_LEFT = 0,
+  FRUSTUM_RIGHT,
+  FRUSTUM_BOTTOM,
+  FRUSTUM_TOP,
+  FRUSTUM_NEAR,
+  FRUSTUM_FAR,
+  FRUSTUM_PLANES
+};
+
+/**
+ * Six planes (a, b, c, d) with unit normals pointing inside, so a point p
+ * is inside a plane when a*px + b*py + c*pz + d >= 0.
+ **/
+typedef struct frustum_t {
+  vec4_t planes[FRUSTUM_PLANES];
+} frustum_t;
+
+/**
+ * Planes of the clip volume of e (Gribb-Hartmann), -w <= x, y, z <= w as
+ * produced by mat44_frustum, mat44_perspective and mat44_ortho. With a
+ * view-projection matrix the planes are in world space, with a projection
+ * alone in view space.
+ **/
+void frustum_extract(frustum_t *f, const mat44_t e);
+
+/**
+ * Batch culling. visible[i] is 1 when object i may intersect f and 0 when
+ * it lies entirely outside one plane; the tests are conservative near the
+ * frustum corners. Both return the number of visible objects.
+ **/
+
+/* spheres at center[i] of radius[i] */
+size_t frustum_cull_spheres(unsigned char *visible, const frustum_t *f,
+                            const vec3s_t *center, const real_t *radius,
+                            size_t count);
+
+/* axis aligned boxes at center[i] with half sizes extent[i] */
+size_t frustum_cull_aabbs(unsigned char *visible, const frustum_t *f,
+                          const vec3s_t *center, const vec3s_t *extent,
+                          size_t count);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __FRUSTUM_H__ */
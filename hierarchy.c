@@ -0,0 +1,133 @@
+/*
+ *  hierarchy.c
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#include "hierarchy.h"
+
+#define hierarchy_align(n) (((n) + MATH_ALIGNMENT - 1) & ~(MATH_ALIGNMENT - 1))
+
+int hierarchy_alloc(hierarchy_t *h, size_t capacity) {
+  size_t world = hierarchy_align(sizeof(mat44_t) * capacity);
+  size_t translation = hierarchy_align(sizeof(vec3_t) * capacity);
+  size_t rotation = hierarchy_align(sizeof(quat_t) * capacity);
+  size_t scale = hierarchy_align(sizeof(vec3_t) * capacity);
+  size_t parent = hierarchy_align(sizeof(int) * capacity);
+  char *p = (char *)math_alloc(world + translation + rotation + scale +
+                               parent + capacity);
+
+  memset(h, 0, sizeof(hierarchy_t));
+  if (!p)
+    return -1;
+
+  /* world first, it is the block handed to math_free */
+  h->world = (mat44_t *)p, p += world;
+  h->translation = (vec3_t *)p, p += translation;
+  h->rotation = (quat_t *)p, p += rotation;
+  h->scale = (vec3_t *)p, p += scale;
+  h->parent = (int *)p, p += parent;
+  h->dirty = (unsigned char *)p;
+  h->capacity = capacity;
+
+  return 0;
+}
+
+void hierarchy_free(hierarchy_t *h) {
+  math_free(h->world);
+  memset(h, 0, sizeof(hierarchy_t));
+}
+
+int hierarchy_add(hierarchy_t *h, int parent) {
+  size_t i = h->count;
+
+  if (i >= h->capacity || parent >= (int)i || parent < -1)
+    return -1;
+
+  h->parent[i] = parent;
+  vec3_zero(h->translation[i]);
+  qw(h->rotation[i]) = r_one;
+  qx(h->rotation[i]) = qy(h->rotation[i]) = qz(h->rotation[i]) = r_zero;
+  vx(h->scale[i]) = vy(h->scale[i]) = vz(h->scale[i]) = r_one;
+  mat44_identity(h->world[i]);
+  h->count += 1;
+
+  hierarchy_mark(h, (int)i);
+  return (int)i;
+}
+
+void hierarchy_set_translation(hierarchy_t *h, int node, const vec3_t t) {
+  vx(h->translation[node]) = vx(t);
+  vy(h->translation[node]) = vy(t);
+  vz(h->translation[node]) = vz(t);
+  hierarchy_mark(h, node);
+}
+
+void hierarchy_set_rotation(hierarchy_t *h, int node, const quat_t q) {
+  qx(h->rotation[node]) = qx(q);
+  qy(h->rotation[node]) = qy(q);
+  qz(h->rotation[node]) = qz(q);
+  qw(h->rotation[node]) = qw(q);
+  hierarchy_mark(h, node);
+}
+
+void hierarchy_set_scale(hierarchy_t *h, int node, const vec3_t s) {
+  vx(h->scale[node]) = vx(s);
+  vy(h->scale[node]) = vy(s);
+  vz(h->scale[node]) = vz(s);
+  hierarchy_mark(h, node);
+}
+
+void hierarchy_mark(hierarchy_t *h, int node) {
+  h->dirty[node] = 1;
+  if ((size_t)node < h->first_dirty || h->first_dirty >= h->count)
+    h->first_dirty = (size_t)node;
+}
+
+/* r = T * R * S */
+static void hierarchy_local(mat44_t r, const vec3_t t, const quat_t q,
+                            const vec3_t s) {
+  mat33_t m;
+
+  quat_tomatrix(m, q);
+
+  e0(r) = e0(m) * vx(s), e1(r) = e1(m) * vx(s), e2(r) = e2(m) * vx(s);
+  e4(r) = e3(m) * vy(s), e5(r) = e4(m) * vy(s), e6(r) = e5(m) * vy(s);
+  e8(r) = e6(m) * vz(s), e9(r) = e7(m) * vz(s), e10(r) = e8(m) * vz(s);
+  e12(r) = vx(t), e13(r) = vy(t), e14(r) = vz(t);
+
+  e3(r) = e7(r) = e11(r) = r_zero;
+  e15(r) = r_one;
+}
+
+void hierarchy_update(hierarchy_t *h) {
+  size_t i;
+
+  for (i = h->first_dirty; i < h->count; ++i) {
+    int p = h->parent[i];
+
+    /* parents come first, so their flag is already final */
+    if (p >= 0 && h->dirty[p])
+      h->dirty[i] = 1;
+    if (!h->dirty[i])
+      continue;
+
+    if (p < 0)
+      hierarchy_local(h->world[i], h->translation[i], h->rotation[i],
+                      h->scale[i]);
+    else {
+      mat44_t local;
+      hierarchy_local(local, h->translation[i], h->rotation[i], h->scale[i]);
+      mat44_mul_affine(h->world[i], h->world[p], local);
+    }
+  }
+
+  if (h->first_dirty < h->count)
+    memset(h->dirty + h->first_dirty, 0, h->count - h->first_dirty);
+  h->first_dirty = h->count;
+}
@@ -0,0 +1,68 @@
+/*
+ *  hierarchy.h
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#ifndef __HIERARCHY_H__
+#define __HIERARCHY_H__
+
+#include "matrix.h"
+#include "quaternion.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Transform hierarchy stored as flat arrays sorted by parent: a node is
+ * always added after its parent, so parent[i] < i and one forward pass
+ * sees every parent before its children.
+ *
+ * Each node holds a local translation, rotation and scale (world = parent
+ * world * T * R * S). Setters mark the node dirty; hierarchy_update then
+ * recomputes the world matrix of the dirty nodes and their descendants
+ * only, starting at the lowest dirty index. world is one contiguous
+ * mat44_t array that can be handed to batch kernels or uploaded as is.
+ **/
+typedef struct hierarchy_t {
+  size_t count, capacity;
+  size_t first_dirty; /* count when nothing is dirty */
+  int *parent;        /* -1 for roots */
+  vec3_t *translation;
+  quat_t *rotation;
+  vec3_t *scale;
+  mat44_t *world;
+  unsigned char *dirty;
+} hierarchy_t;
+
+/* returns 0 on success, -1 when out of memory */
+int hierarchy_alloc(hierarchy_t *h, size_t capacity);
+void hierarchy_free(hierarchy_t *h);
+
+/**
+ * Appends a node with identity TRS under parent (-1 for a root). Returns
+ * the node index, or -1 when full or parent is not an existing node.
+ **/
+int hierarchy_add(hierarchy_t *h, int parent);
+
+void hierarchy_set_translation(hierarchy_t *h, int node, const vec3_t t);
+void hierarchy_set_rotation(hierarchy_t *h, int node, const quat_t q);
+void hierarchy_set_scale(hierarchy_t *h, int node, const vec3_t s);
+
+/* marks a node whose TRS was written in place */
+void hierarchy_mark(hierarchy_t *h, int node);
+
+/* recomputes the world matrices of dirty subtrees */
+void hierarchy_update(hierarchy_t *h);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __HIERARCHY_H__ */
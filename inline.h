@@ -0,0 +1,264 @@
+/*
+ *  inline.h
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#ifndef __INLINE_H__
+#define __INLINE_H__
+
+#include "quaternion.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Function forms of the macros that read an input after writing the
+ * output. Each argument is evaluated once.
+ *
+ * The *_i functions take r_restrict pointers: r must not overlap any input
+ * (inputs may overlap each other). The *_inplace functions overwrite their
+ * first argument and accept any aliasing, e.g. mat44_mul_inplace(a, a).
+ **/
+
+/**
+ *---------------------------------------------
+ *  Vector
+ *---------------------------------------------
+ **/
+
+r_inline void vec3_cross_i(real_t *r_restrict r, const real_t *a,
+                           const real_t *b) {
+  vec3_cross(r, a, b);
+}
+
+/* a = a x b */
+r_inline void vec3_cross_inplace(vec3_t a, const vec3_t b) {
+  vec3_t t;
+  vec3_cross_i(t, a, b);
+  vx(a) = vx(t), vy(a) = vy(t), vz(a) = vz(t);
+}
+
+/**
+ *---------------------------------------------
+ *  Matrix22
+ *---------------------------------------------
+ **/
+
+r_inline void mat22_mul_i(real_t *r_restrict r, const real_t *a,
+                          const real_t *b) {
+  mat22_mul(r, a, b);
+}
+
+r_inline void mat22_inverse_i(real_t *r_restrict r, const real_t *e) {
+  mat22_inverse(r, e);
+}
+
+r_inline void mat22_transpose_i(real_t *r_restrict r, const real_t *e) {
+  mat22_transpose(r, e);
+}
+
+r_inline void mat22_transform2_i(real_t *r_restrict r, const real_t *e,
+                                 const real_t *v) {
+  mat22_transform2(r, e, v);
+}
+
+/* a = a * b */
+r_inline void mat22_mul_inplace(mat22_t a, const mat22_t b) {
+  mat22_t t;
+  mat22_mul_i(t, a, b);
+  memcpy(a, t, sizeof(mat22_t));
+}
+
+/* b = a * b */
+r_inline void mat22_premul_inplace(const mat22_t a, mat22_t b) {
+  mat22_t t;
+  mat22_mul_i(t, a, b);
+  memcpy(b, t, sizeof(mat22_t));
+}
+
+r_inline void mat22_inverse_inplace(mat22_t e) {
+  mat22_t t;
+  mat22_inverse_i(t, e);
+  memcpy(e, t, sizeof(mat22_t));
+}
+
+r_inline void mat22_transpose_inplace(mat22_t e) {
+  real_t t = e1(e);
+  e1(e) = e2(e), e2(e) = t;
+}
+
+/* v = e * v */
+r_inline void mat22_transform2_inplace(vec2_t v, const mat22_t e) {
+  vec2_t t;
+  mat22_transform2_i(t, e, v);
+  vx(v) = vx(t), vy(v) = vy(t);
+}
+
+/**
+ *---------------------------------------------
+ *  Matrix33
+ *---------------------------------------------
+ **/
+
+r_inline void mat33_mul_i(real_t *r_restrict r, const real_t *a,
+                          const real_t *b) {
+  mat33_mul(r, a, b);
+}
+
+r_inline void mat33_inverse_i(real_t *r_restrict r, const real_t *e) {
+  mat33_inverse(r, e);
+}
+
+r_inline void mat33_transpose_i(real_t *r_restrict r, const real_t *e) {
+  mat33_transpose(r, e);
+}
+
+r_inline void mat33_transform3_i(real_t *r_restrict r, const real_t *e,
+                                 const real_t *v) {
+  mat33_transform3(r, e, v);
+}
+
+/* a = a * b */
+r_inline void mat33_mul_inplace(mat33_t a, const mat33_t b) {
+  mat33_t t;
+  mat33_mul_i(t, a, b);
+  memcpy(a, t, sizeof(mat33_t));
+}
+
+/* b = a * b */
+r_inline void mat33_premul_inplace(const mat33_t a, mat33_t b) {
+  mat33_t t;
+  mat33_mul_i(t, a, b);
+  memcpy(b, t, sizeof(mat33_t));
+}
+
+r_inline void mat33_inverse_inplace(mat33_t e) {
+  mat33_t t;
+  mat33_inverse_i(t, e);
+  memcpy(e, t, sizeof(mat33_t));
+}
+
+r_inline void mat33_transpose_inplace(mat33_t e) {
+  real_t t;
+  t = e1(e), e1(e) = e3(e), e3(e) = t;
+  t = e2(e), e2(e) = e6(e), e6(e) = t;
+  t = e5(e), e5(e) = e7(e), e7(e) = t;
+}
+
+/* v = e * v */
+r_inline void mat33_transform3_inplace(vec3_t v, const mat33_t e) {
+  vec3_t t;
+  mat33_transform3_i(t, e, v);
+  vx(v) = vx(t), vy(v) = vy(t), vz(v) = vz(t);
+}
+
+/**
+ *---------------------------------------------
+ *  Matrix44
+ *---------------------------------------------
+ **/
+
+r_inline void mat44_mul_i(real_t *r_restrict r, const real_t *a,
+                          const real_t *b) {
+  mat44_mul(r, a, b);
+}
+
+r_inline void mat44_inverse_i(real_t *r_restrict r, const real_t *e) {
+  mat44_inverse(r, e);
+}
+
+r_inline void mat44_transpose_i(real_t *r_restrict r, const real_t *e) {
+  mat44_transpose(r, e);
+}
+
+r_inline void mat44_transform3_i(real_t *r_restrict r, const real_t *e,
+                                 const real_t *v) {
+  mat44_transform3(r, e, v);
+}
+
+r_inline void mat44_transform4_i(real_t *r_restrict r, const real_t *e,
+                                 const real_t *v) {
+  mat44_transform4(r, e, v);
+}
+
+/* a = a * b */
+r_inline void mat44_mul_inplace(mat44_t a, const mat44_t b) {
+  mat44_t t;
+  mat44_mul_i(t, a, b);
+  memcpy(a, t, sizeof(mat44_t));
+}
+
+/* b = a * b */
+r_inline void mat44_premul_inplace(const mat44_t a, mat44_t b) {
+  mat44_t t;
+  mat44_mul_i(t, a, b);
+  memcpy(b, t, sizeof(mat44_t));
+}
+
+r_inline void mat44_inverse_inplace(mat44_t e) {
+  mat44_t t;
+  mat44_inverse_i(t, e);
+  memcpy(e, t, sizeof(mat44_t));
+}
+
+r_inline void mat44_transpose_inplace(mat44_t e) {
+  real_t t;
+  t = e1(e), e1(e) = e4(e), e4(e) = t;
+  t = e2(e), e2(e) = e8(e), e8(e) = t;
+  t = e3(e), e3(e) = e12(e), e12(e) = t;
+  t = e6(e), e6(e) = e9(e), e9(e) = t;
+  t = e7(e), e7(e) = e13(e), e13(e) = t;
+  t = e11(e), e11(e) = e14(e), e14(e) = t;
+}
+
+/* v = e * (v, 1), xyz only */
+r_inline void mat44_transform3_inplace(vec3_t v, const mat44_t e) {
+  vec3_t t;
+  mat44_transform3_i(t, e, v);
+  vx(v) = vx(t), vy(v) = vy(t), vz(v) = vz(t);
+}
+
+/* v = e * v */
+r_inline void mat44_transform4_inplace(vec4_t v, const mat44_t e) {
+  vec4_t t;
+  mat44_transform4_i(t, e, v);
+  memcpy(v, t, sizeof(vec4_t));
+}
+
+/**
+ *---------------------------------------------
+ *  Quaternion
+ *---------------------------------------------
+ **/
+
+r_inline void quat_mul_i(real_t *r_restrict r, const real_t *a,
+                         const real_t *b) {
+  quat_mul(r, a, b);
+}
+
+/* a = a * b */
+r_inline void quat_mul_inplace(quat_t a, const quat_t b) {
+  quat_t t;
+  quat_mul_i(t, a, b);
+  memcpy(a, t, sizeof(quat_t));
+}
+
+/* b = a * b */
+r_inline void quat_premul_inplace(const quat_t a, quat_t b) {
+  quat_t t;
+  quat_mul_i(t, a, b);
+  memcpy(b, t, sizeof(quat_t));
+}
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __INLINE_H__ */
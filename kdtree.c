@@ -0,0 +1,387 @@
+/*
+ *  kdtree.c
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#include "kdtree.h"
+#include "parallel.h"
+#include <string.h>
+
+/* queries per stolen range, tree walks vary a lot in cost */
+#define kdtree_batch_grain 64
+
+/* largest k whose heap lives on the stack */
+#define kdtree_knn_stack 64
+
+#define kdtree_swap(t, i, j)                                                   \
+  do {                                                                         \
+    vec3_t p;                                                                  \
+    unsigned int n = (t)->indices[i];                                          \
+    memcpy(p, (t)->points[i], sizeof(vec3_t));                                 \
+    memcpy((t)->points[i], (t)->points[j], sizeof(vec3_t));                    \
+    memcpy((t)->points[j], p, sizeof(vec3_t));                                 \
+    (t)->indices[i] = (t)->indices[j];                                         \
+    (t)->indices[j] = n;                                                       \
+  } while (0)
+
+/* moves the nth smallest along axis to n, smaller ones before it */
+static void kdtree_select(kdtree_t *t, size_t lo, size_t hi, size_t n,
+                          int axis) {
+  while (hi - lo > 2) {
+    ptrdiff_t i = (ptrdiff_t)lo, j = (ptrdiff_t)hi - 1;
+    size_t mid = lo + (hi - lo) / 2;
+    real_t pivot;
+
+    /* median of three, which also guards both scans */
+    if (t->points[mid][axis] < t->points[lo][axis])
+      kdtree_swap(t, mid, lo);
+    if (t->points[hi - 1][axis] < t->points[lo][axis])
+      kdtree_swap(t, hi - 1, lo);
+    if (t->points[hi - 1][axis] < t->points[mid][axis])
+      kdtree_swap(t, hi - 1, mid);
+    pivot = t->points[mid][axis];
+
+    /* Hoare partition, keys equal to the pivot spread over both sides */
+    while (i <= j) {
+      while (t->points[i][axis] < pivot)
+        ++i;
+      while (t->points[j][axis] > pivot)
+        --j;
+      if (i <= j) {
+        kdtree_swap(t, i, j);
+        ++i, --j;
+      }
+    }
+
+    if ((ptrdiff_t)n <= j)
+      hi = (size_t)j + 1;
+    else if ((ptrdiff_t)n >= i)
+      lo = (size_t)i;
+    else
+      return;
+  }
+
+  if (hi - lo == 2 && t->points[lo + 1][axis] < t->points[lo][axis])
+    kdtree_swap(t, lo, lo + 1);
+}
+
+static void kdtree_split(kdtree_t *t, size_t lo, size_t hi) {
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2, i;
+    vec3_t min, max;
+    int axis = 0;
+
+    /* split along the widest extent of the range */
+    memcpy(min, t->points[lo], sizeof(vec3_t));
+    memcpy(max, t->points[lo], sizeof(vec3_t));
+    for (i = lo + 1; i < hi; ++i) {
+      int k;
+      for (k = 0; k < 3; ++k) {
+        if (t->points[i][k] < min[k])
+          min[k] = t->points[i][k];
+        if (t->points[i][k] > max[k])
+          max[k] = t->points[i][k];
+      }
+    }
+    if (max[1] - min[1] > max[axis] - min[axis])
+      axis = 1;
+    if (max[2] - min[2] > max[axis] - min[axis])
+      axis = 2;
+
+    kdtree_select(t, lo, hi, mid, axis);
+    t->axis[mid] = (unsigned char)axis;
+
+    /* recurse on the smaller half, loop on the larger */
+    if (mid - lo < hi - mid - 1) {
+      kdtree_split(t, lo, mid);
+      lo = mid + 1;
+    } else {
+      kdtree_split(t, mid + 1, hi);
+      hi = mid;
+    }
+  }
+
+  if (hi - lo == 1)
+    t->axis[lo] = 0;
+}
+
+int kdtree_build(kdtree_t *t, const vec3_t *points, size_t count) {
+  size_t n = count ? count : 1, i;
+  char *p = (char *)math_alloc(
+      (sizeof(vec3_t) + sizeof(unsigned int) + sizeof(unsigned char)) * n);
+
+  memset(t, 0, sizeof(kdtree_t));
+  if (!p)
+    return -1;
+
+  t->points = (vec3_t *)p;
+  t->indices = (unsigned int *)(p + sizeof(vec3_t) * n);
+  t->axis = (unsigned char *)(t->indices + n);
+  t->count = count;
+
+  memcpy(t->points, points, sizeof(vec3_t) * count);
+  for (i = 0; i < count; ++i)
+    t->indices[i] = (unsigned int)i;
+
+  kdtree_split(t, 0, count);
+  return 0;
+}
+
+void kdtree_free(kdtree_t *t) {
+  math_free(t->points);
+  memset(t, 0, sizeof(kdtree_t));
+}
+
+/**
+ *---------------------------------------------
+ *  Queries
+ *---------------------------------------------
+ **/
+
+/* max-heap of the k best candidates so far, worst at the root */
+typedef struct kdtree_heap_t {
+  unsigned int *index;
+  real_t *distsq;
+  size_t size, k;
+} kdtree_heap_t;
+
+static void kdtree_heap_push(kdtree_heap_t *h, unsigned int index,
+                             real_t distsq) {
+  size_t i;
+
+  if (h->size < h->k)
+    i = h->size++;
+  else if (distsq < h->distsq[0]) {
+    /* sift down a hole from the root, then fill it */
+    size_t c;
+    for (i = 0; (c = i * 2 + 1) < h->size; i = c) {
+      if (c + 1 < h->size && h->distsq[c + 1] > h->distsq[c])
+        ++c;
+      if (h->distsq[c] <= distsq)
+        break;
+      h->distsq[i] = h->distsq[c];
+      h->index[i] = h->index[c];
+    }
+    h->distsq[i] = distsq;
+    h->index[i] = index;
+    return;
+  } else
+    return;
+
+  /* sift up */
+  while (i > 0 && h->distsq[(i - 1) / 2] < distsq) {
+    h->distsq[i] = h->distsq[(i - 1) / 2];
+    h->index[i] = h->index[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+  h->distsq[i] = distsq;
+  h->index[i] = index;
+}
+
+static void kdtree_knn_search(const kdtree_t *t, const vec3_t p, size_t lo,
+                              size_t hi, kdtree_heap_t *h) {
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    int axis = t->axis[mid];
+    real_t d = p[axis] - t->points[mid][axis];
+    vec3_t v;
+
+    vec3_sub(v, p, t->points[mid]);
+    kdtree_heap_push(h, t->indices[mid], vec3_lensq(v));
+
+    /* near side first, far side only when the plane is close enough */
+    if (d < r_zero) {
+      kdtree_knn_search(t, p, lo, mid, h);
+      if (h->size == h->k && d * d >= h->distsq[0])
+        return;
+      lo = mid + 1;
+    } else {
+      kdtree_knn_search(t, p, mid + 1, hi, h);
+      if (h->size == h->k && d * d >= h->distsq[0])
+        return;
+      hi = mid;
+    }
+  }
+}
+
+size_t kdtree_knn(const kdtree_t *t, const vec3_t p, size_t k,
+                  unsigned int *index, real_t *distsq) {
+  unsigned int hi[kdtree_knn_stack];
+  real_t hd[kdtree_knn_stack];
+  kdtree_heap_t h;
+  size_t n;
+  int owned = 0;
+
+  if (k == 0)
+    return 0;
+
+  /**
+   * The heap sorts in place, each pop filling the slot it frees, so it
+   * can live in index and distsq themselves. Small k without them uses
+   * the stack, larger k allocates.
+   **/
+  if (index && distsq) {
+    h.index = index, h.distsq = distsq;
+  } else if (k <= kdtree_knn_stack) {
+    h.index = hi, h.distsq = hd;
+  } else {
+    h.index = (unsigned int *)malloc(sizeof(unsigned int) * k);
+    h.distsq = (real_t *)malloc(sizeof(real_t) * k);
+    owned = 1;
+    if (!h.index || !h.distsq) {
+      free(h.index);
+      free(h.distsq);
+      return 0;
+    }
+  }
+  h.size = 0, h.k = k;
+
+  kdtree_knn_search(t, p, 0, t->count, &h);
+
+  /* pop the heap back to front for nearest first */
+  for (n = h.size; h.size > 0;) {
+    unsigned int i = h.index[0];
+    real_t d = h.distsq[0];
+    unsigned int li = h.index[h.size - 1];
+    real_t ld = h.distsq[h.size - 1];
+
+    h.size -= 1;
+    if (index)
+      index[h.size] = i;
+    if (distsq)
+      distsq[h.size] = d;
+
+    if (h.size > 0) {
+      /* reinsert the last element from the root */
+      size_t j = 0, c;
+      for (; (c = j * 2 + 1) < h.size; j = c) {
+        if (c + 1 < h.size && h.distsq[c + 1] > h.distsq[c])
+          ++c;
+        if (h.distsq[c] <= ld)
+          break;
+        h.distsq[j] = h.distsq[c];
+        h.index[j] = h.index[c];
+      }
+      h.distsq[j] = ld;
+      h.index[j] = li;
+    }
+  }
+
+  if (owned) {
+    free(h.index);
+    free(h.distsq);
+  }
+  return n;
+}
+
+static size_t kdtree_radius_search(const kdtree_t *t, const vec3_t p,
+                                   real_t rsq, size_t lo, size_t hi,
+                                   unsigned int *index, real_t *distsq,
+                                   size_t max, size_t found) {
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    int axis = t->axis[mid];
+    real_t d = p[axis] - t->points[mid][axis], ls;
+    vec3_t v;
+
+    vec3_sub(v, p, t->points[mid]);
+    if ((ls = vec3_lensq(v)) <= rsq) {
+      if (found < max) {
+        if (index)
+          index[found] = t->indices[mid];
+        if (distsq)
+          distsq[found] = ls;
+      }
+      ++found;
+    }
+
+    if (d * d <= rsq) {
+      found = kdtree_radius_search(t, p, rsq, lo, mid, index, distsq, max,
+                                   found);
+      lo = mid + 1;
+    } else if (d < r_zero)
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+
+  return found;
+}
+
+size_t kdtree_radius(const kdtree_t *t, const vec3_t p, real_t radius,
+                     unsigned int *index, real_t *distsq, size_t max) {
+  return kdtree_radius_search(t, p, radius * radius, 0, t->count, index,
+                              distsq, max, 0);
+}
+
+typedef struct kdtree_batch_t {
+  const kdtree_t *t;
+  const vec3_t *p;
+  size_t k, max, *found;
+  real_t radius, *distsq;
+  unsigned int *index;
+} kdtree_batch_t;
+
+static void kdtree_knn_range(void *ctx, size_t begin, size_t end) {
+  const kdtree_batch_t *b = (const kdtree_batch_t *)ctx;
+  size_t i, k = b->k;
+
+  for (i = begin; i < end; ++i)
+    kdtree_knn(b->t, b->p[i], k, b->index ? b->index + i * k : NULL,
+               b->distsq ? b->distsq + i * k : NULL);
+}
+
+static void kdtree_radius_range(void *ctx, size_t begin, size_t end) {
+  const kdtree_batch_t *b = (const kdtree_batch_t *)ctx;
+  size_t i, max = b->max;
+
+  for (i = begin; i < end; ++i)
+    b->found[i] =
+        kdtree_radius(b->t, b->p[i], b->radius,
+                      b->index ? b->index + i * max : NULL,
+                      b->distsq ? b->distsq + i * max : NULL, max);
+}
+
+int kdtree_knn_batch(const kdtree_t *t, const vec3_t *p, size_t count,
+                     size_t k, unsigned int *index, real_t *distsq) {
+  unsigned int *si = NULL;
+  real_t *sd = NULL;
+  kdtree_batch_t b;
+
+  /* both arrays for every query past the stack heap, so none allocates */
+  if (k > kdtree_knn_stack && count > 0 && (!index || !distsq)) {
+    if (!index)
+      si = (unsigned int *)malloc(sizeof(unsigned int) * count * k);
+    if (!distsq)
+      sd = (real_t *)malloc(sizeof(real_t) * count * k);
+    if ((!index && !si) || (!distsq && !sd)) {
+      free(si);
+      free(sd);
+      return -1;
+    }
+  }
+
+  b.t = t, b.p = p, b.k = k;
+  b.index = index ? index : si, b.distsq = distsq ? distsq : sd;
+  math_parallel_for(0, count, kdtree_batch_grain, kdtree_knn_range, &b);
+
+  free(si);
+  free(sd);
+  return 0;
+}
+
+void kdtree_radius_batch(const kdtree_t *t, const vec3_t *p, size_t count,
+                         real_t radius, unsigned int *index, real_t *distsq,
+                         size_t max, size_t *found) {
+  kdtree_batch_t b;
+
+  b.t = t, b.p = p, b.radius = radius, b.max = max, b.found = found;
+  b.index = index, b.distsq = distsq;
+  math_parallel_for(0, count, kdtree_batch_grain, kdtree_radius_range, &b);
+}
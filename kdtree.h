@@ -0,0 +1,73 @@
+/*
+ *  kdtree.h
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#ifndef __KDTREE_H__
+#define __KDTREE_H__
+
+#include "vector.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Static k-d tree over a vec3_t point cloud with an implicit layout: the
+ * node of range [lo, hi) is the point at mid = (lo + hi) / 2, its children
+ * are [lo, mid) and [mid + 1, hi). The build copies the points and median
+ * partitions the copy in place, so there are no node pointers at all,
+ * only one split axis byte per point.
+ **/
+typedef struct kdtree_t {
+  vec3_t *points;        /* reordered copy */
+  unsigned int *indices; /* original index of points[i] */
+  unsigned char *axis;   /* split axis of the node at i */
+  size_t count;
+} kdtree_t;
+
+/* returns 0 on success, -1 when out of memory */
+int kdtree_build(kdtree_t *t, const vec3_t *points, size_t count);
+void kdtree_free(kdtree_t *t);
+
+/**
+ * The k nearest points to p, nearest first. Writes original indices and
+ * squared distances (either may be NULL) and returns min(k, count). With
+ * both arrays given no memory is allocated; with k > 64 and either one
+ * NULL a heap is, and 0 is returned with nothing written when that fails.
+ **/
+size_t kdtree_knn(const kdtree_t *t, const vec3_t p, size_t k,
+                  unsigned int *index, real_t *distsq);
+
+/**
+ * Points within radius of p, in no particular order. Writes at most max
+ * results and returns how many points are in range, which may be more.
+ **/
+size_t kdtree_radius(const kdtree_t *t, const vec3_t p, real_t radius,
+                     unsigned int *index, real_t *distsq, size_t max);
+
+/**
+ * Batched queries, spread over the math_parallel_for pool. Query i
+ * writes k (or max) results at index + i * k and distsq + i * k.
+ * kdtree_knn_batch returns 0, or -1 with nothing written when k > 64,
+ * index or distsq is NULL and the scratch for it cannot be allocated.
+ **/
+int kdtree_knn_batch(const kdtree_t *t, const vec3_t *p, size_t count,
+                     size_t k, unsigned int *index, real_t *distsq);
+
+/* found[i] = kdtree_radius(p[i]) */
+void kdtree_radius_batch(const kdtree_t *t, const vec3_t *p, size_t count,
+                         real_t radius, unsigned int *index, real_t *distsq,
+                         size_t max, size_t *found);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __KDTREE_H__ */
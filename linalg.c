@@ -0,0 +1,433 @@
+/*
+ *  linalg.c
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#include "linalg.h"
+#include "parallel.h"
+#include <string.h>
+
+#define linalg_min(a, b) ((a) < (b) ? (a) : (b))
+
+/* below this many multiply-adds the solvers stay on the calling thread */
+#define linalg_parallel_min (64 * 64 * 64)
+
+/**
+ *---------------------------------------------
+ *  Column solvers
+ *---------------------------------------------
+ **/
+
+/* every right-hand side is independent, so b is split by columns */
+typedef struct solve_job_t {
+  const matn_t *f;
+  const size_t *piv;
+  const real_t *tau;
+  matn_t *b;
+  void (*column)(const struct solve_job_t *s, real_t *x);
+} solve_job_t;
+
+static void solve_range(void *ctx, size_t begin, size_t end) {
+  const solve_job_t *s = (const solve_job_t *)ctx;
+  size_t j;
+
+  for (j = begin; j < end; ++j)
+    s->column(s, &matn_at(s->b, 0, j));
+}
+
+static void solve_run(solve_job_t *s) {
+  if (s->b->cols * s->f->rows * s->f->cols < linalg_parallel_min)
+    solve_range(s, 0, s->b->cols);
+  else
+    math_parallel_for(0, s->b->cols, 1, solve_range, s);
+}
+
+/* x = L^-1 x, L unit lower triangular, cols x cols */
+static void lower_unit(const matn_t *l, real_t *x) {
+  size_t i, j, n = l->cols;
+
+  for (j = 0; j < n; ++j) {
+    const real_t *c = &matn_at(l, 0, j);
+    real_t s = x[j];
+
+    for (i = j + 1; i < n; ++i)
+      x[i] -= c[i] * s;
+  }
+}
+
+/* x = U^-1 x, U upper triangular, cols x cols */
+static void upper(const matn_t *u, real_t *x) {
+  size_t i, j = u->cols;
+
+  while (j-- > 0) {
+    const real_t *c = &matn_at(u, 0, j);
+    real_t s = x[j] /= c[j];
+
+    for (i = 0; i < j; ++i)
+      x[i] -= c[i] * s;
+  }
+}
+
+static void lower_unit_column(const solve_job_t *s, real_t *x) {
+  lower_unit(s->f, x);
+}
+
+static void lu_column(const solve_job_t *s, real_t *x) {
+  size_t j, p;
+  real_t t;
+
+  for (j = 0; j < s->f->cols; ++j)
+    if ((p = s->piv[j]) != j)
+      t = x[j], x[j] = x[p], x[p] = t;
+
+  lower_unit(s->f, x);
+  upper(s->f, x);
+}
+
+static void cholesky_column(const solve_job_t *s, real_t *x) {
+  const matn_t *l = s->f;
+  size_t i, j, n = l->cols;
+
+  for (j = 0; j < n; ++j) {
+    const real_t *c = &matn_at(l, 0, j);
+    real_t t = x[j] /= c[j];
+
+    for (i = j + 1; i < n; ++i)
+      x[i] -= c[i] * t;
+  }
+
+  /* L^T: column j of L is row j of L^T */
+  for (j = n; j-- > 0;) {
+    const real_t *c = &matn_at(l, 0, j);
+    real_t t = x[j];
+
+    for (i = j + 1; i < n; ++i)
+      t -= c[i] * x[i];
+    x[j] = t / c[j];
+  }
+}
+
+/* x = H(j) x, the reflector stored in column j below the diagonal */
+static void reflect(const matn_t *a, size_t j, real_t tau, real_t *x) {
+  const real_t *v = &matn_at(a, 0, j);
+  real_t s = x[j];
+  size_t i;
+
+  if (tau == r_zero)
+    return;
+  for (i = j + 1; i < a->rows; ++i)
+    s += v[i] * x[i];
+  s *= tau;
+  x[j] -= s;
+  for (i = j + 1; i < a->rows; ++i)
+    x[i] -= v[i] * s;
+}
+
+static void qr_column(const solve_job_t *s, real_t *x) {
+  size_t j;
+
+  for (j = 0; j < s->f->cols; ++j)
+    reflect(s->f, j, s->tau[j], x);
+  upper(s->f, x);
+}
+
+/**
+ *---------------------------------------------
+ *  LU
+ *---------------------------------------------
+ **/
+
+int matn_lu(matn_t *a, size_t *piv) {
+  size_t m = a->rows, n = linalg_min(a->rows, a->cols), i, j, k, kb, c;
+  int singular = 0;
+
+  for (k = 0; k < n; k += kb) {
+    kb = linalg_min(linalg_block, n - k);
+
+    /* panel: unblocked right-looking LU of columns k .. k + kb */
+    for (j = k; j < k + kb; ++j) {
+      real_t *x = &matn_at(a, 0, j), big = r_abs(x[j]), r;
+      size_t p = j;
+
+      for (i = j + 1; i < m; ++i)
+        if (r_abs(x[i]) > big)
+          big = r_abs(x[i]), p = i;
+
+      piv[j] = p;
+      if (big == r_zero) {
+        singular = 1;
+        continue;
+      }
+
+      if (p != j)
+        for (c = 0; c < a->cols; ++c) {
+          real_t t = matn_at(a, j, c);
+          matn_at(a, j, c) = matn_at(a, p, c);
+          matn_at(a, p, c) = t;
+        }
+
+      r = r_one / x[j];
+      for (i = j + 1; i < m; ++i)
+        x[i] *= r;
+
+      for (c = j + 1; c < k + kb; ++c) {
+        real_t *y = &matn_at(a, 0, c), s = y[j];
+
+        for (i = j + 1; i < m; ++i)
+          y[i] -= x[i] * s;
+      }
+    }
+
+    if (k + kb < a->cols) {
+      matn_t l11, a12, l21, a22;
+      solve_job_t s;
+
+      /* U12 = L11^-1 A12 */
+      matn_view(&l11, a, k, k, kb, kb);
+      matn_view(&a12, a, k, k + kb, kb, a->cols - k - kb);
+      s.f = &l11, s.b = &a12, s.column = lower_unit_column;
+      solve_run(&s);
+
+      /* A22 -= L21 U12 */
+      if (k + kb < m) {
+        matn_view(&l21, a, k + kb, k, m - k - kb, kb);
+        matn_view(&a22, a, k + kb, k + kb, m - k - kb, a->cols - k - kb);
+        if (matn_gemm(&a22, -r_one, &l21, &a12, r_one) != 0)
+          return -1;
+      }
+    }
+  }
+
+  return singular;
+}
+
+void matn_lu_solve(const matn_t *lu, const size_t *piv, matn_t *b) {
+  solve_job_t s;
+
+  s.f = lu, s.piv = piv, s.b = b, s.column = lu_column;
+  solve_run(&s);
+}
+
+/**
+ *---------------------------------------------
+ *  Cholesky
+ *---------------------------------------------
+ **/
+
+int matn_cholesky(matn_t *a) {
+  size_t n = a->rows, i, j, k, kb, p;
+  matn_t lt;
+  int ret = 0;
+
+  if (matn_alloc(&lt, linalg_block, n) != 0)
+    return -1;
+
+  for (k = 0; k < n && ret == 0; k += kb) {
+    kb = linalg_min(linalg_block, n - k);
+
+    /* panel: left-looking within columns k .. k + kb, all rows below */
+    for (j = k; j < k + kb; ++j) {
+      real_t *x = &matn_at(a, 0, j), d = x[j], r;
+
+      for (p = k; p < j; ++p) {
+        const real_t *y = &matn_at(a, 0, p);
+        real_t s = y[j];
+
+        d -= s * s;
+        for (i = j + 1; i < n; ++i)
+          x[i] -= y[i] * s;
+      }
+
+      if (!(d > r_zero)) {
+        ret = 1;
+        break;
+      }
+
+      x[j] = r_sqrt(d);
+      r = r_one / x[j];
+      for (i = j + 1; i < n; ++i)
+        x[i] *= r;
+    }
+
+    /* A22 -= L21 L21^T, one column block at a time below the diagonal */
+    if (ret == 0 && k + kb < n) {
+      size_t n2 = n - k - kb, jb, w;
+      matn_t l21, t, c, lb, tb;
+
+      matn_view(&l21, a, k + kb, k, n2, kb);
+      matn_view(&t, &lt, 0, 0, kb, n2);
+      matn_transpose(&t, &l21);
+
+      for (jb = 0; jb < n2 && ret == 0; jb += w) {
+        w = linalg_min(linalg_block, n2 - jb);
+        matn_view(&c, a, k + kb + jb, k + kb + jb, n2 - jb, w);
+        matn_view(&lb, &l21, jb, 0, n2 - jb, kb);
+        matn_view(&tb, &t, 0, jb, kb, w);
+        ret = matn_gemm(&c, -r_one, &lb, &tb, r_one);
+      }
+    }
+  }
+
+  matn_free(&lt);
+
+  /* the diagonal blocks of the update also wrote above the diagonal */
+  if (ret == 0)
+    for (j = 1; j < n; ++j)
+      for (i = 0; i < j; ++i)
+        matn_at(a, i, j) = r_zero;
+
+  return ret;
+}
+
+void matn_cholesky_solve(const matn_t *l, matn_t *b) {
+  solve_job_t s;
+
+  s.f = l, s.b = b, s.column = cholesky_column;
+  solve_run(&s);
+}
+
+/**
+ *---------------------------------------------
+ *  QR
+ *---------------------------------------------
+ **/
+
+/* Householder reflector zeroing column j below the diagonal */
+static real_t householder(matn_t *a, size_t j) {
+  real_t *x = &matn_at(a, 0, j), alpha = x[j], norm = r_zero, beta, r;
+  size_t i;
+
+  for (i = j + 1; i < a->rows; ++i)
+    norm += x[i] * x[i];
+  if (norm == r_zero)
+    return r_zero;
+
+  norm = r_sqrt(alpha * alpha + norm);
+  beta = alpha >= r_zero ? -norm : norm;
+  r = r_one / (alpha - beta);
+  for (i = j + 1; i < a->rows; ++i)
+    x[i] *= r;
+  x[j] = beta;
+  return (beta - alpha) / beta;
+}
+
+/**
+ * The kb reflectors of a panel are applied at once as the compact WY form
+ * H(k) .. H(k + kb - 1) = I - V T V^T, so the trailing update is two
+ * matn_gemm calls and a small triangular product.
+ **/
+typedef struct qr_work_t {
+  matn_t v, vt, t, w;
+} qr_work_t;
+
+static void qr_free(qr_work_t *q) {
+  matn_free(&q->v);
+  matn_free(&q->vt);
+  matn_free(&q->t);
+  matn_free(&q->w);
+}
+
+static int qr_update(matn_t *a, const real_t *tau, size_t k, size_t kb,
+                     qr_work_t *q) {
+  size_t m = a->rows - k, n2 = a->cols - k - kb, i, j, p;
+  matn_t v, vt, w, a2;
+
+  /* V explicitly: unit diagonal, zero above */
+  matn_view(&v, &q->v, 0, 0, m, kb);
+  for (j = 0; j < kb; ++j)
+    for (i = 0; i < m; ++i)
+      matn_at(&v, i, j) = i < j    ? r_zero
+                          : i == j ? r_one
+                                   : matn_at(a, k + i, k + j);
+
+  /* T(0..j, j) = -tau[j] T(0..j, 0..j) V(:, 0..j)^T v(j) */
+  for (j = 0; j < kb; ++j) {
+    real_t *t = &matn_at(&q->t, 0, j);
+
+    for (p = 0; p < j; ++p) {
+      const real_t *x = &matn_at(&v, 0, p), *y = &matn_at(&v, 0, j);
+      real_t s = r_zero;
+
+      for (i = j; i < m; ++i)
+        s += x[i] * y[i];
+      t[p] = s;
+    }
+    for (p = 0; p < j; ++p) {
+      real_t s = r_zero;
+
+      for (i = p; i < j; ++i)
+        s += matn_at(&q->t, p, i) * t[i];
+      t[p] = -tau[k + j] * s;
+    }
+    t[j] = tau[k + j];
+  }
+
+  /* W = V^T A2 */
+  matn_view(&vt, &q->vt, 0, 0, kb, m);
+  matn_view(&w, &q->w, 0, 0, kb, n2);
+  matn_view(&a2, a, k, k + kb, m, n2);
+  matn_transpose(&vt, &v);
+  if (matn_gemm(&w, r_one, &vt, &a2, r_zero) != 0)
+    return -1;
+
+  /* W = T^T W, bottom row first so the rows read are still unchanged */
+  for (j = 0; j < n2; ++j) {
+    real_t *x = &matn_at(&w, 0, j);
+
+    for (i = kb; i-- > 0;) {
+      real_t s = r_zero;
+
+      for (p = 0; p <= i; ++p)
+        s += matn_at(&q->t, p, i) * x[p];
+      x[i] = s;
+    }
+  }
+
+  /* A2 -= V W */
+  return matn_gemm(&a2, -r_one, &v, &w, r_one);
+}
+
+int matn_qr(matn_t *a, real_t *tau) {
+  size_t n = a->cols, j, k, kb, c;
+  qr_work_t q;
+  int ret = 0;
+
+  memset(&q, 0, sizeof(q));
+  if (matn_alloc(&q.v, a->rows, linalg_block) ||
+      matn_alloc(&q.vt, linalg_block, a->rows) ||
+      matn_alloc(&q.t, linalg_block, linalg_block) ||
+      matn_alloc(&q.w, linalg_block, n)) {
+    qr_free(&q);
+    return -1;
+  }
+
+  for (k = 0; k < n && ret == 0; k += kb) {
+    kb = linalg_min(linalg_block, n - k);
+
+    /* panel: reflect and apply within columns k .. k + kb */
+    for (j = k; j < k + kb; ++j) {
+      tau[j] = householder(a, j);
+      for (c = j + 1; c < k + kb; ++c)
+        reflect(a, j, tau[j], &matn_at(a, 0, c));
+    }
+
+    if (k + kb < n)
+      ret = qr_update(a, tau, k, kb, &q);
+  }
+
+  qr_free(&q);
+  return ret;
+}
+
+void matn_qr_solve(const matn_t *qr, const real_t *tau, matn_t *b) {
+  solve_job_t s;
+
+  s.f = qr, s.tau = tau, s.b = b, s.column = qr_column;
+  solve_run(&s);
+}
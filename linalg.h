@@ -0,0 +1,72 @@
+/*
+ *  linalg.h
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#ifndef __LINALG_H__
+#define __LINALG_H__
+
+#include "matn.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Dense factorizations in place over matn_t. They work on panels of
+ * linalg_block columns; the trailing matrix is updated with matn_gemm,
+ * which runs on the math_parallel_for pool. The solvers take any number
+ * of right-hand sides as the columns of b and spread them over the pool.
+ *
+ * The factorizations return 0, 1 when the matrix is singular (LU) or not
+ * positive definite (Cholesky), or -1 when out of memory.
+ **/
+
+/* columns per panel */
+#define linalg_block 64
+
+/**
+ * a = P L U with partial pivoting, a is rows x cols. L (unit diagonal) is
+ * stored below the diagonal and U on and above it. Row i was swapped with
+ * row piv[i], piv holds min(rows, cols) entries. A singular a is still
+ * factored, with a zero on the diagonal of U.
+ **/
+int matn_lu(matn_t *a, size_t *piv);
+
+/* b = a^-1 b with lu, piv from matn_lu on a square a */
+void matn_lu_solve(const matn_t *lu, const size_t *piv, matn_t *b);
+
+/**
+ * a = L L^T for a symmetric positive definite a. Only the lower triangle
+ * is read; a is replaced by L with the strict upper triangle zeroed.
+ **/
+int matn_cholesky(matn_t *a);
+
+/* b = a^-1 b with l from matn_cholesky on a */
+void matn_cholesky_solve(const matn_t *l, matn_t *b);
+
+/**
+ * a = Q R by Householder reflections, rows >= cols. R is stored on and
+ * above the diagonal, the reflector H(i) = I - tau[i] v v^T below it with
+ * v[i] = 1 implied. tau holds cols entries.
+ **/
+int matn_qr(matn_t *a, real_t *tau);
+
+/**
+ * Least squares: b is rows x n, the x minimizing |a x - b| for each column
+ * ends up in the first cols rows of b. qr, tau from matn_qr on a with
+ * full column rank.
+ **/
+void matn_qr_solve(const matn_t *qr, const real_t *tau, matn_t *b);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __LINALG_H__ */
@@ -0,0 +1,333 @@
+/*
+ *  mapfile.c
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L /* mmap, fstat */
+#endif
+
+#include "mapfile.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define mapfile_endian 0x01020304u
+
+/* payload pointers keep the file alignment up to one page */
+#define mapfile_page 4096
+
+/* both laid out without padding, 64 and 48 bytes */
+typedef struct map_header_t {
+  char magic[8];
+  uint32_t version;
+  uint32_t endian;
+  uint32_t precision;
+  uint32_t alignment;
+  uint64_t size;
+  uint64_t arrays;
+  unsigned char reserved[24];
+} map_header_t;
+
+typedef struct map_entry_t {
+  char name[mapfile_name_max + 1];
+  uint32_t type;
+  uint32_t stride;
+  uint64_t count;
+  uint64_t offset;
+} map_entry_t;
+
+static const char map_magic[8] = "MATHMAP";
+
+#define map_align(n)                                                           \
+  (((n) + mapfile_alignment - 1) & ~(uint64_t)(mapfile_alignment - 1))
+
+size_t mapfile_stride(mapfile_type_t type) {
+  switch (type) {
+  case MAPFILE_REAL:
+    return sizeof(real_t);
+  case MAPFILE_VEC2:
+    return sizeof(vec2_t);
+  case MAPFILE_VEC3:
+    return sizeof(vec3_t);
+  case MAPFILE_VEC4:
+    return sizeof(vec4_t);
+  case MAPFILE_QUAT:
+    return sizeof(quat_t);
+  case MAPFILE_MAT33:
+    return sizeof(mat33_t);
+  case MAPFILE_MAT44:
+    return sizeof(mat44_t);
+  default:
+    return 0;
+  }
+}
+
+/**
+ *---------------------------------------------
+ *  Writer
+ *---------------------------------------------
+ **/
+
+int mapfile_write(const char *path, const mapfile_array_t *arrays,
+                  size_t count) {
+  static const unsigned char zeros[mapfile_alignment];
+  map_header_t h;
+  map_entry_t e;
+  uint64_t offset, at;
+  size_t i;
+  FILE *fp;
+
+  for (i = 0; i < count; ++i)
+    if (!mapfile_stride(arrays[i].type))
+      return 1;
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, map_magic, sizeof(h.magic));
+  h.version = mapfile_version;
+  h.endian = mapfile_endian;
+  h.precision = sizeof(real_t);
+  h.alignment = mapfile_alignment;
+  h.arrays = count;
+
+  /* table first, then every payload on an aligned offset */
+  offset = sizeof(h) + sizeof(e) * (uint64_t)count;
+  for (i = 0; i < count; ++i)
+    offset = map_align(offset) +
+             mapfile_stride(arrays[i].type) * (uint64_t)arrays[i].count;
+  h.size = offset;
+
+  fp = fopen(path, "wb");
+  if (!fp)
+    return -1;
+
+  if (fwrite(&h, sizeof(h), 1, fp) != 1)
+    goto fail;
+
+  offset = sizeof(h) + sizeof(e) * (uint64_t)count;
+  for (i = 0; i < count; ++i) {
+    memset(&e, 0, sizeof(e));
+    if (arrays[i].name)
+      strncpy(e.name, arrays[i].name, mapfile_name_max);
+    e.type = (uint32_t)arrays[i].type;
+    e.stride = (uint32_t)mapfile_stride(arrays[i].type);
+    e.count = arrays[i].count;
+    e.offset = map_align(offset);
+    offset = e.offset + e.stride * e.count;
+
+    if (fwrite(&e, sizeof(e), 1, fp) != 1)
+      goto fail;
+  }
+
+  at = offset = sizeof(h) + sizeof(e) * (uint64_t)count;
+  for (i = 0; i < count; ++i) {
+    size_t bytes = mapfile_stride(arrays[i].type) * arrays[i].count;
+
+    offset = map_align(offset);
+    if (offset > at && fwrite(zeros, (size_t)(offset - at), 1, fp) != 1)
+      goto fail;
+    if (bytes > 0 && fwrite(arrays[i].data, bytes, 1, fp) != 1)
+      goto fail;
+    at = offset += bytes;
+  }
+
+  if (fclose(fp) != 0)
+    return -1;
+  return 0;
+
+fail:
+  fclose(fp);
+  return -1;
+}
+
+/**
+ *---------------------------------------------
+ *  Mapping
+ *---------------------------------------------
+ **/
+
+#ifdef _WIN32
+static int map_file(mapfile_t *f, const char *path) {
+  LARGE_INTEGER size;
+  HANDLE file, mapping;
+  void *view;
+
+  file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                     FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return -1;
+
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return -1;
+  }
+  if ((uint64_t)size.QuadPart < sizeof(map_header_t) ||
+      (uint64_t)size.QuadPart > (size_t)-1) {
+    CloseHandle(file);
+    return 1;
+  }
+
+  mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!mapping) {
+    CloseHandle(file);
+    return -1;
+  }
+
+  view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!view) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return -1;
+  }
+
+  f->base = (const unsigned char *)view;
+  f->size = (size_t)size.QuadPart;
+  f->file = file;
+  f->mapping = mapping;
+  return 0;
+}
+
+static void unmap_file(mapfile_t *f) {
+  UnmapViewOfFile(f->base);
+  CloseHandle((HANDLE)f->mapping);
+  CloseHandle((HANDLE)f->file);
+}
+#else
+static int map_file(mapfile_t *f, const char *path) {
+  struct stat st;
+  void *view;
+  int fd;
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return -1;
+
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return -1;
+  }
+  if ((uint64_t)st.st_size < sizeof(map_header_t) ||
+      (uint64_t)st.st_size > (size_t)-1) {
+    close(fd);
+    return 1;
+  }
+
+  /* the mapping outlives the descriptor */
+  view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (view == MAP_FAILED)
+    return -1;
+
+  f->base = (const unsigned char *)view;
+  f->size = (size_t)st.st_size;
+  f->file = f->mapping = NULL;
+  return 0;
+}
+
+static void unmap_file(mapfile_t *f) { munmap((void *)f->base, f->size); }
+#endif
+
+/* header and table checked once, so lookups trust them */
+static int map_check(const mapfile_t *f) {
+  map_header_t h;
+  map_entry_t e;
+  uint64_t table, i;
+
+  memcpy(&h, f->base, sizeof(h));
+  if (memcmp(h.magic, map_magic, sizeof(h.magic)) != 0 ||
+      h.version != mapfile_version || h.endian != mapfile_endian ||
+      h.precision != sizeof(real_t) || h.size != f->size)
+    return 1;
+
+  /* at least what this build promises, and no more than a page gives */
+  if (h.alignment < mapfile_alignment ||
+      (h.alignment & (h.alignment - 1)) != 0 || h.alignment > mapfile_page)
+    return 1;
+
+  table = sizeof(h);
+  if (h.arrays > (f->size - table) / sizeof(e))
+    return 1;
+  table += sizeof(e) * h.arrays;
+
+  for (i = 0; i < h.arrays; ++i) {
+    memcpy(&e, f->base + sizeof(h) + sizeof(e) * i, sizeof(e));
+    if (e.name[mapfile_name_max] != '\0' ||
+        e.stride != mapfile_stride((mapfile_type_t)e.type) || e.stride == 0 ||
+        e.offset % h.alignment != 0 || e.offset < table ||
+        e.offset > f->size || e.count > (f->size - e.offset) / e.stride)
+      return 1;
+  }
+  return 0;
+}
+
+int mapfile_open(mapfile_t *f, const char *path) {
+  int ret;
+
+  memset(f, 0, sizeof(mapfile_t));
+
+  ret = map_file(f, path);
+  if (ret != 0)
+    return ret;
+
+  ret = map_check(f);
+  if (ret != 0) {
+    mapfile_close(f);
+    return ret;
+  }
+
+  f->arrays = (size_t)((const map_header_t *)f->base)->arrays;
+  return 0;
+}
+
+void mapfile_close(mapfile_t *f) {
+  if (f->base)
+    unmap_file(f);
+  memset(f, 0, sizeof(mapfile_t));
+}
+
+int mapfile_array(const mapfile_t *f, size_t i, mapfile_array_t *a) {
+  const map_entry_t *e;
+
+  if (i >= f->arrays)
+    return -1;
+
+  /* the table starts 64 bytes into a page aligned mapping */
+  e = (const map_entry_t *)(f->base + sizeof(map_header_t)) + i;
+  a->name = e->name;
+  a->type = (mapfile_type_t)e->type;
+  a->data = f->base + e->offset;
+  a->count = (size_t)e->count;
+  return 0;
+}
+
+const void *mapfile_get(const mapfile_t *f, const char *name,
+                        mapfile_type_t type, size_t *count) {
+  mapfile_array_t a;
+  size_t i;
+
+  for (i = 0; mapfile_array(f, i, &a) == 0; ++i) {
+    if (strncmp(a.name, name, mapfile_name_max) != 0)
+      continue;
+    if (a.type != type)
+      break;
+    if (count)
+      *count = a.count;
+    return a.data;
+  }
+  return NULL;
+}
@@ -0,0 +1,127 @@
+/*
+ *  mapfile.h
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#ifndef __MAPFILE_H__
+#define __MAPFILE_H__
+
+#include "matrix.h"
+#include "quaternion.h"
+#include "vector.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Self-describing container of real_t arrays, loaded by mapping the file
+ * into memory. Arrays come back as pointers into the mapping, so nothing
+ * is parsed or copied at load time.
+ *
+ *   offset  bytes  header
+ *        0      8  magic "MATHMAP\0"
+ *        8      4  version, mapfile_version
+ *       12      4  0x01020304 in the writer's byte order
+ *       16      4  sizeof(real_t), 4 or 8
+ *       20      4  payload alignment, mapfile_alignment
+ *       24      8  file size in bytes
+ *       32      8  number of arrays
+ *       40     24  reserved, zero
+ *
+ *   offset  bytes  array table, one 48-byte entry per array from 64
+ *        0     24  name, zero padded
+ *       24      4  mapfile_type_t
+ *       28      4  bytes per element
+ *       32      8  element count
+ *       40      8  payload offset from the start of the file
+ *
+ * Payloads follow the table, each starting on a mapfile_alignment
+ * boundary. Integers are in the writer's byte order; files are only
+ * opened by builds with the same byte order and real_t.
+ **/
+
+#define mapfile_version 1
+#define mapfile_alignment 64
+#define mapfile_name_max 23
+
+typedef enum mapfile_type_t {
+  MAPFILE_REAL = 1,
+  MAPFILE_VEC2,
+  MAPFILE_VEC3,
+  MAPFILE_VEC4,
+  MAPFILE_QUAT,
+  MAPFILE_MAT33,
+  MAPFILE_MAT44
+} mapfile_type_t;
+
+/* one array to write, or one found in an opened file */
+typedef struct mapfile_array_t {
+  const char *name;
+  mapfile_type_t type;
+  const void *data;
+  size_t count;
+} mapfile_array_t;
+
+typedef struct mapfile_t {
+  const unsigned char *base;
+  size_t size;
+  size_t arrays;
+  void *file, *mapping; /* windows handles */
+} mapfile_t;
+
+/* bytes per element of type, 0 for an unknown type */
+size_t mapfile_stride(mapfile_type_t type);
+
+/**
+ * Writes count arrays to path, names truncated to mapfile_name_max.
+ * Returns 0 on success, 1 for an unknown type, -1 on an I/O error.
+ **/
+int mapfile_write(const char *path, const mapfile_array_t *arrays,
+                  size_t count);
+
+/**
+ * Maps path read-only. Returns 0 on success, 1 when the file is not a
+ * mapfile this build can use (magic, version, byte order, precision, an
+ * alignment below mapfile_alignment or a malformed table), -1 on an I/O
+ * error.
+ **/
+int mapfile_open(mapfile_t *f, const char *path);
+void mapfile_close(mapfile_t *f);
+
+/* a = array i, data pointing into the mapping; -1 when i is out of range */
+int mapfile_array(const mapfile_t *f, size_t i, mapfile_array_t *a);
+
+/**
+ * Payload of the first array called name, NULL when there is none or it
+ * holds another type. count may be NULL.
+ **/
+const void *mapfile_get(const mapfile_t *f, const char *name,
+                        mapfile_type_t type, size_t *count);
+
+#define mapfile_real(f, name, count)                                           \
+  ((const real_t *)mapfile_get(f, name, MAPFILE_REAL, count))
+#define mapfile_vec2(f, name, count)                                           \
+  ((const vec2_t *)mapfile_get(f, name, MAPFILE_VEC2, count))
+#define mapfile_vec3(f, name, count)                                           \
+  ((const vec3_t *)mapfile_get(f, name, MAPFILE_VEC3, count))
+#define mapfile_vec4(f, name, count)                                           \
+  ((const vec4_t *)mapfile_get(f, name, MAPFILE_VEC4, count))
+#define mapfile_quat(f, name, count)                                           \
+  ((const quat_t *)mapfile_get(f, name, MAPFILE_QUAT, count))
+#define mapfile_mat33(f, name, count)                                          \
+  ((const mat33_t *)mapfile_get(f, name, MAPFILE_MAT33, count))
+#define mapfile_mat44(f, name, count)                                          \
+  ((const mat44_t *)mapfile_get(f, name, MAPFILE_MAT44, count))
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __MAPFILE_H__ */
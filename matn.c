@@ -0,0 +1,332 @@
+/*
+ *  matn.c
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#include "matn.h"
+#include "parallel.h"
+#include "simd.h"
+#include <string.h>
+
+/* reals per MATH_ALIGNMENT bytes */
+#define matn_align (MATH_ALIGNMENT / sizeof(real_t))
+
+int matn_alloc(matn_t *m, size_t rows, size_t cols) {
+  size_t ld = (rows + matn_align - 1) / matn_align * matn_align;
+
+  m->rows = rows, m->cols = cols, m->ld = ld ? ld : matn_align;
+  m->e = (real_t *)math_alloc(sizeof(real_t) * m->ld * (cols ? cols : 1));
+  if (!m->e)
+    return -1;
+  memset(m->e, 0, sizeof(real_t) * m->ld * (cols ? cols : 1));
+  return 0;
+}
+
+void matn_free(matn_t *m) {
+  math_free(m->e);
+  m->e = NULL;
+  m->rows = m->cols = 0;
+}
+
+void matn_view(matn_t *v, const matn_t *m, size_t i, size_t j, size_t rows,
+               size_t cols) {
+  v->rows = rows, v->cols = cols, v->ld = m->ld;
+  v->e = m->e + j * m->ld + i;
+}
+
+void matn_zero(matn_t *m) {
+  size_t j;
+
+  for (j = 0; j < m->cols; ++j)
+    memset(m->e + j * m->ld, 0, sizeof(real_t) * m->rows);
+}
+
+void matn_identity(matn_t *m) {
+  size_t i;
+
+  matn_zero(m);
+  for (i = 0; i < m->rows && i < m->cols; ++i)
+    matn_at(m, i, i) = r_one;
+}
+
+void matn_copy(matn_t *r, const matn_t *a) {
+  size_t j;
+
+  if (r != a)
+    for (j = 0; j < a->cols; ++j)
+      memcpy(r->e + j * r->ld, a->e + j * a->ld, sizeof(real_t) * a->rows);
+}
+
+void matn_add(matn_t *r, const matn_t *a, const matn_t *b) {
+  size_t i, j;
+
+  for (j = 0; j < a->cols; ++j) {
+    const real_t *x = a->e + j * a->ld, *y = b->e + j * b->ld;
+    real_t *z = r->e + j * r->ld;
+
+    for (i = 0; i < a->rows; ++i)
+      z[i] = x[i] + y[i];
+  }
+}
+
+void matn_sub(matn_t *r, const matn_t *a, const matn_t *b) {
+  size_t i, j;
+
+  for (j = 0; j < a->cols; ++j) {
+    const real_t *x = a->e + j * a->ld, *y = b->e + j * b->ld;
+    real_t *z = r->e + j * r->ld;
+
+    for (i = 0; i < a->rows; ++i)
+      z[i] = x[i] - y[i];
+  }
+}
+
+void matn_scale(matn_t *r, const matn_t *a, real_t s) {
+  size_t i, j;
+
+  for (j = 0; j < a->cols; ++j) {
+    const real_t *x = a->e + j * a->ld;
+    real_t *z = r->e + j * r->ld;
+
+    for (i = 0; i < a->rows; ++i)
+      z[i] = x[i] * s;
+  }
+}
+
+/* tiles small enough that both the read and the write side stay cached */
+#define transpose_tile 32
+
+void matn_transpose(matn_t *r, const matn_t *a) {
+  size_t i0, j0, i, j;
+
+  for (j0 = 0; j0 < a->cols; j0 += transpose_tile)
+    for (i0 = 0; i0 < a->rows; i0 += transpose_tile) {
+      size_t i1 = i0 + transpose_tile < a->rows ? i0 + transpose_tile
+                                                : a->rows;
+      size_t j1 = j0 + transpose_tile < a->cols ? j0 + transpose_tile
+                                                : a->cols;
+
+      for (j = j0; j < j1; ++j)
+        for (i = i0; i < i1; ++i)
+          matn_at(r, j, i) = matn_at(a, i, j);
+    }
+}
+
+/**
+ *---------------------------------------------
+ *  GEMM
+ *---------------------------------------------
+ **/
+
+/**
+ * Goto/BLIS layout: for every gemm_nc columns of c and gemm_kc deep slice,
+ * b is packed into gemm_nr wide row panels (fits L3) and each gemm_mc rows
+ * of a into gemm_mr tall column panels (fits L2). The kernel keeps a
+ * gemm_mr x gemm_nr block of c in registers over the whole slice.
+ **/
+#ifdef MATH_SIMD
+#define gemm_mr (2 * rv_lanes)
+#else
+#define gemm_mr 4
+#endif
+#define gemm_nr 4
+#define gemm_kc 256
+#define gemm_mc (gemm_mr * 16)
+#define gemm_nc 2048
+
+/* below this many multiply-adds packing costs more than it saves */
+#define gemm_small (64 * 64 * 64)
+
+#define gemm_min(a, b) ((a) < (b) ? (a) : (b))
+
+/* c += a * b, c is gemm_mr x gemm_nr with column stride ldc */
+static void gemm_kernel(size_t kc, const real_t *a, const real_t *b,
+                        real_t *c, size_t ldc) {
+  size_t p;
+  int j;
+#ifdef MATH_SIMD
+  rv_t c0[gemm_nr], c1[gemm_nr], a0, a1, bj;
+
+  for (j = 0; j < gemm_nr; ++j)
+    c0[j] = c1[j] = rv_zero();
+
+  for (p = 0; p < kc; ++p, a += gemm_mr, b += gemm_nr) {
+    a0 = rv_load(a);
+    a1 = rv_load(a + rv_lanes);
+    for (j = 0; j < gemm_nr; ++j) {
+      bj = rv_set1(b[j]);
+      c0[j] = rv_madd(a0, bj, c0[j]);
+      c1[j] = rv_madd(a1, bj, c1[j]);
+    }
+  }
+
+  for (j = 0; j < gemm_nr; ++j, c += ldc) {
+    rv_store(c, rv_add(rv_load(c), c0[j]));
+    rv_store(c + rv_lanes, rv_add(rv_load(c + rv_lanes), c1[j]));
+  }
+#else
+  real_t t[gemm_nr][gemm_mr] = {{0}};
+  int i;
+
+  for (p = 0; p < kc; ++p, a += gemm_mr, b += gemm_nr)
+    for (j = 0; j < gemm_nr; ++j)
+      for (i = 0; i < gemm_mr; ++i)
+        t[j][i] += a[i] * b[j];
+
+  for (j = 0; j < gemm_nr; ++j, c += ldc)
+    for (i = 0; i < gemm_mr; ++i)
+      c[i] += t[j][i];
+#endif
+}
+
+/* alpha * a[i0.., p0..] as gemm_mr row panels, zero padded */
+static void gemm_pack_a(real_t *r, const matn_t *a, real_t alpha, size_t i0,
+                        size_t mc, size_t p0, size_t kc) {
+  size_t ir, i, p;
+
+  for (ir = 0; ir < mc; ir += gemm_mr) {
+    size_t m = gemm_min(gemm_mr, mc - ir);
+
+    for (p = 0; p < kc; ++p, r += gemm_mr) {
+      const real_t *x = &matn_at(a, i0 + ir, p0 + p);
+
+      for (i = 0; i < m; ++i)
+        r[i] = alpha * x[i];
+      for (; i < gemm_mr; ++i)
+        r[i] = r_zero;
+    }
+  }
+}
+
+/* b[p0.., j0..] as gemm_nr column panels, zero padded */
+static void gemm_pack_b(real_t *r, const matn_t *b, size_t p0, size_t kc,
+                        size_t j0, size_t nc) {
+  size_t jr, j, p;
+
+  for (jr = 0; jr < nc; jr += gemm_nr) {
+    size_t n = gemm_min(gemm_nr, nc - jr);
+
+    for (p = 0; p < kc; ++p, r += gemm_nr) {
+      for (j = 0; j < n; ++j)
+        r[j] = matn_at(b, p0 + p, j0 + jr + j);
+      for (; j < gemm_nr; ++j)
+        r[j] = r_zero;
+    }
+  }
+}
+
+typedef struct gemm_job_t {
+  matn_t *c;
+  const matn_t *a, *b;
+  const real_t *pb; /* packed b slice */
+  real_t alpha;
+  size_t p0, kc, j0, nc;
+} gemm_job_t;
+
+/* c[i0..i1, j0..j1] += alpha * a[i0..i1, p0..p1] * b[p0..p1, j0..j1] */
+static void gemm_direct(matn_t *c, real_t alpha, const matn_t *a,
+                        const matn_t *b, size_t i0, size_t i1, size_t p0,
+                        size_t p1, size_t j0, size_t j1) {
+  size_t i, j, p;
+
+  for (j = j0; j < j1; ++j)
+    for (p = p0; p < p1; ++p) {
+      real_t s = alpha * matn_at(b, p, j);
+      const real_t *x = &matn_at(a, 0, p);
+      real_t *y = &matn_at(c, 0, j);
+
+      for (i = i0; i < i1; ++i)
+        y[i] += x[i] * s;
+    }
+}
+
+/* row blocks [begin, end) of c += a * packed b, each packs its own a */
+static void gemm_rows(void *ctx, size_t begin, size_t end) {
+  const gemm_job_t *g = (const gemm_job_t *)ctx;
+  real_t *pa, edge[gemm_nr * gemm_mr];
+  size_t blk, ir, jr, i, j;
+
+  pa = (real_t *)math_alloc(sizeof(real_t) * gemm_mc * g->kc);
+  if (!pa) {
+    /* out of memory, still correct without the packed panel */
+    gemm_direct(g->c, g->alpha, g->a, g->b, begin * gemm_mc,
+                gemm_min(end * gemm_mc, g->c->rows), g->p0, g->p0 + g->kc,
+                g->j0, g->j0 + g->nc);
+    return;
+  }
+
+  for (blk = begin; blk < end; ++blk) {
+    size_t i0 = blk * gemm_mc, mc = gemm_min(gemm_mc, g->c->rows - i0);
+
+    gemm_pack_a(pa, g->a, g->alpha, i0, mc, g->p0, g->kc);
+
+    for (jr = 0; jr < g->nc; jr += gemm_nr) {
+      size_t n = gemm_min(gemm_nr, g->nc - jr);
+      const real_t *b = g->pb + jr * g->kc;
+
+      for (ir = 0; ir < mc; ir += gemm_mr) {
+        size_t m = gemm_min(gemm_mr, mc - ir);
+        real_t *c = &matn_at(g->c, i0 + ir, g->j0 + jr);
+
+        if (m == gemm_mr && n == gemm_nr) {
+          gemm_kernel(g->kc, pa + ir * g->kc, b, c, g->c->ld);
+          continue;
+        }
+
+        /* partial block: run the full kernel on a scratch tile */
+        memset(edge, 0, sizeof(edge));
+        gemm_kernel(g->kc, pa + ir * g->kc, b, edge, gemm_mr);
+        for (j = 0; j < n; ++j)
+          for (i = 0; i < m; ++i)
+            c[j * g->c->ld + i] += edge[j * gemm_mr + i];
+      }
+    }
+  }
+
+  math_free(pa);
+}
+
+int matn_gemm(matn_t *c, real_t alpha, const matn_t *a, const matn_t *b,
+              real_t beta) {
+  size_t m = c->rows, n = c->cols, k = a->cols;
+  real_t *pb = NULL;
+  gemm_job_t g;
+
+  /* allocate before touching c, so -1 leaves it as it was */
+  if (m * n * k >= gemm_small) {
+    pb = (real_t *)math_alloc(sizeof(real_t) * gemm_kc * gemm_nc);
+    if (!pb)
+      return -1;
+  }
+
+  if (beta == r_zero)
+    matn_zero(c);
+  else if (beta != r_one)
+    matn_scale(c, c, beta);
+
+  if (!pb) {
+    gemm_direct(c, alpha, a, b, 0, m, 0, k, 0, n);
+    return 0;
+  }
+
+  g.c = c, g.a = a, g.b = b, g.pb = pb, g.alpha = alpha;
+
+  for (g.j0 = 0; g.j0 < n; g.j0 += gemm_nc) {
+    g.nc = gemm_min(gemm_nc, n - g.j0);
+
+    for (g.p0 = 0; g.p0 < k; g.p0 += gemm_kc) {
+      g.kc = gemm_min(gemm_kc, k - g.p0);
+      gemm_pack_b(pb, b, g.p0, g.kc, g.j0, g.nc);
+      math_parallel_for(0, (m + gemm_mc - 1) / gemm_mc, 1, gemm_rows, &g);
+    }
+  }
+
+  math_free(pb);
+  return 0;
+}
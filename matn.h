@@ -0,0 +1,75 @@
+/*
+ *  matn.h
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#ifndef __MATN_H__
+#define __MATN_H__
+
+#include "real.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Dense rows x cols matrix on the heap, column-major like mat44_t. Column j
+ * starts at e + j * ld; ld is rows rounded up so every column starts on a
+ * MATH_ALIGNMENT boundary. The padding rows are kept at zero.
+ **/
+typedef struct matn_t {
+  size_t rows, cols, ld;
+  real_t *e;
+} matn_t;
+
+/* element at row i, column j */
+#define matn_at(m, i, j) ((m)->e[(j) * (m)->ld + (i)])
+
+/* zero filled, returns 0 or -1 when out of memory */
+int matn_alloc(matn_t *m, size_t rows, size_t cols);
+void matn_free(matn_t *m);
+
+/**
+ * v = the rows x cols block of m at row i, column j. v shares m's storage
+ * and ld, so it is not aligned and must not be passed to matn_free.
+ **/
+void matn_view(matn_t *v, const matn_t *m, size_t i, size_t j, size_t rows,
+               size_t cols);
+
+void matn_zero(matn_t *m);
+void matn_identity(matn_t *m);
+
+/**
+ * Element-wise operations need equal shapes and allow any aliasing,
+ * transpose needs r to be cols x rows and distinct from a.
+ **/
+void matn_copy(matn_t *r, const matn_t *a);
+void matn_add(matn_t *r, const matn_t *a, const matn_t *b);
+void matn_sub(matn_t *r, const matn_t *a, const matn_t *b);
+void matn_scale(matn_t *r, const matn_t *a, real_t s);
+void matn_transpose(matn_t *r, const matn_t *a);
+
+/**
+ * c = alpha * a * b + beta * c, with c distinct from a and b. Large
+ * products are packed into cache-sized panels, run through a register-
+ * blocked SIMD kernel and spread over the math_parallel_for pool. beta = 0
+ * ignores what c held, NaN included. Returns 0, or -1 when out of memory
+ * with c unchanged.
+ **/
+int matn_gemm(matn_t *c, real_t alpha, const matn_t *a, const matn_t *b,
+              real_t beta);
+
+/* r = a * b */
+#define matn_mul(r, a, b) matn_gemm(r, r_one, a, b, r_zero)
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __MATN_H__ */
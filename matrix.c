@@ -10,10 +10,13 @@
  */
 
 #include "matrix.h"
+#include "parallel.h"
+#include "simd.h"
 
 void mat22_rotation(mat22_t r, real_t theta) {
-  real_t c = r_cos(theta);
-  real_t s = r_sin(theta);
+  real_t c, s;
+
+  r_sincos(theta, &s, &c);
 
   /**
    * | c -s |
@@ -29,8 +32,9 @@ void mat22_rotation(mat22_t r, real_t theta) {
 void mat33_transformation(mat33_t r, real_t x, real_t y, real_t theta,
                           real_t sx, real_t sy, real_t ox, real_t oy, real_t kx,
                           real_t ky) {
-  real_t c = r_cos(theta);
-  real_t s = r_sin(theta);
+  real_t c, s;
+
+  r_sincos(theta, &s, &c);
 
   /**
    * |1    x| |c -s  | |sx     | | 1 ky  | |1   -ox|
@@ -50,8 +54,9 @@ void mat33_transformation(mat33_t r, real_t x, real_t y, real_t theta,
 }
 
 void mat33_rotatex(mat33_t r, real_t theta) {
-  real_t c = r_cos(theta);
-  real_t s = r_sin(theta);
+  real_t c, s;
+
+  r_sincos(theta, &s, &c);
 
   /**
    * | 1  0  0 |
@@ -67,8 +72,9 @@ void mat33_rotatex(mat33_t r, real_t theta) {
 }
 
 void mat33_rotatey(mat33_t r, real_t theta) {
-  real_t c = r_cos(theta);
-  real_t s = r_sin(theta);
+  real_t c, s;
+
+  r_sincos(theta, &s, &c);
 
   /**
    * |  c  0  s |
@@ -84,8 +90,9 @@ void mat33_rotatey(mat33_t r, real_t theta) {
 }
 
 void mat33_rotatez(mat33_t r, real_t theta) {
-  real_t c = r_cos(theta);
-  real_t s = r_sin(theta);
+  real_t c, s;
+
+  r_sincos(theta, &s, &c);
 
   /**
    * | c -s  0 |
@@ -101,18 +108,19 @@ void mat33_rotatez(mat33_t r, real_t theta) {
 }
 
 void mat33_rotateaxis(mat33_t r, real_t theta, vec3_t axis) {
-  real_t c = r_cos(theta);
-  real_t s = r_sin(theta);
-  real_t t = 1 - c;
+  real_t c, s, t, xs, ys, zs;
   real_t xx = vx(axis) * vx(axis);
   real_t xy = vx(axis) * vy(axis);
   real_t xz = vx(axis) * vz(axis);
   real_t yy = vy(axis) * vy(axis);
   real_t yz = vy(axis) * vz(axis);
   real_t zz = vz(axis) * vz(axis);
-  real_t xs = vx(axis) * s;
-  real_t ys = vy(axis) * s;
-  real_t zs = vz(axis) * s;
+
+  r_sincos(theta, &s, &c);
+  t = 1 - c;
+  xs = vx(axis) * s;
+  ys = vy(axis) * s;
+  zs = vz(axis) * s;
 
   e0(r) = xx * t + c;
   e3(r) = xy * t - zs;
@@ -127,11 +135,28 @@ void mat33_rotateaxis(mat33_t r, real_t theta, vec3_t axis) {
   e8(r) = zz * t + c;
 }
 
+void vec3_rotateaxis_sweep(vec3_t *r, const vec3_t v, vec3_t axis,
+                           real_t theta, real_t step, size_t count) {
+  mat33_t e, a;
+  size_t i;
+
+  mat33_rotateaxis(e, step, axis);
+
+  for (i = 0; i < count; ++i) {
+    if (i % rotate_sweep_anchor == 0) {
+      mat33_rotateaxis(a, theta + (real_t)i * step, axis);
+      mat33_transform3(r[i], a, v);
+    } else
+      mat33_transform3(r[i], e, r[i - 1]);
+  }
+}
+
 void mat44_transformation(mat44_t r, real_t x, real_t y, real_t theta,
                           real_t sx, real_t sy, real_t ox, real_t oy, real_t kx,
                           real_t ky) {
-  real_t c = r_cos(theta);
-  real_t s = r_sin(theta);
+  real_t c, s;
+
+  r_sincos(theta, &s, &c);
 
   /**
    * |1     x| |c -s    | |sx       | | 1 ky    | |1     -ox|
@@ -152,8 +177,9 @@ void mat44_transformation(mat44_t r, real_t x, real_t y, real_t theta,
 }
 
 void mat44_rotatex(mat44_t r, real_t theta) {
-  real_t c = r_cos(theta);
-  real_t s = r_sin(theta);
+  real_t c, s;
+
+  r_sincos(theta, &s, &c);
 
   /**
    * | 1  0  0  0 |
@@ -170,8 +196,9 @@ void mat44_rotatex(mat44_t r, real_t theta) {
 }
 
 void mat44_rotatey(mat44_t r, real_t theta) {
-  real_t c = r_cos(theta);
-  real_t s = r_sin(theta);
+  real_t c, s;
+
+  r_sincos(theta, &s, &c);
 
   /**
    * |  c  0  s  0 |
@@ -188,8 +215,9 @@ void mat44_rotatey(mat44_t r, real_t theta) {
 }
 
 void mat44_rotatez(mat44_t r, real_t theta) {
-  real_t c = r_cos(theta);
-  real_t s = r_sin(theta);
+  real_t c, s;
+
+  r_sincos(theta, &s, &c);
 
   /**
    * | c -s  0  0 |
@@ -206,18 +234,19 @@ void mat44_rotatez(mat44_t r, real_t theta) {
 }
 
 void mat44_rotateaxis(mat44_t r, real_t theta, vec3_t axis) {
-  real_t c = r_cos(theta);
-  real_t s = r_sin(theta);
-  real_t t = 1 - c;
+  real_t c, s, t, xs, ys, zs;
   real_t xx = vx(axis) * vx(axis);
   real_t xy = vx(axis) * vy(axis);
   real_t xz = vx(axis) * vz(axis);
   real_t yy = vy(axis) * vy(axis);
   real_t yz = vy(axis) * vz(axis);
   real_t zz = vz(axis) * vz(axis);
-  real_t xs = vx(axis) * s;
-  real_t ys = vy(axis) * s;
-  real_t zs = vz(axis) * s;
+
+  r_sincos(theta, &s, &c);
+  t = 1 - c;
+  xs = vx(axis) * s;
+  ys = vy(axis) * s;
+  zs = vz(axis) * s;
 
   mat44_identity(r);
 
@@ -234,6 +263,1175 @@ void mat44_rotateaxis(mat44_t r, real_t theta, vec3_t axis) {
   e10(r) = zz * t + c;
 }
 
+/* i-th vector of a strided batch */
+#define batch_at(v, i, stride)                                                 \
+  ((const real_t *)((const char *)(v) + (i) * (stride)))
+
+#ifdef MATH_SIMD_R4
+/* c0*x + c1*y + c3 */
+#define r4_transform2(c, v)                                                    \
+  r4_madd(c[1], r4_set1(vy(v)), r4_madd(c[0], r4_set1(vx(v)), c[3]))
+
+/* c0*x + c1*y + c2*z + c3 */
+#define r4_transform3(c, v)                                                    \
+  r4_madd(c[2], r4_set1(vz(v)), r4_transform2(c, v))
+
+/* c0*x + c1*y + c2*z + c3*w */
+#define r4_transform4(c, v)                                                    \
+  r4_madd(c[3], r4_set1(vw(v)),                                                \
+          r4_madd(c[2], r4_set1(vz(v)),                                        \
+                  r4_madd(c[1], r4_set1(vy(v)),                                \
+                          r4_mul(c[0], r4_set1(vx(v))))))
+#endif
+
+/* arguments of a batch split over math_parallel_for */
+typedef struct batch_job_t {
+  void *r;
+  const real_t *e, *v;
+  size_t stride;
+} batch_job_t;
+
+static void transform2_batch(vec2_t *r, const mat44_t e, const real_t *v,
+                             size_t count, size_t stride) {
+  size_t i = 0;
+
+  if (!stride)
+    stride = sizeof(vec2_t);
+
+#ifdef MATH_SIMD_R4
+  {
+    r4_t c[4], t0, t1, t2, t3;
+
+    c[0] = r4_load(e);
+    c[1] = r4_load(e + 4);
+    c[3] = r4_load(e + 12);
+
+    for (; i + 4 <= count; i += 4) {
+      t0 = r4_transform2(c, batch_at(v, i, stride));
+      t1 = r4_transform2(c, batch_at(v, i + 1, stride));
+      t2 = r4_transform2(c, batch_at(v, i + 2, stride));
+      t3 = r4_transform2(c, batch_at(v, i + 3, stride));
+
+      r4_store2(r[i], t0);
+      r4_store2(r[i + 1], t1);
+      r4_store2(r[i + 2], t2);
+      r4_store2(r[i + 3], t3);
+    }
+  }
+#endif
+  for (; i < count; ++i) {
+    const real_t *p = batch_at(v, i, stride);
+    vec2_t t;
+
+    mat44_transform2(t, e, p);
+    vx(r[i]) = vx(t);
+    vy(r[i]) = vy(t);
+  }
+}
+
+static void transform2_range(void *ctx, size_t begin, size_t end) {
+  const batch_job_t *j = (const batch_job_t *)ctx;
+
+  transform2_batch((vec2_t *)j->r + begin, j->e,
+                   batch_at(j->v, begin, j->stride), end - begin, j->stride);
+}
+
+void mat44_transform2_batch(vec2_t *r, const mat44_t e, const real_t *v,
+                            size_t count, size_t stride) {
+  batch_job_t j;
+
+  if (!stride)
+    stride = sizeof(vec2_t);
+
+  if (count < math_parallel_min) {
+    transform2_batch(r, e, v, count, stride);
+    return;
+  }
+
+  j.r = r, j.e = e, j.v = v, j.stride = stride;
+  math_parallel_for(0, count, math_parallel_grain, transform2_range, &j);
+}
+
+static void transform3_batch(vec3_t *r, const mat44_t e, const real_t *v,
+                             size_t count, size_t stride) {
+  size_t i = 0;
+
+  if (!stride)
+    stride = sizeof(vec3_t);
+
+#ifdef MATH_SIMD_R4
+  {
+    r4_t c[4], t0, t1, t2, t3;
+
+    c[0] = r4_load(e);
+    c[1] = r4_load(e + 4);
+    c[2] = r4_load(e + 8);
+    c[3] = r4_load(e + 12);
+
+    for (; i + 4 <= count; i += 4) {
+      t0 = r4_transform3(c, batch_at(v, i, stride));
+      t1 = r4_transform3(c, batch_at(v, i + 1, stride));
+      t2 = r4_transform3(c, batch_at(v, i + 2, stride));
+      t3 = r4_transform3(c, batch_at(v, i + 3, stride));
+
+      r4_store3(r[i], t0);
+      r4_store3(r[i + 1], t1);
+      r4_store3(r[i + 2], t2);
+      r4_store3(r[i + 3], t3);
+    }
+  }
+#endif
+  for (; i < count; ++i) {
+    const real_t *p = batch_at(v, i, stride);
+    vec3_t t;
+
+    mat44_transform3(t, e, p);
+    vx(r[i]) = vx(t);
+    vy(r[i]) = vy(t);
+    vz(r[i]) = vz(t);
+  }
+}
+
+static void transform3_range(void *ctx, size_t begin, size_t end) {
+  const batch_job_t *j = (const batch_job_t *)ctx;
+
+  transform3_batch((vec3_t *)j->r + begin, j->e,
+                   batch_at(j->v, begin, j->stride), end - begin, j->stride);
+}
+
+void mat44_transform3_batch(vec3_t *r, const mat44_t e, const real_t *v,
+                            size_t count, size_t stride) {
+  batch_job_t j;
+
+  if (!stride)
+    stride = sizeof(vec3_t);
+
+  if (count < math_parallel_min) {
+    transform3_batch(r, e, v, count, stride);
+    return;
+  }
+
+  j.r = r, j.e = e, j.v = v, j.stride = stride;
+  math_parallel_for(0, count, math_parallel_grain, transform3_range, &j);
+}
+
+static void transform4_batch(vec4_t *r, const mat44_t e, const real_t *v,
+                             size_t count, size_t stride) {
+  size_t i = 0;
+
+  if (!stride)
+    stride = sizeof(vec4_t);
+
+#ifdef MATH_SIMD_R4
+  {
+    r4_t c[4], t0, t1, t2, t3;
+
+    c[0] = r4_load(e);
+    c[1] = r4_load(e + 4);
+    c[2] = r4_load(e + 8);
+    c[3] = r4_load(e + 12);
+
+    for (; i + 4 <= count; i += 4) {
+      t0 = r4_transform4(c, batch_at(v, i, stride));
+      t1 = r4_transform4(c, batch_at(v, i + 1, stride));
+      t2 = r4_transform4(c, batch_at(v, i + 2, stride));
+      t3 = r4_transform4(c, batch_at(v, i + 3, stride));
+
+      r4_store(r[i], t0);
+      r4_store(r[i + 1], t1);
+      r4_store(r[i + 2], t2);
+      r4_store(r[i + 3], t3);
+    }
+  }
+#endif
+  for (; i < count; ++i) {
+    const real_t *p = batch_at(v, i, stride);
+    vec4_t t;
+
+    mat44_transform4(t, e, p);
+    vx(r[i]) = vx(t);
+    vy(r[i]) = vy(t);
+    vz(r[i]) = vz(t);
+    vw(r[i]) = vw(t);
+  }
+}
+
+static void transform4_range(void *ctx, size_t begin, size_t end) {
+  const batch_job_t *j = (const batch_job_t *)ctx;
+
+  transform4_batch((vec4_t *)j->r + begin, j->e,
+                   batch_at(j->v, begin, j->stride), end - begin, j->stride);
+}
+
+void mat44_transform4_batch(vec4_t *r, const mat44_t e, const real_t *v,
+                            size_t count, size_t stride) {
+  batch_job_t j;
+
+  if (!stride)
+    stride = sizeof(vec4_t);
+
+  if (count < math_parallel_min) {
+    transform4_batch(r, e, v, count, stride);
+    return;
+  }
+
+  j.r = r, j.e = e, j.v = v, j.stride = stride;
+  math_parallel_for(0, count, math_parallel_grain, transform4_range, &j);
+}
+
+#ifdef MATH_SIMD_R4
+/* r = (columns c) * b, r may alias b */
+r_inline void r4_mul44(real_t *r, const r4_t *c, const real_t *b) {
+  r4_t t[4];
+  int j;
+
+  for (j = 0; j < 4; ++j) {
+    const real_t *bj = b + j * 4;
+
+    t[j] = r4_madd(c[3], r4_set1(bj[3]),
+                   r4_madd(c[2], r4_set1(bj[2]),
+                           r4_madd(c[1], r4_set1(bj[1]),
+                                   r4_mul(c[0], r4_set1(bj[0])))));
+  }
+
+  r4_store(r, t[0]);
+  r4_store(r + 4, t[1]);
+  r4_store(r + 8, t[2]);
+  r4_store(r + 12, t[3]);
+}
+#endif
+
+void mat44_mul_simd(mat44_t r, const mat44_t a, const mat44_t b) {
+#ifdef MATH_SIMD_R4
+  r4_t c[4];
+
+  c[0] = r4_load(a);
+  c[1] = r4_load(a + 4);
+  c[2] = r4_load(a + 8);
+  c[3] = r4_load(a + 12);
+
+  /* column j of r = a * column j of b */
+  r4_mul44(r, c, b);
+#else
+  mat44_t t;
+  mat44_mul(t, a, b);
+  memcpy(r, t, sizeof(mat44_t));
+#endif
+}
+
+#ifdef MATH_SIMD_R4_SHUFFLE
+/**
+ * 2x2 blocks packed as (m00, m01, m10, m11), with # the adjugate:
+ * a*b, (a#)*b and a*(b#).
+ **/
+#define r4_swizzle(a, x, y, z, w) r4_shuffle(a, a, x, y, z, w)
+
+r_inline r4_t mat2_mul(r4_t a, r4_t b) {
+  return r4_madd(a, r4_swizzle(b, 0, 3, 0, 3),
+                 r4_mul(r4_swizzle(a, 1, 0, 3, 2), r4_swizzle(b, 2, 1, 2, 1)));
+}
+
+r_inline r4_t mat2_adjmul(r4_t a, r4_t b) {
+  return r4_sub(r4_mul(r4_swizzle(a, 3, 3, 0, 0), b),
+                r4_mul(r4_swizzle(a, 1, 1, 2, 2), r4_swizzle(b, 2, 3, 0, 1)));
+}
+
+r_inline r4_t mat2_muladj(r4_t a, r4_t b) {
+  return r4_sub(r4_mul(a, r4_swizzle(b, 3, 0, 3, 0)),
+                r4_mul(r4_swizzle(a, 1, 0, 3, 2), r4_swizzle(b, 2, 1, 2, 1)));
+}
+#endif
+
+#ifdef MATH_SIMD_R4_SHUFFLE
+/**
+ * Block inverse of the columns m, in place. The columns are read as the
+ * rows of e^T, whose inverse read back by rows is the column-major inverse
+ * of e. Returns (1, -1, -1, 1) / |e|.
+ *
+ * | A B |-1             | X# Y# |
+ * | C D |    = 1/|e| *  | Z# W# |
+ **/
+r_inline r4_t r4_inverse44(r4_t *m) {
+  r4_t c0 = m[0], c1 = m[1], c2 = m[2], c3 = m[3];
+  r4_t a = r4_shuffle(c0, c1, 0, 1, 0, 1);
+  r4_t b = r4_shuffle(c0, c1, 2, 3, 2, 3);
+  r4_t c = r4_shuffle(c2, c3, 0, 1, 0, 1);
+  r4_t d = r4_shuffle(c2, c3, 2, 3, 2, 3);
+
+  /* |A| |B| |C| |D| */
+  r4_t dets = r4_sub(
+      r4_mul(r4_shuffle(c0, c2, 0, 2, 0, 2), r4_shuffle(c1, c3, 1, 3, 1, 3)),
+      r4_mul(r4_shuffle(c0, c2, 1, 3, 1, 3), r4_shuffle(c1, c3, 0, 2, 0, 2)));
+  r4_t deta = r4_swizzle(dets, 0, 0, 0, 0);
+  r4_t detb = r4_swizzle(dets, 1, 1, 1, 1);
+  r4_t detc = r4_swizzle(dets, 2, 2, 2, 2);
+  r4_t detd = r4_swizzle(dets, 3, 3, 3, 3);
+
+  r4_t dc = mat2_adjmul(d, c);
+  r4_t ab = mat2_adjmul(a, b);
+
+  /* X# = |D|A - B(D#C), W# = |A|D - C(A#B) */
+  r4_t x = r4_sub(r4_mul(detd, a), mat2_mul(b, dc));
+  r4_t w = r4_sub(r4_mul(deta, d), mat2_mul(c, ab));
+
+  /* Y# = |B|C - D(A#B)#, Z# = |C|B - A(D#C)# */
+  r4_t y = r4_sub(r4_mul(detb, c), mat2_muladj(d, ab));
+  r4_t z = r4_sub(r4_mul(detc, b), mat2_muladj(a, dc));
+
+  /* |e| = |A||D| + |B||C| - tr((A#B)(D#C)) */
+  r4_t tr = r4_mul(ab, r4_swizzle(dc, 0, 2, 1, 3));
+  r4_t det;
+
+  tr = r4_add(tr, r4_swizzle(tr, 1, 0, 3, 2));
+  tr = r4_add(tr, r4_swizzle(tr, 2, 3, 0, 1));
+  det = r4_sub(r4_add(r4_mul(deta, detd), r4_mul(detb, detc)), tr);
+  det = r4_div(r4_set(r_one, r_negone, r_negone, r_one), det);
+
+  x = r4_mul(x, det);
+  y = r4_mul(y, det);
+  z = r4_mul(z, det);
+  w = r4_mul(w, det);
+
+  m[0] = r4_shuffle(x, y, 3, 1, 3, 1);
+  m[1] = r4_shuffle(x, y, 2, 0, 2, 0);
+  m[2] = r4_shuffle(z, w, 3, 1, 3, 1);
+  m[3] = r4_shuffle(z, w, 2, 0, 2, 0);
+  return det;
+}
+#endif
+
+void mat44_inverse_simd(mat44_t r, const mat44_t e) {
+#ifdef MATH_SIMD_R4_SHUFFLE
+  r4_t c[4];
+
+  c[0] = r4_load(e);
+  c[1] = r4_load(e + 4);
+  c[2] = r4_load(e + 8);
+  c[3] = r4_load(e + 12);
+
+  r4_inverse44(c);
+
+  r4_store(r, c[0]);
+  r4_store(r + 4, c[1]);
+  r4_store(r + 8, c[2]);
+  r4_store(r + 12, c[3]);
+#else
+  mat44_t t;
+  mat44_inverse(t, e);
+  memcpy(r, t, sizeof(mat44_t));
+#endif
+}
+
+void mat44_transpose_simd(mat44_t r, const mat44_t e) {
+#ifdef MATH_SIMD_R4
+  r4_t c[4];
+
+  c[0] = r4_load(e);
+  c[1] = r4_load(e + 4);
+  c[2] = r4_load(e + 8);
+  c[3] = r4_load(e + 12);
+
+  r4_transpose(c);
+
+  r4_store(r, c[0]);
+  r4_store(r + 4, c[1]);
+  r4_store(r + 8, c[2]);
+  r4_store(r + 12, c[3]);
+#else
+  mat44_t t;
+  mat44_transpose(t, e);
+  memcpy(r, t, sizeof(mat44_t));
+#endif
+}
+
+void mat44_mul_affine(mat44_t r, const mat44_t a, const mat44_t b) {
+  mat44_t t;
+
+  e0(t) = e0(a) * e0(b) + e4(a) * e1(b) + e8(a) * e2(b);
+  e1(t) = e1(a) * e0(b) + e5(a) * e1(b) + e9(a) * e2(b);
+  e2(t) = e2(a) * e0(b) + e6(a) * e1(b) + e10(a) * e2(b);
+
+  e4(t) = e0(a) * e4(b) + e4(a) * e5(b) + e8(a) * e6(b);
+  e5(t) = e1(a) * e4(b) + e5(a) * e5(b) + e9(a) * e6(b);
+  e6(t) = e2(a) * e4(b) + e6(a) * e5(b) + e10(a) * e6(b);
+
+  e8(t) = e0(a) * e8(b) + e4(a) * e9(b) + e8(a) * e10(b);
+  e9(t) = e1(a) * e8(b) + e5(a) * e9(b) + e9(a) * e10(b);
+  e10(t) = e2(a) * e8(b) + e6(a) * e9(b) + e10(a) * e10(b);
+
+  e12(t) = e0(a) * e12(b) + e4(a) * e13(b) + e8(a) * e14(b) + e12(a);
+  e13(t) = e1(a) * e12(b) + e5(a) * e13(b) + e9(a) * e14(b) + e13(a);
+  e14(t) = e2(a) * e12(b) + e6(a) * e13(b) + e10(a) * e14(b) + e14(a);
+
+  e3(t) = e7(t) = e11(t) = r_zero;
+  e15(t) = r_one;
+
+  memcpy(r, t, sizeof(mat44_t));
+}
+
+/* arguments of a product batch split over math_parallel_for */
+typedef struct mul_job_t {
+  void *r;
+  const void *a, *b;
+} mul_job_t;
+
+static void mul_batch(mat44_t *r, const mat44_t a, const mat44_t *b,
+                      size_t count) {
+  size_t i;
+#ifdef MATH_SIMD_R4
+  r4_t c[4];
+
+  c[0] = r4_load(a);
+  c[1] = r4_load(a + 4);
+  c[2] = r4_load(a + 8);
+  c[3] = r4_load(a + 12);
+
+  for (i = 0; i < count; ++i)
+    r4_mul44(r[i], c, b[i]);
+#else
+  for (i = 0; i < count; ++i) {
+    mat44_t t;
+    mat44_mul(t, a, b[i]);
+    memcpy(r[i], t, sizeof(mat44_t));
+  }
+#endif
+}
+
+static void mul_batch_right(mat44_t *r, const mat44_t *a, const mat44_t b,
+                            size_t count) {
+  size_t i;
+#ifdef MATH_SIMD_R4
+  r4_t s[16], c[4], t[4];
+  int j;
+
+  for (j = 0; j < 16; ++j)
+    s[j] = r4_set1(b[j]);
+
+  for (i = 0; i < count; ++i) {
+    c[0] = r4_load(a[i]);
+    c[1] = r4_load(a[i] + 4);
+    c[2] = r4_load(a[i] + 8);
+    c[3] = r4_load(a[i] + 12);
+
+    for (j = 0; j < 4; ++j)
+      t[j] = r4_madd(c[3], s[j * 4 + 3],
+                     r4_madd(c[2], s[j * 4 + 2],
+                             r4_madd(c[1], s[j * 4 + 1],
+                                     r4_mul(c[0], s[j * 4]))));
+
+    r4_store(r[i], t[0]);
+    r4_store(r[i] + 4, t[1]);
+    r4_store(r[i] + 8, t[2]);
+    r4_store(r[i] + 12, t[3]);
+  }
+#else
+  for (i = 0; i < count; ++i) {
+    mat44_t t;
+    mat44_mul(t, a[i], b);
+    memcpy(r[i], t, sizeof(mat44_t));
+  }
+#endif
+}
+
+static void mul_each(mat44_t *r, const mat44_t *a, const mat44_t *b,
+                     size_t count) {
+  size_t i;
+
+  for (i = 0; i < count; ++i)
+    mat44_mul_simd(r[i], a[i], b[i]);
+}
+
+static void mul_batch_range(void *ctx, size_t begin, size_t end) {
+  const mul_job_t *j = (const mul_job_t *)ctx;
+  mul_batch((mat44_t *)j->r + begin, (const real_t *)j->a,
+            (const mat44_t *)j->b + begin, end - begin);
+}
+
+static void mul_batch_right_range(void *ctx, size_t begin, size_t end) {
+  const mul_job_t *j = (const mul_job_t *)ctx;
+  mul_batch_right((mat44_t *)j->r + begin, (const mat44_t *)j->a + begin,
+                  (const real_t *)j->b, end - begin);
+}
+
+static void mul_each_range(void *ctx, size_t begin, size_t end) {
+  const mul_job_t *j = (const mul_job_t *)ctx;
+  mul_each((mat44_t *)j->r + begin, (const mat44_t *)j->a + begin,
+           (const mat44_t *)j->b + begin, end - begin);
+}
+
+/* fn over [0, count), pooled from math_parallel_min items */
+static void mul_run(math_range_t fn, void *r, const void *a, const void *b,
+                    size_t count, size_t per) {
+  mul_job_t j;
+
+  j.r = r, j.a = a, j.b = b;
+  if (count * per < math_parallel_min)
+    fn(&j, 0, count);
+  else
+    math_parallel_for(0, count, math_parallel_grain / per, fn, &j);
+}
+
+void mat44_mul_batch(mat44_t *r, const mat44_t a, const mat44_t *b,
+                     size_t count) {
+  mul_run(mul_batch_range, r, a, b, count, 1);
+}
+
+void mat44_mul_batch_right(mat44_t *r, const mat44_t *a, const mat44_t b,
+                           size_t count) {
+  mul_run(mul_batch_right_range, r, a, b, count, 1);
+}
+
+void mat44_mul_each(mat44_t *r, const mat44_t *a, const mat44_t *b,
+                    size_t count) {
+  mul_run(mul_each_range, r, a, b, count, 1);
+}
+
+void mat44_block_pack(mat44_block_t *r, const mat44_t *e, size_t count) {
+  size_t i = 0;
+  int k;
+#ifdef MATH_SIMD_R4
+  /* four matrices at a time: column j of each, transposed, is four rows */
+  r4_t c[4];
+  int j;
+
+  for (; i + 4 <= count; i += 4)
+    for (j = 0; j < 4; ++j) {
+      real_t(*t)[mat44_block_size] = r[i / mat44_block_size].e + j * 4;
+
+      for (k = 0; k < 4; ++k)
+        c[k] = r4_load(e[i + k] + j * 4);
+      r4_transpose(c);
+      for (k = 0; k < 4; ++k)
+        r4_store(t[k] + i % mat44_block_size, c[k]);
+    }
+#endif
+
+  for (; i < count; ++i)
+    for (k = 0; k < 16; ++k)
+      r[i / mat44_block_size].e[k][i % mat44_block_size] = e[i][k];
+
+  /* identity in the unused lanes of the last block */
+  for (; i % mat44_block_size; ++i)
+    for (k = 0; k < 16; ++k)
+      r[i / mat44_block_size].e[k][i % mat44_block_size] =
+          k % 5 ? r_zero : r_one;
+}
+
+void mat44_block_unpack(mat44_t *r, const mat44_block_t *b, size_t count) {
+  size_t i = 0;
+  int k;
+#ifdef MATH_SIMD_R4
+  r4_t c[4];
+  int j;
+
+  for (; i + 4 <= count; i += 4)
+    for (j = 0; j < 4; ++j) {
+      const real_t(*t)[mat44_block_size] = b[i / mat44_block_size].e + j * 4;
+
+      for (k = 0; k < 4; ++k)
+        c[k] = r4_load(t[k] + i % mat44_block_size);
+      r4_transpose(c);
+      for (k = 0; k < 4; ++k)
+        r4_store(r[i + k] + j * 4, c[k]);
+    }
+#endif
+
+  for (; i < count; ++i)
+    for (k = 0; k < 16; ++k)
+      r[i][k] = b[i / mat44_block_size].e[k][i % mat44_block_size];
+}
+
+#ifdef MATH_SIMD
+/* lanes l.. of row k of a times the column b0..b3, from memory */
+#define block_row(a, k, l, b0, b1, b2, b3)                                     \
+  rv_madd(rv_load((a)->e[12 + (k)] + (l)), b3,                                 \
+          rv_madd(rv_load((a)->e[8 + (k)] + (l)), b2,                          \
+                  rv_madd(rv_load((a)->e[4 + (k)] + (l)), b1,                  \
+                          rv_mul(rv_load((a)->e[k] + (l)), b0))))
+#endif
+
+/**
+ * Lane l of r = lane l of a * lane l of b, one column of r at a time. a is
+ * read from memory for every column: holding all 16 rows in registers
+ * spills on targets with 16 vector registers. Column j of r only needs
+ * column j of b, so r may alias b; an aliased a is copied first.
+ **/
+static void block_mul(mat44_block_t *r, const mat44_block_t *a,
+                      const mat44_block_t *b, size_t blocks) {
+  mat44_block_t t;
+  size_t i;
+  int l, j;
+
+  for (i = 0; i < blocks; ++i, ++r, ++a, ++b) {
+    const mat44_block_t *x = r == a ? &t : a;
+
+#ifdef MATH_SIMD
+    for (l = 0; l < mat44_block_size; l += rv_lanes) {
+      if (x == &t)
+        for (j = 0; j < 16; ++j)
+          rv_store(t.e[j] + l, rv_load(a->e[j] + l));
+
+      for (j = 0; j < 4; ++j) {
+        rv_t b0 = rv_load(b->e[j * 4] + l), b1 = rv_load(b->e[j * 4 + 1] + l);
+        rv_t b2 = rv_load(b->e[j * 4 + 2] + l);
+        rv_t b3 = rv_load(b->e[j * 4 + 3] + l);
+
+        rv_store(r->e[j * 4] + l, block_row(x, 0, l, b0, b1, b2, b3));
+        rv_store(r->e[j * 4 + 1] + l, block_row(x, 1, l, b0, b1, b2, b3));
+        rv_store(r->e[j * 4 + 2] + l, block_row(x, 2, l, b0, b1, b2, b3));
+        rv_store(r->e[j * 4 + 3] + l, block_row(x, 3, l, b0, b1, b2, b3));
+      }
+    }
+#else
+    if (x == &t)
+      memcpy(&t, a, sizeof(mat44_block_t));
+
+    for (l = 0; l < mat44_block_size; ++l)
+      for (j = 0; j < 4; ++j) {
+        real_t b0 = b->e[j * 4][l], b1 = b->e[j * 4 + 1][l];
+        real_t b2 = b->e[j * 4 + 2][l], b3 = b->e[j * 4 + 3][l];
+        int k;
+
+        for (k = 0; k < 4; ++k)
+          r->e[j * 4 + k][l] = x->e[k][l] * b0 + x->e[4 + k][l] * b1 +
+                               x->e[8 + k][l] * b2 + x->e[12 + k][l] * b3;
+      }
+#endif
+  }
+}
+
+/* every lane of r = a * lane of b, a broadcast once for all blocks */
+static void block_mul_batch(mat44_block_t *r, const real_t *a,
+                            const mat44_block_t *b, size_t blocks) {
+  size_t i;
+  int l, j, k;
+#ifdef MATH_SIMD
+  rv_t c[16], b0, b1, b2, b3;
+
+  for (k = 0; k < 16; ++k)
+    c[k] = rv_set1(a[k]);
+
+  for (i = 0; i < blocks; ++i, ++r, ++b)
+    for (l = 0; l < mat44_block_size; l += rv_lanes)
+      for (j = 0; j < 4; ++j) {
+        b0 = rv_load(b->e[j * 4] + l);
+        b1 = rv_load(b->e[j * 4 + 1] + l);
+        b2 = rv_load(b->e[j * 4 + 2] + l);
+        b3 = rv_load(b->e[j * 4 + 3] + l);
+
+        for (k = 0; k < 4; ++k)
+          rv_store(r->e[j * 4 + k] + l,
+                   rv_madd(c[12 + k], b3,
+                           rv_madd(c[8 + k], b2,
+                                   rv_madd(c[4 + k], b1, rv_mul(c[k], b0)))));
+      }
+#else
+  real_t b0, b1, b2, b3;
+
+  for (i = 0; i < blocks; ++i, ++r, ++b)
+    for (l = 0; l < mat44_block_size; ++l)
+      for (j = 0; j < 4; ++j) {
+        b0 = b->e[j * 4][l], b1 = b->e[j * 4 + 1][l];
+        b2 = b->e[j * 4 + 2][l], b3 = b->e[j * 4 + 3][l];
+
+        for (k = 0; k < 4; ++k)
+          r->e[j * 4 + k][l] =
+              a[k] * b0 + a[4 + k] * b1 + a[8 + k] * b2 + a[12 + k] * b3;
+      }
+#endif
+}
+
+static void block_mul_range(void *ctx, size_t begin, size_t end) {
+  const mul_job_t *j = (const mul_job_t *)ctx;
+  block_mul((mat44_block_t *)j->r + begin, (const mat44_block_t *)j->a + begin,
+            (const mat44_block_t *)j->b + begin, end - begin);
+}
+
+static void block_mul_batch_range(void *ctx, size_t begin, size_t end) {
+  const mul_job_t *j = (const mul_job_t *)ctx;
+  block_mul_batch((mat44_block_t *)j->r + begin, (const real_t *)j->a,
+                  (const mat44_block_t *)j->b + begin, end - begin);
+}
+
+void mat44_block_mul(mat44_block_t *r, const mat44_block_t *a,
+                     const mat44_block_t *b, size_t blocks) {
+  mul_run(block_mul_range, r, a, b, blocks, mat44_block_size);
+}
+
+void mat44_block_mul_batch(mat44_block_t *r, const mat44_t a,
+                           const mat44_block_t *b, size_t blocks) {
+  mul_run(block_mul_batch_range, r, a, b, blocks, mat44_block_size);
+}
+
+/**
+ * Lane-wide arithmetic for the block inverses: one rv_t of lanes with a
+ * vector path, else one real_t, so the kernels are written once.
+ **/
+#ifdef MATH_SIMD
+typedef rv_t lane_t;
+typedef rv_t lane_mask_t;
+
+#define lane_step rv_lanes
+#define lane_load(p) rv_load(p)
+#define lane_store(p, v) rv_store(p, v)
+#define lane_set1(x) rv_set1(x)
+#define lane_add(a, b) rv_add(a, b)
+#define lane_sub(a, b) rv_sub(a, b)
+#define lane_mul(a, b) rv_mul(a, b)
+#define lane_div(a, b) rv_div(a, b)
+#define lane_cmplt(a, b) rv_cmplt(a, b)
+#define lane_select(m, a, b) rv_select(m, a, b)
+#define lane_and(m, a) rv_and(m, a)
+#define lane_bits(m) rv_movemask(m)
+#else
+typedef real_t lane_t;
+typedef int lane_mask_t;
+
+#define lane_step 1
+#define lane_load(p) (*(p))
+#define lane_store(p, v) (*(p) = (v))
+#define lane_set1(x) (x)
+#define lane_add(a, b) ((a) + (b))
+#define lane_sub(a, b) ((a) - (b))
+#define lane_mul(a, b) ((a) * (b))
+#define lane_div(a, b) ((a) / (b))
+#define lane_cmplt(a, b) ((a) < (b))
+#define lane_select(m, a, b) ((m) ? (a) : (b))
+#define lane_and(m, a) ((m) ? (a) : r_zero)
+#define lane_bits(m) (m)
+#endif
+
+/* a * b - c * d */
+#define lane_cross(a, b, c, d) lane_sub(lane_mul(a, b), lane_mul(c, d))
+
+/**
+ * Regular when det^2 > mat_inverse_tolerance^2 * |c0|^2 |c1|^2 .. over the
+ * column lengths (Hadamard's bound, so the ratio is 1 for orthogonal
+ * columns at any scale). Tested with s = 1 / det as |c0|^2 |c1|^2 s *
+ * |c2|^2 .. s < inverse_bound, each factor near 1 so float builds do not
+ * overflow. NaN and inf fail the compare.
+ **/
+#define inverse_bound (r_one / (mat_inverse_tolerance * mat_inverse_tolerance))
+
+static lane_mask_t lane_regular(lane_t s, const lane_t *c) {
+  lane_t l[4];
+  int i;
+
+  for (i = 0; i < 4; ++i)
+    l[i] = lane_add(lane_add(lane_mul(c[i * 4], c[i * 4]),
+                             lane_mul(c[i * 4 + 1], c[i * 4 + 1])),
+                    lane_add(lane_mul(c[i * 4 + 2], c[i * 4 + 2]),
+                             lane_mul(c[i * 4 + 3], c[i * 4 + 3])));
+
+  l[0] = lane_mul(lane_mul(l[0], l[1]), s);
+  l[2] = lane_mul(lane_mul(l[2], l[3]), s);
+  return lane_cmplt(lane_mul(l[0], l[2]), lane_set1(inverse_bound));
+}
+
+/**
+ * Lanes l .. l + lane_step of e[k][l] inverted into r through the 2x2
+ * minors of the first two and last two columns (read as rows, which
+ * inverts e^T, i.e. e column by column). Flagged lanes become the
+ * identity; returns them as bits. r may alias e.
+ **/
+static int lane_inverse44(real_t (*r)[mat44_block_size],
+                          const real_t (*e)[mat44_block_size], int l) {
+  lane_t a[16], s[6], c[6], det, t;
+  lane_t one = lane_set1(r_one), zero = lane_set1(r_zero);
+  lane_mask_t ok;
+  int k;
+
+  for (k = 0; k < 16; ++k)
+    a[k] = lane_load(e[k] + l);
+
+  s[0] = lane_cross(a[0], a[5], a[4], a[1]);
+  s[1] = lane_cross(a[0], a[6], a[4], a[2]);
+  s[2] = lane_cross(a[0], a[7], a[4], a[3]);
+  s[3] = lane_cross(a[1], a[6], a[5], a[2]);
+  s[4] = lane_cross(a[1], a[7], a[5], a[3]);
+  s[5] = lane_cross(a[2], a[7], a[6], a[3]);
+
+  c[5] = lane_cross(a[10], a[15], a[14], a[11]);
+  c[4] = lane_cross(a[9], a[15], a[13], a[11]);
+  c[3] = lane_cross(a[9], a[14], a[13], a[10]);
+  c[2] = lane_cross(a[8], a[15], a[12], a[11]);
+  c[1] = lane_cross(a[8], a[14], a[12], a[10]);
+  c[0] = lane_cross(a[8], a[13], a[12], a[9]);
+
+  det = lane_add(lane_sub(lane_cross(s[0], c[5], s[1], c[4]),
+                          lane_mul(s[4], c[1])),
+                 lane_add(lane_add(lane_mul(s[2], c[3]), lane_mul(s[3], c[2])),
+                          lane_mul(s[5], c[0])));
+  t = lane_div(one, det);
+  ok = lane_regular(t, a);
+
+  /* flagged lanes are masked to 0 and get 1 added on the diagonal */
+  one = lane_select(ok, zero, one);
+
+  /* each cofactor goes out as soon as it is known, to save registers */
+#define lane_out(k, v)                                                         \
+  lane_store(r[k] + l, k % 5 ? lane_and(ok, lane_mul(v, t))                    \
+                             : lane_add(lane_and(ok, lane_mul(v, t)), one))
+#define lane_cof(x, p, y, q, z, w)                                             \
+  lane_add(lane_cross(a[x], p, a[y], q), lane_mul(a[z], w))
+#define lane_cof_neg(x, p, y, q, z, w)                                         \
+  lane_sub(lane_cross(a[x], p, a[y], q), lane_mul(a[z], w))
+
+  lane_out(0, lane_cof(5, c[5], 6, c[4], 7, c[3]));
+  lane_out(1, lane_cof_neg(2, c[4], 1, c[5], 3, c[3]));
+  lane_out(2, lane_cof(13, s[5], 14, s[4], 15, s[3]));
+  lane_out(3, lane_cof_neg(10, s[4], 9, s[5], 11, s[3]));
+  lane_out(4, lane_cof_neg(6, c[2], 4, c[5], 7, c[1]));
+  lane_out(5, lane_cof(0, c[5], 2, c[2], 3, c[1]));
+  lane_out(6, lane_cof_neg(14, s[2], 12, s[5], 15, s[1]));
+  lane_out(7, lane_cof(8, s[5], 10, s[2], 11, s[1]));
+  lane_out(8, lane_cof(4, c[4], 5, c[2], 7, c[0]));
+  lane_out(9, lane_cof_neg(1, c[2], 0, c[4], 3, c[0]));
+  lane_out(10, lane_cof(12, s[4], 13, s[2], 15, s[0]));
+  lane_out(11, lane_cof_neg(9, s[2], 8, s[4], 11, s[0]));
+  lane_out(12, lane_cof_neg(5, c[1], 4, c[3], 6, c[0]));
+  lane_out(13, lane_cof(0, c[3], 1, c[1], 2, c[0]));
+  lane_out(14, lane_cof_neg(13, s[1], 12, s[3], 14, s[0]));
+  lane_out(15, lane_cof(8, s[3], 9, s[1], 10, s[0]));
+
+#undef lane_out
+#undef lane_cof
+#undef lane_cof_neg
+
+  return ~lane_bits(ok) & ((1 << lane_step) - 1);
+}
+
+/* flags of lanes l .. l + lane_step from the bits of lane_inverse */
+static void lane_flags(unsigned char *singular, int bits) {
+  int k;
+
+  for (k = 0; k < lane_step; ++k)
+    singular[k] = (unsigned char)((bits >> k) & 1);
+}
+
+static void block_inverse(mat44_block_t *r, const mat44_block_t *e,
+                          unsigned char *singular, size_t blocks) {
+  size_t i;
+  int l;
+
+  for (i = 0; i < blocks; ++i, ++r, ++e, singular += mat44_block_size)
+    for (l = 0; l < mat44_block_size; l += lane_step)
+      lane_flags(singular + l, lane_inverse44(r->e, e->e, l));
+}
+
+#ifdef MATH_SIMD_R4_SHUFFLE
+/**
+ * One mat44_t through r4_inverse44, cheaper than transposing into lanes
+ * and back; the column lengths come from one transpose of the squares.
+ **/
+static int inverse44_one(mat44_t r, const mat44_t e) {
+  r4_t c[4], l[4], s;
+  real_t p[4];
+  int k;
+
+  for (k = 0; k < 4; ++k) {
+    c[k] = r4_load(e + k * 4);
+    l[k] = r4_mul(c[k], c[k]);
+  }
+  r4_transpose(l);
+  l[0] = r4_add(r4_add(l[0], l[1]), r4_add(l[2], l[3]));
+
+  /* p[0] * p[3] = |c0|^2 |c1|^2 s * |c2|^2 |c3|^2 s, as lane_regular */
+  s = r4_inverse44(c);
+  r4_store(p, r4_mul(r4_mul(l[0], r4_swizzle(l[0], 1, 0, 3, 2)), s));
+
+  if (!(p[0] * p[3] < inverse_bound)) {
+    mat44_identity(r);
+    return 1;
+  }
+
+  for (k = 0; k < 4; ++k)
+    r4_store(r + k * 4, c[k]);
+  return 0;
+}
+
+static void inverse44(mat44_t *r, const mat44_t *e, unsigned char *singular,
+                      size_t count) {
+  size_t i;
+
+  for (i = 0; i < count; ++i)
+    singular[i] = (unsigned char)inverse44_one(r[i], e[i]);
+}
+#else
+static void inverse44(mat44_t *r, const mat44_t *e, unsigned char *singular,
+                      size_t count) {
+  mat44_block_t b;
+  unsigned char f[mat44_block_size];
+  size_t i, n;
+
+  for (i = 0; i < count; i += n) {
+    n = count - i < mat44_block_size ? count - i : mat44_block_size;
+    mat44_block_pack(&b, e + i, n);
+    block_inverse(&b, &b, f, 1);
+    mat44_block_unpack(r + i, &b, n);
+    memcpy(singular + i, f, n);
+  }
+}
+#endif
+
+#if defined(MATH_SIMD_R4) && rv_lanes >= 4
+/* a * b - c * d and a^2 + b^2 + c^2 */
+#define inv_cross(a, b, c, d) r4_sub(r4_mul(a, b), r4_mul(c, d))
+#define inv_lensq(a, b, c)                                                     \
+  r4_add(r4_add(r4_mul(a, a), r4_mul(b, b)), r4_mul(c, c))
+
+/**
+ * Four mat33_t at a time, all in registers: elements 0 .. 3 and 4 .. 7 of
+ * the four are two r4 transposes and element 8 is gathered, so lane l of
+ * a[k] is element k of matrix l. Returns the flagged matrices as bits,
+ * which become the identity. r may alias e.
+ **/
+static int inverse33_r4(mat33_t *r, const mat33_t *e) {
+  r4_t a[9], b[9], c[4], s;
+  real_t p[4], b8[4];
+  int k, bits = 0;
+
+  /* unrolled by hand so a and b stay in registers */
+  for (k = 0; k < 4; ++k)
+    c[k] = r4_load(e[k]);
+  r4_transpose(c);
+  a[0] = c[0], a[1] = c[1], a[2] = c[2], a[3] = c[3];
+  for (k = 0; k < 4; ++k)
+    c[k] = r4_load(e[k] + 4);
+  r4_transpose(c);
+  a[4] = c[0], a[5] = c[1], a[6] = c[2], a[7] = c[3];
+  a[8] = r4_set(e[0][8], e[1][8], e[2][8], e[3][8]);
+
+  b[0] = inv_cross(a[4], a[8], a[7], a[5]);
+  b[1] = inv_cross(a[2], a[7], a[1], a[8]);
+  b[2] = inv_cross(a[1], a[5], a[2], a[4]);
+  b[3] = inv_cross(a[5], a[6], a[3], a[8]);
+  b[4] = inv_cross(a[0], a[8], a[2], a[6]);
+  b[5] = inv_cross(a[3], a[2], a[0], a[5]);
+  b[6] = inv_cross(a[3], a[7], a[6], a[4]);
+  b[7] = inv_cross(a[6], a[1], a[0], a[7]);
+  b[8] = inv_cross(a[0], a[4], a[3], a[1]);
+
+  s = r4_add(r4_add(r4_mul(a[0], b[0]), r4_mul(a[3], b[1])),
+             r4_mul(a[6], b[2]));
+  s = r4_div(r4_set1(r_one), s);
+
+  /* |c0|^2 |c1|^2 s * |c2|^2 s, as lane_regular */
+  c[0] = r4_mul(inv_lensq(a[0], a[1], a[2]), inv_lensq(a[3], a[4], a[5]));
+  c[1] = r4_mul(inv_lensq(a[6], a[7], a[8]), s);
+  r4_store(p, r4_mul(r4_mul(c[0], s), c[1]));
+
+  for (k = 0; k < 4; ++k)
+    c[k] = r4_mul(b[k], s);
+  r4_transpose(c);
+  for (k = 0; k < 4; ++k)
+    r4_store(r[k], c[k]);
+  for (k = 0; k < 4; ++k)
+    c[k] = r4_mul(b[k + 4], s);
+  r4_transpose(c);
+  for (k = 0; k < 4; ++k)
+    r4_store(r[k] + 4, c[k]);
+  r4_store(b8, r4_mul(b[8], s));
+
+  for (k = 0; k < 4; ++k) {
+    r[k][8] = b8[k];
+    if (!(p[k] < inverse_bound)) {
+      mat33_identity(r[k]);
+      bits |= 1 << k;
+    }
+  }
+  return bits;
+}
+
+static void inverse33(mat33_t *r, const mat33_t *e, unsigned char *singular,
+                      size_t count) {
+  mat33_t t[4];
+  size_t i, n;
+  int bits, k;
+
+  for (i = 0; i + 4 <= count; i += 4) {
+    bits = inverse33_r4(r + i, e + i);
+    for (k = 0; k < 4; ++k)
+      singular[i + k] = (unsigned char)((bits >> k) & 1);
+  }
+
+  /* the last count % 4 once, padded with identities */
+  n = count - i;
+  if (n == 0)
+    return;
+
+  memcpy(t, e + i, sizeof(mat33_t) * n);
+  for (k = (int)n; k < 4; ++k)
+    mat33_identity(t[k]);
+  bits = inverse33_r4(t, (const mat33_t *)t);
+  memcpy(r + i, t, sizeof(mat33_t) * n);
+  for (k = 0; k < (int)n; ++k)
+    singular[i + k] = (unsigned char)((bits >> k) & 1);
+}
+#else
+#define inv_cross(a, b, c, d) ((a) * (b) - (c) * (d))
+#define inv_lensq(a, b, c) ((a) * (a) + (b) * (b) + (c) * (c))
+
+/**
+ * One mat33_t with the test of inverse33_r4. Two double lanes do not pay
+ * for the transposes, so SSE2 double builds take this path too.
+ **/
+static int inverse33_one(mat33_t r, const mat33_t e) {
+  real_t b[9], s, p;
+  int k;
+
+  b[0] = inv_cross(e[4], e[8], e[7], e[5]);
+  b[1] = inv_cross(e[2], e[7], e[1], e[8]);
+  b[2] = inv_cross(e[1], e[5], e[2], e[4]);
+  b[3] = inv_cross(e[5], e[6], e[3], e[8]);
+  b[4] = inv_cross(e[0], e[8], e[2], e[6]);
+  b[5] = inv_cross(e[3], e[2], e[0], e[5]);
+  b[6] = inv_cross(e[3], e[7], e[6], e[4]);
+  b[7] = inv_cross(e[6], e[1], e[0], e[7]);
+  b[8] = inv_cross(e[0], e[4], e[3], e[1]);
+
+  s = r_one / (e[0] * b[0] + e[3] * b[1] + e[6] * b[2]);
+  p = inv_lensq(e[0], e[1], e[2]) * inv_lensq(e[3], e[4], e[5]) * s *
+      (inv_lensq(e[6], e[7], e[8]) * s);
+
+  if (!(p < inverse_bound)) {
+    mat33_identity(r);
+    return 1;
+  }
+
+  for (k = 0; k < 9; ++k)
+    r[k] = b[k] * s;
+  return 0;
+}
+
+static void inverse33(mat33_t *r, const mat33_t *e, unsigned char *singular,
+                      size_t count) {
+  size_t i;
+
+  for (i = 0; i < count; ++i)
+    singular[i] = (unsigned char)inverse33_one(r[i], e[i]);
+}
+#endif
+
+/* arguments of an inverse batch split over math_parallel_for */
+typedef struct inverse_job_t {
+  void *r;
+  const void *e;
+  unsigned char *singular;
+} inverse_job_t;
+
+static void inverse33_range(void *ctx, size_t begin, size_t end) {
+  const inverse_job_t *j = (const inverse_job_t *)ctx;
+  inverse33((mat33_t *)j->r + begin, (const mat33_t *)j->e + begin,
+            j->singular + begin, end - begin);
+}
+
+static void inverse44_range(void *ctx, size_t begin, size_t end) {
+  const inverse_job_t *j = (const inverse_job_t *)ctx;
+  inverse44((mat44_t *)j->r + begin, (const mat44_t *)j->e + begin,
+            j->singular + begin, end - begin);
+}
+
+static void block_inverse_range(void *ctx, size_t begin, size_t end) {
+  const inverse_job_t *j = (const inverse_job_t *)ctx;
+  block_inverse((mat44_block_t *)j->r + begin,
+                (const mat44_block_t *)j->e + begin,
+                j->singular + begin * mat44_block_size, end - begin);
+}
+
+/* fn over [0, count), pooled from math_parallel_min items; flagged count */
+static size_t inverse_run(math_range_t fn, void *r, const void *e,
+                          unsigned char *singular, size_t count, size_t per) {
+  inverse_job_t j;
+  size_t i, n = 0;
+
+  j.r = r, j.e = e, j.singular = singular;
+  if (count * per < math_parallel_min)
+    fn(&j, 0, count);
+  else
+    math_parallel_for(0, count, math_parallel_grain / per, fn, &j);
+
+  for (i = 0; i < count * per; ++i)
+    n += singular[i];
+  return n;
+}
+
+size_t mat33_inverse_batch(mat33_t *r, const mat33_t *e,
+                           unsigned char *singular, size_t count) {
+  return inverse_run(inverse33_range, r, e, singular, count, 1);
+}
+
+size_t mat44_inverse_batch(mat44_t *r, const mat44_t *e,
+                           unsigned char *singular, size_t count) {
+  return inverse_run(inverse44_range, r, e, singular, count, 1);
+}
+
+size_t mat44_block_inverse(mat44_block_t *r, const mat44_block_t *e,
+                           unsigned char *singular, size_t blocks) {
+  return inverse_run(block_inverse_range, r, e, singular, blocks,
+                     mat44_block_size);
+}
+
+void mat44_inverse_affine(mat44_t r, const mat44_t e) {
+  vec3_t a0, a1, a2, t, r0, r1, r2;
+  real_t det;
+
+  /**
+   * | A t |-1   | A^-1  -A^-1*t |
+   * | 0 1 |   = | 0        1    |
+   *
+   * with the rows of A^-1 = (a1 x a2, a2 x a0, a0 x a1) / |A|
+   **/
+
+  vx(a0) = e0(e), vy(a0) = e1(e), vz(a0) = e2(e);
+  vx(a1) = e4(e), vy(a1) = e5(e), vz(a1) = e6(e);
+  vx(a2) = e8(e), vy(a2) = e9(e), vz(a2) = e10(e);
+  vx(t) = e12(e), vy(t) = e13(e), vz(t) = e14(e);
+
+  vec3_cross(r0, a1, a2);
+  vec3_cross(r1, a2, a0);
+  vec3_cross(r2, a0, a1);
+
+  det = r_one / vec3_dot(a0, r0);
+  vec3_scale(r0, r0, det);
+  vec3_scale(r1, r1, det);
+  vec3_scale(r2, r2, det);
+
+  e0(r) = vx(r0), e4(r) = vy(r0), e8(r) = vz(r0);
+  e1(r) = vx(r1), e5(r) = vy(r1), e9(r) = vz(r1);
+  e2(r) = vx(r2), e6(r) = vy(r2), e10(r) = vz(r2);
+  e3(r) = e7(r) = e11(r) = r_zero;
+
+  e12(r) = -vec3_dot(r0, t);
+  e13(r) = -vec3_dot(r1, t);
+  e14(r) = -vec3_dot(r2, t);
+  e15(r) = r_one;
+}
+
+void mat44_inverse_rigid(mat44_t r, const mat44_t e) {
+  vec3_t a0, a1, a2, t;
+
+  /**
+   * | R t |-1   | R^T  -R^T*t |
+   * | 0 1 |   = | 0       1   |
+   **/
+
+  vx(a0) = e0(e), vy(a0) = e1(e), vz(a0) = e2(e);
+  vx(a1) = e4(e), vy(a1) = e5(e), vz(a1) = e6(e);
+  vx(a2) = e8(e), vy(a2) = e9(e), vz(a2) = e10(e);
+  vx(t) = e12(e), vy(t) = e13(e), vz(t) = e14(e);
+
+  e0(r) = vx(a0), e4(r) = vy(a0), e8(r) = vz(a0);
+  e1(r) = vx(a1), e5(r) = vy(a1), e9(r) = vz(a1);
+  e2(r) = vx(a2), e6(r) = vy(a2), e10(r) = vz(a2);
+  e3(r) = e7(r) = e11(r) = r_zero;
+
+  e12(r) = -vec3_dot(a0, t);
+  e13(r) = -vec3_dot(a1, t);
+  e14(r) = -vec3_dot(a2, t);
+  e15(r) = r_one;
+}
+
 void mat44_ortho(mat44_t r, real_t left, real_t right, real_t bottom,
                  real_t top, real_t near, real_t far) {
   real_t rml = right - left;
@@ -309,3 +1507,313 @@ void mat44_lookat(mat44_t r, vec3_t eye, vec3_t target, vec3_t up) {
   e10(r) = vz(z);
   e14(r) = -vec3_dot(z, eye);
 }
+
+void mat22f_rotation(mat22f_t r, realf_t theta) {
+  realf_t c, s;
+
+  rf_sincos(theta, &s, &c);
+
+  /**
+   * | c -s |
+   * | s  c |
+   **/
+
+  e0(r) = c;
+  e1(r) = s;
+  e2(r) = -s;
+  e3(r) = c;
+}
+
+void mat33f_transformation(mat33f_t r, realf_t x, realf_t y, realf_t theta,
+                           realf_t sx, realf_t sy, realf_t ox, realf_t oy,
+                           realf_t kx, realf_t ky) {
+  realf_t c, s;
+
+  rf_sincos(theta, &s, &c);
+
+  /**
+   * |1    x| |c -s  | |sx     | | 1 ky  | |1   -ox|
+   * |  1  y| |s  c  | |   sy  | |kx  1  | |  1 -oy|
+   * |     1| |     1| |      1| |      1| |     1 |
+   *   move    rotate    scale     skew      origin
+   **/
+
+  e0(r) = c * sx - ky * s * sy; /* = a */
+  e1(r) = s * sx + ky * c * sy; /* = b */
+  e3(r) = kx * c * sx - s * sy; /* = c */
+  e4(r) = kx * s * sx + c * sy; /* = d */
+  e6(r) = x - ox * e0(r) - oy * e3(r);
+  e7(r) = y - ox * e1(r) - oy * e4(r);
+  e2(r) = e5(r) = rf_zero;
+  e8(r) = rf_one;
+}
+
+void mat33f_rotatex(mat33f_t r, realf_t theta) {
+  realf_t c, s;
+
+  rf_sincos(theta, &s, &c);
+
+  /**
+   * | 1  0  0 |
+   * | 0  c -s |
+   * | 0  s  c |
+   **/
+
+  mat33_identity(r);
+  e4(r) = c;
+  e5(r) = s;
+  e7(r) = -s;
+  e8(r) = c;
+}
+
+void mat33f_rotatey(mat33f_t r, realf_t theta) {
+  realf_t c, s;
+
+  rf_sincos(theta, &s, &c);
+
+  /**
+   * |  c  0  s |
+   * |  0  1  0 |
+   * | -s  0  c |
+   **/
+
+  mat33_identity(r);
+  e0(r) = c;
+  e2(r) = -s;
+  e6(r) = s;
+  e8(r) = c;
+}
+
+void mat33f_rotatez(mat33f_t r, realf_t theta) {
+  realf_t c, s;
+
+  rf_sincos(theta, &s, &c);
+
+  /**
+   * | c -s  0 |
+   * | s  c  0 |
+   * | 0  0  1 |
+   **/
+
+  mat33_identity(r);
+  e0(r) = c;
+  e1(r) = s;
+  e3(r) = -s;
+  e4(r) = c;
+}
+
+void mat33f_rotateaxis(mat33f_t r, realf_t theta, vec3f_t axis) {
+  realf_t c, s, t, xs, ys, zs;
+  realf_t xx = vx(axis) * vx(axis);
+  realf_t xy = vx(axis) * vy(axis);
+  realf_t xz = vx(axis) * vz(axis);
+  realf_t yy = vy(axis) * vy(axis);
+  realf_t yz = vy(axis) * vz(axis);
+  realf_t zz = vz(axis) * vz(axis);
+
+  rf_sincos(theta, &s, &c);
+  t = 1 - c;
+  xs = vx(axis) * s;
+  ys = vy(axis) * s;
+  zs = vz(axis) * s;
+
+  e0(r) = xx * t + c;
+  e3(r) = xy * t - zs;
+  e6(r) = xz * t + ys;
+
+  e1(r) = xy * t + zs;
+  e4(r) = yy * t + c;
+  e7(r) = yz * t - xs;
+
+  e2(r) = xz * t - ys;
+  e5(r) = yz * t + xs;
+  e8(r) = zz * t + c;
+}
+
+void mat44f_transformation(mat44f_t r, realf_t x, realf_t y, realf_t theta,
+                           realf_t sx, realf_t sy, realf_t ox, realf_t oy,
+                           realf_t kx, realf_t ky) {
+  realf_t c, s;
+
+  rf_sincos(theta, &s, &c);
+
+  /**
+   * |1     x| |c -s    | |sx       | | 1 ky    | |1     -ox|
+   * |  1   y| |s  c    | |   sy    | |kx  1    | |  1   -oy|
+   * |    1  | |     1  | |      1  | |      1  | |    1    |
+   * |      1| |       1| |        1| |        1| |       1 |
+   *   move      rotate      scale       skew       origin
+   **/
+
+  mat44_zero(r);
+  e0(r) = c * sx - ky * s * sy; /* = a */
+  e1(r) = s * sx + ky * c * sy; /* = b */
+  e4(r) = kx * c * sx - s * sy; /* = c */
+  e5(r) = kx * s * sx + c * sy; /* = d */
+  e12(r) = x - ox * e0(r) - oy * e4(r);
+  e13(r) = y - ox * e1(r) - oy * e5(r);
+  e10(r) = e15(r) = rf_one;
+}
+
+void mat44f_rotatex(mat44f_t r, realf_t theta) {
+  realf_t c, s;
+
+  rf_sincos(theta, &s, &c);
+
+  /**
+   * | 1  0  0  0 |
+   * | 0  c -s  0 |
+   * | 0  s  c  0 |
+   * | 0  0  0  1 |
+   **/
+
+  mat44_identity(r);
+  e5(r) = c;
+  e6(r) = s;
+  e9(r) = -s;
+  e10(r) = c;
+}
+
+void mat44f_rotatey(mat44f_t r, realf_t theta) {
+  realf_t c, s;
+
+  rf_sincos(theta, &s, &c);
+
+  /**
+   * |  c  0  s  0 |
+   * |  0  1  0  0 |
+   * | -s  0  c  0 |
+   * |  0  0  0  1 |
+   **/
+
+  mat44_identity(r);
+  e0(r) = c;
+  e2(r) = -s;
+  e8(r) = s;
+  e10(r) = c;
+}
+
+void mat44f_rotatez(mat44f_t r, realf_t theta) {
+  realf_t c, s;
+
+  rf_sincos(theta, &s, &c);
+
+  /**
+   * | c -s  0  0 |
+   * | s  c  0  0 |
+   * | 0  0  1  0 |
+   * | 0  0  0  1 |
+   **/
+
+  mat44_identity(r);
+  e0(r) = c;
+  e1(r) = s;
+  e4(r) = -s;
+  e5(r) = c;
+}
+
+void mat44f_rotateaxis(mat44f_t r, realf_t theta, vec3f_t axis) {
+  realf_t c, s, t, xs, ys, zs;
+  realf_t xx = vx(axis) * vx(axis);
+  realf_t xy = vx(axis) * vy(axis);
+  realf_t xz = vx(axis) * vz(axis);
+  realf_t yy = vy(axis) * vy(axis);
+  realf_t yz = vy(axis) * vz(axis);
+  realf_t zz = vz(axis) * vz(axis);
+
+  rf_sincos(theta, &s, &c);
+  t = 1 - c;
+  xs = vx(axis) * s;
+  ys = vy(axis) * s;
+  zs = vz(axis) * s;
+
+  mat44_identity(r);
+
+  e0(r) = xx * t + c;
+  e4(r) = xy * t - zs;
+  e8(r) = xz * t + ys;
+
+  e1(r) = xy * t + zs;
+  e5(r) = yy * t + c;
+  e9(r) = yz * t - xs;
+
+  e2(r) = xz * t - ys;
+  e6(r) = yz * t + xs;
+  e10(r) = zz * t + c;
+}
+
+void mat44f_ortho(mat44f_t r, realf_t left, realf_t right, realf_t bottom,
+                  realf_t top, realf_t near, realf_t far) {
+  realf_t rml = right - left;
+  realf_t tmb = top - bottom;
+  realf_t fmn = far - near;
+
+  realf_t rpl = right + left;
+  realf_t tpb = top + bottom;
+  realf_t fpn = far + near;
+
+  mat44_identity(r);
+
+  e0(r) = rf_two / rml;
+  e5(r) = rf_two / tmb;
+  e10(r) = -rf_two / fmn;
+
+  e12(r) = -rpl / rml;
+  e13(r) = -tpb / tmb;
+  e14(r) = -fpn / fmn;
+}
+
+void mat44f_frustum(mat44f_t r, realf_t left, realf_t right, realf_t bottom,
+                    realf_t top, realf_t near, realf_t far) {
+  realf_t rl = right - left;
+  realf_t tb = top - bottom;
+  realf_t fn = far - near;
+
+  mat44_zero(r);
+
+  e0(r) = (near * rf_two) / rl;
+  e5(r) = (near * rf_two) / tb;
+  e8(r) = (right + left) / rl;
+  e9(r) = (top + bottom) / tb;
+  e10(r) = -(far + near) / fn;
+  e11(r) = -rf_one;
+  e14(r) = -(far * near * rf_two) / fn;
+}
+
+void mat44f_perspective(mat44f_t r, realf_t fovy, realf_t aspect,
+                        realf_t near, realf_t far) {
+  realf_t top = near * rf_tan(fovy * rf_pi / rf_360);
+  realf_t right = top * aspect;
+
+  mat44f_frustum(r, -right, right, -top, top, near, far);
+}
+
+void mat44f_lookat(mat44f_t r, vec3f_t eye, vec3f_t target, vec3f_t up) {
+  vec3f_t focal, x, y, z;
+
+  vec3_sub(focal, target, eye);
+  vec3f_normalize(focal, rf_one);
+
+  vec3_cross(x, focal, up);
+  vec3f_normalize(x, rf_one);
+
+  vec3_cross(y, x, focal);
+  vec3_neg(z, focal);
+
+  mat44_identity(r);
+
+  e0(r) = vx(x);
+  e4(r) = vy(x);
+  e8(r) = vz(x);
+  e12(r) = -vec3_dot(x, eye);
+
+  e1(r) = vx(y);
+  e5(r) = vy(y);
+  e9(r) = vz(y);
+  e13(r) = -vec3_dot(y, eye);
+
+  e2(r) = vx(z);
+  e6(r) = vy(z);
+  e10(r) = vz(z);
+  e14(r) = -vec3_dot(z, eye);
+}
@@ -40,6 +40,25 @@ typedef real_t mat33_t[9];
  **/
 typedef real_t mat44_t[16];
 
+/**
+ * mat44_block_size matrices stored element-major: e[k][l] is element k of
+ * matrix l, so a lane-wide load reads one element of several matrices.
+ **/
+#define mat44_block_size 8
+
+typedef struct mat44_block_t {
+  real_t e[16][mat44_block_size];
+} mat44_block_t;
+
+/**
+ * Single precision flavour. Every macro below except the *_equal tests is
+ * type-generic and also takes the float types; the inverse macros evaluate
+ * their determinant in real_t.
+ **/
+typedef realf_t mat22f_t[4];
+typedef realf_t mat33f_t[9];
+typedef realf_t mat44f_t[16];
+
 #define e0(e) e[0]
 #define e1(e) e[1]
 #define e2(e) e[2]
@@ -63,7 +82,7 @@ typedef real_t mat44_t[16];
  *---------------------------------------------
  **/
 
-#define mat22_zero(e) memset(e, 0, sizeof(real_t) * 4)
+#define mat22_zero(e) memset(e, 0, sizeof(e0(e)) * 4)
 
 #define mat22_equal(a, b)                                                      \
   (r_equal(e0(a), e0(b)) && r_equal(e1(a), e1(b)) && r_equal(e2(a), e2(b)) &&  \
@@ -133,7 +152,7 @@ void mat22_rotation(mat22_t r, real_t theta);
  *---------------------------------------------
  **/
 
-#define mat33_zero(e) memset(e, 0, sizeof(real_t) * 9)
+#define mat33_zero(e) memset(e, 0, sizeof(e0(e)) * 9)
 
 #define mat33_equal(a, b)                                                      \
   (r_equal(e0(a), e0(b)) && r_equal(e1(a), e1(b)) && r_equal(e2(a), e2(b)) &&  \
@@ -195,13 +214,13 @@ void mat22_rotation(mat22_t r, real_t theta);
     real_t det = mat33_determinant(e);                                         \
     det = r_one / det;                                                         \
     e0(r) = det * (e4(e) * e8(e) - e7(e) * e5(e));                             \
-    e1(r) = -det * (e3(e) * e8(e) - e5(e) * e6(e));                            \
-    e2(r) = det * (e3(e) * e7(e) - e6(e) * e4(e));                             \
-    e3(r) = -det * (e1(e) * e8(e) - e2(e) * e7(e));                            \
+    e1(r) = -det * (e1(e) * e8(e) - e2(e) * e7(e));                            \
+    e2(r) = det * (e1(e) * e5(e) - e2(e) * e4(e));                             \
+    e3(r) = -det * (e3(e) * e8(e) - e5(e) * e6(e));                            \
     e4(r) = det * (e0(e) * e8(e) - e2(e) * e6(e));                             \
-    e5(r) = -det * (e0(e) * e7(e) - e6(e) * e1(e));                            \
-    e6(r) = det * (e1(e) * e5(e) - e2(e) * e4(e));                             \
-    e7(r) = -det * (e0(e) * e5(e) - e3(e) * e2(e));                            \
+    e5(r) = -det * (e0(e) * e5(e) - e3(e) * e2(e));                            \
+    e6(r) = det * (e3(e) * e7(e) - e6(e) * e4(e));                             \
+    e7(r) = -det * (e0(e) * e7(e) - e6(e) * e1(e));                            \
     e8(r) = det * (e0(e) * e4(e) - e3(e) * e1(e));                             \
   } while (0)
 
@@ -240,18 +259,22 @@ void mat33_rotatey(mat33_t r, real_t theta);
 void mat33_rotatez(mat33_t r, real_t theta);
 void mat33_rotateaxis(mat33_t r, real_t theta, vec3_t axis);
 
-#define mat33_tomat44(r4, e3)                                                  \
+/* r[i] = mat33_rotateaxis(theta + i * step, axis) * v, see vec2_rotate_sweep */
+void vec3_rotateaxis_sweep(vec3_t *r, const vec3_t v, vec3_t axis,
+                           real_t theta, real_t step, size_t count);
+
+#define mat33_tomat44(r, e)                                                    \
   do {                                                                         \
-    mat44_identity(r4);                                                        \
-    e0(r4) = e0(e3);                                                           \
-    e1(r4) = e1(e3);                                                           \
-    e2(r4) = e2(e3);                                                           \
-    e4(r4) = e3(e3);                                                           \
-    e5(r4) = e4(e3);                                                           \
-    e6(r4) = e5(e3);                                                           \
-    e8(r4) = e6(e3);                                                           \
-    e9(r4) = e7(e3);                                                           \
-    e10(r4) = e8(e3);                                                          \
+    mat44_identity(r);                                                         \
+    e0(r) = e0(e);                                                             \
+    e1(r) = e1(e);                                                             \
+    e2(r) = e2(e);                                                             \
+    e4(r) = e3(e);                                                             \
+    e5(r) = e4(e);                                                             \
+    e6(r) = e5(e);                                                             \
+    e8(r) = e6(e);                                                             \
+    e9(r) = e7(e);                                                             \
+    e10(r) = e8(e);                                                            \
   } while (0)
 
 /**
@@ -260,7 +283,7 @@ void mat33_rotateaxis(mat33_t r, real_t theta, vec3_t axis);
  *---------------------------------------------
  **/
 
-#define mat44_zero(e) memset(e, 0, sizeof(real_t) * 16)
+#define mat44_zero(e) memset(e, 0, sizeof(e0(e)) * 16)
 
 #define mat44_equal(a, b)                                                      \
   (r_equal(e0(a), e0(b)) && r_equal(e1(a), e1(b)) && r_equal(e2(a), e2(b)) &&  \
@@ -394,7 +417,7 @@ void mat33_rotateaxis(mat33_t r, real_t theta, vec3_t axis);
             e8(e) * e5(e) * e14(e) - e4(e) * e9(e) * e14(e)) +                 \
    e7(e) * (e0(e) * e9(e) * e14(e) - e0(e) * e13(e) * e10(e) +                 \
             e12(e) * e1(e) * e10(e) - e8(e) * e1(e) * e14(e) +                 \
-            e12(e) * e13(e) * e2(e) - e12(e) * e9(e) * e2(e)) +                \
+            e8(e) * e13(e) * e2(e) - e12(e) * e9(e) * e2(e)) +                 \
    e11(e) * (e0(e) * e13(e) * e6(e) - e0(e) * e5(e) * e14(e) -                 \
              e12(e) * e1(e) * e6(e) + e4(e) * e1(e) * e14(e) +                 \
              e12(e) * e5(e) * e2(e) - e4(e) * e13(e) * e2(e)) +                \
@@ -497,6 +520,95 @@ void mat33_rotateaxis(mat33_t r, real_t theta, vec3_t axis);
     vw(r) = e3(e) * vx(v) + e7(e) * vy(v) + e11(e) * vz(v) + e15(e) * vw(v);   \
   } while (0)
 
+/**
+ * Vectorized mat44_mul, mat44_inverse and mat44_transpose, picked at compile
+ * time (see simd.h); builds without a vector path use the macros above as
+ * the reference. Unlike the macros, r may alias the inputs.
+ **/
+void mat44_mul_simd(mat44_t r, const mat44_t a, const mat44_t b);
+void mat44_inverse_simd(mat44_t r, const mat44_t e);
+void mat44_transpose_simd(mat44_t r, const mat44_t e);
+
+/**
+ * Cheaper inverses for matrices whose last row is (0 0 0 1): affine takes
+ * the upper 3x3 through one 3x3 adjugate, rigid additionally requires that
+ * 3x3 to be a rotation and only transposes it. r may alias e.
+ **/
+void mat44_inverse_affine(mat44_t r, const mat44_t e);
+void mat44_inverse_rigid(mat44_t r, const mat44_t e);
+
+/* r = a * b when both last rows are (0 0 0 1), r may alias a or b */
+void mat44_mul_affine(mat44_t r, const mat44_t a, const mat44_t b);
+
+/**
+ * Products over arrays, pooled from math_parallel_min matrices. The shared
+ * matrix is loaded into registers once. r may alias the array operands.
+ **/
+
+/* r[i] = a * b[i], e.g. view-projection times every model matrix */
+void mat44_mul_batch(mat44_t *r, const mat44_t a, const mat44_t *b,
+                     size_t count);
+
+/* r[i] = a[i] * b */
+void mat44_mul_batch_right(mat44_t *r, const mat44_t *a, const mat44_t b,
+                           size_t count);
+
+/* r[i] = a[i] * b[i], e.g. parent world times child local */
+void mat44_mul_each(mat44_t *r, const mat44_t *a, const mat44_t *b,
+                    size_t count);
+
+/**
+ * Block layout for mat44_mul_each on long arrays: every lane computes one
+ * product, with no shuffles. Pack fills ceil(count / mat44_block_size)
+ * blocks, padding the last one with identities. The gain grows with the
+ * lane count; with two double lanes (SSE2) it is close to mat44_mul_each.
+ **/
+void mat44_block_pack(mat44_block_t *r, const mat44_t *e, size_t count);
+void mat44_block_unpack(mat44_t *r, const mat44_block_t *b, size_t count);
+
+/* r[i] = a[i] * b[i] lane by lane over blocks, r may alias a or b */
+void mat44_block_mul(mat44_block_t *r, const mat44_block_t *a,
+                     const mat44_block_t *b, size_t blocks);
+
+/* r[i] = a * b[i] lane by lane, r may alias b */
+void mat44_block_mul_batch(mat44_block_t *r, const mat44_t a,
+                           const mat44_block_t *b, size_t blocks);
+
+/**
+ * Inverses over arrays with a per-item flag. singular[i] is set to 1 when
+ * |det| is at most mat_inverse_tolerance times the product of the column
+ * lengths (singular, nearly so, or not finite) and r[i] is then the
+ * identity instead of inf/NaN, else 0. Returns the number of flagged items.
+ * r may alias e; pooled from math_parallel_min matrices.
+ *
+ * mat33 runs four matrices per r4 transpose where rv_t has four lanes or
+ * more, one at a time otherwise; mat44 runs mat44_inverse_simd's kernel
+ * one at a time where it exists, else through packed blocks.
+ **/
+#define mat_inverse_tolerance (r_epsilon * 16)
+
+size_t mat33_inverse_batch(mat33_t *r, const mat33_t *e,
+                           unsigned char *singular, size_t count);
+size_t mat44_inverse_batch(mat44_t *r, const mat44_t *e,
+                           unsigned char *singular, size_t count);
+
+/* same on packed blocks, singular holds blocks * mat44_block_size flags */
+size_t mat44_block_inverse(mat44_block_t *r, const mat44_block_t *e,
+                           unsigned char *singular, size_t blocks);
+
+/**
+ * r[i] = mat44_transformN(e, v[i]) over count vectors read every stride
+ * bytes from v (0 means tightly packed), so v may point into an interleaved
+ * vertex buffer. r may alias v when both are packed. From math_parallel_min
+ * vectors on the work is spread over the math_parallel_for pool.
+ **/
+void mat44_transform2_batch(vec2_t *r, const mat44_t e, const real_t *v,
+                            size_t count, size_t stride);
+void mat44_transform3_batch(vec3_t *r, const mat44_t e, const real_t *v,
+                            size_t count, size_t stride);
+void mat44_transform4_batch(vec4_t *r, const mat44_t e, const real_t *v,
+                            size_t count, size_t stride);
+
 void mat44_transformation(mat44_t r, real_t x, real_t y, real_t theta,
                           real_t sx, real_t sy, real_t ox, real_t oy, real_t kx,
                           real_t ky);
@@ -514,19 +626,73 @@ void mat44_perspective(mat44_t r, real_t fovy, real_t aspect, real_t near,
                        real_t far);
 void mat44_lookat(mat44_t r, vec3_t eye, vec3_t target, vec3_t up);
 
-#define mat44_tomat33(r3, e4)                                                  \
+#define mat44_tomat33(r, e)                                                    \
   do {                                                                         \
-    e0(r3) = e0(e4);                                                           \
-    e1(r3) = e1(e4);                                                           \
-    e2(r3) = e2(e4);                                                           \
-    e3(r3) = e4(e4);                                                           \
-    e4(r3) = e5(e4);                                                           \
-    e5(r3) = e6(e4);                                                           \
-    e6(r3) = e8(e4);                                                           \
-    e7(r3) = e9(e4);                                                           \
-    e8(r3) = e10(e4);                                                          \
+    e0(r) = e0(e);                                                             \
+    e1(r) = e1(e);                                                             \
+    e2(r) = e2(e);                                                             \
+    e3(r) = e4(e);                                                             \
+    e4(r) = e5(e);                                                             \
+    e5(r) = e6(e);                                                             \
+    e6(r) = e8(e);                                                             \
+    e7(r) = e9(e);                                                             \
+    e8(r) = e10(e);                                                            \
   } while (0)
 
+/**
+ *---------------------------------------------
+ *  Single Precision Matrix
+ *---------------------------------------------
+ **/
+
+#define mat22f_equal(a, b)                                                     \
+  (rf_equal(e0(a), e0(b)) && rf_equal(e1(a), e1(b)) &&                         \
+   rf_equal(e2(a), e2(b)) && rf_equal(e3(a), e3(b)))
+
+#define mat33f_equal(a, b)                                                     \
+  (rf_equal(e0(a), e0(b)) && rf_equal(e1(a), e1(b)) &&                         \
+   rf_equal(e2(a), e2(b)) && rf_equal(e3(a), e3(b)) &&                         \
+   rf_equal(e4(a), e4(b)) && rf_equal(e5(a), e5(b)) &&                         \
+   rf_equal(e6(a), e6(b)) && rf_equal(e7(a), e7(b)) && rf_equal(e8(a), e8(b)))
+
+#define mat44f_equal(a, b)                                                     \
+  (rf_equal(e0(a), e0(b)) && rf_equal(e1(a), e1(b)) &&                         \
+   rf_equal(e2(a), e2(b)) && rf_equal(e3(a), e3(b)) &&                         \
+   rf_equal(e4(a), e4(b)) && rf_equal(e5(a), e5(b)) &&                         \
+   rf_equal(e6(a), e6(b)) && rf_equal(e7(a), e7(b)) &&                         \
+   rf_equal(e8(a), e8(b)) && rf_equal(e9(a), e9(b)) &&                         \
+   rf_equal(e10(a), e10(b)) && rf_equal(e11(a), e11(b)) &&                     \
+   rf_equal(e12(a), e12(b)) && rf_equal(e13(a), e13(b)) &&                     \
+   rf_equal(e14(a), e14(b)) && rf_equal(e15(a), e15(b)))
+
+void mat22f_rotation(mat22f_t r, realf_t theta);
+
+void mat33f_transformation(mat33f_t r, realf_t x, realf_t y, realf_t theta,
+                           realf_t sx, realf_t sy, realf_t ox, realf_t oy,
+                           realf_t kx, realf_t ky);
+
+void mat33f_rotatex(mat33f_t r, realf_t theta);
+void mat33f_rotatey(mat33f_t r, realf_t theta);
+void mat33f_rotatez(mat33f_t r, realf_t theta);
+void mat33f_rotateaxis(mat33f_t r, realf_t theta, vec3f_t axis);
+
+void mat44f_transformation(mat44f_t r, realf_t x, realf_t y, realf_t theta,
+                           realf_t sx, realf_t sy, realf_t ox, realf_t oy,
+                           realf_t kx, realf_t ky);
+
+void mat44f_rotatex(mat44f_t r, realf_t theta);
+void mat44f_rotatey(mat44f_t r, realf_t theta);
+void mat44f_rotatez(mat44f_t r, realf_t theta);
+void mat44f_rotateaxis(mat44f_t r, realf_t theta, vec3f_t axis);
+
+void mat44f_ortho(mat44f_t r, realf_t left, realf_t right, realf_t bottom,
+                  realf_t top, realf_t near, realf_t far);
+void mat44f_frustum(mat44f_t r, realf_t left, realf_t right, realf_t bottom,
+                    realf_t top, realf_t near, realf_t far);
+void mat44f_perspective(mat44f_t r, realf_t fovy, realf_t aspect,
+                        realf_t near, realf_t far);
+void mat44f_lookat(mat44f_t r, vec3f_t eye, vec3f_t target, vec3f_t up);
+
 #ifdef __cplusplus
 };
 #endif
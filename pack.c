@@ -0,0 +1,488 @@
+/*
+ *  pack.c
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#include "pack.h"
+#include "parallel.h"
+#include "simd.h"
+
+/**
+ *---------------------------------------------
+ *  Quaternion
+ *---------------------------------------------
+ **/
+
+/* 1 / sqrt(2), the range of the three smallest components */
+#define pack_range ((real_t)0.70710678118654752440)
+
+/* quaternions per unpack chunk, a multiple of rv_lanes */
+#define pack_chunk 64
+
+/* slots of the three stored components when index k was dropped */
+static const unsigned char pack_slots[4][3] = {
+    {1, 2, 3}, {0, 2, 3}, {0, 1, 3}, {0, 1, 2}};
+
+/**
+ * index << 3 bits | a << 2 bits | b << bits | c. The spare high bits of the
+ * 48 and 64-bit forms are 0 and ignored when decoding.
+ **/
+static uint64_t quat_encode(const quat_t q, int bits) {
+  const real_t top = (real_t)((1u << bits) - 1);
+  const real_t scale = top * pack_range; /* top / (2 pack_range) */
+  const real_t a0 = r_abs(q[0]), a1 = r_abs(q[1]);
+  const real_t a2 = r_abs(q[2]), a3 = r_abs(q[3]);
+  /**
+   * Pairwise, with twice the maxima as a + b + |a - b| so nothing depends
+   * on a branch: on unordered data the compares are coin flips.
+   **/
+  const real_t m01 = a0 + a1 + r_abs(a0 - a1), m23 = a2 + a3 + r_abs(a2 - a3);
+  const int k01 = a1 > a0, k23 = 2 + (a3 > a2);
+  const int k = k01 + (k23 - k01) * (m23 > m01);
+  const real_t sign = r_copysign(r_one, q[k]);
+  uint64_t w;
+  int i;
+
+  w = (uint64_t)k;
+
+  for (i = 0; i < 3; ++i) {
+    real_t t = (q[pack_slots[k][i]] * sign + pack_range) * scale + r_half;
+
+    t = t < top ? t : top; /* NaN goes to top */
+    t = t > r_zero ? t : r_zero;
+    w = (w << bits) | (uint32_t)t; /* cheaper than a direct 64-bit convert */
+  }
+  return w;
+}
+
+/* the three fields of w scaled back into c[0..2][i], index into k[i] */
+#define quat_fields(c, k, i, w, bits)                                          \
+  do {                                                                         \
+    const real_t step = 2 * pack_range / (real_t)((1u << (bits)) - 1);         \
+    const uint64_t mask = ((uint64_t)1 << (bits)) - 1;                         \
+    uint64_t v = (w);                                                          \
+    (c)[2][i] = (real_t)(v & mask) * step - pack_range;                        \
+    (c)[1][i] = (real_t)((v >> (bits)) & mask) * step - pack_range;            \
+    (c)[0][i] = (real_t)((v >> 2 * (bits)) & mask) * step - pack_range;        \
+    (k)[i] = (unsigned char)((v >> 3 * (bits)) & 3);                           \
+  } while (0)
+
+/* r[i] from the fields of n quaternions, the dropped one from 1 - |abc|^2 */
+static void quat_assemble(quat_t *r, real_t (*c)[pack_chunk],
+                          const unsigned char *k, size_t n) {
+  real_t d[pack_chunk];
+  size_t i = 0;
+
+#ifdef MATH_SIMD
+  for (; i + rv_lanes <= n; i += rv_lanes) {
+    rv_t a = rv_load(c[0] + i), b = rv_load(c[1] + i), e = rv_load(c[2] + i);
+    rv_t s = rv_madd(a, a, rv_madd(b, b, rv_mul(e, e)));
+
+    rv_store(d + i, rv_sqrt(rv_max(rv_sub(rv_set1(r_one), s), rv_zero())));
+  }
+#endif
+  for (; i < n; ++i) {
+    real_t s = r_one - c[0][i] * c[0][i] - c[1][i] * c[1][i] -
+               c[2][i] * c[2][i];
+    d[i] = r_sqrt(s > r_zero ? s : r_zero);
+  }
+
+  for (i = 0; i < n; ++i) {
+    const unsigned char *slot = pack_slots[k[i]];
+
+    r[i][k[i]] = d[i];
+    r[i][slot[0]] = c[0][i];
+    r[i][slot[1]] = c[1][i];
+    r[i][slot[2]] = c[2][i];
+  }
+}
+
+/* one quaternion, the scalar form of quat_fields and quat_assemble */
+static void quat_decode(quat_t r, uint64_t w, int bits) {
+  const real_t step = 2 * pack_range / (real_t)((1u << bits) - 1);
+  const uint64_t mask = ((uint64_t)1 << bits) - 1;
+  const unsigned char *slot = pack_slots[(w >> 3 * bits) & 3];
+  real_t s = r_one;
+  int i;
+
+  for (i = 2; i >= 0; --i, w >>= bits) {
+    real_t c = (real_t)(w & mask) * step - pack_range;
+
+    r[slot[i]] = c;
+    s -= c * c;
+  }
+  r[w & 3] = r_sqrt(s > r_zero ? s : r_zero);
+}
+
+static uint64_t quat48_word(quat48_t p) {
+  return (uint64_t)p.v[0] | (uint64_t)p.v[1] << 16 | (uint64_t)p.v[2] << 32;
+}
+
+quat32_t quat_pack32(const quat_t q) { return (quat32_t)quat_encode(q, 10); }
+
+quat48_t quat_pack48(const quat_t q) {
+  uint64_t w = quat_encode(q, 15);
+  quat48_t p;
+
+  p.v[0] = (uint16_t)w;
+  p.v[1] = (uint16_t)(w >> 16);
+  p.v[2] = (uint16_t)(w >> 32);
+  return p;
+}
+
+quat64_t quat_pack64(const quat_t q) { return quat_encode(q, 20); }
+
+void quat_unpack32(quat_t r, quat32_t p) { quat_decode(r, p, 10); }
+
+void quat_unpack48(quat_t r, quat48_t p) {
+  quat_decode(r, quat48_word(p), 15);
+}
+
+void quat_unpack64(quat_t r, quat64_t p) { quat_decode(r, p, 20); }
+
+/* arguments of a pack or unpack split over math_parallel_for */
+typedef struct pack_job_t {
+  void *r;
+  const void *p;
+} pack_job_t;
+
+static void pack32_range(void *ctx, size_t begin, size_t end) {
+  const pack_job_t *j = (const pack_job_t *)ctx;
+  const quat_t *q = (const quat_t *)j->p;
+  quat32_t *r = (quat32_t *)j->r;
+
+  for (; begin < end; ++begin)
+    r[begin] = quat_pack32(q[begin]);
+}
+
+static void pack48_range(void *ctx, size_t begin, size_t end) {
+  const pack_job_t *j = (const pack_job_t *)ctx;
+  const quat_t *q = (const quat_t *)j->p;
+  quat48_t *r = (quat48_t *)j->r;
+
+  for (; begin < end; ++begin)
+    r[begin] = quat_pack48(q[begin]);
+}
+
+static void pack64_range(void *ctx, size_t begin, size_t end) {
+  const pack_job_t *j = (const pack_job_t *)ctx;
+  const quat_t *q = (const quat_t *)j->p;
+  quat64_t *r = (quat64_t *)j->r;
+
+  for (; begin < end; ++begin)
+    r[begin] = quat_pack64(q[begin]);
+}
+
+/* chunk by chunk: split the fields, then assemble */
+#define quat_unpack_range(name, type, word, bits)                              \
+  static void name(void *ctx, size_t begin, size_t end) {                      \
+    const pack_job_t *j = (const pack_job_t *)ctx;                             \
+    const type *p = (const type *)j->p + begin;                                \
+    quat_t *r = (quat_t *)j->r + begin;                                        \
+    real_t c[3][pack_chunk];                                                   \
+    unsigned char k[pack_chunk];                                               \
+    size_t i, n;                                                               \
+                                                                               \
+    for (; begin < end; begin += n, p += n, r += n) {                          \
+      n = end - begin < pack_chunk ? end - begin : pack_chunk;                 \
+      for (i = 0; i < n; ++i)                                                  \
+        quat_fields(c, k, i, word(p[i]), bits);                                \
+      quat_assemble(r, c, k, n);                                               \
+    }                                                                          \
+  }
+
+#define quat_word(p) (p)
+
+quat_unpack_range(unpack32_range, quat32_t, quat_word, 10)
+quat_unpack_range(unpack48_range, quat48_t, quat48_word, 15)
+quat_unpack_range(unpack64_range, quat64_t, quat_word, 20)
+
+/* fn over [0, count), pooled from math_parallel_min items */
+static void pack_run(math_range_t fn, void *r, const void *p, size_t count) {
+  pack_job_t j;
+
+  j.r = r, j.p = p;
+  if (count < math_parallel_min)
+    fn(&j, 0, count);
+  else
+    math_parallel_for(0, count, math_parallel_grain, fn, &j);
+}
+
+void quat_pack32_array(quat32_t *r, const quat_t *q, size_t count) {
+  pack_run(pack32_range, r, q, count);
+}
+
+void quat_unpack32_array(quat_t *r, const quat32_t *p, size_t count) {
+  pack_run(unpack32_range, r, p, count);
+}
+
+void quat_pack48_array(quat48_t *r, const quat_t *q, size_t count) {
+  pack_run(pack48_range, r, q, count);
+}
+
+void quat_unpack48_array(quat_t *r, const quat48_t *p, size_t count) {
+  pack_run(unpack48_range, r, p, count);
+}
+
+void quat_pack64_array(quat64_t *r, const quat_t *q, size_t count) {
+  pack_run(pack64_range, r, q, count);
+}
+
+void quat_unpack64_array(quat_t *r, const quat64_t *p, size_t count) {
+  pack_run(unpack64_range, r, p, count);
+}
+
+/**
+ *---------------------------------------------
+ *  Unit Vector
+ *---------------------------------------------
+ **/
+
+/* v onto the octahedron, the lower half folded over: p in [-1, 1]^2 */
+static void oct_fold(real_t *px, real_t *py, const vec3_t v) {
+  real_t s = r_one / (r_abs(vx(v)) + r_abs(vy(v)) + r_abs(vz(v)));
+  real_t x = vx(v) * s, y = vy(v) * s;
+
+  if (vz(v) < r_zero) {
+    real_t t = x;
+    x = r_copysign(r_one - r_abs(y), x);
+    y = r_copysign(r_one - r_abs(t), y);
+  }
+  *px = x, *py = y;
+}
+
+/* inverse of oct_fold, normalized */
+static void oct_unfold(vec3_t r, real_t x, real_t y) {
+  real_t z = r_one - r_abs(x) - r_abs(y), t = (r_abs(z) - z) * r_half, s;
+
+  x -= r_copysign(t, x);
+  y -= r_copysign(t, y);
+  s = r_one / r_sqrt(x * x + y * y + z * z);
+  vx(r) = x * s, vy(r) = y * s, vz(r) = z * s;
+}
+
+/* p in [-1, 1] to 0 .. 2^bits - 1, NaN to 0 like oct_encode's lanes */
+static uint32_t oct_code(real_t p, int bits) {
+  const real_t top = (real_t)((1u << bits) - 1);
+  real_t t = (p + r_one) * (top * r_half) + r_half;
+
+  t = t > r_zero ? t : r_zero;
+  t = t < top ? t : top;
+  return (uint32_t)t;
+}
+
+static real_t oct_value(uint32_t c, int bits) {
+  return (real_t)c * (r_two / (real_t)((1u << bits) - 1)) - r_one;
+}
+
+/**
+ * Chunks of pack_chunk vectors go through x, y and z lanes: the fold and
+ * the unfold with its normalize run on rv_t, the integer codes are packed
+ * and split by the scalar loops around them.
+ **/
+static void oct_encode(uint32_t *cu, uint32_t *cv, const vec3_t *v, size_t n,
+                       int bits) {
+  size_t i = 0;
+#ifdef MATH_SIMD
+  const rv_t sign = rv_set1(-r_zero), one = rv_set1(r_one);
+  const rv_t top = rv_set1((real_t)((1u << bits) - 1));
+  const rv_t half = rv_set1(r_half), scale = rv_mul(top, half);
+  real_t x[pack_chunk], y[pack_chunk], z[pack_chunk];
+  size_t m = n / rv_lanes * rv_lanes;
+
+  for (i = 0; i < m; ++i)
+    x[i] = vx(v[i]), y[i] = vy(v[i]), z[i] = vz(v[i]);
+
+  for (i = 0; i < m; i += rv_lanes) {
+    rv_t a = rv_load(x + i), b = rv_load(y + i), c = rv_load(z + i);
+    rv_t s = rv_div(one, rv_add(rv_add(rv_abs(a), rv_abs(b)), rv_abs(c)));
+    rv_t fa, fb, lower;
+
+    a = rv_mul(a, s);
+    b = rv_mul(b, s);
+
+    /* copysign(1 - |b|, a) and copysign(1 - |a|, b) where c < 0 */
+    fa = rv_or(rv_and(a, sign), rv_sub(one, rv_abs(b)));
+    fb = rv_or(rv_and(b, sign), rv_sub(one, rv_abs(a)));
+    lower = rv_cmplt(c, rv_zero());
+    a = rv_select(lower, fa, a);
+    b = rv_select(lower, fb, b);
+
+    /* max(t, 0) returns 0 for NaN */
+    a = rv_madd(rv_add(a, one), scale, half);
+    b = rv_madd(rv_add(b, one), scale, half);
+    rv_store(x + i, rv_min(rv_max(a, rv_zero()), top));
+    rv_store(y + i, rv_min(rv_max(b, rv_zero()), top));
+  }
+
+  for (i = 0; i < m; ++i)
+    cu[i] = (uint32_t)x[i], cv[i] = (uint32_t)y[i];
+#endif
+
+  for (; i < n; ++i) {
+    real_t px, py;
+
+    oct_fold(&px, &py, v[i]);
+    cu[i] = oct_code(px, bits);
+    cv[i] = oct_code(py, bits);
+  }
+}
+
+static void oct_decode(vec3_t *r, const uint32_t *cu, const uint32_t *cv,
+                       size_t n, int bits) {
+  size_t i = 0;
+#ifdef MATH_SIMD
+  const real_t step = r_two / (real_t)((1u << bits) - 1);
+  const rv_t sign = rv_set1(-r_zero), one = rv_set1(r_one);
+  real_t x[pack_chunk], y[pack_chunk], z[pack_chunk];
+  size_t m = n / rv_lanes * rv_lanes;
+
+  for (i = 0; i < m; ++i) {
+    x[i] = (real_t)cu[i] * step - r_one;
+    y[i] = (real_t)cv[i] * step - r_one;
+  }
+
+  for (i = 0; i < m; i += rv_lanes) {
+    rv_t a = rv_load(x + i), b = rv_load(y + i), c, t, s;
+
+    c = rv_sub(rv_sub(one, rv_abs(a)), rv_abs(b));
+    t = rv_max(rv_sub(rv_zero(), c), rv_zero());
+    a = rv_sub(a, rv_or(rv_and(a, sign), t));
+    b = rv_sub(b, rv_or(rv_and(b, sign), t));
+    s = rv_div(one, rv_sqrt(rv_madd(a, a, rv_madd(b, b, rv_mul(c, c)))));
+
+    rv_store(x + i, rv_mul(a, s));
+    rv_store(y + i, rv_mul(b, s));
+    rv_store(z + i, rv_mul(c, s));
+  }
+
+  for (i = 0; i < m; ++i)
+    vx(r[i]) = x[i], vy(r[i]) = y[i], vz(r[i]) = z[i];
+#endif
+
+  for (; i < n; ++i)
+    oct_unfold(r[i], oct_value(cu[i], bits), oct_value(cv[i], bits));
+}
+
+oct16_t vec3_pack16(const vec3_t v) {
+  real_t x, y;
+
+  oct_fold(&x, &y, v);
+  return (oct16_t)(oct_code(x, 8) << 8 | oct_code(y, 8));
+}
+
+void vec3_unpack16(vec3_t r, oct16_t p) {
+  oct_unfold(r, oct_value(p >> 8, 8), oct_value(p & 0xff, 8));
+}
+
+oct24_t vec3_pack24(const vec3_t v) {
+  real_t x, y;
+  uint32_t w;
+  oct24_t p;
+
+  oct_fold(&x, &y, v);
+  w = oct_code(x, 12) << 12 | oct_code(y, 12);
+  p.v[0] = (uint8_t)w, p.v[1] = (uint8_t)(w >> 8), p.v[2] = (uint8_t)(w >> 16);
+  return p;
+}
+
+static uint32_t oct24_word(oct24_t p) {
+  return (uint32_t)p.v[0] | (uint32_t)p.v[1] << 8 | (uint32_t)p.v[2] << 16;
+}
+
+void vec3_unpack24(vec3_t r, oct24_t p) {
+  uint32_t w = oct24_word(p);
+  oct_unfold(r, oct_value(w >> 12, 12), oct_value(w & 0xfff, 12));
+}
+
+oct32_t vec3_pack32(const vec3_t v) {
+  real_t x, y;
+
+  oct_fold(&x, &y, v);
+  return oct_code(x, 16) << 16 | oct_code(y, 16);
+}
+
+void vec3_unpack32(vec3_t r, oct32_t p) {
+  oct_unfold(r, oct_value(p >> 16, 16), oct_value(p & 0xffff, 16));
+}
+
+/* chunk by chunk through oct_encode, then the codes joined */
+#define oct_pack_range(name, type, bits, join)                                 \
+  static void name(void *ctx, size_t begin, size_t end) {                      \
+    const pack_job_t *j = (const pack_job_t *)ctx;                             \
+    const vec3_t *v = (const vec3_t *)j->p + begin;                            \
+    type *r = (type *)j->r + begin;                                            \
+    uint32_t cu[pack_chunk], cv[pack_chunk];                                   \
+    size_t i, n;                                                               \
+                                                                               \
+    for (; begin < end; begin += n, v += n, r += n) {                          \
+      n = end - begin < pack_chunk ? end - begin : pack_chunk;                 \
+      oct_encode(cu, cv, v, n, bits);                                          \
+      for (i = 0; i < n; ++i)                                                  \
+        join(r[i], cu[i] << (bits) | cv[i]);                                   \
+    }                                                                          \
+  }
+
+/* the codes split, then chunk by chunk through oct_decode */
+#define oct_unpack_range(name, type, bits, word)                               \
+  static void name(void *ctx, size_t begin, size_t end) {                      \
+    const pack_job_t *j = (const pack_job_t *)ctx;                             \
+    const type *p = (const type *)j->p + begin;                                \
+    vec3_t *r = (vec3_t *)j->r + begin;                                        \
+    uint32_t cu[pack_chunk], cv[pack_chunk];                                   \
+    size_t i, n;                                                               \
+                                                                               \
+    for (; begin < end; begin += n, p += n, r += n) {                          \
+      n = end - begin < pack_chunk ? end - begin : pack_chunk;                 \
+      for (i = 0; i < n; ++i) {                                                \
+        uint32_t w = word(p[i]);                                               \
+        cu[i] = w >> (bits);                                                   \
+        cv[i] = w & ((1u << (bits)) - 1);                                      \
+      }                                                                        \
+      oct_decode(r, cu, cv, n, bits);                                          \
+    }                                                                          \
+  }
+
+#define oct_join(r, w) ((r) = (w))
+#define oct_join16(r, w) ((r) = (oct16_t)(w))
+#define oct_join24(r, w)                                                       \
+  ((r).v[0] = (uint8_t)(w), (r).v[1] = (uint8_t)((w) >> 8),                    \
+   (r).v[2] = (uint8_t)((w) >> 16))
+
+oct_pack_range(oct16_range, oct16_t, 8, oct_join16)
+oct_pack_range(oct24_range, oct24_t, 12, oct_join24)
+oct_pack_range(oct32_range, oct32_t, 16, oct_join)
+
+oct_unpack_range(unoct16_range, oct16_t, 8, quat_word)
+oct_unpack_range(unoct24_range, oct24_t, 12, oct24_word)
+oct_unpack_range(unoct32_range, oct32_t, 16, quat_word)
+
+void vec3_pack16_array(oct16_t *r, const vec3_t *v, size_t count) {
+  pack_run(oct16_range, r, v, count);
+}
+
+void vec3_unpack16_array(vec3_t *r, const oct16_t *p, size_t count) {
+  pack_run(unoct16_range, r, p, count);
+}
+
+void vec3_pack24_array(oct24_t *r, const vec3_t *v, size_t count) {
+  pack_run(oct24_range, r, v, count);
+}
+
+void vec3_unpack24_array(vec3_t *r, const oct24_t *p, size_t count) {
+  pack_run(unoct24_range, r, p, count);
+}
+
+void vec3_pack32_array(oct32_t *r, const vec3_t *v, size_t count) {
+  pack_run(oct32_range, r, v, count);
+}
+
+void vec3_unpack32_array(vec3_t *r, const oct32_t *p, size_t count) {
+  pack_run(unoct32_range, r, p, count);
+}
@@ -0,0 +1,129 @@
+/*
+ *  pack.h
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#ifndef __PACK_H__
+#define __PACK_H__
+
+#include "quaternion.h"
+#include "vector.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *---------------------------------------------
+ *  Quaternion
+ *---------------------------------------------
+ **/
+
+/**
+ * Smallest-three encoding of a unit quaternion: the index of the largest
+ * component (2 bits), made positive since q and -q are the same rotation,
+ * and the other three, which lie in [-1/sqrt2, 1/sqrt2], quantized to
+ * bits each. Unpack rebuilds the largest one from the unit length, so the
+ * result is normalized.
+ *
+ *   type      bytes  bits  max angular error (2 sqrt6 / (2^bits - 1))
+ *   quat32_t    4     10   4.8e-3 rad (0.27 deg)
+ *   quat48_t    6     15   1.5e-4 rad (0.0086 deg)
+ *   quat64_t    8     20   4.7e-6 rad (0.00027 deg)
+ *
+ * The bound holds for normalized input; float builds add their own
+ * rounding on top of the 64-bit form.
+ **/
+typedef uint32_t quat32_t;
+typedef uint64_t quat64_t;
+
+typedef struct quat48_t {
+  uint16_t v[3];
+} quat48_t;
+
+quat32_t quat_pack32(const quat_t q);
+void quat_unpack32(quat_t r, quat32_t p);
+
+quat48_t quat_pack48(const quat_t q);
+void quat_unpack48(quat_t r, quat48_t p);
+
+quat64_t quat_pack64(const quat_t q);
+void quat_unpack64(quat_t r, quat64_t p);
+
+/**
+ * Array forms. Unpack runs in chunks: the fields are split into lanes,
+ * the largest components come out of one vector sqrt, then each quat_t is
+ * put back in order. Pooled from math_parallel_min items.
+ **/
+void quat_pack32_array(quat32_t *r, const quat_t *q, size_t count);
+void quat_unpack32_array(quat_t *r, const quat32_t *p, size_t count);
+
+void quat_pack48_array(quat48_t *r, const quat_t *q, size_t count);
+void quat_unpack48_array(quat_t *r, const quat48_t *p, size_t count);
+
+void quat_pack64_array(quat64_t *r, const quat_t *q, size_t count);
+void quat_unpack64_array(quat_t *r, const quat64_t *p, size_t count);
+
+/**
+ *---------------------------------------------
+ *  Unit Vector
+ *---------------------------------------------
+ **/
+
+/**
+ * Octahedral encoding of a unit vec3_t: v is projected onto the octahedron
+ * |x| + |y| + |z| = 1, the lower half folded over the upper one, and the
+ * resulting square [-1, 1]^2 quantized to bits per axis. Unpack unfolds
+ * and normalizes. A coordinate that comes out NaN (a zero or non-finite v)
+ * takes code 0 in every form, so a zero vector packs to 0 and unpacks to
+ * (0, 0, -1).
+ *
+ *   type     bytes  bits  max angular error
+ *   oct16_t    2      8   1.7e-2 rad (0.95 deg)
+ *   oct24_t    3     12   1.1e-3 rad (0.060 deg)
+ *   oct32_t    4     16   7.0e-5 rad (0.0040 deg)
+ *
+ * Bounds measured over 4M directions, axes and fold edges, in both
+ * precisions; the error halves with every extra bit.
+ **/
+typedef uint16_t oct16_t;
+typedef uint32_t oct32_t;
+
+typedef struct oct24_t {
+  uint8_t v[3];
+} oct24_t;
+
+oct16_t vec3_pack16(const vec3_t v);
+void vec3_unpack16(vec3_t r, oct16_t p);
+
+oct24_t vec3_pack24(const vec3_t v);
+void vec3_unpack24(vec3_t r, oct24_t p);
+
+oct32_t vec3_pack32(const vec3_t v);
+void vec3_unpack32(vec3_t r, oct32_t p);
+
+/**
+ * Array forms, vectorized over chunks split into x, y and z lanes both
+ * ways. Pooled from math_parallel_min items.
+ **/
+void vec3_pack16_array(oct16_t *r, const vec3_t *v, size_t count);
+void vec3_unpack16_array(vec3_t *r, const oct16_t *p, size_t count);
+
+void vec3_pack24_array(oct24_t *r, const vec3_t *v, size_t count);
+void vec3_unpack24_array(vec3_t *r, const oct24_t *p, size_t count);
+
+void vec3_pack32_array(oct32_t *r, const vec3_t *v, size_t count);
+void vec3_unpack32_array(vec3_t *r, const oct32_t *p, size_t count);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __PACK_H__ */
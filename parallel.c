@@ -0,0 +1,364 @@
+/*
+ *  parallel.c
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L /* sysconf, sched_yield */
+#endif
+
+#include "parallel.h"
+#include <stdlib.h>
+
+#ifndef MATH_NO_THREADS
+
+#ifdef _WIN32
+#include <windows.h>
+
+typedef HANDLE par_thread_t;
+typedef CRITICAL_SECTION par_mutex_t;
+typedef CONDITION_VARIABLE par_cond_t;
+
+#define par_mutex_init(m) (InitializeCriticalSection(m), 0)
+#define par_mutex_destroy(m) DeleteCriticalSection(m)
+#define par_mutex_lock(m) EnterCriticalSection(m)
+#define par_mutex_unlock(m) LeaveCriticalSection(m)
+#define par_cond_init(c) (InitializeConditionVariable(c), 0)
+#define par_cond_destroy(c) ((void)(c))
+#define par_cond_wait(c, m) SleepConditionVariableCS(c, m, INFINITE)
+#define par_cond_broadcast(c) WakeAllConditionVariable(c)
+#define par_thread_yield() SwitchToThread()
+
+static DWORD WINAPI worker_main(LPVOID arg);
+
+static int par_thread_create(par_thread_t *t, void *arg) {
+  *t = CreateThread(NULL, 0, worker_main, arg, 0, NULL);
+  return *t ? 0 : -1;
+}
+
+static void par_thread_join(par_thread_t t) {
+  WaitForSingleObject(t, INFINITE);
+  CloseHandle(t);
+}
+
+static int hardware_threads(void) {
+  SYSTEM_INFO si;
+  GetSystemInfo(&si);
+  return (int)si.dwNumberOfProcessors;
+}
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+typedef pthread_t par_thread_t;
+typedef pthread_mutex_t par_mutex_t;
+typedef pthread_cond_t par_cond_t;
+
+#define par_mutex_init(m) pthread_mutex_init(m, NULL)
+#define par_mutex_destroy(m) pthread_mutex_destroy(m)
+#define par_mutex_lock(m) pthread_mutex_lock(m)
+#define par_mutex_unlock(m) pthread_mutex_unlock(m)
+#define par_cond_init(c) pthread_cond_init(c, NULL)
+#define par_cond_destroy(c) pthread_cond_destroy(c)
+#define par_cond_wait(c, m) pthread_cond_wait(c, m)
+#define par_cond_broadcast(c) pthread_cond_broadcast(c)
+#define par_thread_yield() sched_yield()
+
+static void *worker_main(void *arg);
+
+static int par_thread_create(par_thread_t *t, void *arg) {
+  return pthread_create(t, NULL, worker_main, arg) == 0 ? 0 : -1;
+}
+
+static void par_thread_join(par_thread_t t) { pthread_join(t, NULL); }
+
+static int hardware_threads(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (int)n : 1;
+#else
+  return 1;
+#endif
+}
+#endif
+
+/* a split range pushes its upper half, so 64 entries cover any size_t */
+#define deque_capacity 64
+
+typedef struct range_t {
+  size_t begin, end;
+} range_t;
+
+/* owner pushes and pops at bottom, thieves take top */
+typedef struct deque_t {
+  par_mutex_t lock;
+  int top, bottom;
+  range_t range[deque_capacity];
+  char pad[64];
+} deque_t;
+
+typedef struct pool_t {
+  int workers; /* including the caller, 1 means serial */
+  par_thread_t *threads;
+  deque_t *deques;
+
+  par_mutex_t lock; /* guards everything below */
+  par_cond_t wake;
+  unsigned int generation;
+  int quit, busy;
+  size_t remaining;
+
+  math_range_t fn;
+  void *ctx;
+  size_t grain;
+} pool_t;
+
+static pool_t pool; /* workers 0 or 1 is serial */
+
+static int deque_push(deque_t *d, size_t begin, size_t end) {
+  int ok;
+
+  par_mutex_lock(&d->lock);
+  if ((ok = d->bottom < deque_capacity) != 0) {
+    d->range[d->bottom].begin = begin;
+    d->range[d->bottom].end = end;
+    d->bottom += 1;
+  }
+  par_mutex_unlock(&d->lock);
+  return ok;
+}
+
+static int deque_pop(deque_t *d, range_t *r, int steal) {
+  int ok;
+
+  par_mutex_lock(&d->lock);
+  if ((ok = d->top < d->bottom) != 0) {
+    if (steal)
+      *r = d->range[d->top++];
+    else
+      *r = d->range[--d->bottom];
+    if (d->top == d->bottom)
+      d->top = d->bottom = 0;
+  }
+  par_mutex_unlock(&d->lock);
+  return ok;
+}
+
+static int pool_steal(int self, range_t *r) {
+  int i;
+
+  for (i = 1; i < pool.workers; ++i)
+    if (deque_pop(&pool.deques[(self + i) % pool.workers], r, 1))
+      return 1;
+  return 0;
+}
+
+/* until the job is done: pop or steal, split down to grain, run */
+static void pool_work(int self) {
+  deque_t *d = &pool.deques[self];
+  size_t done = 0;
+  range_t r;
+
+  for (;;) {
+    if (deque_pop(d, &r, 0) || pool_steal(self, &r)) {
+      while (r.end - r.begin > pool.grain) {
+        size_t mid = r.begin + (r.end - r.begin) / 2;
+
+        if (!deque_push(d, mid, r.end))
+          break;
+        r.end = mid;
+      }
+      pool.fn(pool.ctx, r.begin, r.end);
+      done += r.end - r.begin;
+      continue;
+    } else {
+      int finished;
+
+      par_mutex_lock(&pool.lock);
+      pool.remaining -= done;
+      finished = pool.remaining == 0;
+      par_mutex_unlock(&pool.lock);
+
+      if (finished)
+        return;
+      done = 0;
+      par_thread_yield();
+    }
+  }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI worker_main(LPVOID arg)
+#else
+static void *worker_main(void *arg)
+#endif
+{
+  int self = (int)(size_t)arg;
+  unsigned int seen = 0;
+
+  for (;;) {
+    par_mutex_lock(&pool.lock);
+    while (!pool.quit && pool.generation == seen)
+      par_cond_wait(&pool.wake, &pool.lock);
+    seen = pool.generation;
+    if (pool.quit) {
+      par_mutex_unlock(&pool.lock);
+      break;
+    }
+    par_mutex_unlock(&pool.lock);
+
+    pool_work(self);
+  }
+  return 0;
+}
+
+int math_parallel_init(int workers) {
+  int i;
+
+  math_parallel_shutdown();
+
+  if (workers <= 0)
+    workers = hardware_threads();
+  if (workers <= 1)
+    return 0;
+
+  pool.threads = (par_thread_t *)malloc(sizeof(par_thread_t) * workers);
+  pool.deques = (deque_t *)math_alloc(sizeof(deque_t) * workers);
+  if (!pool.threads || !pool.deques)
+    goto fail;
+
+  if (par_mutex_init(&pool.lock) != 0)
+    goto fail;
+  if (par_cond_init(&pool.wake) != 0) {
+    par_mutex_destroy(&pool.lock);
+    goto fail;
+  }
+  for (i = 0; i < workers; ++i) {
+    pool.deques[i].top = pool.deques[i].bottom = 0;
+    par_mutex_init(&pool.deques[i].lock);
+  }
+
+  pool.quit = pool.busy = 0;
+  pool.generation = 0;
+  pool.remaining = 0;
+
+  /* worker 0 is the thread calling math_parallel_for */
+  for (pool.workers = 1; pool.workers < workers; ++pool.workers)
+    if (par_thread_create(&pool.threads[pool.workers],
+                      (void *)(size_t)pool.workers) != 0)
+      break;
+
+  if (pool.workers == workers)
+    return 0;
+  math_parallel_shutdown();
+  return -1;
+
+fail:
+  free(pool.threads);
+  math_free(pool.deques);
+  pool.threads = NULL;
+  pool.deques = NULL;
+  return -1;
+}
+
+void math_parallel_shutdown(void) {
+  int i, workers = pool.workers;
+
+  if (!pool.deques)
+    return;
+
+  par_mutex_lock(&pool.lock);
+  pool.quit = 1;
+  par_cond_broadcast(&pool.wake);
+  par_mutex_unlock(&pool.lock);
+
+  for (i = 1; i < workers; ++i)
+    par_thread_join(pool.threads[i]);
+  for (i = 0; i < workers; ++i)
+    par_mutex_destroy(&pool.deques[i].lock);
+  par_cond_destroy(&pool.wake);
+  par_mutex_destroy(&pool.lock);
+
+  free(pool.threads);
+  math_free(pool.deques);
+  pool.threads = NULL;
+  pool.deques = NULL;
+  pool.workers = 0;
+}
+
+int math_parallel_workers(void) {
+  return pool.workers > 1 ? pool.workers : 1;
+}
+
+void math_parallel_for(size_t begin, size_t end, size_t grain,
+                       math_range_t fn, void *ctx) {
+  size_t count = end > begin ? end - begin : 0, share;
+  int i, busy = 1;
+
+  if (grain == 0)
+    grain = 1;
+
+  /* remaining is set before any range becomes visible to a worker */
+  if (pool.workers > 1 && count > grain) {
+    par_mutex_lock(&pool.lock);
+    if ((busy = pool.busy) == 0) {
+      pool.busy = 1;
+      pool.remaining = count;
+    }
+    par_mutex_unlock(&pool.lock);
+  }
+
+  if (busy) {
+    if (count)
+      fn(ctx, begin, end);
+    return;
+  }
+
+  pool.fn = fn;
+  pool.ctx = ctx;
+  pool.grain = grain;
+
+  /* seed every deque with an equal share, stealing evens out the rest */
+  share = (count + pool.workers - 1) / pool.workers;
+  for (i = 0; i < pool.workers && begin < end; ++i, begin += share)
+    deque_push(&pool.deques[i], begin,
+               end - begin > share ? begin + share : end);
+
+  par_mutex_lock(&pool.lock);
+  pool.generation += 1;
+  par_cond_broadcast(&pool.wake);
+  par_mutex_unlock(&pool.lock);
+
+  pool_work(0);
+
+  par_mutex_lock(&pool.lock);
+  pool.busy = 0;
+  par_mutex_unlock(&pool.lock);
+}
+
+#else /* MATH_NO_THREADS */
+
+int math_parallel_init(int workers) {
+  (void)workers;
+  return 0;
+}
+
+void math_parallel_shutdown(void) {}
+
+int math_parallel_workers(void) { return 1; }
+
+void math_parallel_for(size_t begin, size_t end, size_t grain,
+                       math_range_t fn, void *ctx) {
+  (void)grain;
+  if (end > begin)
+    fn(ctx, begin, end);
+}
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ *  parallel.h
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include "real.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Optional work-stealing pool behind the batch kernels. Until
+ * math_parallel_init is called, and always under MATH_NO_THREADS,
+ * math_parallel_for runs fn(ctx, begin, end) on the calling thread.
+ *
+ * Every worker owns a deque of ranges. It splits its bottom range in half
+ * down to the grain, keeping the lower half and pushing the upper one;
+ * idle workers steal the top, largest, range of another deque. The caller
+ * works as worker 0. A math_parallel_for issued while the pool is busy
+ * (from inside fn, or from a second thread) runs serially.
+ **/
+
+/* fn processes [begin, end), ranges are disjoint */
+typedef void (*math_range_t)(void *ctx, size_t begin, size_t end);
+
+/* batch kernels stay on the calling thread below this many items */
+#define math_parallel_min 16384
+
+/* items per range the batch kernels hand to math_parallel_for */
+#define math_parallel_grain 4096
+
+/**
+ * Start the pool with workers threads including the caller, 0 means one
+ * per hardware thread. Restarts a running pool. Not thread safe with
+ * math_parallel_for. Returns 0, or -1 when threads could not be created
+ * (the pool then stays serial).
+ **/
+int math_parallel_init(int workers);
+
+/* join the workers, math_parallel_for becomes serial again */
+void math_parallel_shutdown(void);
+
+/* threads used by math_parallel_for, 1 when serial */
+int math_parallel_workers(void);
+
+/* run fn over [begin, end) in ranges of about grain items, 0 means 1 */
+void math_parallel_for(size_t begin, size_t end, size_t grain,
+                       math_range_t fn, void *ctx);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __PARALLEL_H__ */
@@ -1,38 +1,59 @@
-solution ( "math-test" )
-  configurations { "Release", "Debug" }
-  platforms { "x64" }
+newoption {
+  trigger = "simd",
+  value = "ISA",
+  description = "Instruction set used by the batch kernels",
+  allowed = {
+    { "sse2", "SSE2 (x64 default)" },
+    { "avx", "AVX" },
+    { "avx2", "AVX2 and FMA" },
+    { "none", "Scalar reference path" }
+  }
+}
 
-  if _ACTION == "clean" then
-    os.rmdir(".vs")
-    os.rmdir("test")
-    os.remove("math-test.VC.db")
-    os.remove("math-test.sln")
-    os.remove("math-test.vcxproj")
-    os.remove("math-test.vcxproj.filters")
-    os.remove("math-test.vcxproj.user")
-    os.remove("math-test.make")
-    os.remove("Makefile")
-    return
-  end
+newoption {
+  trigger = "precision",
+  value = "TYPE",
+  description = "Floating point type behind real_t",
+  allowed = {
+    { "double", "Double precision (default)" },
+    { "single", "Single precision" }
+  }
+}
 
-  -- A project defines one build target
-  project ( "math-test" )
+-- test.c and bench.c each carry a main, one per target
+function math_project(name, skip)
+  project ( name )
   kind ( "ConsoleApp" )
   language ( "C" )
-  targetname ("math-test")
+  targetname ( name )
   files { "./*.h", "./*.c" }
+  removefiles { skip }
   defines { "_UNICODE" }
   flags { "StaticRuntime" }
 
+  if _OPTIONS["precision"] == "single" then
+    defines { "MATH_SINGLE_PRECISION" }
+  end
+
+  if _OPTIONS["simd"] == "avx" then
+    vectorextensions "AVX"
+  elseif _OPTIONS["simd"] == "avx2" then
+    vectorextensions "AVX2"
+    configuration ( "gmake" )
+      buildoptions { "-mfma" }
+  elseif _OPTIONS["simd"] == "none" then
+    defines { "MATH_NO_SIMD" }
+  end
+
   configuration ( "Release" )
     optimize "On"
-    objdir ( "./test/tmp" )
+    objdir ( "./test/tmp/" .. name )
     targetdir ( "./test" )
     defines { "NDEBUG", "_NDEBUG" }
 
   configuration ( "Debug" )
     symbols "On"
-    objdir ( "./test/tmp" )
+    objdir ( "./test/tmp/" .. name )
     targetdir ( "./test" )
     defines { "DEBUG", "_DEBUG" }
 
@@ -44,9 +65,38 @@ solution ( "math-test" )
   configuration ( "gmake" )
     warnings  "Default" --"Extra"
     defines { "LINUX_OR_MACOSX" }
+    links { "pthread" }
 
   configuration { "gmake", "macosx" }
     defines { "__APPLE__", "__MACH__", "__MRC__", "macintosh" }
 
   configuration { "gmake", "linux" }
     defines { "__linux__" }
+end
+
+solution ( "math-test" )
+  configurations { "Release", "Debug" }
+  platforms { "x64" }
+
+  if _ACTION == "clean" then
+    os.rmdir(".vs")
+    os.rmdir("test")
+    os.remove("math-test.VC.db")
+    os.remove("math-test.sln")
+    os.remove("math-test.vcxproj")
+    os.remove("math-test.vcxproj.filters")
+    os.remove("math-test.vcxproj.user")
+    os.remove("math-test.make")
+    os.remove("math-bench.vcxproj")
+    os.remove("math-bench.vcxproj.filters")
+    os.remove("math-bench.vcxproj.user")
+    os.remove("math-bench.make")
+    os.remove("Makefile")
+    return
+  end
+
+  -- A project defines one build target
+  math_project("math-test", "./bench.c")
+
+  -- ns/op of the public API: math-bench [--json] [--quick] [--filter text]
+  math_project("math-bench", "./test.c")
@@ -10,6 +10,8 @@
  */
 
 #include "quaternion.h"
+#include "parallel.h"
+#include "simd.h"
 
 real_t quat_normalize(quat_t q, real_t length) {
   real_t ls = quat_len(q);
@@ -25,9 +27,15 @@ real_t quat_normalize(quat_t q, real_t length) {
 }
 
 void quat_slerp(quat_t r, const quat_t from, const quat_t to, real_t t) {
-  real_t scale_from, scale_to;
+  real_t scale_from, scale_to, sign = r_one;
   real_t c, s, dot = quat_dot(from, to);
 
+  /* q and -q are the same rotation, take the shorter arc */
+  if (dot < r_zero) {
+    dot = -dot;
+    sign = r_negone;
+  }
+
   if ((r_one - dot) > r_epsilon) {
     c = r_acos(dot);
     s = r_sin(c);
@@ -37,6 +45,7 @@ void quat_slerp(quat_t r, const quat_t from, const quat_t to, real_t t) {
     scale_from = r_one - t;
     scale_to = t;
   }
+  scale_to *= sign;
 
   qw(r) = qw(from) * scale_from + qw(to) * scale_to;
   qx(r) = qx(from) * scale_from + qx(to) * scale_to;
@@ -44,19 +53,125 @@ void quat_slerp(quat_t r, const quat_t from, const quat_t to, real_t t) {
   qz(r) = qz(from) * scale_from + qz(to) * scale_to;
 }
 
+void quat_slerp_array(quat_t *r, const quat_t *from, const quat_t *to,
+                      const real_t *t, size_t count) {
+  size_t i;
+  for (i = 0; i < count; ++i)
+    quat_slerp(r[i], from[i], to[i], t[i]);
+}
+
+/**
+ * Corrected nlerp parameter, after Kapoulkine's "Approximating slerp":
+ * t' = t + t(t - 1/2)(t - 1) k, with k fitted in t and d = |dot|.
+ **/
+#define slerp_fast_a(d)                                                        \
+  ((real_t)1.0904 +                                                            \
+   (d) * ((real_t)-3.2452 + (d) * ((real_t)3.55645 - (d) * (real_t)1.43519)))
+#define slerp_fast_b(d)                                                        \
+  ((real_t)0.848013 + (d) * ((real_t)-1.06021 + (d) * (real_t)0.215638))
+
+void quat_slerp_fast(quat_t r, const quat_t from, const quat_t to, real_t t) {
+  real_t dot = quat_dot(from, to);
+  real_t d = r_abs(dot), h = t - r_half;
+  real_t k = slerp_fast_a(d) * h * h + slerp_fast_b(d);
+  real_t scale_to = t + t * h * (t - r_one) * k;
+  real_t scale_from = r_one - scale_to;
+  quat_t q;
+
+  if (dot < r_zero)
+    scale_to = -scale_to;
+
+  qw(q) = qw(from) * scale_from + qw(to) * scale_to;
+  qx(q) = qx(from) * scale_from + qx(to) * scale_to;
+  qy(q) = qy(from) * scale_from + qy(to) * scale_to;
+  qz(q) = qz(from) * scale_from + qz(to) * scale_to;
+
+  k = r_one / quat_len(q);
+  qw(r) = qw(q) * k;
+  qx(r) = qx(q) * k;
+  qy(r) = qy(q) * k;
+  qz(r) = qz(q) * k;
+}
+
+#ifdef MATH_SIMD_R4
+/**
+ * Four pairs per call, kept in registers: one r4_transpose turns four
+ * quaternions into w, x, y and z lanes and another turns the results back.
+ **/
+static void slerp_fast4(quat_t *r, const quat_t *from, const quat_t *to,
+                        const real_t *t) {
+  r4_t a[4], b[4], q[4], vt, dot, d, h, ka, kb, st, sf;
+  r4_t one = r4_set1(r_one);
+
+  a[0] = r4_load(from[0]), a[1] = r4_load(from[1]);
+  a[2] = r4_load(from[2]), a[3] = r4_load(from[3]);
+  b[0] = r4_load(to[0]), b[1] = r4_load(to[1]);
+  b[2] = r4_load(to[2]), b[3] = r4_load(to[3]);
+  r4_transpose(a);
+  r4_transpose(b);
+
+  dot = r4_madd(a[0], b[0], r4_mul(a[1], b[1]));
+  dot = r4_madd(a[2], b[2], r4_madd(a[3], b[3], dot));
+
+  d = r4_abs(dot);
+  vt = r4_load(t);
+  h = r4_sub(vt, r4_set1(r_half));
+
+  ka = r4_madd(d, r4_set1((real_t)-1.43519), r4_set1((real_t)3.55645));
+  ka = r4_madd(d, ka, r4_set1((real_t)-3.2452));
+  ka = r4_madd(d, ka, r4_set1((real_t)1.0904));
+  kb = r4_madd(d, r4_set1((real_t)0.215638), r4_set1((real_t)-1.06021));
+  kb = r4_madd(d, kb, r4_set1((real_t)0.848013));
+
+  ka = r4_madd(r4_mul(ka, h), h, kb);
+  st = r4_madd(r4_mul(r4_mul(vt, h), r4_sub(vt, one)), ka, vt);
+  sf = r4_sub(one, st);
+
+  /* take the shorter arc: scale_to gets the sign of dot */
+  st = r4_xor(st, r4_and(dot, r4_set1(-r_zero)));
+
+  q[0] = r4_madd(b[0], st, r4_mul(a[0], sf));
+  q[1] = r4_madd(b[1], st, r4_mul(a[1], sf));
+  q[2] = r4_madd(b[2], st, r4_mul(a[2], sf));
+  q[3] = r4_madd(b[3], st, r4_mul(a[3], sf));
+
+  d = r4_madd(q[0], q[0], r4_mul(q[1], q[1]));
+  d = r4_madd(q[2], q[2], r4_madd(q[3], q[3], d));
+  d = r4_div(one, r4_sqrt(d));
+
+  q[0] = r4_mul(q[0], d), q[1] = r4_mul(q[1], d);
+  q[2] = r4_mul(q[2], d), q[3] = r4_mul(q[3], d);
+  r4_transpose(q);
+
+  r4_store(r[0], q[0]), r4_store(r[1], q[1]);
+  r4_store(r[2], q[2]), r4_store(r[3], q[3]);
+}
+#endif
+
+void quat_slerp_fast_array(quat_t *r, const quat_t *from, const quat_t *to,
+                           const real_t *t, size_t count) {
+  size_t i = 0;
+#ifdef MATH_SIMD_R4
+  for (; i + 4 <= count; i += 4)
+    slerp_fast4(r + i, from + i, to + i, t + i);
+#endif
+  for (; i < count; ++i)
+    quat_slerp_fast(r[i], from[i], to[i], t[i]);
+}
+
 void quat_rotate(vec3_t r, const quat_t q, const vec3_t v) {
-  quat_t t, c;
+  /* q v q* = |q|^2 v + w t + u x t, t = 2 u x v, u = (qx, qy, qz) */
+  real_t ls = quat_lensq(q), tx, ty, tz, x, y, z;
 
-  quat_conjugate(c, q);
+  tx = r_two * (qy(q) * vz(v) - qz(q) * vy(v));
+  ty = r_two * (qz(q) * vx(v) - qx(q) * vz(v));
+  tz = r_two * (qx(q) * vy(v) - qy(q) * vx(v));
 
-  qw(t) = -qx(c) * vx(v) - qy(c) * vy(v) - qz(c) * vz(v);
-  qx(t) = vx(v) * qw(c) + vy(v) * qz(c) - qy(c) * vz(v);
-  qy(t) = vy(v) * qw(c) + qx(c) * vz(v) - vx(v) * qz(c);
-  qz(t) = vz(v) * qw(c) + vx(v) * qy(c) - qx(c) * vy(v);
+  x = ls * vx(v) + qw(q) * tx + qy(q) * tz - qz(q) * ty;
+  y = ls * vy(v) + qw(q) * ty + qz(q) * tx - qx(q) * tz;
+  z = ls * vz(v) + qw(q) * tz + qx(q) * ty - qy(q) * tx;
 
-  vx(r) = qx(t) * qw(q) + qx(q) * qw(t) + qy(q) * qz(t) - qy(t) * qz(q);
-  vy(r) = qy(t) * qw(q) + qy(q) * qw(t) + qx(t) * qz(q) - qx(q) * qz(t);
-  vz(r) = qz(t) * qw(q) + qz(q) * qw(t) + qx(q) * qy(t) - qx(t) * qy(q);
+  vx(r) = x, vy(r) = y, vz(r) = z;
 }
 
 void quat_tomatrix(mat33_t m, const quat_t q) {
@@ -83,6 +198,54 @@ void quat_tomatrix(mat33_t m, const quat_t q) {
   e8(m) = r_one - r_two * (xx + yy);
 }
 
+static void rotate_array(vec3_t *r, const quat_t q, const vec3_t *v,
+                         size_t count) {
+  mat33_t m;
+  real_t ls;
+  size_t i;
+
+  if (count < quat_rotate_matrix_min) {
+    for (i = 0; i < count; ++i)
+      quat_rotate(r[i], q, v[i]);
+    return;
+  }
+
+  /* quat_tomatrix assumes |q| = 1, the diagonal takes the |q|^2 - 1 */
+  quat_tomatrix(m, q);
+  ls = quat_lensq(q) - r_one;
+  e0(m) += ls, e4(m) += ls, e8(m) += ls;
+
+  for (i = 0; i < count; ++i) {
+    real_t x = vx(v[i]), y = vy(v[i]), z = vz(v[i]);
+
+    vx(r[i]) = e0(m) * x + e3(m) * y + e6(m) * z;
+    vy(r[i]) = e1(m) * x + e4(m) * y + e7(m) * z;
+    vz(r[i]) = e2(m) * x + e5(m) * y + e8(m) * z;
+  }
+}
+
+typedef struct rotate_job_t {
+  vec3_t *r;
+  const real_t *q;
+  const vec3_t *v;
+} rotate_job_t;
+
+static void rotate_range(void *ctx, size_t begin, size_t end) {
+  const rotate_job_t *j = (const rotate_job_t *)ctx;
+  rotate_array(j->r + begin, j->q, j->v + begin, end - begin);
+}
+
+void quat_rotate_array(vec3_t *r, const quat_t q, const vec3_t *v,
+                       size_t count) {
+  rotate_job_t j;
+
+  j.r = r, j.q = q, j.v = v;
+  if (count < math_parallel_min)
+    rotate_array(r, q, v, count);
+  else
+    math_parallel_for(0, count, math_parallel_grain, rotate_range, &j);
+}
+
 void quat_toeuler(vec3_t r, const quat_t q) {
   real_t xx = qx(q) * qx(q);
   real_t yy = qy(q) * qy(q);
@@ -101,17 +264,11 @@ void quat_toeuler(vec3_t r, const quat_t q) {
 }
 
 void quat_fromeuler(quat_t r, const vec3_t v) {
-  real_t hx = vx(v) * r_half;
-  real_t hy = vy(v) * r_half;
-  real_t hz = vz(v) * r_half;
-
-  real_t sx = r_sin(hx);
-  real_t sy = r_sin(hy);
-  real_t sz = r_sin(hz);
+  real_t sx, sy, sz, cx, cy, cz;
 
-  real_t cx = r_cos(hx);
-  real_t cy = r_cos(hy);
-  real_t cz = r_cos(hz);
+  r_sincos(vx(v) * r_half, &sx, &cx);
+  r_sincos(vy(v) * r_half, &sy, &cy);
+  r_sincos(vz(v) * r_half, &sz, &cz);
 
   qw(r) = cx * cy * cz - sx * sy * sz;
   qx(r) = sx * cy * cz + cx * sy * sz;
@@ -120,7 +277,7 @@ void quat_fromeuler(quat_t r, const vec3_t v) {
 }
 
 void quat_fromangleaxis(quat_t r, const vec3_t v, real_t theta) {
-  real_t ht, s, ls = vec2_len(v);
+  real_t ht, s, ls = vec3_len(v);
 
   if (r_equal(ls, r_zero)) {
     qw(r) = r_one;
@@ -128,9 +285,132 @@ void quat_fromangleaxis(quat_t r, const vec3_t v, real_t theta) {
   } else {
     ls = r_one / ls;
     ht = theta * r_half;
-    s = r_sin(ht);
+    r_sincos(ht, &s, &qw(r));
+    qx(r) = s * vx(v) * ls;
+    qy(r) = s * vy(v) * ls;
+    qz(r) = s * vz(v) * ls;
+  }
+}
+
+realf_t quatf_normalize(quatf_t q, realf_t length) {
+  realf_t ls = quatf_len(q);
+  if (!rf_equal(ls, rf_zero)) {
+    length = length / ls;
+
+    qw(q) = qw(q) * length;
+    qx(q) = qx(q) * length;
+    qy(q) = qy(q) * length;
+    qz(q) = qz(q) * length;
+  }
+  return ls;
+}
+
+void quatf_slerp(quatf_t r, const quatf_t from, const quatf_t to, realf_t t) {
+  realf_t scale_from, scale_to, sign = rf_one;
+  realf_t c, s, dot = quat_dot(from, to);
+
+  /* q and -q are the same rotation, take the shorter arc */
+  if (dot < rf_zero) {
+    dot = -dot;
+    sign = rf_negone;
+  }
+
+  if ((rf_one - dot) > rf_epsilon) {
+    c = rf_acos(dot);
+    s = rf_sin(c);
+    scale_from = rf_sin((rf_one - t) * c) / s;
+    scale_to = rf_sin(t * c) / s;
+  } else {
+    scale_from = rf_one - t;
+    scale_to = t;
+  }
+  scale_to *= sign;
+
+  qw(r) = qw(from) * scale_from + qw(to) * scale_to;
+  qx(r) = qx(from) * scale_from + qx(to) * scale_to;
+  qy(r) = qy(from) * scale_from + qy(to) * scale_to;
+  qz(r) = qz(from) * scale_from + qz(to) * scale_to;
+}
+
+void quatf_rotate(vec3f_t r, const quatf_t q, const vec3f_t v) {
+  /* q v q* = |q|^2 v + w t + u x t, t = 2 u x v, u = (qx, qy, qz) */
+  realf_t ls = quat_lensq(q), tx, ty, tz, x, y, z;
 
-    qw(r) = r_cos(ht);
+  tx = rf_two * (qy(q) * vz(v) - qz(q) * vy(v));
+  ty = rf_two * (qz(q) * vx(v) - qx(q) * vz(v));
+  tz = rf_two * (qx(q) * vy(v) - qy(q) * vx(v));
+
+  x = ls * vx(v) + qw(q) * tx + qy(q) * tz - qz(q) * ty;
+  y = ls * vy(v) + qw(q) * ty + qz(q) * tx - qx(q) * tz;
+  z = ls * vz(v) + qw(q) * tz + qx(q) * ty - qy(q) * tx;
+
+  vx(r) = x, vy(r) = y, vz(r) = z;
+}
+
+void quatf_tomatrix(mat33f_t m, const quatf_t q) {
+  realf_t xx = qx(q) * qx(q);
+  realf_t yy = qy(q) * qy(q);
+  realf_t zz = qz(q) * qz(q);
+  realf_t xy = qx(q) * qy(q);
+  realf_t xz = qx(q) * qz(q);
+  realf_t yz = qy(q) * qz(q);
+  realf_t wx = qw(q) * qx(q);
+  realf_t wy = qw(q) * qy(q);
+  realf_t wz = qw(q) * qz(q);
+
+  e0(m) = rf_one - rf_two * (yy + zz);
+  e3(m) = rf_two * (xy - wz);
+  e6(m) = rf_two * (xz + wy);
+
+  e1(m) = rf_two * (xy + wz);
+  e4(m) = rf_one - rf_two * (xx + zz);
+  e7(m) = rf_two * (yz - wx);
+
+  e2(m) = rf_two * (xz - wy);
+  e5(m) = rf_two * (yz + wx);
+  e8(m) = rf_one - rf_two * (xx + yy);
+}
+
+void quatf_toeuler(vec3f_t r, const quatf_t q) {
+  realf_t xx = qx(q) * qx(q);
+  realf_t yy = qy(q) * qy(q);
+  realf_t zz = qz(q) * qz(q);
+  realf_t xz = qx(q) * qz(q);
+  realf_t xy = qx(q) * qy(q);
+  realf_t yz = qy(q) * qz(q);
+  realf_t wx = qw(q) * qx(q);
+  realf_t wy = qw(q) * qy(q);
+  realf_t wz = qw(q) * qz(q);
+  realf_t ty = rf_two * (xz + wy);
+
+  vx(r) = rf_atan2(rf_two * (wx - yz), rf_one - rf_two * (xx + yy));
+  vy(r) = rf_asin((ty < rf_negone) ? rf_negone : (ty > rf_one) ? rf_one : ty);
+  vz(r) = rf_atan2(rf_two * (wz - xy), rf_one - rf_two * (yy + zz));
+}
+
+void quatf_fromeuler(quatf_t r, const vec3f_t v) {
+  realf_t sx, sy, sz, cx, cy, cz;
+
+  rf_sincos(vx(v) * rf_half, &sx, &cx);
+  rf_sincos(vy(v) * rf_half, &sy, &cy);
+  rf_sincos(vz(v) * rf_half, &sz, &cz);
+
+  qw(r) = cx * cy * cz - sx * sy * sz;
+  qx(r) = sx * cy * cz + cx * sy * sz;
+  qy(r) = cx * sy * cz - sx * cy * sz;
+  qz(r) = cx * cy * sz + sx * sy * cz;
+}
+
+void quatf_fromangleaxis(quatf_t r, const vec3f_t v, realf_t theta) {
+  realf_t ht, s, ls = vec3f_len(v);
+
+  if (rf_equal(ls, rf_zero)) {
+    qw(r) = rf_one;
+    qx(r) = qy(r) = qz(r) = rf_zero;
+  } else {
+    ls = rf_one / ls;
+    ht = theta * rf_half;
+    rf_sincos(ht, &s, &qw(r));
     qx(r) = s * vx(v) * ls;
     qy(r) = s * vy(v) * ls;
     qz(r) = s * vz(v) * ls;
@@ -20,6 +20,7 @@ extern "C" {
 #endif
 
 typedef real_t quat_t[4];
+typedef realf_t quatf_t[4];
 
 #define qw(q) q[0]
 #define qx(q) q[1]
@@ -57,6 +58,15 @@ typedef real_t quat_t[4];
     qz(r) = qz(a) - qz(b);                                                     \
   } while (0)
 
+/* rw,rx,ry,rz = qw*s, qx*s, qy*s, qz*s */
+#define quat_scale(r, q, s)                                                    \
+  do {                                                                         \
+    qw(r) = qw(q) * (s);                                                       \
+    qx(r) = qx(q) * (s);                                                       \
+    qy(r) = qy(q) * (s);                                                       \
+    qz(r) = qz(q) * (s);                                                       \
+  } while (0)
+
 /**
  * rw = aw*bw - ax*bx - ay*by - az*bz
  * rx = ax*bw + bx*aw + by*az - ay*bz
@@ -96,13 +106,57 @@ typedef real_t quat_t[4];
 /* qw,qx,qy,qz = qw*(len/qlen), qx*(len/qlen), qy*(len/qlen), qz*(len/qlen) */
 real_t quat_normalize(quat_t q, real_t length);
 
+/* spherical interpolation along the shorter of the two arcs */
 void quat_slerp(quat_t r, const quat_t from, const quat_t to, real_t t);
+
+/* r[i] = quat_slerp(from[i], to[i], t[i]) */
+void quat_slerp_array(quat_t *r, const quat_t *from, const quat_t *to,
+                      const real_t *t, size_t count);
+
+/**
+ * Trig-free slerp: nlerp with a polynomial correction of t, normalized.
+ * For unit inputs the rotation differs from quat_slerp by less than 8e-4
+ * radians (0.045 degrees) over the whole range of t and of angles.
+ **/
+void quat_slerp_fast(quat_t r, const quat_t from, const quat_t to, real_t t);
+
+/* r[i] = quat_slerp_fast(from[i], to[i], t[i]), four at a time in r4_t */
+void quat_slerp_fast_array(quat_t *r, const quat_t *from, const quat_t *to,
+                           const real_t *t, size_t count);
+/* r = q v q*, scaled by |q|^2 when q is not unit; r may alias v */
 void quat_rotate(vec3_t r, const quat_t q, const vec3_t v);
 void quat_tomatrix(mat33_t m, const quat_t q);
+
+/* from this many vectors on, quat_rotate_array goes through a mat33 */
+#define quat_rotate_matrix_min 4
+
+/* r[i] = quat_rotate(q, v[i]), r may alias v, pooled like the batches */
+void quat_rotate_array(vec3_t *r, const quat_t q, const vec3_t *v,
+                       size_t count);
 void quat_toeuler(vec3_t r, const quat_t q);
 void quat_fromeuler(quat_t r, const vec3_t v);
 void quat_fromangleaxis(quat_t r, const vec3_t v, real_t theta);
 
+/**
+ *---------------------------------------------
+ *  Single Precision Quaternion
+ *---------------------------------------------
+ **/
+
+/* the arithmetic macros above are type-generic and also take quatf_t */
+
+/* sqrt(qw*qw + qx*qx + qy*qy + qz*qz) */
+#define quatf_len(q) rf_sqrt(quat_lensq(q))
+
+realf_t quatf_normalize(quatf_t q, realf_t length);
+
+void quatf_slerp(quatf_t r, const quatf_t from, const quatf_t to, realf_t t);
+void quatf_rotate(vec3f_t r, const quatf_t q, const vec3f_t v);
+void quatf_tomatrix(mat33f_t m, const quatf_t q);
+void quatf_toeuler(vec3f_t r, const quatf_t q);
+void quatf_fromeuler(quatf_t r, const vec3f_t v);
+void quatf_fromangleaxis(quatf_t r, const vec3f_t v, realf_t theta);
+
 #ifdef __cplusplus
 };
 #endif
@@ -9,4 +9,519 @@
  *  https://github.com/shixiongfei/math
  */
 
-#include "real.h"
+#include "parallel.h"
+#include "simd.h"
+
+void *math_alloc(size_t size) {
+  char *ptr, *base = (char *)malloc(size + MATH_ALIGNMENT + sizeof(void *));
+
+  if (!base)
+    return NULL;
+
+  ptr = base + sizeof(void *);
+  ptr += (MATH_ALIGNMENT - ((size_t)ptr & (MATH_ALIGNMENT - 1))) &
+         (MATH_ALIGNMENT - 1);
+  ((void **)ptr)[-1] = base;
+
+  return ptr;
+}
+
+void math_free(void *ptr) {
+  if (ptr)
+    free(((void **)ptr)[-1]);
+}
+
+/**
+ *---------------------------------------------
+ *  Sine And Cosine
+ *---------------------------------------------
+ **/
+
+/**
+ * Cody-Waite reduction x = k * pi/2 + r with |r| <= pi/4, pi/2 split so the
+ * first product is exact over the supported range, followed by the fdlibm
+ * kernels (double) or the cephes ones (float) on r.
+ **/
+
+#define pio2_1 1.57079632673412561417e+00 /* first 33 bits of pi/2 */
+#define pio2_2 6.07710050630396597660e-11 /* next 33 bits */
+#define pio2_3 2.02226624871116645580e-21 /* pi/2 - pio2_1 - pio2_2 */
+#define invpio2 6.36619772367581382433e-01
+#define sincos_limit 1.0e5
+
+#define pio2f_1 1.5703125f
+#define pio2f_2 4.837512969970703125e-4f
+#define pio2f_3 7.54978995489188216e-8f
+#define invpio2f 6.36619772367581382433e-01f
+#define sincosf_limit 8192.0f
+
+/* sin(r) = r + r * z * P(z), cos(r) = 1 - z/2 + z * z * Q(z), z = r * r */
+static const double sin_d[] = {
+    1.58969099521155010221e-10, -2.50507602534068634195e-08,
+    2.75573137070700676789e-06, -1.98412698298579493134e-04,
+    8.33333333332248946124e-03, -1.66666666666666324348e-01};
+static const double cos_d[] = {
+    -1.13596475577881948265e-11, 2.08757232129817482790e-09,
+    -2.75573143513906633035e-07, 2.48015872894767294178e-05,
+    -1.38888888888741095749e-03, 4.16666666666666019037e-02};
+static const float sin_f[] = {-1.9515295891e-4f, 8.3321608736e-3f,
+                              -1.6666654611e-1f};
+static const float cos_f[] = {2.443315711809948e-5f, -1.388731625493765e-3f,
+                              4.166664568298827e-2f};
+
+#define sincos_quadrant(q, sr, cr, s, c)                                       \
+  do {                                                                         \
+    switch ((q)&3) {                                                           \
+    case 0:                                                                    \
+      *(s) = (sr), *(c) = (cr);                                                \
+      break;                                                                   \
+    case 1:                                                                    \
+      *(s) = (cr), *(c) = -(sr);                                               \
+      break;                                                                   \
+    case 2:                                                                    \
+      *(s) = -(sr), *(c) = -(cr);                                              \
+      break;                                                                   \
+    default:                                                                   \
+      *(s) = -(cr), *(c) = (sr);                                               \
+      break;                                                                   \
+    }                                                                          \
+  } while (0)
+
+void math_sincos(double x, double *s, double *c) {
+  double k, r, z, ps, pc;
+  int i;
+
+  if (!(fabs(x) <= sincos_limit)) {
+    *s = sin(x);
+    *c = cos(x);
+    return;
+  }
+
+  k = floor(x * invpio2 + 0.5);
+  r = ((x - k * pio2_1) - k * pio2_2) - k * pio2_3;
+  z = r * r;
+
+  ps = sin_d[0], pc = cos_d[0];
+  for (i = 1; i < 6; ++i) {
+    ps = ps * z + sin_d[i];
+    pc = pc * z + cos_d[i];
+  }
+  ps = r + r * z * ps;
+  pc = 1.0 - (0.5 * z - z * z * pc);
+
+  sincos_quadrant((int)k, ps, pc, s, c);
+}
+
+void math_sincosf(float x, float *s, float *c) {
+  float k, r, z, ps, pc;
+
+  if (!(fabsf(x) <= sincosf_limit)) {
+    *s = sinf(x);
+    *c = cosf(x);
+    return;
+  }
+
+  k = floorf(x * invpio2f + 0.5f);
+  r = ((x - k * pio2f_1) - k * pio2f_2) - k * pio2f_3;
+  z = r * r;
+
+  ps = (sin_f[0] * z + sin_f[1]) * z + sin_f[2];
+  pc = (cos_f[0] * z + cos_f[1]) * z + cos_f[2];
+  ps = r + r * z * ps;
+  pc = 1.0f - (0.5f * z - z * z * pc);
+
+  sincos_quadrant((int)k, ps, pc, s, c);
+}
+
+/**
+ *---------------------------------------------
+ *  Trigonometric Arrays
+ *---------------------------------------------
+ **/
+
+/**
+ * Polynomials of one accuracy tier, highest degree first. atan and asin
+ * are x + x * z * P(z) / Q(z); a Q of length one is the constant 1.
+ **/
+typedef struct trig_tier_t {
+  const real_t *sin_p, *cos_p;
+  const real_t *atan_p, *atan_q;
+  const real_t *asin_p, *asin_q;
+  int sin_n, cos_n, atan_pn, atan_qn, asin_pn, asin_qn;
+  real_t atan_split; /* atan(a) = pi/4 + atan((a-1)/(a+1)) above this */
+} trig_tier_t;
+
+#define tier_len(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+static const real_t one_p[] = {1.0};
+
+/* fdlibm atan/asin are too long for float, cephes single precision ones */
+static const real_t atan_f[] = {8.05374449538e-2, -1.38776856032e-1,
+                                1.99777106478e-1, -3.33329491539e-1};
+static const real_t asin_f[] = {4.2163199048e-2, 2.4181311049e-2,
+                                4.5470025998e-2, 7.4953002686e-2,
+                                1.6666752422e-1};
+
+#ifdef MATH_SINGLE_PRECISION
+
+#define trig_pio2_1 pio2f_1
+#define trig_pio2_2 pio2f_2
+#define trig_pio2_3 pio2f_3
+#define trig_invpio2 invpio2f
+#define trig_limit sincosf_limit
+#define trig_magic 12582912.0f /* 1.5 * 2^23 rounds to an integer */
+
+/* minimax fits on the same ranges, about 1e-6 */
+static const real_t sin_fast[] = {8.152989e-3f, -1.6662834e-1f};
+static const real_t cos_fast[] = {-1.3652444e-3f, 4.1661278e-2f};
+static const real_t atan_fast[] = {1.6856569e-1f, -3.3156813e-1f};
+static const real_t asin_fast[] = {6.5769939e-2f, 7.1277144e-2f,
+                                   1.6685561e-1f};
+
+static const trig_tier_t trig_precise = {
+    sin_f,  cos_f,  atan_f, one_p,  asin_f, one_p,
+    tier_len(sin_f), tier_len(cos_f), tier_len(atan_f), 1, tier_len(asin_f),
+    1, 0.41421356f};
+
+static const trig_tier_t trig_fast = {
+    sin_fast, cos_fast, atan_fast, one_p, asin_fast, one_p,
+    tier_len(sin_fast), tier_len(cos_fast), tier_len(atan_fast), 1,
+    tier_len(asin_fast), 1, 0.41421356f};
+
+#else
+
+#define trig_pio2_1 pio2_1
+#define trig_pio2_2 pio2_2
+#define trig_pio2_3 pio2_3
+#define trig_invpio2 invpio2
+#define trig_limit sincos_limit
+#define trig_magic 6755399441055744.0 /* 1.5 * 2^52 rounds to an integer */
+
+/* cephes atan, a in [-0.2, 0.66] */
+static const real_t atan_d_p[] = {
+    -8.750608600031904122785e-1, -1.615753718733365076637e1,
+    -7.500855792314704667340e1, -1.228866684490136173410e2,
+    -6.485021904942025371773e1};
+static const real_t atan_d_q[] = {
+    1.0, 2.485846490142306297962e1, 1.650270098316988542046e2,
+    4.328810604912902668951e2, 4.853903996359136964868e2,
+    1.945506571482613964425e2};
+
+/* fdlibm asin, x * x <= 0.25 */
+static const real_t asin_d_p[] = {
+    3.47933107596021167570e-05, 7.91534994289814532176e-04,
+    -4.00555345006794114027e-02, 2.01212532134862925881e-01,
+    -3.25565818622400915405e-01, 1.66666666666666657415e-01};
+static const real_t asin_d_q[] = {
+    7.70381505559019352791e-02, -6.88283971605453293030e-01,
+    2.02094576023350569471e+00, -2.40339491173441421878e+00, 1.0};
+
+static const real_t sin_fast[] = {-1.9515295891e-4, 8.3321608736e-3,
+                                  -1.6666654611e-1};
+static const real_t cos_fast[] = {2.443315711809948e-5,
+                                  -1.388731625493765e-3,
+                                  4.166664568298827e-2};
+
+static const trig_tier_t trig_precise = {
+    sin_d,    cos_d,    atan_d_p, atan_d_q, asin_d_p, asin_d_q,
+    tier_len(sin_d), tier_len(cos_d), tier_len(atan_d_p),
+    tier_len(atan_d_q), tier_len(asin_d_p), tier_len(asin_d_q), 0.66};
+
+static const trig_tier_t trig_fast = {
+    sin_fast, cos_fast, atan_f, one_p, asin_f, one_p,
+    tier_len(sin_fast), tier_len(cos_fast), tier_len(atan_f), 1,
+    tier_len(asin_f), 1, 0.41421356237309504880};
+
+#endif
+
+#define trig_pio4 (r_pi * 0.25)
+#define trig_pio2 (r_pi * 0.5)
+
+#define trig_tier(accuracy)                                                    \
+  ((accuracy) == MATH_FAST ? &trig_fast : &trig_precise)
+
+static real_t poly(real_t z, const real_t *c, int n) {
+  real_t p = c[0];
+  int i;
+
+  for (i = 1; i < n; ++i)
+    p = p * z + c[i];
+  return p;
+}
+
+/* x + x * z * P(z) / Q(z) */
+static real_t rational(real_t x, real_t z, const real_t *p, int pn,
+                       const real_t *q, int qn) {
+  real_t t = poly(z, p, pn);
+
+  if (qn > 1)
+    t /= poly(z, q, qn);
+  return x + x * z * t;
+}
+
+static void trig_sincos1(real_t *s, real_t *c, real_t x,
+                         const trig_tier_t *t) {
+  real_t k, r, z, ps, pc, ts, tc;
+
+  if (!(r_abs(x) <= trig_limit)) {
+    if (s)
+      *s = r_sin(x);
+    if (c)
+      *c = r_cos(x);
+    return;
+  }
+
+  k = (real_t)floor(x * trig_invpio2 + r_half);
+  r = ((x - k * trig_pio2_1) - k * trig_pio2_2) - k * trig_pio2_3;
+  z = r * r;
+
+  ps = r + r * z * poly(z, t->sin_p, t->sin_n);
+  pc = r_one - (r_half * z - z * z * poly(z, t->cos_p, t->cos_n));
+
+  sincos_quadrant((int)k, ps, pc, &ts, &tc);
+  if (s)
+    *s = ts;
+  if (c)
+    *c = tc;
+}
+
+static real_t trig_atan21(real_t y, real_t x, const trig_tier_t *t) {
+  real_t ax = r_abs(x), ay = r_abs(y);
+  real_t mx = ax > ay ? ax : ay, mn = ax > ay ? ay : ax;
+  real_t a = mx > r_zero ? mn / mx : r_zero, base = r_zero, r;
+
+  if (a > t->atan_split) {
+    a = (a - r_one) / (a + r_one);
+    base = trig_pio4;
+  }
+  r = base + rational(a, a * a, t->atan_p, t->atan_pn, t->atan_q, t->atan_qn);
+
+  if (ay > ax)
+    r = trig_pio2 - r;
+  if (x < r_zero)
+    r = r_pi - r;
+  return signbit(y) ? -r : r;
+}
+
+static real_t trig_acos1(real_t x, const trig_tier_t *t) {
+  real_t a = r_abs(x), z, p;
+
+  if (a > r_half) {
+    z = (r_one - a) * r_half;
+    a = r_sqrt(z);
+    p = r_two * rational(a, z, t->asin_p, t->asin_pn, t->asin_q, t->asin_qn);
+    return x < r_zero ? r_pi - p : p;
+  }
+
+  p = rational(a, a * a, t->asin_p, t->asin_pn, t->asin_q, t->asin_qn);
+  return trig_pio2 - (x < r_zero ? -p : p);
+}
+
+#ifdef MATH_SIMD
+r_inline rv_t rv_poly(rv_t z, const real_t *c, int n) {
+  rv_t p = rv_set1(c[0]);
+  int i;
+
+  for (i = 1; i < n; ++i)
+    p = rv_madd(p, z, rv_set1(c[i]));
+  return p;
+}
+
+r_inline rv_t rv_rational(rv_t x, rv_t z, const real_t *p, int pn,
+                          const real_t *q, int qn) {
+  rv_t t = rv_poly(z, p, pn);
+
+  if (qn > 1)
+    t = rv_div(t, rv_poly(z, q, qn));
+  return rv_madd(rv_mul(x, z), t, x);
+}
+
+/* x rounded to the nearest integer, |x| < 2^22 (float) or 2^51 (double) */
+r_inline rv_t rv_round(rv_t x) {
+  rv_t magic = rv_set1(trig_magic);
+  return rv_sub(rv_add(x, magic), magic);
+}
+
+/* returns the movemask of the lanes that are in range */
+r_inline int rv_sincos(rv_t *s, rv_t *c, rv_t x, const trig_tier_t *t) {
+  rv_t sign = rv_set1(-r_zero), one = rv_set1(r_one);
+  rv_t k, q, r, z, ps, pc, odd;
+  int ok = rv_movemask(rv_cmple(rv_abs(x), rv_set1(trig_limit)));
+
+  k = rv_round(rv_mul(x, rv_set1(trig_invpio2)));
+  /* k mod 4, floor(k / 4) never ties at k / 4 - 3 / 8 */
+  q = rv_round(rv_madd(k, rv_set1((real_t)0.25), rv_set1((real_t)-0.375)));
+  q = rv_sub(k, rv_mul(q, rv_set1((real_t)4)));
+
+  r = rv_sub(x, rv_mul(k, rv_set1(trig_pio2_1)));
+  r = rv_sub(r, rv_mul(k, rv_set1(trig_pio2_2)));
+  r = rv_sub(r, rv_mul(k, rv_set1(trig_pio2_3)));
+  z = rv_mul(r, r);
+
+  ps = rv_madd(rv_mul(r, z), rv_poly(z, t->sin_p, t->sin_n), r);
+  pc = rv_mul(rv_mul(z, z), rv_poly(z, t->cos_p, t->cos_n));
+  pc = rv_sub(one, rv_sub(rv_mul(rv_set1(r_half), z), pc));
+
+  odd = rv_or(rv_cmpeq(q, one), rv_cmpeq(q, rv_set1((real_t)3)));
+  *s = rv_select(odd, pc, ps);
+  *c = rv_select(odd, ps, pc);
+  *s = rv_xor(*s, rv_and(rv_cmpge(q, rv_set1(r_two)), sign));
+  *c = rv_xor(*c, rv_and(rv_or(rv_cmpeq(q, one), rv_cmpeq(q, rv_set1(r_two))),
+                         sign));
+  return ok;
+}
+#endif
+
+static void trig_sincos_run(real_t *s, real_t *c, const real_t *x,
+                            size_t count, const trig_tier_t *t) {
+  size_t i = 0, j;
+
+#ifdef MATH_SIMD
+  for (; i + rv_lanes <= count; i += rv_lanes) {
+    rv_t vs, vc;
+    int ok = rv_sincos(&vs, &vc, rv_load(x + i), t);
+
+    if (s)
+      rv_store(s + i, vs);
+    if (c)
+      rv_store(c + i, vc);
+
+    /* lanes past the reduction range, or NaN */
+    if (ok != (1 << rv_lanes) - 1)
+      for (j = i; j < i + rv_lanes; ++j)
+        if (!(ok & (1 << (j - i))))
+          trig_sincos1(s ? s + j : NULL, c ? c + j : NULL, x[j], t);
+  }
+#endif
+
+  for (j = i; j < count; ++j)
+    trig_sincos1(s ? s + j : NULL, c ? c + j : NULL, x[j], t);
+}
+
+static void trig_atan2_run(real_t *r, const real_t *y, const real_t *x,
+                           size_t count, const trig_tier_t *t) {
+  size_t i = 0;
+
+#ifdef MATH_SIMD
+  rv_t sign = rv_set1(-r_zero), one = rv_set1(r_one), zero = rv_zero();
+
+  for (; i + rv_lanes <= count; i += rv_lanes) {
+    rv_t vy = rv_load(y + i), vx = rv_load(x + i);
+    rv_t ax = rv_abs(vx), ay = rv_abs(vy);
+    rv_t mx = rv_max(ax, ay), a, big, v;
+
+    a = rv_div(rv_min(ax, ay), mx);
+    a = rv_select(rv_cmpgt(mx, zero), a, zero);
+
+    big = rv_cmpgt(a, rv_set1(t->atan_split));
+    a = rv_select(big, rv_div(rv_sub(a, one), rv_add(a, one)), a);
+
+    v = rv_rational(a, rv_mul(a, a), t->atan_p, t->atan_pn, t->atan_q,
+                    t->atan_qn);
+    v = rv_add(v, rv_and(big, rv_set1(trig_pio4)));
+    v = rv_select(rv_cmpgt(ay, ax), rv_sub(rv_set1(trig_pio2), v), v);
+    v = rv_select(rv_cmplt(vx, zero), rv_sub(rv_set1(r_pi), v), v);
+
+    rv_store(r + i, rv_xor(v, rv_and(vy, sign)));
+  }
+#endif
+
+  for (; i < count; ++i)
+    r[i] = trig_atan21(y[i], x[i], t);
+}
+
+static void trig_acos_run(real_t *r, const real_t *x, size_t count,
+                          const trig_tier_t *t) {
+  size_t i = 0;
+
+#ifdef MATH_SIMD
+  rv_t sign = rv_set1(-r_zero), half = rv_set1(r_half);
+
+  for (; i + rv_lanes <= count; i += rv_lanes) {
+    rv_t vx = rv_load(x + i), a = rv_abs(vx);
+    rv_t big = rv_cmpgt(a, half), z, p, pb, ps;
+
+    z = rv_select(big, rv_mul(rv_sub(rv_set1(r_one), a), half),
+                  rv_mul(a, a));
+    a = rv_select(big, rv_sqrt(z), a);
+    p = rv_rational(a, z, t->asin_p, t->asin_pn, t->asin_q, t->asin_qn);
+
+    /* 2 asin(sqrt((1 - |x|) / 2)), or pi/2 - asin(x) */
+    pb = rv_add(p, p);
+    pb = rv_select(rv_cmplt(vx, rv_zero()), rv_sub(rv_set1(r_pi), pb), pb);
+    ps = rv_sub(rv_set1(trig_pio2), rv_xor(p, rv_and(vx, sign)));
+
+    rv_store(r + i, rv_select(big, pb, ps));
+  }
+#endif
+
+  for (; i < count; ++i)
+    r[i] = trig_acos1(x[i], t);
+}
+
+/* arguments of a trig array split over math_parallel_for */
+typedef struct trig_job_t {
+  real_t *r, *c;
+  const real_t *x, *y;
+  const trig_tier_t *t;
+} trig_job_t;
+
+static void trig_sincos_range(void *ctx, size_t begin, size_t end) {
+  const trig_job_t *j = (const trig_job_t *)ctx;
+  trig_sincos_run(j->r ? j->r + begin : NULL, j->c ? j->c + begin : NULL,
+                  j->x + begin, end - begin, j->t);
+}
+
+static void trig_atan2_range(void *ctx, size_t begin, size_t end) {
+  const trig_job_t *j = (const trig_job_t *)ctx;
+  trig_atan2_run(j->r + begin, j->y + begin, j->x + begin, end - begin, j->t);
+}
+
+static void trig_acos_range(void *ctx, size_t begin, size_t end) {
+  const trig_job_t *j = (const trig_job_t *)ctx;
+  trig_acos_run(j->r + begin, j->x + begin, end - begin, j->t);
+}
+
+/* fn over [0, count), pooled from math_parallel_min values */
+static void trig_run(math_range_t fn, trig_job_t *j, size_t count,
+                     math_accuracy_t accuracy) {
+  j->t = trig_tier(accuracy);
+  if (count < math_parallel_min)
+    fn(j, 0, count);
+  else
+    math_parallel_for(0, count, math_parallel_grain, fn, j);
+}
+
+void math_sincos_array(real_t *s, real_t *c, const real_t *x, size_t count,
+                       math_accuracy_t accuracy) {
+  trig_job_t j;
+
+  j.r = s, j.c = c, j.x = x, j.y = NULL;
+  trig_run(trig_sincos_range, &j, count, accuracy);
+}
+
+void math_sin_array(real_t *r, const real_t *x, size_t count,
+                    math_accuracy_t accuracy) {
+  math_sincos_array(r, NULL, x, count, accuracy);
+}
+
+void math_cos_array(real_t *r, const real_t *x, size_t count,
+                    math_accuracy_t accuracy) {
+  math_sincos_array(NULL, r, x, count, accuracy);
+}
+
+void math_atan2_array(real_t *r, const real_t *y, const real_t *x,
+                      size_t count, math_accuracy_t accuracy) {
+  trig_job_t j;
+
+  j.r = r, j.c = NULL, j.x = x, j.y = y;
+  trig_run(trig_atan2_range, &j, count, accuracy);
+}
+
+void math_acos_array(real_t *r, const real_t *x, size_t count,
+                     math_accuracy_t accuracy) {
+  trig_job_t j;
+
+  j.r = r, j.c = NULL, j.x = x, j.y = NULL;
+  trig_run(trig_acos_range, &j, count, accuracy);
+}
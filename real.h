@@ -22,6 +22,69 @@
 extern "C" {
 #endif
 
+/**
+ * realf_t is always single precision and backs the vec*f_t/mat*f_t/quatf_t
+ * types, so float and double code can live in the same binary.
+ **/
+typedef float realf_t;
+
+#define rf_zero 0.0f
+#define rf_half 0.5f
+#define rf_one 1.0f
+#define rf_two 2.0f
+#define rf_negone -1.0f
+#define rf_360 360.0f
+#define rf_epsilon FLT_EPSILON
+#define rf_max FLT_MAX
+#define rf_pi 3.14159265358979323846f
+#define rf_deg (180.0f / rf_pi)
+#define rf_rad (rf_pi / 180.0f)
+
+#define rf_sqrt(x) sqrtf(x)
+#define rf_abs(x) fabsf(x)
+#define rf_copysign(x, y) copysignf(x, y)
+#define rf_sin(x) sinf(x)
+#define rf_cos(x) cosf(x)
+#define rf_tan(x) tanf(x)
+#define rf_asin(x) asinf(x)
+#define rf_acos(x) acosf(x)
+#define rf_atan2(y, x) atan2f(y, x)
+#define rf_sincos(x, s, c) math_sincosf(x, s, c)
+#define rf_equal(a, b) (rf_abs((a) - (b)) < rf_epsilon)
+
+/**
+ * real_t is double unless the library is built with MATH_SINGLE_PRECISION,
+ * which turns the whole real_t API (and its batch kernels) into float.
+ **/
+#ifdef MATH_SINGLE_PRECISION
+
+typedef realf_t real_t;
+
+#define r_zero rf_zero
+#define r_half rf_half
+#define r_one rf_one
+#define r_two rf_two
+#define r_negone rf_negone
+#define r_360 rf_360
+#define r_epsilon rf_epsilon
+#define r_max rf_max
+#define r_pi rf_pi
+#define r_deg rf_deg
+#define r_rad rf_rad
+
+#define r_sqrt(x) rf_sqrt(x)
+#define r_abs(x) rf_abs(x)
+#define r_copysign(x, y) rf_copysign(x, y)
+#define r_sin(x) rf_sin(x)
+#define r_cos(x) rf_cos(x)
+#define r_tan(x) rf_tan(x)
+#define r_asin(x) rf_asin(x)
+#define r_acos(x) rf_acos(x)
+#define r_atan2(y, x) rf_atan2(y, x)
+#define r_sincos(x, s, c) rf_sincos(x, s, c)
+
+#else
+
 typedef double real_t;
 
 #define r_zero 0.0
@@ -31,23 +94,85 @@ typedef double real_t;
 #define r_negone -1.0
 #define r_360 360.0
 #define r_epsilon DBL_EPSILON
+#define r_max DBL_MAX
 #define r_pi 3.14159265358979323846
 #define r_deg (180.0 / r_pi)
 #define r_rad (r_pi / 180.0)
 
 #define r_sqrt(x) sqrt(x)
 #define r_abs(x) fabs(x)
+#define r_copysign(x, y) copysign(x, y)
 #define r_sin(x) sin(x)
 #define r_cos(x) cos(x)
 #define r_tan(x) tan(x)
 #define r_asin(x) asin(x)
 #define r_acos(x) acos(x)
 #define r_atan2(y, x) atan2(y, x)
+#define r_sincos(x, s, c) math_sincos(x, s, c)
+
+#endif
+
 #define r_equal(a, b) (r_abs((a) - (b)) < r_epsilon)
 
 #define degrees(rad) ((rad)*r_deg)
 #define radians(deg) ((deg)*r_rad)
 
+#if defined(_MSC_VER) && !defined(__cplusplus)
+#define r_inline static __inline
+#else
+#define r_inline static inline
+#endif
+
+/* no-alias contract for pointer parameters */
+#if defined(_MSC_VER) || defined(__GNUC__)
+#define r_restrict __restrict
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 199901L
+#define r_restrict restrict
+#else
+#define r_restrict
+#endif
+
+/* alignment of math_alloc blocks, one cache line */
+#define MATH_ALIGNMENT 64
+
+void *math_alloc(size_t size);
+void math_free(void *ptr);
+
+/**
+ * *s = sin(x), *c = cos(x) with one shared range reduction. Arguments past
+ * 1e5 (8192 for float) go to libm.
+ **/
+void math_sincos(double x, double *s, double *c);
+void math_sincosf(float x, float *s, float *c);
+
+/**
+ * Accuracy of the math_*_array functions. MATH_PRECISE keeps within a few
+ * ulp of libm; MATH_FAST uses shorter polynomials, good to about 1e-8 for
+ * double and 1e-5 for float. The arrays are pooled from math_parallel_min
+ * values.
+ **/
+typedef enum math_accuracy_t { MATH_PRECISE = 0, MATH_FAST } math_accuracy_t;
+
+/* r[i] = sin(x[i]) */
+void math_sin_array(real_t *r, const real_t *x, size_t count,
+                    math_accuracy_t accuracy);
+
+/* r[i] = cos(x[i]) */
+void math_cos_array(real_t *r, const real_t *x, size_t count,
+                    math_accuracy_t accuracy);
+
+/* s[i] = sin(x[i]), c[i] = cos(x[i]) */
+void math_sincos_array(real_t *s, real_t *c, const real_t *x, size_t count,
+                       math_accuracy_t accuracy);
+
+/* r[i] = atan2(y[i], x[i]) for finite inputs, x = -0 counts as +0 */
+void math_atan2_array(real_t *r, const real_t *y, const real_t *x,
+                      size_t count, math_accuracy_t accuracy);
+
+/* r[i] = acos(x[i]), NaN outside [-1, 1] */
+void math_acos_array(real_t *r, const real_t *x, size_t count,
+                     math_accuracy_t accuracy);
+
 #ifdef __cplusplus
 };
 #endif
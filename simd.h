@@ -0,0 +1,379 @@
+/*
+ *  simd.h
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+#include "real.h"
+
+/**
+ * Internal lane abstraction used by the batch kernels.
+ *
+ * rv_t holds rv_lanes consecutive real_t values, so the lane count follows
+ * MATH_SINGLE_PRECISION (8/4 floats, 4/2 doubles). The ISA is picked at
+ * compile time from the compiler's target macros (-mavx, -mavx2, /arch:AVX2,
+ * x64 implies SSE2). MATH_SIMD is defined when a vector path exists; every
+ * kernel keeps a scalar loop for the tail, which is also the whole kernel
+ * when MATH_SIMD is not defined. Define MATH_NO_SIMD to force the scalar
+ * reference path.
+ **/
+
+#if !defined(MATH_NO_SIMD)
+#if defined(__AVX__)
+#define MATH_SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) ||                                  \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATH_SIMD_SSE2
+#endif
+#endif
+
+#if defined(MATH_SIMD_AVX) && defined(MATH_SINGLE_PRECISION)
+#include <immintrin.h>
+#define MATH_SIMD
+
+typedef __m256 rv_t;
+
+#define rv_lanes 8
+#define rv_load(p) _mm256_loadu_ps(p)
+#define rv_store(p, v) _mm256_storeu_ps(p, v)
+#define rv_set1(x) _mm256_set1_ps(x)
+#define rv_zero() _mm256_setzero_ps()
+#define rv_add(a, b) _mm256_add_ps(a, b)
+#define rv_sub(a, b) _mm256_sub_ps(a, b)
+#define rv_mul(a, b) _mm256_mul_ps(a, b)
+#define rv_div(a, b) _mm256_div_ps(a, b)
+#define rv_sqrt(a) _mm256_sqrt_ps(a)
+#define rv_min(a, b) _mm256_min_ps(a, b)
+#define rv_max(a, b) _mm256_max_ps(a, b)
+#define rv_and(a, b) _mm256_and_ps(a, b)
+#define rv_or(a, b) _mm256_or_ps(a, b)
+#define rv_xor(a, b) _mm256_xor_ps(a, b)
+#define rv_andnot(a, b) _mm256_andnot_ps(a, b)
+#define rv_cmplt(a, b) _mm256_cmp_ps(a, b, _CMP_LT_OQ)
+#define rv_cmple(a, b) _mm256_cmp_ps(a, b, _CMP_LE_OQ)
+#define rv_cmpgt(a, b) _mm256_cmp_ps(a, b, _CMP_GT_OQ)
+#define rv_cmpge(a, b) _mm256_cmp_ps(a, b, _CMP_GE_OQ)
+#define rv_cmpeq(a, b) _mm256_cmp_ps(a, b, _CMP_EQ_OQ)
+#define rv_movemask(m) _mm256_movemask_ps(m)
+#define rv_select(m, a, b) _mm256_blendv_ps(b, a, m)
+
+#if defined(__FMA__)
+#define rv_madd(a, b, c) _mm256_fmadd_ps(a, b, c)
+#else
+#define rv_madd(a, b, c) _mm256_add_ps(_mm256_mul_ps(a, b), c)
+#endif
+
+#elif defined(MATH_SIMD_AVX)
+#include <immintrin.h>
+#define MATH_SIMD
+
+typedef __m256d rv_t;
+
+#define rv_lanes 4
+#define rv_load(p) _mm256_loadu_pd(p)
+#define rv_store(p, v) _mm256_storeu_pd(p, v)
+#define rv_set1(x) _mm256_set1_pd(x)
+#define rv_zero() _mm256_setzero_pd()
+#define rv_add(a, b) _mm256_add_pd(a, b)
+#define rv_sub(a, b) _mm256_sub_pd(a, b)
+#define rv_mul(a, b) _mm256_mul_pd(a, b)
+#define rv_div(a, b) _mm256_div_pd(a, b)
+#define rv_sqrt(a) _mm256_sqrt_pd(a)
+#define rv_min(a, b) _mm256_min_pd(a, b)
+#define rv_max(a, b) _mm256_max_pd(a, b)
+#define rv_and(a, b) _mm256_and_pd(a, b)
+#define rv_or(a, b) _mm256_or_pd(a, b)
+#define rv_xor(a, b) _mm256_xor_pd(a, b)
+#define rv_andnot(a, b) _mm256_andnot_pd(a, b)
+#define rv_cmplt(a, b) _mm256_cmp_pd(a, b, _CMP_LT_OQ)
+#define rv_cmple(a, b) _mm256_cmp_pd(a, b, _CMP_LE_OQ)
+#define rv_cmpgt(a, b) _mm256_cmp_pd(a, b, _CMP_GT_OQ)
+#define rv_cmpge(a, b) _mm256_cmp_pd(a, b, _CMP_GE_OQ)
+#define rv_cmpeq(a, b) _mm256_cmp_pd(a, b, _CMP_EQ_OQ)
+#define rv_movemask(m) _mm256_movemask_pd(m)
+#define rv_select(m, a, b) _mm256_blendv_pd(b, a, m)
+
+#if defined(__FMA__)
+#define rv_madd(a, b, c) _mm256_fmadd_pd(a, b, c)
+#else
+#define rv_madd(a, b, c) _mm256_add_pd(_mm256_mul_pd(a, b), c)
+#endif
+
+#elif defined(MATH_SIMD_SSE2) && defined(MATH_SINGLE_PRECISION)
+#include <emmintrin.h>
+#define MATH_SIMD
+
+typedef __m128 rv_t;
+
+#define rv_lanes 4
+#define rv_load(p) _mm_loadu_ps(p)
+#define rv_store(p, v) _mm_storeu_ps(p, v)
+#define rv_set1(x) _mm_set1_ps(x)
+#define rv_zero() _mm_setzero_ps()
+#define rv_add(a, b) _mm_add_ps(a, b)
+#define rv_sub(a, b) _mm_sub_ps(a, b)
+#define rv_mul(a, b) _mm_mul_ps(a, b)
+#define rv_div(a, b) _mm_div_ps(a, b)
+#define rv_sqrt(a) _mm_sqrt_ps(a)
+#define rv_min(a, b) _mm_min_ps(a, b)
+#define rv_max(a, b) _mm_max_ps(a, b)
+#define rv_and(a, b) _mm_and_ps(a, b)
+#define rv_or(a, b) _mm_or_ps(a, b)
+#define rv_xor(a, b) _mm_xor_ps(a, b)
+#define rv_andnot(a, b) _mm_andnot_ps(a, b)
+#define rv_cmplt(a, b) _mm_cmplt_ps(a, b)
+#define rv_cmple(a, b) _mm_cmple_ps(a, b)
+#define rv_cmpgt(a, b) _mm_cmpgt_ps(a, b)
+#define rv_cmpge(a, b) _mm_cmpge_ps(a, b)
+#define rv_cmpeq(a, b) _mm_cmpeq_ps(a, b)
+#define rv_movemask(m) _mm_movemask_ps(m)
+#define rv_select(m, a, b) _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b))
+#define rv_madd(a, b, c) _mm_add_ps(_mm_mul_ps(a, b), c)
+
+#elif defined(MATH_SIMD_SSE2)
+#include <emmintrin.h>
+#define MATH_SIMD
+
+typedef __m128d rv_t;
+
+#define rv_lanes 2
+#define rv_load(p) _mm_loadu_pd(p)
+#define rv_store(p, v) _mm_storeu_pd(p, v)
+#define rv_set1(x) _mm_set1_pd(x)
+#define rv_zero() _mm_setzero_pd()
+#define rv_add(a, b) _mm_add_pd(a, b)
+#define rv_sub(a, b) _mm_sub_pd(a, b)
+#define rv_mul(a, b) _mm_mul_pd(a, b)
+#define rv_div(a, b) _mm_div_pd(a, b)
+#define rv_sqrt(a) _mm_sqrt_pd(a)
+#define rv_min(a, b) _mm_min_pd(a, b)
+#define rv_max(a, b) _mm_max_pd(a, b)
+#define rv_and(a, b) _mm_and_pd(a, b)
+#define rv_or(a, b) _mm_or_pd(a, b)
+#define rv_xor(a, b) _mm_xor_pd(a, b)
+#define rv_andnot(a, b) _mm_andnot_pd(a, b)
+#define rv_cmplt(a, b) _mm_cmplt_pd(a, b)
+#define rv_cmple(a, b) _mm_cmple_pd(a, b)
+#define rv_cmpgt(a, b) _mm_cmpgt_pd(a, b)
+#define rv_cmpge(a, b) _mm_cmpge_pd(a, b)
+#define rv_cmpeq(a, b) _mm_cmpeq_pd(a, b)
+#define rv_movemask(m) _mm_movemask_pd(m)
+#define rv_select(m, a, b) _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b))
+#define rv_madd(a, b, c) _mm_add_pd(_mm_mul_pd(a, b), c)
+
+#endif
+
+#ifdef MATH_SIMD
+/* |a| */
+#define rv_abs(a) rv_andnot(rv_set1(-r_zero), a)
+#endif
+
+/**
+ * r4_t holds exactly four real_t values: one mat44_t column or one vec4_t.
+ * MATH_SIMD_R4 is defined when it exists. Floats use one SSE register,
+ * doubles one AVX register or a pair of SSE2 registers.
+ **/
+
+#if defined(MATH_SIMD) && defined(MATH_SINGLE_PRECISION)
+#define MATH_SIMD_R4
+
+typedef __m128 r4_t;
+
+#define r4_load(p) _mm_loadu_ps(p)
+#define r4_store(p, v) _mm_storeu_ps(p, v)
+#define r4_store2(p, v) _mm_storel_pi((__m64 *)(p), v)
+#define r4_store3(p, v)                                                        \
+  (_mm_storel_pi((__m64 *)(p), v), _mm_store_ss((p) + 2, _mm_movehl_ps(v, v)))
+#define r4_set1(x) _mm_set1_ps(x)
+#define r4_set(x, y, z, w) _mm_setr_ps(x, y, z, w)
+#define r4_add(a, b) _mm_add_ps(a, b)
+#define r4_sub(a, b) _mm_sub_ps(a, b)
+#define r4_mul(a, b) _mm_mul_ps(a, b)
+#define r4_div(a, b) _mm_div_ps(a, b)
+#define r4_sqrt(a) _mm_sqrt_ps(a)
+#define r4_abs(a) _mm_andnot_ps(_mm_set1_ps(-0.0f), a)
+#define r4_and(a, b) _mm_and_ps(a, b)
+#define r4_xor(a, b) _mm_xor_ps(a, b)
+#define r4_transpose(c) _MM_TRANSPOSE4_PS((c)[0], (c)[1], (c)[2], (c)[3])
+
+#define MATH_SIMD_R4_SHUFFLE
+/* a[x], a[y], b[z], b[w] */
+#define r4_shuffle(a, b, x, y, z, w)                                           \
+  _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+
+#if defined(__FMA__)
+#define r4_madd(a, b, c) _mm_fmadd_ps(a, b, c)
+#else
+#define r4_madd(a, b, c) _mm_add_ps(_mm_mul_ps(a, b), c)
+#endif
+
+#elif defined(MATH_SIMD_AVX)
+#define MATH_SIMD_R4
+
+typedef __m256d r4_t;
+
+#define r4_load(p) _mm256_loadu_pd(p)
+#define r4_store(p, v) _mm256_storeu_pd(p, v)
+#define r4_store2(p, v) _mm_storeu_pd(p, _mm256_castpd256_pd128(v))
+#define r4_store3(p, v)                                                        \
+  _mm256_maskstore_pd(p, _mm256_setr_epi64x(-1, -1, -1, 0), v)
+#define r4_set1(x) _mm256_set1_pd(x)
+#define r4_set(x, y, z, w) _mm256_setr_pd(x, y, z, w)
+#define r4_add(a, b) _mm256_add_pd(a, b)
+#define r4_sub(a, b) _mm256_sub_pd(a, b)
+#define r4_mul(a, b) _mm256_mul_pd(a, b)
+#define r4_div(a, b) _mm256_div_pd(a, b)
+#define r4_sqrt(a) _mm256_sqrt_pd(a)
+#define r4_abs(a) _mm256_andnot_pd(_mm256_set1_pd(-0.0), a)
+#define r4_and(a, b) _mm256_and_pd(a, b)
+#define r4_xor(a, b) _mm256_xor_pd(a, b)
+
+r_inline void r4_transpose(r4_t *c) {
+  __m256d t0 = _mm256_unpacklo_pd(c[0], c[1]);
+  __m256d t1 = _mm256_unpackhi_pd(c[0], c[1]);
+  __m256d t2 = _mm256_unpacklo_pd(c[2], c[3]);
+  __m256d t3 = _mm256_unpackhi_pd(c[2], c[3]);
+
+  c[0] = _mm256_permute2f128_pd(t0, t2, 0x20);
+  c[1] = _mm256_permute2f128_pd(t1, t3, 0x20);
+  c[2] = _mm256_permute2f128_pd(t0, t2, 0x31);
+  c[3] = _mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
+#if defined(__AVX2__)
+#define MATH_SIMD_R4_SHUFFLE
+/* a[x], a[y], b[z], b[w] */
+#define r4_shuffle(a, b, x, y, z, w)                                           \
+  _mm256_blend_pd(_mm256_permute4x64_pd(a, _MM_SHUFFLE(w, z, y, x)),           \
+                  _mm256_permute4x64_pd(b, _MM_SHUFFLE(w, z, y, x)), 0xC)
+#endif
+
+#if defined(__FMA__)
+#define r4_madd(a, b, c) _mm256_fmadd_pd(a, b, c)
+#else
+#define r4_madd(a, b, c) _mm256_add_pd(_mm256_mul_pd(a, b), c)
+#endif
+
+#elif defined(MATH_SIMD_SSE2)
+#define MATH_SIMD_R4
+
+typedef struct r4_t {
+  __m128d lo, hi;
+} r4_t;
+
+r_inline r4_t r4_load(const double *p) {
+  r4_t r;
+  r.lo = _mm_loadu_pd(p);
+  r.hi = _mm_loadu_pd(p + 2);
+  return r;
+}
+
+r_inline void r4_store(double *p, r4_t v) {
+  _mm_storeu_pd(p, v.lo);
+  _mm_storeu_pd(p + 2, v.hi);
+}
+
+r_inline void r4_store2(double *p, r4_t v) { _mm_storeu_pd(p, v.lo); }
+
+r_inline void r4_store3(double *p, r4_t v) {
+  _mm_storeu_pd(p, v.lo);
+  _mm_store_sd(p + 2, v.hi);
+}
+
+r_inline r4_t r4_make(__m128d lo, __m128d hi) {
+  r4_t r;
+  r.lo = lo;
+  r.hi = hi;
+  return r;
+}
+
+r_inline r4_t r4_set1(double x) {
+  return r4_make(_mm_set1_pd(x), _mm_set1_pd(x));
+}
+
+r_inline r4_t r4_set(double x, double y, double z, double w) {
+  return r4_make(_mm_setr_pd(x, y), _mm_setr_pd(z, w));
+}
+
+r_inline r4_t r4_add(r4_t a, r4_t b) {
+  r4_t r;
+  r.lo = _mm_add_pd(a.lo, b.lo);
+  r.hi = _mm_add_pd(a.hi, b.hi);
+  return r;
+}
+
+r_inline r4_t r4_sub(r4_t a, r4_t b) {
+  r4_t r;
+  r.lo = _mm_sub_pd(a.lo, b.lo);
+  r.hi = _mm_sub_pd(a.hi, b.hi);
+  return r;
+}
+
+r_inline r4_t r4_mul(r4_t a, r4_t b) {
+  r4_t r;
+  r.lo = _mm_mul_pd(a.lo, b.lo);
+  r.hi = _mm_mul_pd(a.hi, b.hi);
+  return r;
+}
+
+r_inline r4_t r4_div(r4_t a, r4_t b) {
+  r4_t r;
+  r.lo = _mm_div_pd(a.lo, b.lo);
+  r.hi = _mm_div_pd(a.hi, b.hi);
+  return r;
+}
+
+r_inline r4_t r4_sqrt(r4_t a) {
+  return r4_make(_mm_sqrt_pd(a.lo), _mm_sqrt_pd(a.hi));
+}
+
+r_inline r4_t r4_abs(r4_t a) {
+  __m128d sign = _mm_set1_pd(-0.0);
+  return r4_make(_mm_andnot_pd(sign, a.lo), _mm_andnot_pd(sign, a.hi));
+}
+
+r_inline r4_t r4_and(r4_t a, r4_t b) {
+  return r4_make(_mm_and_pd(a.lo, b.lo), _mm_and_pd(a.hi, b.hi));
+}
+
+r_inline r4_t r4_xor(r4_t a, r4_t b) {
+  return r4_make(_mm_xor_pd(a.lo, b.lo), _mm_xor_pd(a.hi, b.hi));
+}
+
+r_inline r4_t r4_madd(r4_t a, r4_t b, r4_t c) {
+  r4_t r;
+  r.lo = _mm_add_pd(_mm_mul_pd(a.lo, b.lo), c.lo);
+  r.hi = _mm_add_pd(_mm_mul_pd(a.hi, b.hi), c.hi);
+  return r;
+}
+
+r_inline void r4_transpose(r4_t *c) {
+  r4_t t0 = c[0], t1 = c[1], t2 = c[2], t3 = c[3];
+
+  c[0] = r4_make(_mm_unpacklo_pd(t0.lo, t1.lo), _mm_unpacklo_pd(t2.lo, t3.lo));
+  c[1] = r4_make(_mm_unpackhi_pd(t0.lo, t1.lo), _mm_unpackhi_pd(t2.lo, t3.lo));
+  c[2] = r4_make(_mm_unpacklo_pd(t0.hi, t1.hi), _mm_unpacklo_pd(t2.hi, t3.hi));
+  c[3] = r4_make(_mm_unpackhi_pd(t0.hi, t1.hi), _mm_unpackhi_pd(t2.hi, t3.hi));
+}
+
+#define MATH_SIMD_R4_SHUFFLE
+/* the pair of a[i] and a[j] held in one SSE2 register */
+#define r4_pair(a, i, j)                                                       \
+  _mm_shuffle_pd((i) < 2 ? (a).lo : (a).hi, (j) < 2 ? (a).lo : (a).hi,         \
+                 ((i)&1) | (((j)&1) << 1))
+
+/* a[x], a[y], b[z], b[w] */
+#define r4_shuffle(a, b, x, y, z, w)                                           \
+  r4_make(r4_pair(a, x, y), r4_pair(b, z, w))
+
+#endif
+
+#endif /* __SIMD_H__ */
@@ -0,0 +1,249 @@
+/*
+ *  skin.c
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#include "skin.h"
+#include "parallel.h"
+#include "simd.h"
+
+void dualquat_set(dualquat_t *r, const quat_t q, const vec3_t t) {
+  /* dual = (0, t) q / 2 */
+  qw(r->dual) = -(vx(t) * qx(q) + vy(t) * qy(q) + vz(t) * qz(q)) * r_half;
+  qx(r->dual) = (vx(t) * qw(q) + vy(t) * qz(q) - vz(t) * qy(q)) * r_half;
+  qy(r->dual) = (vy(t) * qw(q) + vz(t) * qx(q) - vx(t) * qz(q)) * r_half;
+  qz(r->dual) = (vz(t) * qw(q) + vx(t) * qy(q) - vy(t) * qx(q)) * r_half;
+  memcpy(r->real, q, sizeof(quat_t));
+}
+
+/* p' = p + 2 u x (u x p + w p) + 2 (w du - dw u + u x du), (w, u) = real */
+static void dualquat_apply(vec3_t r, vec3_t n, const quat_t b, const quat_t d,
+                           const vec3_t p, const vec3_t pn) {
+  real_t w = qw(b), x = qx(b), y = qy(b), z = qz(b);
+  real_t tx, ty, tz, ax, ay, az;
+
+  tx = w * qx(d) - qw(d) * x + y * qz(d) - z * qy(d);
+  ty = w * qy(d) - qw(d) * y + z * qx(d) - x * qz(d);
+  tz = w * qz(d) - qw(d) * z + x * qy(d) - y * qx(d);
+
+  if (n) {
+    ax = y * vz(pn) - z * vy(pn) + w * vx(pn);
+    ay = z * vx(pn) - x * vz(pn) + w * vy(pn);
+    az = x * vy(pn) - y * vx(pn) + w * vz(pn);
+
+    vx(n) = vx(pn) + r_two * (y * az - z * ay);
+    vy(n) = vy(pn) + r_two * (z * ax - x * az);
+    vz(n) = vz(pn) + r_two * (x * ay - y * ax);
+  }
+
+  ax = y * vz(p) - z * vy(p) + w * vx(p);
+  ay = z * vx(p) - x * vz(p) + w * vy(p);
+  az = x * vy(p) - y * vx(p) + w * vz(p);
+
+  vx(r) = vx(p) + r_two * (y * az - z * ay + tx);
+  vy(r) = vy(p) + r_two * (z * ax - x * az + ty);
+  vz(r) = vz(p) + r_two * (x * ay - y * ax + tz);
+}
+
+void dualquat_transform(vec3_t r, const dualquat_t *d, const vec3_t v) {
+  quat_t b, u;
+  real_t s = quat_lensq(d->real);
+
+  s = r_one / r_sqrt(s);
+  quat_scale(b, d->real, s);
+  quat_scale(u, d->dual, s);
+  dualquat_apply(r, NULL, b, u, v, NULL);
+}
+
+void skin_linear(vec3_t *position, vec3_t *normal, const skin_t *s,
+                 const mat44_t *palette, size_t first, size_t count) {
+  const unsigned short *bone = s->bones + first * s->influences;
+  const real_t *weight = s->weights + first * s->influences;
+  size_t i, k, last = first + count;
+
+  /* no bind pose normals, nothing to skin */
+  if (!s->normal)
+    normal = NULL;
+
+  for (i = first; i < last; ++i) {
+#ifdef MATH_SIMD_R4
+    r4_t c0 = r4_set1(r_zero), c1 = c0, c2 = c0, c3 = c0, p;
+
+    for (k = 0; k < s->influences; ++k, ++bone, ++weight) {
+      const real_t *e = palette[*bone];
+      r4_t w;
+
+      if (*weight == r_zero)
+        continue;
+
+      w = r4_set1(*weight);
+      c0 = r4_madd(r4_load(e), w, c0);
+      c1 = r4_madd(r4_load(e + 4), w, c1);
+      c2 = r4_madd(r4_load(e + 8), w, c2);
+      c3 = r4_madd(r4_load(e + 12), w, c3);
+    }
+
+    if (normal) {
+      const real_t *n = s->normal[i];
+
+      p = r4_mul(c0, r4_set1(vx(n)));
+      p = r4_madd(c1, r4_set1(vy(n)), p);
+      p = r4_madd(c2, r4_set1(vz(n)), p);
+      r4_store3(normal[i], p);
+    }
+
+    p = r4_madd(c0, r4_set1(vx(s->position[i])), c3);
+    p = r4_madd(c1, r4_set1(vy(s->position[i])), p);
+    p = r4_madd(c2, r4_set1(vz(s->position[i])), p);
+    r4_store3(position[i], p);
+#else
+    real_t m[12] = {0}, x, y, z;
+    size_t j;
+
+    for (k = 0; k < s->influences; ++k, ++bone, ++weight) {
+      const real_t *e = palette[*bone];
+
+      if (*weight == r_zero)
+        continue;
+
+      for (j = 0; j < 3; ++j) {
+        m[j] += e[j] * *weight;
+        m[j + 3] += e[j + 4] * *weight;
+        m[j + 6] += e[j + 8] * *weight;
+        m[j + 9] += e[j + 12] * *weight;
+      }
+    }
+
+    if (normal) {
+      x = vx(s->normal[i]), y = vy(s->normal[i]), z = vz(s->normal[i]);
+      vx(normal[i]) = m[0] * x + m[3] * y + m[6] * z;
+      vy(normal[i]) = m[1] * x + m[4] * y + m[7] * z;
+      vz(normal[i]) = m[2] * x + m[5] * y + m[8] * z;
+    }
+
+    x = vx(s->position[i]), y = vy(s->position[i]), z = vz(s->position[i]);
+    vx(position[i]) = m[0] * x + m[3] * y + m[6] * z + m[9];
+    vy(position[i]) = m[1] * x + m[4] * y + m[7] * z + m[10];
+    vz(position[i]) = m[2] * x + m[5] * y + m[8] * z + m[11];
+#endif
+  }
+}
+
+void skin_dualquat(vec3_t *position, vec3_t *normal, const skin_t *s,
+                   const dualquat_t *palette, size_t first, size_t count) {
+  const unsigned short *bone = s->bones + first * s->influences;
+  const real_t *weight = s->weights + first * s->influences;
+  size_t i, k, last = first + count;
+
+  /* no bind pose normals, nothing to skin */
+  if (!s->normal)
+    normal = NULL;
+
+  for (i = first; i < last; ++i) {
+    const real_t *pivot = NULL;
+    quat_t b, d;
+    real_t len;
+#ifdef MATH_SIMD_R4
+    r4_t rb = r4_set1(r_zero), rd = rb;
+#else
+    memset(b, 0, sizeof(quat_t));
+    memset(d, 0, sizeof(quat_t));
+#endif
+
+    for (k = 0; k < s->influences; ++k, ++bone, ++weight) {
+      const dualquat_t *q = &palette[*bone];
+      real_t w = *weight;
+
+      if (w == r_zero)
+        continue;
+
+      /* q and -q are the same transform, blend on one hemisphere */
+      if (!pivot)
+        pivot = q->real;
+      else if (quat_dot(pivot, q->real) < r_zero)
+        w = -w;
+
+#ifdef MATH_SIMD_R4
+      rb = r4_madd(r4_load(q->real), r4_set1(w), rb);
+      rd = r4_madd(r4_load(q->dual), r4_set1(w), rd);
+#else
+      qw(b) += qw(q->real) * w, qw(d) += qw(q->dual) * w;
+      qx(b) += qx(q->real) * w, qx(d) += qx(q->dual) * w;
+      qy(b) += qy(q->real) * w, qy(d) += qy(q->dual) * w;
+      qz(b) += qz(q->real) * w, qz(d) += qz(q->dual) * w;
+#endif
+    }
+
+#ifdef MATH_SIMD_R4
+    r4_store(b, rb);
+    r4_store(d, rd);
+#endif
+
+    len = quat_lensq(b);
+    if (len == r_zero) {
+      vx(position[i]) = vx(s->position[i]);
+      vy(position[i]) = vy(s->position[i]);
+      vz(position[i]) = vz(s->position[i]);
+      if (normal) {
+        vx(normal[i]) = vx(s->normal[i]);
+        vy(normal[i]) = vy(s->normal[i]);
+        vz(normal[i]) = vz(s->normal[i]);
+      }
+      continue;
+    }
+
+    len = r_one / r_sqrt(len);
+    quat_scale(b, b, len);
+    quat_scale(d, d, len);
+    dualquat_apply(position[i], normal ? normal[i] : NULL, b, d,
+                   s->position[i], normal ? s->normal[i] : NULL);
+  }
+}
+
+/* arguments of a skin split over math_parallel_for */
+typedef struct skin_job_t {
+  vec3_t *position, *normal;
+  const skin_t *s;
+  const void *palette;
+} skin_job_t;
+
+static void skin_linear_range(void *ctx, size_t begin, size_t end) {
+  const skin_job_t *j = (const skin_job_t *)ctx;
+  skin_linear(j->position, j->normal, j->s, (const mat44_t *)j->palette,
+              begin, end - begin);
+}
+
+static void skin_dualquat_range(void *ctx, size_t begin, size_t end) {
+  const skin_job_t *j = (const skin_job_t *)ctx;
+  skin_dualquat(j->position, j->normal, j->s, (const dualquat_t *)j->palette,
+                begin, end - begin);
+}
+
+/* fn over [0, count), pooled from math_parallel_min influences */
+static void skin_run(math_range_t fn, vec3_t *position, vec3_t *normal,
+                     const skin_t *s, const void *palette, size_t count) {
+  size_t per = s->influences ? s->influences : 1;
+  skin_job_t j;
+
+  j.position = position, j.normal = normal, j.s = s, j.palette = palette;
+  if (count * per < math_parallel_min)
+    fn(&j, 0, count);
+  else
+    math_parallel_for(0, count, math_parallel_grain / per, fn, &j);
+}
+
+void skin_linear_batch(vec3_t *position, vec3_t *normal, const skin_t *s,
+                       const mat44_t *palette, size_t count) {
+  skin_run(skin_linear_range, position, normal, s, palette, count);
+}
+
+void skin_dualquat_batch(vec3_t *position, vec3_t *normal, const skin_t *s,
+                         const dualquat_t *palette, size_t count) {
+  skin_run(skin_dualquat_range, position, normal, s, palette, count);
+}
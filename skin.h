@@ -0,0 +1,75 @@
+/*
+ *  skin.h
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#ifndef __SKIN_H__
+#define __SKIN_H__
+
+#include "quaternion.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* rigid transform as real + dual part, both in Hamilton convention */
+typedef struct dualquat_t {
+  quat_t real, dual;
+} dualquat_t;
+
+/* rotate by unit q, then translate by t */
+void dualquat_set(dualquat_t *r, const quat_t q, const vec3_t t);
+
+/* r = d applied to the point v, d need not be normalized */
+void dualquat_transform(vec3_t r, const dualquat_t *d, const vec3_t v);
+
+/**
+ * Bind pose plus per vertex influences. Vertex i is driven by bones
+ * bones[i * influences + k] with weights[i * influences + k], k below
+ * influences (usually 4 or 8). Weights sum to 1, zero weights are skipped
+ * so short vertices can be padded.
+ **/
+typedef struct skin_t {
+  const vec3_t *position;
+  const vec3_t *normal; /* may be NULL */
+  const unsigned short *bones;
+  const real_t *weights;
+  size_t influences;
+} skin_t;
+
+/**
+ * Skin vertices [first, first + count) into position[i] and normal[i].
+ * Disjoint ranges may run on different threads. normal is left untouched
+ * when it or s->normal is NULL, and either output may alias the bind pose
+ * arrays. Normals are not renormalized.
+ **/
+
+/* linear blend: sum of weight * palette[bone], palette is affine */
+void skin_linear(vec3_t *position, vec3_t *normal, const skin_t *s,
+                 const mat44_t *palette, size_t first, size_t count);
+
+/**
+ * Dual quaternion blend: sum of weight * palette[bone], each flipped onto
+ * the hemisphere of the first bone, then normalized. No volume loss at
+ * twisting joints, rigid palettes only.
+ **/
+void skin_dualquat(vec3_t *position, vec3_t *normal, const skin_t *s,
+                   const dualquat_t *palette, size_t first, size_t count);
+
+/* all count vertices, pooled from math_parallel_min bone influences */
+void skin_linear_batch(vec3_t *position, vec3_t *normal, const skin_t *s,
+                       const mat44_t *palette, size_t count);
+void skin_dualquat_batch(vec3_t *position, vec3_t *normal, const skin_t *s,
+                         const dualquat_t *palette, size_t count);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __SKIN_H__ */
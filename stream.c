@@ -0,0 +1,548 @@
+/*
+ *  stream.c
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#include "stream.h"
+#include "parallel.h"
+#include "simd.h"
+
+static real_t *stream_alloc(real_t **c, int dim, size_t count) {
+  size_t align = MATH_ALIGNMENT / sizeof(real_t);
+  size_t stride = (count + align - 1) / align * align;
+  real_t *p = (real_t *)math_alloc(sizeof(real_t) * stride * dim);
+  int k;
+
+  for (k = 0; k < dim; ++k)
+    c[k] = p ? p + stride * k : NULL;
+
+  return p;
+}
+
+static void stream_add(real_t *r, const real_t *a, const real_t *b,
+                       size_t count) {
+  size_t i = 0;
+#ifdef MATH_SIMD
+  for (; i + rv_lanes <= count; i += rv_lanes)
+    rv_store(r + i, rv_add(rv_load(a + i), rv_load(b + i)));
+#endif
+  for (; i < count; ++i)
+    r[i] = a[i] + b[i];
+}
+
+static void stream_sub(real_t *r, const real_t *a, const real_t *b,
+                       size_t count) {
+  size_t i = 0;
+#ifdef MATH_SIMD
+  for (; i + rv_lanes <= count; i += rv_lanes)
+    rv_store(r + i, rv_sub(rv_load(a + i), rv_load(b + i)));
+#endif
+  for (; i < count; ++i)
+    r[i] = a[i] - b[i];
+}
+
+static void stream_mul(real_t *r, const real_t *a, const real_t *b,
+                       size_t count) {
+  size_t i = 0;
+#ifdef MATH_SIMD
+  for (; i + rv_lanes <= count; i += rv_lanes)
+    rv_store(r + i, rv_mul(rv_load(a + i), rv_load(b + i)));
+#endif
+  for (; i < count; ++i)
+    r[i] = a[i] * b[i];
+}
+
+static void stream_scale(real_t *r, const real_t *v, real_t s, size_t count) {
+  size_t i = 0;
+#ifdef MATH_SIMD
+  rv_t vs = rv_set1(s);
+  for (; i + rv_lanes <= count; i += rv_lanes)
+    rv_store(r + i, rv_mul(rv_load(v + i), vs));
+#endif
+  for (; i < count; ++i)
+    r[i] = v[i] * s;
+}
+
+/* r[i] = sum(a[k][i] * b[k][i]) */
+static void stream_dot(real_t *r, const real_t **a, const real_t **b, int dim,
+                       size_t count) {
+  size_t i = 0;
+  int k;
+#ifdef MATH_SIMD
+  for (; i + rv_lanes <= count; i += rv_lanes) {
+    rv_t d = rv_mul(rv_load(a[0] + i), rv_load(b[0] + i));
+    for (k = 1; k < dim; ++k)
+      d = rv_madd(rv_load(a[k] + i), rv_load(b[k] + i), d);
+    rv_store(r + i, d);
+  }
+#endif
+  for (; i < count; ++i) {
+    real_t d = a[0][i] * b[0][i];
+    for (k = 1; k < dim; ++k)
+      d += a[k][i] * b[k][i];
+    r[i] = d;
+  }
+}
+
+static void stream_normalize(real_t *r, real_t **v, int dim, real_t length,
+                             size_t count) {
+  size_t i = 0;
+  int k;
+#ifdef MATH_SIMD
+  rv_t vl = rv_set1(length);
+  rv_t eps = rv_set1(r_epsilon);
+  rv_t one = rv_set1(r_one);
+
+  for (; i + rv_lanes <= count; i += rv_lanes) {
+    rv_t ls, s, x[4];
+
+    x[0] = rv_load(v[0] + i);
+    ls = rv_mul(x[0], x[0]);
+    for (k = 1; k < dim; ++k) {
+      x[k] = rv_load(v[k] + i);
+      ls = rv_madd(x[k], x[k], ls);
+    }
+    ls = rv_sqrt(ls);
+
+    /* leave vectors with !r_equal(ls, r_zero) == false untouched */
+    s = rv_select(rv_cmpge(ls, eps), rv_div(vl, ls), one);
+    for (k = 0; k < dim; ++k)
+      rv_store(v[k] + i, rv_mul(x[k], s));
+    if (r)
+      rv_store(r + i, ls);
+  }
+#endif
+  for (; i < count; ++i) {
+    real_t ls = v[0][i] * v[0][i];
+    for (k = 1; k < dim; ++k)
+      ls += v[k][i] * v[k][i];
+    ls = r_sqrt(ls);
+
+    if (!r_equal(ls, r_zero)) {
+      real_t s = length / ls;
+      for (k = 0; k < dim; ++k)
+        v[k][i] *= s;
+    }
+    if (r)
+      r[i] = ls;
+  }
+}
+
+/* r = a x b over three components */
+static void stream_cross(real_t **r, const real_t **a, const real_t **b,
+                         size_t count) {
+  size_t i = 0;
+#ifdef MATH_SIMD
+  for (; i + rv_lanes <= count; i += rv_lanes) {
+    rv_t ax = rv_load(a[0] + i), ay = rv_load(a[1] + i), az = rv_load(a[2] + i);
+    rv_t bx = rv_load(b[0] + i), by = rv_load(b[1] + i), bz = rv_load(b[2] + i);
+
+    rv_store(r[0] + i, rv_sub(rv_mul(ay, bz), rv_mul(az, by)));
+    rv_store(r[1] + i, rv_sub(rv_mul(az, bx), rv_mul(ax, bz)));
+    rv_store(r[2] + i, rv_sub(rv_mul(ax, by), rv_mul(ay, bx)));
+  }
+#endif
+  for (; i < count; ++i) {
+    real_t ax = a[0][i], ay = a[1][i], az = a[2][i];
+    real_t bx = b[0][i], by = b[1][i], bz = b[2][i];
+
+    r[0][i] = ay * bz - az * by;
+    r[1][i] = az * bx - ax * bz;
+    r[2][i] = ax * by - ay * bx;
+  }
+}
+
+/* arguments of a stream kernel split over math_parallel_for */
+typedef struct stream_job_t {
+  real_t *r;    /* per element results, may be NULL for normalize */
+  real_t *v[4]; /* component outputs */
+  const real_t *a[4], *b[4];
+  real_t s;
+  int dim;
+} stream_job_t;
+
+/* the components of j from element begin on */
+static void stream_offset(const stream_job_t *j, size_t begin, real_t **v,
+                          const real_t **a, const real_t **b) {
+  int k;
+
+  for (k = 0; k < j->dim; ++k) {
+    v[k] = j->v[k] ? j->v[k] + begin : NULL;
+    a[k] = j->a[k] ? j->a[k] + begin : NULL;
+    b[k] = j->b[k] ? j->b[k] + begin : NULL;
+  }
+}
+
+static void stream_add_range(void *ctx, size_t begin, size_t end) {
+  const stream_job_t *j = (const stream_job_t *)ctx;
+  real_t *v[4];
+  const real_t *a[4], *b[4];
+  int k;
+
+  stream_offset(j, begin, v, a, b);
+  for (k = 0; k < j->dim; ++k)
+    stream_add(v[k], a[k], b[k], end - begin);
+}
+
+static void stream_sub_range(void *ctx, size_t begin, size_t end) {
+  const stream_job_t *j = (const stream_job_t *)ctx;
+  real_t *v[4];
+  const real_t *a[4], *b[4];
+  int k;
+
+  stream_offset(j, begin, v, a, b);
+  for (k = 0; k < j->dim; ++k)
+    stream_sub(v[k], a[k], b[k], end - begin);
+}
+
+static void stream_mul_range(void *ctx, size_t begin, size_t end) {
+  const stream_job_t *j = (const stream_job_t *)ctx;
+  real_t *v[4];
+  const real_t *a[4], *b[4];
+  int k;
+
+  stream_offset(j, begin, v, a, b);
+  for (k = 0; k < j->dim; ++k)
+    stream_mul(v[k], a[k], b[k], end - begin);
+}
+
+static void stream_scale_range(void *ctx, size_t begin, size_t end) {
+  const stream_job_t *j = (const stream_job_t *)ctx;
+  real_t *v[4];
+  const real_t *a[4], *b[4];
+  int k;
+
+  stream_offset(j, begin, v, a, b);
+  for (k = 0; k < j->dim; ++k)
+    stream_scale(v[k], a[k], j->s, end - begin);
+}
+
+static void stream_dot_range(void *ctx, size_t begin, size_t end) {
+  const stream_job_t *j = (const stream_job_t *)ctx;
+  real_t *v[4];
+  const real_t *a[4], *b[4];
+
+  stream_offset(j, begin, v, a, b);
+  stream_dot(j->r + begin, a, b, j->dim, end - begin);
+}
+
+static void stream_cross_range(void *ctx, size_t begin, size_t end) {
+  const stream_job_t *j = (const stream_job_t *)ctx;
+  real_t *v[4];
+  const real_t *a[4], *b[4];
+
+  stream_offset(j, begin, v, a, b);
+  stream_cross(v, a, b, end - begin);
+}
+
+static void stream_normalize_range(void *ctx, size_t begin, size_t end) {
+  const stream_job_t *j = (const stream_job_t *)ctx;
+  real_t *v[4];
+  const real_t *a[4], *b[4];
+
+  stream_offset(j, begin, v, a, b);
+  stream_normalize(j->r ? j->r + begin : NULL, v, j->dim, j->s, end - begin);
+}
+
+/* fn over [0, count), pooled from math_parallel_min elements */
+static void stream_run(math_range_t fn, stream_job_t *j, int dim,
+                       size_t count) {
+  j->dim = dim;
+  if (count < math_parallel_min)
+    fn(j, 0, count);
+  else
+    math_parallel_for(0, count, math_parallel_grain, fn, j);
+}
+
+/* the component arrays of a stream, NULL past its dimension */
+#define stream_cols2(c, p)                                                     \
+  ((c)[0] = (p)->x, (c)[1] = (p)->y, (c)[2] = (c)[3] = NULL)
+#define stream_cols3(c, p)                                                     \
+  ((c)[0] = (p)->x, (c)[1] = (p)->y, (c)[2] = (p)->z, (c)[3] = NULL)
+#define stream_cols4(c, p)                                                     \
+  ((c)[0] = (p)->x, (c)[1] = (p)->y, (c)[2] = (p)->z, (c)[3] = (p)->w)
+#define stream_none(c) ((c)[0] = (c)[1] = (c)[2] = (c)[3] = NULL)
+
+/**
+ *---------------------------------------------
+ *  Vector2 Stream
+ *---------------------------------------------
+ **/
+
+int vec2s_alloc(vec2s_t *s, size_t count) {
+  real_t *c[2];
+
+  if (!stream_alloc(c, 2, count))
+    return -1;
+
+  s->x = c[0];
+  s->y = c[1];
+  return 0;
+}
+
+void vec2s_free(vec2s_t *s) {
+  math_free(s->x);
+  s->x = s->y = NULL;
+}
+
+void vec2s_from_aos(vec2s_t *s, const vec2_t *v, size_t count) {
+  size_t i;
+  for (i = 0; i < count; ++i) {
+    s->x[i] = vx(v[i]);
+    s->y[i] = vy(v[i]);
+  }
+}
+
+void vec2s_to_aos(vec2_t *v, const vec2s_t *s, size_t count) {
+  size_t i;
+  for (i = 0; i < count; ++i) {
+    vx(v[i]) = s->x[i];
+    vy(v[i]) = s->y[i];
+  }
+}
+
+void vec2s_add(vec2s_t *r, const vec2s_t *a, const vec2s_t *b, size_t count) {
+  stream_job_t j;
+
+  stream_cols2(j.v, r), stream_cols2(j.a, a), stream_cols2(j.b, b);
+  stream_run(stream_add_range, &j, 2, count);
+}
+
+void vec2s_sub(vec2s_t *r, const vec2s_t *a, const vec2s_t *b, size_t count) {
+  stream_job_t j;
+
+  stream_cols2(j.v, r), stream_cols2(j.a, a), stream_cols2(j.b, b);
+  stream_run(stream_sub_range, &j, 2, count);
+}
+
+void vec2s_mul(vec2s_t *r, const vec2s_t *a, const vec2s_t *b, size_t count) {
+  stream_job_t j;
+
+  stream_cols2(j.v, r), stream_cols2(j.a, a), stream_cols2(j.b, b);
+  stream_run(stream_mul_range, &j, 2, count);
+}
+
+void vec2s_scale(vec2s_t *r, const vec2s_t *v, real_t s, size_t count) {
+  stream_job_t j;
+
+  stream_cols2(j.v, r), stream_cols2(j.a, v), stream_none(j.b);
+  j.s = s;
+  stream_run(stream_scale_range, &j, 2, count);
+}
+
+void vec2s_dot(real_t *r, const vec2s_t *a, const vec2s_t *b, size_t count) {
+  stream_job_t j;
+
+  stream_none(j.v), stream_cols2(j.a, a), stream_cols2(j.b, b);
+  j.r = r;
+  stream_run(stream_dot_range, &j, 2, count);
+}
+
+void vec2s_lensq(real_t *r, const vec2s_t *v, size_t count) {
+  vec2s_dot(r, v, v, count);
+}
+
+void vec2s_normalize(real_t *r, vec2s_t *v, real_t length, size_t count) {
+  stream_job_t j;
+
+  stream_cols2(j.v, v), stream_none(j.a), stream_none(j.b);
+  j.r = r, j.s = length;
+  stream_run(stream_normalize_range, &j, 2, count);
+}
+
+/**
+ *---------------------------------------------
+ *  Vector3 Stream
+ *---------------------------------------------
+ **/
+
+int vec3s_alloc(vec3s_t *s, size_t count) {
+  real_t *c[3];
+
+  if (!stream_alloc(c, 3, count))
+    return -1;
+
+  s->x = c[0];
+  s->y = c[1];
+  s->z = c[2];
+  return 0;
+}
+
+void vec3s_free(vec3s_t *s) {
+  math_free(s->x);
+  s->x = s->y = s->z = NULL;
+}
+
+void vec3s_from_aos(vec3s_t *s, const vec3_t *v, size_t count) {
+  size_t i;
+  for (i = 0; i < count; ++i) {
+    s->x[i] = vx(v[i]);
+    s->y[i] = vy(v[i]);
+    s->z[i] = vz(v[i]);
+  }
+}
+
+void vec3s_to_aos(vec3_t *v, const vec3s_t *s, size_t count) {
+  size_t i;
+  for (i = 0; i < count; ++i) {
+    vx(v[i]) = s->x[i];
+    vy(v[i]) = s->y[i];
+    vz(v[i]) = s->z[i];
+  }
+}
+
+void vec3s_add(vec3s_t *r, const vec3s_t *a, const vec3s_t *b, size_t count) {
+  stream_job_t j;
+
+  stream_cols3(j.v, r), stream_cols3(j.a, a), stream_cols3(j.b, b);
+  stream_run(stream_add_range, &j, 3, count);
+}
+
+void vec3s_sub(vec3s_t *r, const vec3s_t *a, const vec3s_t *b, size_t count) {
+  stream_job_t j;
+
+  stream_cols3(j.v, r), stream_cols3(j.a, a), stream_cols3(j.b, b);
+  stream_run(stream_sub_range, &j, 3, count);
+}
+
+void vec3s_mul(vec3s_t *r, const vec3s_t *a, const vec3s_t *b, size_t count) {
+  stream_job_t j;
+
+  stream_cols3(j.v, r), stream_cols3(j.a, a), stream_cols3(j.b, b);
+  stream_run(stream_mul_range, &j, 3, count);
+}
+
+void vec3s_scale(vec3s_t *r, const vec3s_t *v, real_t s, size_t count) {
+  stream_job_t j;
+
+  stream_cols3(j.v, r), stream_cols3(j.a, v), stream_none(j.b);
+  j.s = s;
+  stream_run(stream_scale_range, &j, 3, count);
+}
+
+void vec3s_dot(real_t *r, const vec3s_t *a, const vec3s_t *b, size_t count) {
+  stream_job_t j;
+
+  stream_none(j.v), stream_cols3(j.a, a), stream_cols3(j.b, b);
+  j.r = r;
+  stream_run(stream_dot_range, &j, 3, count);
+}
+
+void vec3s_cross(vec3s_t *r, const vec3s_t *a, const vec3s_t *b,
+                 size_t count) {
+  stream_job_t j;
+
+  stream_cols3(j.v, r), stream_cols3(j.a, a), stream_cols3(j.b, b);
+  stream_run(stream_cross_range, &j, 3, count);
+}
+
+void vec3s_lensq(real_t *r, const vec3s_t *v, size_t count) {
+  vec3s_dot(r, v, v, count);
+}
+
+void vec3s_normalize(real_t *r, vec3s_t *v, real_t length, size_t count) {
+  stream_job_t j;
+
+  stream_cols3(j.v, v), stream_none(j.a), stream_none(j.b);
+  j.r = r, j.s = length;
+  stream_run(stream_normalize_range, &j, 3, count);
+}
+
+/**
+ *---------------------------------------------
+ *  Vector4 Stream
+ *---------------------------------------------
+ **/
+
+int vec4s_alloc(vec4s_t *s, size_t count) {
+  real_t *c[4];
+
+  if (!stream_alloc(c, 4, count))
+    return -1;
+
+  s->x = c[0];
+  s->y = c[1];
+  s->z = c[2];
+  s->w = c[3];
+  return 0;
+}
+
+void vec4s_free(vec4s_t *s) {
+  math_free(s->x);
+  s->x = s->y = s->z = s->w = NULL;
+}
+
+void vec4s_from_aos(vec4s_t *s, const vec4_t *v, size_t count) {
+  size_t i;
+  for (i = 0; i < count; ++i) {
+    s->x[i] = vx(v[i]);
+    s->y[i] = vy(v[i]);
+    s->z[i] = vz(v[i]);
+    s->w[i] = vw(v[i]);
+  }
+}
+
+void vec4s_to_aos(vec4_t *v, const vec4s_t *s, size_t count) {
+  size_t i;
+  for (i = 0; i < count; ++i) {
+    vx(v[i]) = s->x[i];
+    vy(v[i]) = s->y[i];
+    vz(v[i]) = s->z[i];
+    vw(v[i]) = s->w[i];
+  }
+}
+
+void vec4s_add(vec4s_t *r, const vec4s_t *a, const vec4s_t *b, size_t count) {
+  stream_job_t j;
+
+  stream_cols4(j.v, r), stream_cols4(j.a, a), stream_cols4(j.b, b);
+  stream_run(stream_add_range, &j, 4, count);
+}
+
+void vec4s_sub(vec4s_t *r, const vec4s_t *a, const vec4s_t *b, size_t count) {
+  stream_job_t j;
+
+  stream_cols4(j.v, r), stream_cols4(j.a, a), stream_cols4(j.b, b);
+  stream_run(stream_sub_range, &j, 4, count);
+}
+
+void vec4s_mul(vec4s_t *r, const vec4s_t *a, const vec4s_t *b, size_t count) {
+  stream_job_t j;
+
+  stream_cols4(j.v, r), stream_cols4(j.a, a), stream_cols4(j.b, b);
+  stream_run(stream_mul_range, &j, 4, count);
+}
+
+void vec4s_scale(vec4s_t *r, const vec4s_t *v, real_t s, size_t count) {
+  stream_job_t j;
+
+  stream_cols4(j.v, r), stream_cols4(j.a, v), stream_none(j.b);
+  j.s = s;
+  stream_run(stream_scale_range, &j, 4, count);
+}
+
+void vec4s_dot(real_t *r, const vec4s_t *a, const vec4s_t *b, size_t count) {
+  stream_job_t j;
+
+  stream_none(j.v), stream_cols4(j.a, a), stream_cols4(j.b, b);
+  j.r = r;
+  stream_run(stream_dot_range, &j, 4, count);
+}
+
+void vec4s_lensq(real_t *r, const vec4s_t *v, size_t count) {
+  vec4s_dot(r, v, v, count);
+}
+
+void vec4s_normalize(real_t *r, vec4s_t *v, real_t length, size_t count) {
+  stream_job_t j;
+
+  stream_cols4(j.v, v), stream_none(j.a), stream_none(j.b);
+  j.r = r, j.s = length;
+  stream_run(stream_normalize_range, &j, 4, count);
+}
@@ -0,0 +1,165 @@
+/*
+ *  stream.h
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+#include "vector.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Structure-of-arrays vector streams.
+ *
+ * Each component lives in its own array, so element i of a vec3s_t is
+ * (x[i], y[i], z[i]). Streams created by vecNs_alloc share one block with
+ * every component array aligned to MATH_ALIGNMENT; a stream may also wrap
+ * caller-owned arrays, or point into another stream at an offset.
+ *
+ * The output of every kernel may alias its inputs element for element.
+ * Kernels are pooled from math_parallel_min elements; the AoS conversions
+ * are plain copies and stay on the calling thread.
+ **/
+
+typedef struct vec2s_t {
+  real_t *x, *y;
+} vec2s_t;
+
+typedef struct vec3s_t {
+  real_t *x, *y, *z;
+} vec3s_t;
+
+typedef struct vec4s_t {
+  real_t *x, *y, *z, *w;
+} vec4s_t;
+
+/**
+ *---------------------------------------------
+ *  Vector2 Stream
+ *---------------------------------------------
+ **/
+
+/* returns 0 on success, -1 when out of memory */
+int vec2s_alloc(vec2s_t *s, size_t count);
+void vec2s_free(vec2s_t *s);
+
+/* s[i] = v[i] */
+void vec2s_from_aos(vec2s_t *s, const vec2_t *v, size_t count);
+
+/* v[i] = s[i] */
+void vec2s_to_aos(vec2_t *v, const vec2s_t *s, size_t count);
+
+/* r[i] = a[i] + b[i] */
+void vec2s_add(vec2s_t *r, const vec2s_t *a, const vec2s_t *b, size_t count);
+
+/* r[i] = a[i] - b[i] */
+void vec2s_sub(vec2s_t *r, const vec2s_t *a, const vec2s_t *b, size_t count);
+
+/* r[i] = a[i] * b[i] */
+void vec2s_mul(vec2s_t *r, const vec2s_t *a, const vec2s_t *b, size_t count);
+
+/* r[i] = v[i] * s */
+void vec2s_scale(vec2s_t *r, const vec2s_t *v, real_t s, size_t count);
+
+/* r[i] = vec2_dot(a[i], b[i]) */
+void vec2s_dot(real_t *r, const vec2s_t *a, const vec2s_t *b, size_t count);
+
+/* r[i] = vec2_lensq(v[i]) */
+void vec2s_lensq(real_t *r, const vec2s_t *v, size_t count);
+
+/* r[i] = vec2_normalize(v[i], length), r may be NULL */
+void vec2s_normalize(real_t *r, vec2s_t *v, real_t length, size_t count);
+
+/**
+ *---------------------------------------------
+ *  Vector3 Stream
+ *---------------------------------------------
+ **/
+
+/* returns 0 on success, -1 when out of memory */
+int vec3s_alloc(vec3s_t *s, size_t count);
+void vec3s_free(vec3s_t *s);
+
+/* s[i] = v[i] */
+void vec3s_from_aos(vec3s_t *s, const vec3_t *v, size_t count);
+
+/* v[i] = s[i] */
+void vec3s_to_aos(vec3_t *v, const vec3s_t *s, size_t count);
+
+/* r[i] = a[i] + b[i] */
+void vec3s_add(vec3s_t *r, const vec3s_t *a, const vec3s_t *b, size_t count);
+
+/* r[i] = a[i] - b[i] */
+void vec3s_sub(vec3s_t *r, const vec3s_t *a, const vec3s_t *b, size_t count);
+
+/* r[i] = a[i] * b[i] */
+void vec3s_mul(vec3s_t *r, const vec3s_t *a, const vec3s_t *b, size_t count);
+
+/* r[i] = v[i] * s */
+void vec3s_scale(vec3s_t *r, const vec3s_t *v, real_t s, size_t count);
+
+/* r[i] = vec3_dot(a[i], b[i]) */
+void vec3s_dot(real_t *r, const vec3s_t *a, const vec3s_t *b, size_t count);
+
+/* r[i] = vec3_cross(a[i], b[i]) */
+void vec3s_cross(vec3s_t *r, const vec3s_t *a, const vec3s_t *b,
+                 size_t count);
+
+/* r[i] = vec3_lensq(v[i]) */
+void vec3s_lensq(real_t *r, const vec3s_t *v, size_t count);
+
+/* r[i] = vec3_normalize(v[i], length), r may be NULL */
+void vec3s_normalize(real_t *r, vec3s_t *v, real_t length, size_t count);
+
+/**
+ *---------------------------------------------
+ *  Vector4 Stream
+ *---------------------------------------------
+ **/
+
+/* returns 0 on success, -1 when out of memory */
+int vec4s_alloc(vec4s_t *s, size_t count);
+void vec4s_free(vec4s_t *s);
+
+/* s[i] = v[i] */
+void vec4s_from_aos(vec4s_t *s, const vec4_t *v, size_t count);
+
+/* v[i] = s[i] */
+void vec4s_to_aos(vec4_t *v, const vec4s_t *s, size_t count);
+
+/* r[i] = a[i] + b[i] */
+void vec4s_add(vec4s_t *r, const vec4s_t *a, const vec4s_t *b, size_t count);
+
+/* r[i] = a[i] - b[i] */
+void vec4s_sub(vec4s_t *r, const vec4s_t *a, const vec4s_t *b, size_t count);
+
+/* r[i] = a[i] * b[i] */
+void vec4s_mul(vec4s_t *r, const vec4s_t *a, const vec4s_t *b, size_t count);
+
+/* r[i] = v[i] * s */
+void vec4s_scale(vec4s_t *r, const vec4s_t *v, real_t s, size_t count);
+
+/* r[i] = vec4_dot(a[i], b[i]) */
+void vec4s_dot(real_t *r, const vec4s_t *a, const vec4s_t *b, size_t count);
+
+/* r[i] = vec4_lensq(v[i]) */
+void vec4s_lensq(real_t *r, const vec4s_t *v, size_t count);
+
+/* r[i] = vec4_normalize(v[i], length), r may be NULL */
+void vec4s_normalize(real_t *r, vec4s_t *v, real_t length, size_t count);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __STREAM_H__ */
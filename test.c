@@ -9,8 +9,22 @@
  *  https://github.com/shixiongfei/math
  */
 
+#include "aabb.h"
+#include "bvh.h"
+#include "frustum.h"
+#include "hierarchy.h"
+#include "inline.h"
+#include "kdtree.h"
+#include "linalg.h"
+#include "mapfile.h"
+#include "matn.h"
+#include "pack.h"
+#include "parallel.h"
 #include "matrix.h"
 #include "quaternion.h"
+#include "skin.h"
+#include "stream.h"
+#include "transform.h"
 #include "vector.h"
 #include <stdio.h>
 
@@ -46,6 +60,1390 @@ static void print_quat(const quat_t q) {
   printf("quat(%lf %lf %lf %lf)\n", qw(q), qx(q), qy(q), qz(q));
 }
 
+static void test_stream(void) {
+  vec3_t a[7], b[7], r[7];
+  real_t d[7], ls[7];
+  vec3s_t sa, sb, sr;
+  real_t err = r_zero;
+  int i;
+
+  for (i = 0; i < 7; ++i) {
+    vx(a[i]) = i + 1.0;
+    vy(a[i]) = 2.0 - i;
+    vz(a[i]) = 0.5 * i;
+    vx(b[i]) = 3.0;
+    vy(b[i]) = i * 0.25;
+    vz(b[i]) = -1.0 - i;
+  }
+
+  vec3s_alloc(&sa, 7);
+  vec3s_alloc(&sb, 7);
+  vec3s_alloc(&sr, 7);
+
+  vec3s_from_aos(&sa, a, 7);
+  vec3s_from_aos(&sb, b, 7);
+
+  vec3s_cross(&sr, &sa, &sb, 7);
+  vec3s_to_aos(r, &sr, 7);
+  for (i = 0; i < 7; ++i) {
+    vec3_t c;
+    vec3_cross(c, a[i], b[i]);
+    vec3_sub(c, c, r[i]);
+    err += vec3_lensq(c);
+  }
+
+  vec3s_add(&sr, &sa, &sb, 7);
+  vec3s_dot(d, &sr, &sb, 7);
+  for (i = 0; i < 7; ++i) {
+    vec3_t c;
+    vec3_add(c, a[i], b[i]);
+    err += r_abs(vec3_dot(c, b[i]) - d[i]);
+  }
+
+  vec3s_normalize(ls, &sa, 2.0, 7);
+  vec3s_lensq(d, &sa, 7);
+  for (i = 0; i < 7; ++i)
+    err += r_abs(d[i] - (real_t)4.0) + r_abs(ls[i] - vec3_len(a[i]));
+
+  printf("vec3 stream error = %lf\n", err);
+
+  vec3s_free(&sa);
+  vec3s_free(&sb);
+  vec3s_free(&sr);
+}
+
+static void test_float(void) {
+  vec3_t axis = {0.0, 0.6, 0.8};
+  vec3f_t axisf = {0.0f, 0.6f, 0.8f};
+  quat_t q, p = {1.0, 0.5, 0.5, 0.75};
+  quatf_t qf, pf = {1.0f, 0.5f, 0.5f, 0.75f};
+  mat44_t m;
+  mat44f_t mf;
+  real_t err = r_zero;
+  int i;
+
+  mat44_rotateaxis(m, radians(30.0), axis);
+  mat44f_rotateaxis(mf, (realf_t)radians(30.0), axisf);
+  for (i = 0; i < 16; ++i)
+    err += r_abs(m[i] - mf[i]);
+
+  quat_fromangleaxis(q, axis, radians(60.0));
+  quatf_fromangleaxis(qf, axisf, (realf_t)radians(60.0));
+  quat_normalize(p, 1.0);
+  quatf_normalize(pf, 1.0f);
+  quat_slerp(q, q, p, 0.25);
+  quatf_slerp(qf, qf, pf, 0.25f);
+  for (i = 0; i < 4; ++i)
+    err += r_abs(q[i] - qf[i]);
+
+  printf("sizeof mat44_t = %d, mat44f_t = %d\n", (int)sizeof(mat44_t),
+         (int)sizeof(mat44f_t));
+  printf("float vs real_t error < 1e-5: %d\n", err < 1e-5);
+}
+
+static void test_transform_batch(void) {
+  /* interleaved position(3) + uv(2) vertices */
+  real_t vertices[11][5];
+  vec2_t r2[11];
+  vec3_t r3[11], t3;
+  vec4_t r4[11], t4;
+  vec3_t axis = {0.0, 0.0, 1.0};
+  mat44_t m;
+  real_t err = r_zero;
+  int i;
+
+  for (i = 0; i < 11; ++i) {
+    vertices[i][0] = i * 0.5;
+    vertices[i][1] = 1.0 - i;
+    vertices[i][2] = i * i * 0.1;
+    vertices[i][3] = vertices[i][4] = 1.0;
+  }
+
+  mat44_rotateaxis(m, radians(45.0), axis);
+  e12(m) = 1.0;
+  e13(m) = 2.0;
+  e14(m) = 3.0;
+
+  mat44_transform2_batch(r2, m, vertices[0], 11, sizeof(vertices[0]));
+  mat44_transform3_batch(r3, m, vertices[0], 11, sizeof(vertices[0]));
+  mat44_transform4_batch(r4, m, vertices[0], 11, sizeof(real_t) * 2);
+
+  for (i = 0; i < 11; ++i) {
+    mat44_transform3(t3, m, vertices[i]);
+    err += r_abs(vx(t3) - vx(r2[i])) + r_abs(vy(t3) - vy(r2[i]));
+    vec3_sub(t3, t3, r3[i]);
+    err += vec3_len(t3);
+
+    mat44_transform4(t4, m, (&vertices[0][0] + i * 2));
+    vec4_sub(t4, t4, r4[i]);
+    err += vec4_len(t4);
+  }
+
+  printf("mat44 transform batch error = %lf\n", err);
+}
+
+static void test_mat44_simd(void) {
+  vec3_t axis = {0.48, 0.6, 0.64};
+  vec3_t move = {1.0, -2.0, 3.0};
+  mat44_t a, b, m, r, t;
+  real_t err = r_zero;
+  int i;
+
+  mat44_rotateaxis(a, radians(35.0), axis);
+  mat44_translate3(b, move);
+  mat44_mul(m, b, a);
+  mat44_perspective(a, 60.0, 1.5, 0.1, 100.0);
+  mat44_mul(t, a, m);
+
+  mat44_mul_simd(r, a, m);
+  for (i = 0; i < 16; ++i)
+    err += r_abs(r[i] - t[i]);
+
+  mat44_inverse(t, r);
+  mat44_inverse_simd(r, r);
+  for (i = 0; i < 16; ++i)
+    err += r_abs(r[i] - t[i]);
+
+  mat44_transpose(t, r);
+  mat44_transpose_simd(r, r);
+  for (i = 0; i < 16; ++i)
+    err += r_abs(r[i] - t[i]);
+
+  printf("mat44 simd error = %lf\n", err);
+}
+
+static void test_transform(void) {
+  vec3_t axis = {0.0, 0.6, 0.8};
+  vec3_t eye = {1.0, 2.0, 3.0}, target = {0.0}, up = {0.0, 1.0, 0.0};
+  vec3_t move = {4.0, 5.0, 6.0}, size = {2.0, 3.0, 4.0};
+  vec3_t p = {0.5, -1.5, 2.5}, q, s;
+  transform_t a, b, c, r;
+  mat44_t m;
+  real_t err = r_zero;
+  int i;
+
+  transform_rotateaxis(&a, radians(40.0), axis);
+  transform_translate3(&b, move);
+  transform_mul(&c, &b, &a);
+  printf("translate * rotate kind = %d\n", c.kind);
+
+  transform_inverse(&r, &c);
+  mat44_inverse(m, c.m);
+  for (i = 0; i < 16; ++i)
+    err += r_abs(m[i] - r.m[i]);
+
+  /* a scaled axis still gives a rigid rotation */
+  vec3_scale(s, axis, 5.0);
+  transform_rotateaxis(&b, radians(40.0), s);
+  mat44_rotateaxis(m, radians(40.0), axis);
+  for (i = 0; i < 16; ++i)
+    err += r_abs(m[i] - b.m[i]);
+
+  transform_lookat(&a, eye, target, up);
+  printf("lookat classify = %d\n", mat44_classify(a.m));
+  transform_scale3(&b, size);
+  transform_mul(&c, &a, &b);
+  transform_inverse(&r, &c);
+  mat44_inverse(m, c.m);
+  for (i = 0; i < 16; ++i)
+    err += r_abs(m[i] - r.m[i]);
+
+  transform_point(q, &c, p);
+  transform_point(s, &r, q);
+  vec3_sub(s, s, p);
+  err += vec3_len(s);
+
+  transform_perspective(&a, 60.0, 1.5, 0.1, 100.0);
+  transform_mul(&r, &a, &c);
+  printf("perspective * affine kind = %d\n", r.kind);
+
+  printf("transform error = %lf\n", err);
+}
+
+static void test_slerp(void) {
+  quat_t from[37], to[37], r[37], f[37];
+  real_t t[37], dot, err = r_zero, diff = r_zero;
+  vec3_t axis = {0.0, 0.6, 0.8}, turn = {1.0, 0.0, 0.0};
+  int i;
+
+  for (i = 0; i < 37; ++i) {
+    quat_fromangleaxis(from[i], axis, radians(i * 10.0));
+    quat_fromangleaxis(to[i], turn, radians(180.0 - i * 5.0));
+    if (i & 1)
+      quat_neg(to[i], to[i]);
+    t[i] = i / 36.0;
+  }
+
+  quat_slerp_array(r, from, to, t, 37);
+  quat_slerp_fast_array(f, from, to, t, 37);
+
+  for (i = 0; i < 37; ++i) {
+    quat_t q;
+
+    /* rotation angle between them from the chord |r - f| */
+    if (quat_dot(r[i], f[i]) < r_zero)
+      quat_add(q, f[i], r[i]);
+    else
+      quat_sub(q, f[i], r[i]);
+    dot = 4.0 * r_asin(quat_len(q) * r_half);
+    if (dot > err)
+      err = dot;
+
+    quat_slerp_fast(q, from[i], to[i], t[i]);
+    quat_sub(q, q, f[i]);
+    diff += quat_len(q);
+  }
+
+  /* the shorter arc stays between from and to */
+  quat_slerp(r[0], from[1], to[1], 0.5);
+  printf("slerp shortest path = %d\n",
+         quat_dot(r[0], from[1]) > 0.0 &&
+             r_abs(quat_dot(r[0], from[1]) - r_abs(quat_dot(r[0], to[1]))) <
+                 1e-5);
+  printf("slerp fast error < 8e-4 rad: %d, array vs scalar = %lf\n",
+         err < 8e-4, diff);
+}
+
+static void test_trig(void) {
+  real_t x[203], y[203], s[203], c[203], a[203];
+  real_t es = r_zero, ec = r_zero, ea = r_zero, eb = r_zero, e;
+  int i, fast;
+
+  for (fast = 0; fast < 2; ++fast) {
+    es = ec = ea = eb = r_zero;
+
+    for (i = 0; i < 203; ++i) {
+      x[i] = (i - 101) * (real_t)0.37;
+      y[i] = (i % 7 - 3) * (real_t)0.5;
+    }
+    x[7] = (real_t)1.0e6; /* libm fallback */
+
+    math_sincos_array(s, c, x, 203, fast ? MATH_FAST : MATH_PRECISE);
+    math_atan2_array(a, y, x, 203, fast ? MATH_FAST : MATH_PRECISE);
+
+    for (i = 0; i < 203; ++i) {
+      if ((e = r_abs(s[i] - r_sin(x[i]))) > es)
+        es = e;
+      if ((e = r_abs(c[i] - r_cos(x[i]))) > ec)
+        ec = e;
+      if ((e = r_abs(a[i] - r_atan2(y[i], x[i]))) > ea)
+        ea = e;
+      x[i] = (i - 101) / (real_t)101;
+    }
+
+    math_acos_array(a, x, 203, fast ? MATH_FAST : MATH_PRECISE);
+    for (i = 0; i < 203; ++i)
+      if ((e = r_abs(a[i] - r_acos(x[i]))) > eb)
+        eb = e;
+
+    printf("trig %s error: sin %g, cos %g, atan2 %g, acos %g\n",
+           fast ? "fast" : "precise", es, ec, ea, eb);
+  }
+
+  es = r_zero;
+  for (i = 0; i < 203; ++i) {
+    real_t ts, tc;
+    r_sincos((i - 101) * (real_t)0.37, &ts, &tc);
+    e = r_abs(ts - r_sin((i - 101) * (real_t)0.37)) +
+        r_abs(tc - r_cos((i - 101) * (real_t)0.37));
+    es = e > es ? e : es;
+  }
+  printf("r_sincos error %g\n", es);
+}
+
+static void test_sweep(void) {
+  vec2_t fan[1000], p2, v2 = {2.0, 0.5};
+  vec3_t orbit[1000], p3, v3 = {1.0, 2.0, 3.0}, axis = {0.0, 0.6, 0.8};
+  mat33_t e;
+  real_t step = radians(0.7), e2 = r_zero, e3 = r_zero, d;
+  int i;
+
+  vec2_rotate_sweep(fan, v2, r_one, step, 1000);
+  vec3_rotateaxis_sweep(orbit, v3, axis, r_one, step, 1000);
+
+  for (i = 0; i < 1000; ++i) {
+    vec2_rotate(p2, v2, r_one + i * step);
+    vec2_sub(p2, p2, fan[i]);
+    if ((d = vec2_len(p2)) > e2)
+      e2 = d;
+
+    mat33_rotateaxis(e, r_one + i * step, axis);
+    mat33_transform3(p3, e, v3);
+    vec3_sub(p3, p3, orbit[i]);
+    if ((d = vec3_len(p3)) > e3)
+      e3 = d;
+  }
+  printf("sweep drift: vec2 %g, vec3 %g\n", e2, e3);
+}
+
+static void test_hierarchy(void) {
+  hierarchy_t h;
+  mat44_t m, t, r, e;
+  mat33_t q33;
+  vec3_t up = {0.0, 0.0, 1.0}, move = {1.0, 2.0, 3.0}, grow = {2.0, 2.0, 2.0};
+  quat_t q;
+  int root, arm, hand, other, i;
+  real_t err = r_zero;
+
+  if (hierarchy_alloc(&h, 8) != 0)
+    return;
+
+  root = hierarchy_add(&h, -1);
+  arm = hierarchy_add(&h, root);
+  hand = hierarchy_add(&h, arm);
+  other = hierarchy_add(&h, -1);
+
+  quat_fromangleaxis(q, up, radians(90.0));
+  hierarchy_set_rotation(&h, root, q);
+  hierarchy_set_translation(&h, arm, move);
+  hierarchy_set_scale(&h, hand, grow);
+  hierarchy_update(&h);
+
+  /* only the arm subtree is recomputed, the other root is left alone */
+  e0(h.world[other]) = 42.0;
+  hierarchy_set_translation(&h, arm, grow);
+  hierarchy_update(&h);
+
+  quat_tomatrix(q33, q);
+  mat33_tomat44(m, q33);
+  mat44_translate3(t, grow);
+  mat44_mul(r, m, t);
+  mat44_scale3(t, grow);
+  mat44_mul(e, r, t);
+
+  for (i = 0; i < 16; ++i)
+    err += r_abs(e[i] - h.world[hand][i]);
+
+  printf("hierarchy error = %lf, untouched = %d\n", err,
+         e0(h.world[other]) == 42.0);
+
+  hierarchy_free(&h);
+}
+
+static void test_frustum(void) {
+  frustum_t f;
+  mat44_t proj, view, vp;
+  vec3_t eye = {0.0, 0.0, 5.0}, target = {0.0}, up = {0.0, 1.0, 0.0};
+  vec3s_t c, e;
+  real_t radius[1000] = {0.0};
+  unsigned char vis[1000];
+  size_t points, spheres, boxes;
+  int i, agree = 1;
+
+  if (vec3s_alloc(&c, 1000) != 0)
+    return;
+  if (vec3s_alloc(&e, 1000) != 0) {
+    vec3s_free(&c);
+    return;
+  }
+
+  mat44_perspective(proj, 60.0, 1.5, 0.1, 50.0);
+  mat44_lookat(view, eye, target, up);
+  mat44_mul(vp, proj, view);
+  frustum_extract(&f, vp);
+
+  for (i = 0; i < 1000; ++i) {
+    c.x[i] = (i % 10 - 4.5) * 2.0;
+    c.y[i] = (i / 10 % 10 - 4.5) * 2.0;
+    c.z[i] = (i / 100 - 4.5) * 3.0;
+    e.x[i] = e.y[i] = e.z[i] = 0.5;
+  }
+
+  points = frustum_cull_spheres(vis, &f, &c, radius, 1000);
+  for (i = 0; i < 1000; ++i) {
+    vec4_t p = {c.x[i], c.y[i], c.z[i], 1.0}, q;
+    mat44_transform4(q, vp, p);
+    agree &= vis[i] == (r_abs(vx(q)) <= vw(q) && r_abs(vy(q)) <= vw(q) &&
+                        r_abs(vz(q)) <= vw(q));
+    radius[i] = 0.5;
+  }
+  spheres = frustum_cull_spheres(vis, &f, &c, radius, 1000);
+  boxes = frustum_cull_aabbs(vis, &f, &c, &e, 1000);
+
+  printf("frustum points %d, spheres %d, boxes %d, agree = %d\n",
+         (int)points, (int)spheres, (int)boxes, agree);
+
+  vec3s_free(&c);
+  vec3s_free(&e);
+}
+
+static void test_aabb(void) {
+  aabb_t boxes[16], shared[16], each[16];
+  mat44_t m[16], t;
+  vec3_t axis = {1.0, 2.0, 2.0}, move = {3.0, -1.0, 0.5};
+  real_t err = r_zero;
+  int i, k;
+
+  vec3_normalize(axis, r_one);
+
+  for (i = 0; i < 16; ++i) {
+    vx(boxes[i].min) = -i * 0.5, vy(boxes[i].min) = i * 0.25;
+    vz(boxes[i].min) = -1.0;
+    vx(boxes[i].max) = i * 0.5 + 1.0, vy(boxes[i].max) = i * 0.75 + 0.5;
+    vz(boxes[i].max) = i * 0.1;
+
+    mat44_rotateaxis(m[i], radians(i * 23.0), axis);
+    mat44_translate3(t, move);
+    mat44_mul(m[i], t, m[i]);
+    e0(m[i]) *= 2.0; /* affine, not rigid */
+  }
+
+  aabb_transform_batch(shared, m[5], boxes, 16);
+  aabb_transform_each(each, m, boxes, 16);
+
+  for (i = 0; i < 16; ++i) {
+    aabb_t ref;
+
+    /* eight corners against each[i] */
+    for (k = 0; k < 8; ++k) {
+      vec3_t p;
+      vec4_t q;
+      vx(p) = k & 1 ? vx(boxes[i].max) : vx(boxes[i].min);
+      vy(p) = k & 2 ? vy(boxes[i].max) : vy(boxes[i].min);
+      vz(p) = k & 4 ? vz(boxes[i].max) : vz(boxes[i].min);
+      mat44_transform3(q, m[i], p);
+      if (k == 0) {
+        vx(ref.min) = vx(ref.max) = vx(q);
+        vy(ref.min) = vy(ref.max) = vy(q);
+        vz(ref.min) = vz(ref.max) = vz(q);
+      }
+      vx(ref.min) = vx(q) < vx(ref.min) ? vx(q) : vx(ref.min);
+      vy(ref.min) = vy(q) < vy(ref.min) ? vy(q) : vy(ref.min);
+      vz(ref.min) = vz(q) < vz(ref.min) ? vz(q) : vz(ref.min);
+      vx(ref.max) = vx(q) > vx(ref.max) ? vx(q) : vx(ref.max);
+      vy(ref.max) = vy(q) > vy(ref.max) ? vy(q) : vy(ref.max);
+      vz(ref.max) = vz(q) > vz(ref.max) ? vz(q) : vz(ref.max);
+    }
+
+    for (k = 0; k < 3; ++k)
+      err += r_abs(ref.min[k] - each[i].min[k]) +
+             r_abs(ref.max[k] - each[i].max[k]);
+    if (i == 5)
+      for (k = 0; k < 3; ++k)
+        err += r_abs(shared[i].min[k] - each[i].min[k]) +
+               r_abs(shared[i].max[k] - each[i].max[k]);
+  }
+
+  printf("aabb transform error = %lf\n", err);
+}
+
+/* nearest hit over all triangles, the reference for the bvh */
+static int brute_intersect(const vec3_t *v, int count, const vec3_t o,
+                           const vec3_t d, real_t *tmax) {
+  int i, best = -1;
+
+  for (i = 0; i < count; ++i) {
+    vec3_t e1, e2, p, s, q;
+    real_t det, u, w, t;
+
+    vec3_sub(e1, v[i * 3 + 1], v[i * 3]);
+    vec3_sub(e2, v[i * 3 + 2], v[i * 3]);
+    vec3_cross(p, d, e2);
+    det = vec3_dot(e1, p);
+    if (det == 0.0)
+      continue;
+    vec3_sub(s, o, v[i * 3]);
+    u = vec3_dot(s, p) / det;
+    vec3_cross(q, s, e1);
+    w = vec3_dot(d, q) / det;
+    t = vec3_dot(e2, q) / det;
+    if (u >= 0.0 && w >= 0.0 && u + w <= 1.0 && t >= 0.0 && t < *tmax)
+      *tmax = t, best = i;
+  }
+  return best;
+}
+
+static void test_bvh(void) {
+  enum { grid = 24, tris = grid * grid * 2, rays = 203 };
+  static vec3_t v[tris * 3];
+  real_t tmax[rays], t;
+  int tri[rays], i, x, y, agree = 1, packet = 1, hits = 0;
+  vec3s_t o, d;
+  bvh_t b;
+
+  /* a bumpy height field */
+  for (i = 0, y = 0; y < grid; ++y)
+    for (x = 0; x < grid; ++x) {
+      real_t h[4];
+      int k;
+      for (k = 0; k < 4; ++k)
+        h[k] = r_sin((x + (k & 1)) * 0.7) * r_cos((y + (k >> 1)) * 0.5);
+#define vtx(dx, dy)                                                            \
+  (vx(v[i]) = x + dx, vy(v[i]) = y + dy, vz(v[i]) = h[dx + dy * 2], ++i)
+      vtx(0, 0), vtx(1, 0), vtx(1, 1);
+      vtx(0, 0), vtx(1, 1), vtx(0, 1);
+#undef vtx
+    }
+
+  if (bvh_build(&b, v, tris) != 0)
+    return;
+  if (vec3s_alloc(&o, rays) != 0 || vec3s_alloc(&d, rays) != 0)
+    return;
+
+  for (i = 0; i < rays; ++i) {
+    o.x[i] = (i * 7 % 29) * 0.9 - 1.0, o.y[i] = (i * 11 % 31) * 0.8 - 1.0;
+    o.z[i] = 5.0;
+    d.x[i] = (i % 5 - 2) * 0.1, d.y[i] = (i % 3 - 1) * 0.1, d.z[i] = -1.0;
+    tmax[i] = 100.0;
+  }
+
+  bvh_intersect_packet(&b, &o, &d, tmax, tri, rays);
+
+  for (i = 0; i < rays; ++i) {
+    vec3_t ro = {o.x[i], o.y[i], o.z[i]}, rd = {d.x[i], d.y[i], d.z[i]};
+    bvh_hit_t hit;
+    int ref;
+
+    /* rays through shared edges may report either triangle */
+    t = 100.0;
+    ref = brute_intersect(v, tris, ro, rd, &t);
+    agree &= (bvh_intersect(&b, ro, rd, 100.0, &hit) < 0) == (ref < 0);
+    agree &= ref < 0 || r_abs(hit.t - t) < 1e-4;
+    agree &= bvh_occluded(&b, ro, rd, 100.0) == (ref >= 0);
+    packet &= (tri[i] < 0) == (ref < 0) && r_abs(tmax[i] - t) < 1e-4;
+    hits += ref >= 0;
+  }
+
+  /* lift the whole mesh, refit, and the same rays hit 1 higher */
+  for (i = 0; i < tris * 3; ++i)
+    vz(v[i]) += 1.0;
+  bvh_refit(&b);
+  for (i = 0; i < rays; ++i) {
+    vec3_t ro = {o.x[i], o.y[i], o.z[i]}, rd = {d.x[i], d.y[i], d.z[i]};
+    bvh_hit_t hit;
+
+    t = 100.0;
+    brute_intersect(v, tris, ro, rd, &t);
+    bvh_intersect(&b, ro, rd, 100.0, &hit);
+    agree &= r_abs(hit.t - t) < 1e-4;
+  }
+
+  printf("bvh nodes %d, hits %d, agree = %d, packet = %d\n",
+         (int)b.node_count, hits, agree, packet);
+  bvh_free(&b);
+
+  /* an empty tree refits and misses everything */
+  if (bvh_build(&b, v, 0) == 0) {
+    vec3_t ro = {0.0, 0.0, 5.0}, rd = {0.0, 0.0, -1.0};
+    bvh_refit(&b);
+    printf("bvh empty: %d\n", bvh_intersect(&b, ro, rd, 100.0, NULL));
+    bvh_free(&b);
+  }
+
+  vec3s_free(&o);
+  vec3s_free(&d);
+}
+
+static void test_kdtree(void) {
+  enum { count = 2000, queries = 50, k = 5 };
+  static vec3_t points[count], p[queries];
+  static unsigned int index[queries * k], near[32];
+  static real_t distsq[queries * k];
+  size_t found[queries];
+  unsigned int seed = 12345;
+  int i, j, n, knn = 1, radius = 1;
+  kdtree_t t;
+
+  for (i = 0; i < count + queries; ++i) {
+    real_t *v = i < count ? points[i] : p[i - count];
+    for (j = 0; j < 3; ++j) {
+      seed = seed * 1103515245 + 12345;
+      v[j] = (seed >> 8 & 0xffff) / 6553.6;
+    }
+    if (i % 97 == 0 && i < count)
+      vx(v) = 5.0; /* duplicate keys along one axis */
+  }
+
+  if (kdtree_build(&t, points, count) != 0)
+    return;
+
+  kdtree_knn_batch(&t, p, queries, k, index, distsq);
+  kdtree_radius_batch(&t, p, queries, 1.5, NULL, NULL, 0, found);
+
+  for (i = 0; i < queries; ++i) {
+    real_t best[k];
+    int inside = 0;
+
+    /* brute force: k smallest distances and the count within 1.5 */
+    for (j = 0; j < k; ++j)
+      best[j] = 1e30;
+    for (j = 0; j < count; ++j) {
+      vec3_t d;
+      real_t ls;
+      int m;
+      vec3_sub(d, p[i], points[j]);
+      ls = vec3_lensq(d);
+      inside += ls <= 1.5 * 1.5;
+      for (m = k - 1; m >= 0 && ls < best[m]; --m) {
+        if (m + 1 < k)
+          best[m + 1] = best[m];
+        best[m] = ls;
+      }
+    }
+
+    for (j = 0; j < k; ++j) {
+      vec3_t d;
+      vec3_sub(d, p[i], points[index[i * k + j]]);
+      knn &= r_abs(distsq[i * k + j] - best[j]) < 1e-4 &&
+             r_abs(vec3_lensq(d) - best[j]) < 1e-4;
+    }
+    radius &= (int)found[i] == inside;
+  }
+
+  n = (int)kdtree_radius(&t, p[0], 1.5, near, NULL, 32);
+  for (j = 0; j < n && j < 32; ++j) {
+    vec3_t d;
+    vec3_sub(d, p[0], points[near[j]]);
+    radius &= vec3_lensq(d) <= 1.5 * 1.5;
+  }
+
+  /* k past the stack heap: in the caller's arrays, allocated, batched */
+  {
+    static unsigned int wi[100], ni[100], bi[200];
+    static real_t wd[100];
+
+    knn &= kdtree_knn(&t, p[0], 100, wi, wd) == 100;
+    knn &= kdtree_knn(&t, p[0], 100, ni, NULL) == 100;
+    knn &= kdtree_knn_batch(&t, p, 2, 100, bi, NULL) == 0;
+    for (j = 0; j < 100; ++j) {
+      vec3_t d;
+      vec3_sub(d, p[0], points[wi[j]]);
+      knn &= ni[j] == wi[j] && bi[j] == wi[j];
+      knn &= r_abs(vec3_lensq(d) - wd[j]) < 1e-4 && (!j || wd[j - 1] <= wd[j]);
+    }
+  }
+
+  printf("kdtree knn = %d, radius = %d\n", knn, radius);
+  kdtree_free(&t);
+}
+
+static void test_inline(void) {
+  vec3_t axis = {0.0, 0.6, 0.8}, v = {1.0, 2.0, 3.0}, v3;
+  quat_t a = {0.5, 0.5, 0.5, 0.5}, b = {0.9, 0.1, 0.3, 0.3}, q;
+  mat33_t m3, r3, i3;
+  mat44_t m4, n4, r4, i4;
+  int ok = 1, k;
+
+  mat33_rotateaxis(m3, 0.7, axis);
+  mat44_rotateaxis(m4, 0.7, axis);
+  mat44_rotateaxis(n4, -1.3, v);
+  e12(m4) = 1.0, e13(m4) = -2.0, e14(m4) = 0.5;
+
+  mat44_mul_i(r4, m4, n4);
+  memcpy(i4, m4, sizeof(mat44_t));
+  mat44_mul_inplace(i4, n4);
+  ok = ok && mat44_equal(i4, r4);
+  memcpy(i4, n4, sizeof(mat44_t));
+  mat44_premul_inplace(m4, i4);
+  ok = ok && mat44_equal(i4, r4);
+
+  mat44_mul_i(r4, m4, m4);
+  memcpy(i4, m4, sizeof(mat44_t));
+  mat44_mul_inplace(i4, i4);
+  ok = ok && mat44_equal(i4, r4);
+
+  mat44_inverse_i(r4, m4);
+  memcpy(i4, m4, sizeof(mat44_t));
+  mat44_inverse_inplace(i4);
+  ok = ok && mat44_equal(i4, r4);
+
+  mat44_transpose_i(r4, m4);
+  mat44_transpose_inplace(m4);
+  ok = ok && mat44_equal(m4, r4);
+
+  mat33_inverse_i(r3, m3);
+  memcpy(i3, m3, sizeof(mat33_t));
+  mat33_inverse_inplace(i3);
+  ok = ok && mat33_equal(i3, r3);
+  mat33_mul_inplace(i3, m3);
+  mat33_identity(r3);
+  for (k = 0; k < 9; ++k)
+    ok = ok && r_abs(i3[k] - r3[k]) < r_epsilon * 16;
+
+  mat33_transform3_i(v3, m3, v);
+  mat33_transform3_inplace(v, m3);
+  ok = ok && r_equal(vx(v), vx(v3)) && r_equal(vy(v), vy(v3)) &&
+       r_equal(vz(v), vz(v3));
+
+  vec3_cross_i(v3, v, axis);
+  vec3_cross_inplace(v, axis);
+  ok = ok && r_equal(vx(v), vx(v3)) && r_equal(vy(v), vy(v3)) &&
+       r_equal(vz(v), vz(v3));
+
+  quat_mul_i(q, a, b);
+  quat_mul_inplace(a, b);
+  ok = ok && r_equal(qw(a), qw(q)) && r_equal(qx(a), qx(q)) &&
+       r_equal(qy(a), qy(q)) && r_equal(qz(a), qz(q));
+
+  printf("inline in-place: %s\n", ok ? "ok" : "FAIL");
+}
+
+static void test_quat_rotate(void) {
+  quat_t q = {0.9, 0.3, -0.5, 0.7}, c, t, p;
+  vec3_t v[16], r[16], s;
+  real_t err = r_zero, d;
+  int i;
+
+  for (i = 0; i < 16; ++i)
+    vx(v[i]) = i * 0.5 - 4.0, vy(v[i]) = r_one / (i + 1), vz(v[i]) = i;
+
+  /* reference: the Hamilton products q (0, v) q*, q left non-unit */
+  quat_conjugate(c, q);
+  for (i = 0; i < 16; ++i) {
+    qw(p) = r_zero, qx(p) = vx(v[i]), qy(p) = vy(v[i]), qz(p) = vz(v[i]);
+    quat_mul(t, c, p);
+    quat_mul(p, t, q);
+
+    quat_rotate(s, q, v[i]);
+    d = r_abs(vx(s) - qx(p)) + r_abs(vy(s) - qy(p)) + r_abs(vz(s) - qz(p));
+    err = d > err ? d : err;
+  }
+  printf("quat_rotate error: %g\n", err);
+
+  quat_rotate_array(r, q, (const vec3_t *)v, 16);
+  quat_rotate_array(v, q, (const vec3_t *)v, 16);
+  err = r_zero;
+  for (i = 0; i < 16; ++i) {
+    d = r_abs(vx(r[i]) - vx(v[i])) + r_abs(vy(r[i]) - vy(v[i])) +
+        r_abs(vz(r[i]) - vz(v[i]));
+    err = d > err ? d : err;
+  }
+  printf("quat_rotate_array in place: %g\n", err);
+}
+
+static void test_skin(void) {
+  vec3_t axis = {0.0, 0.6, 0.8}, t0 = {1.0, -2.0, 0.5}, t1 = {0.0, 0.0, 0.0};
+  vec3_t pos[64], nrm[64], lp[64], ln[64], dp[64], dn[64], p, e;
+  vec3_t bp[64], bq[64], bn[64];
+  unsigned short bones[64 * 8];
+  real_t weights[64 * 8], elbs = r_zero, edqs = r_zero, shrink = r_zero, d;
+  quat_t q[3], h;
+  mat33_t m;
+  mat44_t mp[3];
+  dualquat_t dq[3];
+  skin_t s;
+  int i, k;
+
+  quat_fromangleaxis(q[0], axis, 0.4);
+  quat_fromangleaxis(q[1], axis, 0.4);
+  quat_fromangleaxis(q[2], axis, 1.6);
+  quat_fromangleaxis(h, axis, 1.0);
+
+  for (i = 0; i < 3; ++i) {
+    quat_tomatrix(m, q[i]);
+    mat33_tomat44(mp[i], m);
+    dualquat_set(&dq[i], q[i], i ? t1 : t0);
+  }
+  e12(mp[0]) = vx(t0), e13(mp[0]) = vy(t0), e14(mp[0]) = vz(t0);
+
+  /* 32 vertices on bone 0, the rest split 50/50 on 1 and 2, 8 slots each */
+  for (i = 0; i < 64; ++i) {
+    vx(pos[i]) = i * 0.25 - 8.0, vy(pos[i]) = r_one, vz(pos[i]) = -i * 0.1;
+    vx(nrm[i]) = r_zero, vy(nrm[i]) = r_one, vz(nrm[i]) = r_zero;
+    for (k = 0; k < 8; ++k)
+      bones[i * 8 + k] = (unsigned short)(k % 3), weights[i * 8 + k] = 0;
+    if (i < 32)
+      weights[i * 8] = r_one;
+    else
+      weights[i * 8 + 4] = weights[i * 8 + 5] = r_half; /* bones 1, 2 */
+  }
+
+  s.position = (const vec3_t *)pos, s.normal = (const vec3_t *)nrm;
+  s.bones = bones, s.weights = weights, s.influences = 8;
+
+  skin_linear(lp, ln, &s, (const mat44_t *)mp, 0, 20);
+  skin_linear(lp, ln, &s, (const mat44_t *)mp, 20, 44);
+  skin_dualquat(dp, dn, &s, dq, 0, 40);
+  skin_dualquat(dp, dn, &s, dq, 40, 24);
+
+  for (i = 0; i < 64; ++i) {
+    /* bone 0, or halfway between the two rotations about the same axis */
+    quat_rotate(p, i < 32 ? q[0] : h, pos[i]);
+    if (i < 32) {
+      vec3_add(p, p, t0);
+      vec3_sub(e, p, lp[i]);
+      d = vec3_len(e);
+      elbs = d > elbs ? d : elbs;
+    } else {
+      d = r_one - vec3_len(lp[i]) / vec3_len(pos[i]);
+      shrink = d > shrink ? d : shrink;
+    }
+
+    vec3_sub(e, p, dp[i]);
+    d = vec3_len(e);
+    edqs = d > edqs ? d : edqs;
+
+    quat_rotate(p, i < 32 ? q[0] : h, nrm[i]);
+    vec3_sub(e, p, dn[i]);
+    d = vec3_len(e);
+    edqs = d > edqs ? d : edqs;
+  }
+  printf("skin linear %g (shrink %.3f), dualquat %g\n", elbs, shrink, edqs);
+
+  /* the pooled entry points match the ranges; no bind normals, no output */
+  s.normal = NULL;
+  memcpy(bn, ln, sizeof(ln));
+  skin_linear_batch(bp, bn, &s, (const mat44_t *)mp, 64);
+  skin_dualquat_batch(bq, bn, &s, dq, 64);
+  d = r_zero;
+  for (i = 0; i < 64; ++i) {
+    vec3_sub(e, bp[i], lp[i]);
+    d += vec3_len(e);
+    vec3_sub(e, bq[i], dp[i]);
+    d += vec3_len(e);
+  }
+  printf("skin batch %g, normals untouched %d\n", d,
+         memcmp(bn, ln, sizeof(ln)) == 0);
+}
+
+static void parallel_mark(void *ctx, size_t begin, size_t end) {
+  unsigned char *hits = (unsigned char *)ctx;
+
+  /* nested loops run inline on the calling worker */
+  if (end - begin > 1)
+    math_parallel_for(begin + 1, end, 1, parallel_mark, ctx);
+  hits[begin] += 1;
+}
+
+static void test_parallel(void) {
+  static unsigned char hits[100000];
+  static vec3_t v[20000], r[20000], s[20000];
+  static real_t w[6][20000];
+  mat44_t e;
+  vec3_t axis = {0.0, 0.6, 0.8};
+  vec3s_t p, q;
+  int round, i, k, marks = 1, same;
+
+  if (math_parallel_init(4) != 0)
+    printf("parallel: no threads, serial fallback\n");
+
+  for (round = 0; round < 20; ++round) {
+    memset(hits, 0, sizeof(hits));
+    math_parallel_for(0, 100000, 1 + round * 50, parallel_mark, hits);
+    for (i = 0; i < 100000; ++i)
+      marks &= hits[i] == 1;
+  }
+
+  mat44_rotateaxis(e, 0.3, axis);
+  e12(e) = 1.0, e13(e) = 2.0, e14(e) = 3.0;
+  for (i = 0; i < 20000; ++i)
+    vx(v[i]) = i, vy(v[i]) = -i * 0.5, vz(v[i]) = r_one / (i + 1);
+  mat44_transform3_batch(r, e, (const real_t *)v, 20000, 0);
+  /* below math_parallel_min both halves stay on this thread */
+  mat44_transform3_batch(s, e, (const real_t *)v, 10000, 0);
+  mat44_transform3_batch(s + 10000, e, (const real_t *)(v + 10000), 10000, 0);
+  same = memcmp(r, s, sizeof(r)) == 0;
+
+  /* pooled stream and trig kernels against two serial halves */
+  p.x = w[0], p.y = w[1], p.z = w[2];
+  q.x = w[3], q.y = w[4], q.z = w[5];
+  vec3s_from_aos(&p, v, 20000);
+  vec3s_from_aos(&q, v, 20000);
+  vec3s_normalize(NULL, &p, r_two, 20000);
+  vec3s_normalize(NULL, &q, r_two, 10000);
+  q.x += 10000, q.y += 10000, q.z += 10000;
+  vec3s_normalize(NULL, &q, r_two, 10000);
+  /* ranges may end mid-vector, the scalar tail rounds without FMA */
+  for (k = 0; k < 3; ++k)
+    for (i = 0; i < 20000; ++i)
+      same &= r_abs(w[k][i] - w[k + 3][i]) <= r_epsilon * 8;
+
+  math_sin_array(w[0], w[3], 20000, MATH_PRECISE);
+  math_sin_array(w[1], w[3], 10000, MATH_PRECISE);
+  math_sin_array(w[1] + 10000, w[3] + 10000, 10000, MATH_PRECISE);
+  for (i = 0; i < 20000; ++i)
+    same &= r_abs(w[0][i] - w[1][i]) <= r_epsilon * 4;
+
+  printf("parallel %d workers: each index once %s, batch %s\n",
+         math_parallel_workers(), marks ? "ok" : "FAIL", same ? "ok" : "FAIL");
+  math_parallel_shutdown();
+}
+
+/* max of d and the largest element difference */
+static real_t mat44_diff(real_t d, const mat44_t a, const mat44_t b) {
+  int k;
+
+  for (k = 0; k < 16; ++k)
+    d = r_abs(a[k] - b[k]) > d ? r_abs(a[k] - b[k]) : d;
+  return d;
+}
+
+static void test_mat44_batch(void) {
+  mat44_t a[13], b[13], r[13], s[13], t, v;
+  mat44_block_t pa[2], pb[2];
+  real_t err[5] = {0};
+  int i, k;
+
+  for (i = 0; i < 13; ++i)
+    for (k = 0; k < 16; ++k) {
+      a[i][k] = r_sin(i * 16 + k);
+      b[i][k] = r_cos(i * 7 + k * 3);
+    }
+  memcpy(v, a[5], sizeof(mat44_t));
+
+  mat44_mul_batch(r, v, (const mat44_t *)b, 13);
+  for (i = 0; i < 13; ++i) {
+    mat44_mul(t, v, b[i]);
+    err[0] = mat44_diff(err[0], t, r[i]);
+  }
+
+  mat44_mul_batch_right(r, (const mat44_t *)a, v, 13);
+  for (i = 0; i < 13; ++i) {
+    mat44_mul(t, a[i], v);
+    err[1] = mat44_diff(err[1], t, r[i]);
+  }
+
+  memcpy(s, b, sizeof(s));
+  mat44_mul_each(s, (const mat44_t *)a, (const mat44_t *)s, 13);
+  for (i = 0; i < 13; ++i) {
+    mat44_mul(t, a[i], b[i]);
+    err[2] = mat44_diff(err[2], t, s[i]);
+  }
+
+  mat44_block_pack(pa, (const mat44_t *)a, 13);
+  mat44_block_pack(pb, (const mat44_t *)b, 13);
+  mat44_block_mul(pa, pa, pb, 2);
+  mat44_block_unpack(r, pa, 13);
+  for (i = 0; i < 13; ++i)
+    err[3] = mat44_diff(err[3], s[i], r[i]);
+
+  mat44_block_mul_batch(pb, v, pb, 2);
+  mat44_block_unpack(r, pb, 13);
+  for (i = 0; i < 13; ++i) {
+    mat44_mul(t, v, b[i]);
+    err[4] = mat44_diff(err[4], t, r[i]);
+  }
+
+  printf("mat44 batch: shared %g, right %g, each %g, block %g %g\n", err[0],
+         err[1], err[2], err[3], err[4]);
+}
+
+static void test_matn(void) {
+  /* 150 x 130 by 130 x 70: packed path, with edge tiles on every side */
+  size_t m = 150, k = 130, n = 70, i, j, p;
+  matn_t a, b, c, d, t;
+  real_t err[3] = {0};
+
+  if (matn_alloc(&a, m, k) || matn_alloc(&b, k, n) || matn_alloc(&c, m, n) ||
+      matn_alloc(&d, m, n) || matn_alloc(&t, k, m)) {
+    printf("matn: out of memory\n");
+    return;
+  }
+
+  for (j = 0; j < k; ++j)
+    for (i = 0; i < m; ++i)
+      matn_at(&a, i, j) = r_sin((real_t)(i * 7 + j * 3));
+  for (j = 0; j < n; ++j)
+    for (i = 0; i < k; ++i)
+      matn_at(&b, i, j) = r_cos((real_t)(i * 5 + j));
+  for (j = 0; j < n; ++j)
+    for (i = 0; i < m; ++i)
+      matn_at(&c, i, j) = (real_t)(i + j);
+
+  /* d = 2 * a * b - c by the textbook loop */
+  for (j = 0; j < n; ++j)
+    for (i = 0; i < m; ++i) {
+      real_t s = r_zero;
+      for (p = 0; p < k; ++p)
+        s += matn_at(&a, i, p) * matn_at(&b, p, j);
+      matn_at(&d, i, j) = 2 * s - matn_at(&c, i, j);
+    }
+
+  matn_gemm(&c, r_two, &a, &b, -r_one);
+  for (j = 0; j < n; ++j)
+    for (i = 0; i < m; ++i) {
+      real_t e = r_abs(matn_at(&c, i, j) - matn_at(&d, i, j));
+      err[0] = e > err[0] ? e : err[0];
+    }
+
+  matn_transpose(&t, &a);
+  for (j = 0; j < k; ++j)
+    for (i = 0; i < m; ++i)
+      if (matn_at(&t, j, i) != matn_at(&a, i, j))
+        err[1] = r_one;
+
+  /* (c + d) * 0.5 - d is zero up to the gemm error */
+  matn_add(&c, &c, &d);
+  matn_scale(&c, &c, r_half);
+  matn_sub(&c, &c, &d);
+  for (j = 0; j < n; ++j)
+    for (i = 0; i < m; ++i) {
+      real_t e = r_abs(matn_at(&c, i, j));
+      err[2] = e > err[2] ? e : err[2];
+    }
+
+  printf("matn: gemm %s, transpose %g, add/scale/sub %s\n",
+         err[0] < r_epsilon * 1024 ? "ok" : "FAIL", err[1],
+         err[2] < r_epsilon * 1024 ? "ok" : "FAIL");
+
+  matn_free(&a);
+  matn_free(&b);
+  matn_free(&c);
+  matn_free(&d);
+  matn_free(&t);
+}
+
+/* max |a x - b| / max |b| */
+static real_t linalg_residual(const matn_t *a, const matn_t *x,
+                              const matn_t *b) {
+  real_t big = r_zero, err = r_zero;
+  size_t i, j;
+  matn_t r;
+
+  if (matn_alloc(&r, b->rows, b->cols) != 0)
+    return r_one;
+  matn_copy(&r, b);
+  matn_gemm(&r, r_one, a, x, -r_one);
+  for (j = 0; j < b->cols; ++j)
+    for (i = 0; i < b->rows; ++i) {
+      big = r_abs(matn_at(b, i, j)) > big ? r_abs(matn_at(b, i, j)) : big;
+      err = r_abs(matn_at(&r, i, j)) > err ? r_abs(matn_at(&r, i, j)) : err;
+    }
+  matn_free(&r);
+  return err / big;
+}
+
+static void test_linalg(void) {
+  /* three panels of linalg_block, the last one partial */
+  size_t n = 150, m = 200, nrhs = 5, i, j, piv[150];
+  real_t tau[150], err[3];
+  matn_t a, f, b, x, s, q, qb;
+
+  if (matn_alloc(&a, n, n) || matn_alloc(&f, n, n) ||
+      matn_alloc(&b, n, nrhs) || matn_alloc(&x, n, nrhs) ||
+      matn_alloc(&s, n, n) || matn_alloc(&q, m, n) ||
+      matn_alloc(&qb, m, nrhs)) {
+    printf("linalg: out of memory\n");
+    return;
+  }
+
+  for (j = 0; j < n; ++j)
+    for (i = 0; i < n; ++i)
+      matn_at(&a, i, j) = r_sin((real_t)(i * j + i * 3 + j));
+  for (j = 0; j < nrhs; ++j)
+    for (i = 0; i < n; ++i)
+      matn_at(&b, i, j) = r_cos((real_t)(i + j * 3));
+
+  matn_copy(&f, &a);
+  matn_copy(&x, &b);
+  if (matn_lu(&f, piv) == 0)
+    matn_lu_solve(&f, piv, &x);
+  err[0] = linalg_residual(&a, &x, &b);
+
+  /* s = a^T a + n I is symmetric positive definite */
+  matn_transpose(&f, &a);
+  matn_mul(&s, &f, &a);
+  for (i = 0; i < n; ++i)
+    matn_at(&s, i, i) += (real_t)n;
+  matn_copy(&f, &s);
+  matn_copy(&x, &b);
+  if (matn_cholesky(&f) == 0)
+    matn_cholesky_solve(&f, &x);
+  err[1] = linalg_residual(&s, &x, &b);
+
+  /* consistent overdetermined system q x = q b */
+  for (j = 0; j < n; ++j)
+    for (i = 0; i < m; ++i)
+      matn_at(&q, i, j) = r_cos((real_t)(i * j + i + j * 5));
+  matn_mul(&qb, &q, &b);
+  if (matn_qr(&q, tau) == 0)
+    matn_qr_solve(&q, tau, &qb);
+  err[2] = r_zero;
+  for (j = 0; j < nrhs; ++j)
+    for (i = 0; i < n; ++i) {
+      real_t e = r_abs(matn_at(&qb, i, j) - matn_at(&b, i, j));
+      err[2] = e > err[2] ? e : err[2];
+    }
+
+  printf("linalg: lu %g, cholesky %g, qr %g\n", err[0], err[1], err[2]);
+
+  matn_free(&a);
+  matn_free(&f);
+  matn_free(&b);
+  matn_free(&x);
+  matn_free(&s);
+  matn_free(&q);
+  matn_free(&qb);
+}
+
+static void test_inverse_batch(void) {
+  mat44_t e[21], r[21], t, one;
+  mat33_t m[11], q[11], u, one3;
+  mat44_block_t b[3];
+  unsigned char f[21], fb[24], g[11];
+  real_t err[3] = {0};
+  size_t flagged[3];
+  int i, k, expect = 1;
+
+  mat44_identity(one);
+  for (i = 0; i < 21; ++i) {
+    for (k = 0; k < 16; ++k)
+      e[i][k] = r_sin((real_t)(i * 16 + k * k)) * (k % 5 ? 1 : 4);
+    e[i][12] *= 100; /* a large translation does not matter */
+  }
+  memcpy(e[3] + 8, e[3] + 4, sizeof(real_t) * 4); /* equal columns */
+  e[7][5] = r_zero / r_zero;
+  for (k = 4; k < 8; ++k) /* parallel up to rounding */
+    e[17][k] = e[17][k - 4] * 3 + r_epsilon * r_epsilon;
+
+  flagged[0] = mat44_inverse_batch(r, (const mat44_t *)e, f, 21);
+  for (i = 0; i < 21; ++i) {
+    expect &= f[i] == (i == 3 || i == 7 || i == 17);
+    mat44_mul(t, e[i], r[i]);
+    if (!f[i])
+      err[0] = mat44_diff(err[0], t, one);
+    else
+      expect &= memcmp(r[i], one, sizeof(mat44_t)) == 0;
+  }
+
+  for (i = 0; i < 11; ++i)
+    for (k = 0; k < 9; ++k)
+      m[i][k] = r_cos((real_t)(i * 9 + k * k + 1));
+  memcpy(m[4] + 6, m[4], sizeof(real_t) * 3);
+  mat33_identity(one3);
+
+  flagged[1] = mat33_inverse_batch(q, (const mat33_t *)m, g, 11);
+  for (i = 0; i < 11; ++i) {
+    expect &= g[i] == (i == 4);
+    mat33_mul(u, m[i], q[i]);
+    for (k = 0; k < 9 && !g[i]; ++k)
+      err[1] = r_abs(u[k] - one3[k]) > err[1] ? r_abs(u[k] - one3[k]) : err[1];
+  }
+
+  /* the blocked form flags the same items, padding lanes are regular */
+  mat44_block_pack(b, (const mat44_t *)e, 21);
+  flagged[2] = mat44_block_inverse(b, b, fb, 3);
+  mat44_block_unpack(e, b, 21);
+  for (i = 0; i < 24; ++i)
+    expect &= fb[i] == (i < 21 && f[i]);
+  for (i = 0; i < 21; ++i)
+    err[2] = mat44_diff(err[2], e[i], r[i]);
+  expect &= err[2] < r_epsilon * 4096;
+
+  printf("inverse batch: flags %s (%u %u %u), mat44 %g, mat33 %g, "
+         "block %g\n",
+         expect ? "ok" : "FAIL", (unsigned int)flagged[0],
+         (unsigned int)flagged[1], (unsigned int)flagged[2], err[0], err[1],
+         err[2]);
+}
+
+/* rotation angle between unit quaternions a and b through the chord */
+static real_t quat_angle(const quat_t a, const quat_t b) {
+  real_t d = r_zero, s = quat_dot(a, b) < r_zero ? r_negone : r_one;
+  int k;
+
+  for (k = 0; k < 4; ++k)
+    d += (a[k] - b[k] * s) * (a[k] - b[k] * s);
+  return 4 * r_asin(r_sqrt(d) / 2);
+}
+
+static void test_pack(void) {
+  enum { n = 1000 };
+  static quat_t q[n], r[n], t;
+  static quat32_t p32[n];
+  static quat48_t p48[n];
+  static quat64_t p64[n];
+  /* 2 sqrt6 / (2^bits - 1), plus rounding of the real type */
+  const real_t bound[3] = {(real_t)4.79e-3, (real_t)1.50e-4,
+                           (real_t)4.68e-6 + r_epsilon * 64};
+  real_t err[3] = {0};
+  int i, ok = 1;
+
+  for (i = 0; i < n; ++i) {
+    q[i][0] = r_sin((real_t)i * 1.3f), q[i][1] = r_cos((real_t)i * 0.7f);
+    q[i][2] = r_sin((real_t)i * 2.9f + 1), q[i][3] = r_cos((real_t)i * 0.3f);
+    quat_normalize(q[i], r_one);
+  }
+  /* identity both ways, ties, a half turn */
+  q[0][0] = r_one, q[0][1] = q[0][2] = q[0][3] = r_zero;
+  q[1][0] = r_negone, q[1][1] = q[1][2] = q[1][3] = r_zero;
+  q[2][0] = q[2][1] = q[2][2] = q[2][3] = r_half;
+  q[3][0] = q[3][1] = r_zero, q[3][2] = r_negone, q[3][3] = r_zero;
+
+  quat_pack32_array(p32, (const quat_t *)q, n);
+  quat_unpack32_array(r, p32, n);
+  for (i = 0; i < n; ++i) {
+    real_t a = quat_angle(q[i], r[i]);
+    err[0] = a > err[0] ? a : err[0];
+    quat_unpack32(t, quat_pack32(q[i]));
+    ok &= p32[i] == quat_pack32(q[i]) && quat_angle(t, r[i]) < r_epsilon * 64;
+  }
+
+  quat_pack48_array(p48, (const quat_t *)q, n);
+  quat_unpack48_array(r, p48, n);
+  for (i = 0; i < n; ++i) {
+    real_t a = quat_angle(q[i], r[i]);
+    err[1] = a > err[1] ? a : err[1];
+  }
+
+  quat_pack64_array(p64, (const quat_t *)q, n);
+  quat_unpack64_array(r, p64, n);
+  for (i = 0; i < n; ++i) {
+    real_t a = quat_angle(q[i], r[i]);
+    err[2] = a > err[2] ? a : err[2];
+  }
+
+  for (i = 0; i < 3; ++i)
+    ok &= err[i] <= bound[i];
+
+  printf("pack quat: %s, max error 32 %.3g, 48 %.3g, 64 %.3g rad\n",
+         ok ? "ok" : "FAIL", err[0], err[1], err[2]);
+}
+
+static real_t vec3_angle(const vec3_t a, const vec3_t b) {
+  vec3_t d;
+
+  vec3_sub(d, a, b);
+  return 2 * r_asin(r_sqrt(vec3_dot(d, d)) / 2);
+}
+
+static void test_oct(void) {
+  enum { n = 1000 };
+  static vec3_t v[n], r[n], t;
+  static oct16_t p16[n];
+  static oct24_t p24[n];
+  static oct32_t p32[n];
+  /* the bounds documented in pack.h */
+  const real_t bound[3] = {(real_t)1.7e-2, (real_t)1.1e-3, (real_t)7.0e-5};
+  real_t err[3] = {0};
+  int i, k, ok = 1;
+
+  for (i = 0; i < n; ++i) {
+    vx(v[i]) = r_sin((real_t)i * 1.3f), vy(v[i]) = r_cos((real_t)i * 0.7f);
+    vz(v[i]) = r_sin((real_t)i * 2.9f + 1);
+    vec3_normalize(v[i], r_one);
+  }
+  /* the six axes, then the fold edge z = 0 and a diagonal below it */
+  for (i = 0; i < 6; ++i) {
+    vx(v[i]) = vy(v[i]) = vz(v[i]) = r_zero;
+    v[i][i / 2] = i & 1 ? r_negone : r_one;
+  }
+  vx(v[6]) = r_half, vy(v[6]) = -r_half, vz(v[6]) = r_zero;
+  vx(v[7]) = vy(v[7]) = vz(v[7]) = r_negone;
+  vec3_normalize(v[6], r_one);
+  vec3_normalize(v[7], r_one);
+
+  vec3_pack16_array(p16, (const vec3_t *)v, n);
+  vec3_unpack16_array(r, p16, n);
+  for (i = 0; i < n; ++i) {
+    real_t a = vec3_angle(v[i], r[i]);
+    err[0] = a > err[0] ? a : err[0];
+    vec3_unpack16(t, vec3_pack16(v[i]));
+    ok &= p16[i] == vec3_pack16(v[i]) && vec3_angle(t, r[i]) < r_epsilon * 64;
+  }
+
+  vec3_pack24_array(p24, (const vec3_t *)v, n);
+  vec3_unpack24_array(r, p24, n);
+  for (i = 0; i < n; ++i) {
+    real_t a = vec3_angle(v[i], r[i]);
+    oct24_t p = vec3_pack24(v[i]);
+    err[1] = a > err[1] ? a : err[1];
+    for (k = 0; k < 3; ++k)
+      ok &= p24[i].v[k] == p.v[k];
+  }
+
+  vec3_pack32_array(p32, (const vec3_t *)v, n);
+  vec3_unpack32_array(r, p32, n);
+  for (i = 0; i < n; ++i) {
+    real_t a = vec3_angle(v[i], r[i]);
+    err[2] = a > err[2] ? a : err[2];
+  }
+
+  for (i = 0; i < 3; ++i)
+    ok &= err[i] <= bound[i];
+
+  /* zero vectors in the lanes and in the scalar tail pack to 0 alike */
+  for (i = 0; i < 7; ++i)
+    vx(v[i]) = vy(v[i]) = vz(v[i]) = r_zero;
+  vec3_pack16_array(p16, (const vec3_t *)v, 7);
+  vec3_pack24_array(p24, (const vec3_t *)v, 7);
+  vec3_pack32_array(p32, (const vec3_t *)v, 7);
+  vec3_unpack16(t, vec3_pack16(v[0]));
+  ok &= vec3_pack16(v[0]) == 0 && vec3_pack32(v[0]) == 0 && vz(t) == r_negone;
+  for (i = 0; i < 7; ++i)
+    ok &= p16[i] == 0 && p32[i] == 0 &&
+          (p24[i].v[0] | p24[i].v[1] | p24[i].v[2]) == 0;
+
+  printf("pack vec3: %s, max error 16 %.3g, 24 %.3g, 32 %.3g rad\n",
+         ok ? "ok" : "FAIL", err[0], err[1], err[2]);
+}
+
+static void test_mapfile(void) {
+  enum { n = 100 };
+  static vec3_t v[n], rv[n], mv[n];
+  static mat44_t m[n], rm[n], mm[n];
+  static const char *path = "mapfile_test.bin";
+  quat_t q = {r_half, r_half, -r_half, r_half};
+  mapfile_array_t arrays[3], a;
+  const vec3_t *fv;
+  const mat44_t *fm;
+  const quat_t *fq;
+  size_t count = 0, i;
+  mapfile_t f;
+  FILE *fp;
+  int ok = 1, ret;
+
+  for (i = 0; i < n; ++i) {
+    vx(v[i]) = (real_t)i, vy(v[i]) = r_sin((real_t)i), vz(v[i]) = -r_one;
+    mat44_rotateaxis(m[i], (real_t)i * 0.1f, v[i]);
+    e12(m[i]) = (real_t)i;
+  }
+
+  arrays[0].name = "points", arrays[0].type = MAPFILE_VEC3;
+  arrays[0].data = v, arrays[0].count = n;
+  arrays[1].name = "world", arrays[1].type = MAPFILE_MAT44;
+  arrays[1].data = m, arrays[1].count = n;
+  arrays[2].name = "spin", arrays[2].type = MAPFILE_QUAT;
+  arrays[2].data = q, arrays[2].count = 1;
+
+  ret = mapfile_write(path, arrays, 3);
+  ok &= ret == 0 && mapfile_open(&f, path) == 0 && f.arrays == 3;
+
+  fv = mapfile_vec3(&f, "points", &count);
+  ok &= fv && count == n && ((size_t)fv % mapfile_alignment) == 0;
+  fm = mapfile_mat44(&f, "world", &count);
+  ok &= fm && count == n && ((size_t)fm % mapfile_alignment) == 0;
+  fq = mapfile_quat(&f, "spin", NULL);
+  ok &= fq && ((size_t)fq % mapfile_alignment) == 0;
+
+  /* wrong type and unknown names */
+  ok &= !mapfile_mat33(&f, "world", NULL) && !mapfile_vec3(&f, "none", NULL);
+  ok &= mapfile_array(&f, 1, &a) == 0 && a.data == (const void *)fm &&
+        mapfile_array(&f, 3, &a) == -1;
+
+  /* the mapped arrays go straight into the library */
+  if (fv && fm && fq) {
+    mat44_mul_each(mm, fm, fm, n);
+    mat44_mul_each(rm, (const mat44_t *)m, (const mat44_t *)m, n);
+    quat_rotate_array(mv, *fq, fv, n);
+    quat_rotate_array(rv, q, (const vec3_t *)v, n);
+    ok &= memcmp(mm, rm, sizeof(rm)) == 0 && memcmp(mv, rv, sizeof(rv)) == 0;
+  }
+  mapfile_close(&f);
+
+  /* a file promising less than mapfile_alignment */
+  fp = fopen(path, "r+b");
+  if (fp) {
+    unsigned int align = mapfile_alignment / 4;
+    fseek(fp, 20, SEEK_SET);
+    fwrite(&align, sizeof(align), 1, fp);
+    fclose(fp);
+  }
+  ok &= mapfile_open(&f, path) == 1;
+
+  /* short, foreign and missing files */
+  fp = fopen(path, "wb");
+  if (fp) {
+    fwrite(m, sizeof(mat44_t), 2, fp);
+    fclose(fp);
+  }
+  ok &= mapfile_open(&f, path) == 1 && f.base == NULL;
+  remove(path);
+  ok &= mapfile_open(&f, path) == -1;
+
+  printf("mapfile: %s\n", ok ? "ok" : "FAIL");
+}
+
 int main(int argc, char *argv[]) {
   vec2_t a = {0.0};
   vec2_t b = {3.0};
@@ -273,5 +1671,30 @@ int main(int argc, char *argv[]) {
   printf("r to euler = ");
   print_vec3(r3);
 
+  test_stream();
+  test_float();
+  test_transform_batch();
+  test_mat44_simd();
+  test_transform();
+  test_slerp();
+  test_trig();
+  test_sweep();
+  test_hierarchy();
+  test_frustum();
+  test_aabb();
+  test_bvh();
+  test_kdtree();
+  test_inline();
+  test_quat_rotate();
+  test_skin();
+  test_parallel();
+  test_mat44_batch();
+  test_matn();
+  test_linalg();
+  test_inverse_batch();
+  test_pack();
+  test_oct();
+  test_mapfile();
+
   return 0;
 }
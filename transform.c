@@ -0,0 +1,188 @@
+/*
+ *  transform.c
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#include "transform.h"
+
+/* slack for the rounding of matrices built with sin/cos and normalize */
+#define transform_tolerance (r_epsilon * 64)
+
+#define transform_near(a, b) (r_abs((a) - (b)) < transform_tolerance)
+
+transform_kind_t mat44_classify(const mat44_t e) {
+  vec3_t a0, a1, a2;
+
+  if (!r_equal(e3(e), r_zero) || !r_equal(e7(e), r_zero) ||
+      !r_equal(e11(e), r_zero) || !r_equal(e15(e), r_one))
+    return TRANSFORM_PROJECTIVE;
+
+  vx(a0) = e0(e), vy(a0) = e1(e), vz(a0) = e2(e);
+  vx(a1) = e4(e), vy(a1) = e5(e), vz(a1) = e6(e);
+  vx(a2) = e8(e), vy(a2) = e9(e), vz(a2) = e10(e);
+
+  if (r_equal(e0(e), r_one) && r_equal(e5(e), r_one) &&
+      r_equal(e10(e), r_one) && r_equal(e1(e), r_zero) &&
+      r_equal(e2(e), r_zero) && r_equal(e4(e), r_zero) &&
+      r_equal(e6(e), r_zero) && r_equal(e8(e), r_zero) &&
+      r_equal(e9(e), r_zero)) {
+    if (r_equal(e12(e), r_zero) && r_equal(e13(e), r_zero) &&
+        r_equal(e14(e), r_zero))
+      return TRANSFORM_IDENTITY;
+    return TRANSFORM_TRANSLATION;
+  }
+
+  /* orthonormal columns and no reflection */
+  if (transform_near(vec3_lensq(a0), r_one) &&
+      transform_near(vec3_lensq(a1), r_one) &&
+      transform_near(vec3_lensq(a2), r_one) &&
+      transform_near(vec3_dot(a0, a1), r_zero) &&
+      transform_near(vec3_dot(a0, a2), r_zero) &&
+      transform_near(vec3_dot(a1, a2), r_zero)) {
+    vec3_t c;
+    vec3_cross(c, a0, a1);
+    if (vec3_dot(c, a2) > r_zero)
+      return TRANSFORM_RIGID;
+  }
+
+  return TRANSFORM_AFFINE;
+}
+
+void transform_set(transform_t *t, const mat44_t e) {
+  memcpy(t->m, e, sizeof(mat44_t));
+  t->kind = mat44_classify(e);
+}
+
+void transform_identity(transform_t *t) {
+  mat44_identity(t->m);
+  t->kind = TRANSFORM_IDENTITY;
+}
+
+void transform_translate3(transform_t *t, const vec3_t v) {
+  mat44_translate3(t->m, v);
+  t->kind = TRANSFORM_TRANSLATION;
+}
+
+void transform_scale3(transform_t *t, const vec3_t v) {
+  mat44_scale3(t->m, v);
+  t->kind = TRANSFORM_AFFINE;
+}
+
+void transform_rotateaxis(transform_t *t, real_t theta, vec3_t axis) {
+  vec3_t u = {vx(axis), vy(axis), vz(axis)};
+
+  /* unit axis, or the matrix would scale and not be rigid */
+  if (r_equal(vec3_normalize(u, r_one), r_zero)) {
+    transform_identity(t);
+    return;
+  }
+  mat44_rotateaxis(t->m, theta, u);
+  t->kind = TRANSFORM_RIGID;
+}
+
+void transform_lookat(transform_t *t, vec3_t eye, vec3_t target, vec3_t up) {
+  mat44_lookat(t->m, eye, target, up);
+  t->kind = TRANSFORM_RIGID;
+}
+
+void transform_perspective(transform_t *t, real_t fovy, real_t aspect,
+                           real_t near, real_t far) {
+  mat44_perspective(t->m, fovy, aspect, near, far);
+  t->kind = TRANSFORM_PROJECTIVE;
+}
+
+void transform_inverse(transform_t *r, const transform_t *t) {
+  switch (t->kind) {
+  case TRANSFORM_IDENTITY:
+    mat44_identity(r->m);
+    break;
+  case TRANSFORM_TRANSLATION:
+    if (r != t)
+      memcpy(r->m, t->m, sizeof(mat44_t));
+    e12(r->m) = -e12(r->m);
+    e13(r->m) = -e13(r->m);
+    e14(r->m) = -e14(r->m);
+    break;
+  case TRANSFORM_RIGID:
+    mat44_inverse_rigid(r->m, t->m);
+    break;
+  case TRANSFORM_AFFINE:
+    mat44_inverse_affine(r->m, t->m);
+    break;
+  default:
+    mat44_inverse_simd(r->m, t->m);
+    break;
+  }
+  r->kind = t->kind;
+}
+
+void transform_mul(transform_t *r, const transform_t *a, const transform_t *b) {
+  transform_kind_t kind = transform_max(a->kind, b->kind);
+
+  if (a->kind == TRANSFORM_IDENTITY) {
+    if (r != b)
+      memcpy(r->m, b->m, sizeof(mat44_t));
+  } else if (b->kind == TRANSFORM_IDENTITY) {
+    if (r != a)
+      memcpy(r->m, a->m, sizeof(mat44_t));
+  } else if (kind == TRANSFORM_TRANSLATION) {
+    real_t x = e12(a->m) + e12(b->m);
+    real_t y = e13(a->m) + e13(b->m);
+    real_t z = e14(a->m) + e14(b->m);
+
+    mat44_identity(r->m);
+    e12(r->m) = x;
+    e13(r->m) = y;
+    e14(r->m) = z;
+  } else if (kind != TRANSFORM_PROJECTIVE) {
+    mat44_mul_affine(r->m, a->m, b->m);
+  } else {
+    mat44_mul_simd(r->m, a->m, b->m);
+  }
+  r->kind = kind;
+}
+
+void transform_point(vec3_t r, const transform_t *t, const vec3_t v) {
+  vec4_t p, q;
+
+  switch (t->kind) {
+  case TRANSFORM_IDENTITY:
+    vx(r) = vx(v), vy(r) = vy(v), vz(r) = vz(v);
+    break;
+  case TRANSFORM_TRANSLATION:
+    vx(r) = vx(v) + e12(t->m);
+    vy(r) = vy(v) + e13(t->m);
+    vz(r) = vz(v) + e14(t->m);
+    break;
+  case TRANSFORM_RIGID:
+  case TRANSFORM_AFFINE:
+    mat44_transform3(p, t->m, v);
+    vx(r) = vx(p), vy(r) = vy(p), vz(r) = vz(p);
+    break;
+  default:
+    vx(p) = vx(v), vy(p) = vy(v), vz(p) = vz(v), vw(p) = r_one;
+    mat44_transform4(q, t->m, p);
+    vec3_scale(r, q, r_one / vw(q));
+    break;
+  }
+}
+
+void transform_vector(vec3_t r, const transform_t *t, const vec3_t v) {
+  vec3_t p;
+
+  if (t->kind <= TRANSFORM_TRANSLATION) {
+    vx(r) = vx(v), vy(r) = vy(v), vz(r) = vz(v);
+    return;
+  }
+
+  vx(p) = e0(t->m) * vx(v) + e4(t->m) * vy(v) + e8(t->m) * vz(v);
+  vy(p) = e1(t->m) * vx(v) + e5(t->m) * vy(v) + e9(t->m) * vz(v);
+  vz(p) = e2(t->m) * vx(v) + e6(t->m) * vy(v) + e10(t->m) * vz(v);
+  vx(r) = vx(p), vy(r) = vy(p), vz(r) = vz(p);
+}
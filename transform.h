@@ -0,0 +1,77 @@
+/*
+ *  transform.h
+ *
+ *  copyright (c) 2019-2021 Xiongfei Shi
+ *
+ *  author: Xiongfei Shi <xiongfei.shi(a)icloud.com>
+ *  license: Apache-2.0
+ *
+ *  https://github.com/shixiongfei/math
+ */
+
+#ifndef __TRANSFORM_H__
+#define __TRANSFORM_H__
+
+#include "matrix.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Kinds are ordered so that the kind of a product is the larger of the two
+ * operand kinds.
+ **/
+typedef enum transform_kind_t {
+  TRANSFORM_IDENTITY = 0,
+  TRANSFORM_TRANSLATION, /* identity 3x3, any translation */
+  TRANSFORM_RIGID,       /* rotation and translation */
+  TRANSFORM_AFFINE,      /* last row is (0 0 0 1) */
+  TRANSFORM_PROJECTIVE
+} transform_kind_t;
+
+/* a mat44_t tagged with the cheapest kind that describes it */
+typedef struct transform_t {
+  mat44_t m;
+  transform_kind_t kind;
+} transform_t;
+
+#define transform_max(a, b) ((a) > (b) ? (a) : (b))
+
+/* smallest kind describing e */
+transform_kind_t mat44_classify(const mat44_t e);
+
+/* t = e, kind found with mat44_classify */
+void transform_set(transform_t *t, const mat44_t e);
+
+void transform_identity(transform_t *t);
+void transform_translate3(transform_t *t, const vec3_t v);
+void transform_scale3(transform_t *t, const vec3_t v);
+
+/**
+ * Rotation about axis, normalized first so the result is always rigid;
+ * a zero axis gives the identity. axis itself is left unchanged.
+ **/
+void transform_rotateaxis(transform_t *t, real_t theta, vec3_t axis);
+
+void transform_lookat(transform_t *t, vec3_t eye, vec3_t target, vec3_t up);
+void transform_perspective(transform_t *t, real_t fovy, real_t aspect,
+                           real_t near, real_t far);
+
+/* r = t^-1, r may alias t */
+void transform_inverse(transform_t *r, const transform_t *t);
+
+/* r = a * b, r may alias a or b */
+void transform_mul(transform_t *r, const transform_t *a, const transform_t *b);
+
+/* r = t * (v, 1), divided by w when t is projective */
+void transform_point(vec3_t r, const transform_t *t, const vec3_t v);
+
+/* r = t * (v, 0) */
+void transform_vector(vec3_t r, const transform_t *t, const vec3_t v);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __TRANSFORM_H__ */
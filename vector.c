@@ -21,13 +21,31 @@ real_t vec2_normalize(vec2_t v, real_t length) {
 }
 
 void vec2_rotate(vec2_t r, const vec2_t v, real_t theta) {
-  real_t cos_theta = r_cos(theta);
-  real_t sin_theta = r_sin(theta);
+  real_t cos_theta, sin_theta;
+
+  r_sincos(theta, &sin_theta, &cos_theta);
 
   vx(r) = vx(v) * cos_theta - vy(v) * sin_theta;
   vy(r) = vx(v) * sin_theta + vy(v) * cos_theta;
 }
 
+void vec2_rotate_sweep(vec2_t *r, const vec2_t v, real_t theta, real_t step,
+                       size_t count) {
+  real_t c, s;
+  size_t i;
+
+  r_sincos(step, &s, &c);
+
+  for (i = 0; i < count; ++i) {
+    if (i % rotate_sweep_anchor == 0)
+      vec2_rotate(r[i], v, theta + (real_t)i * step);
+    else {
+      vx(r[i]) = vx(r[i - 1]) * c - vy(r[i - 1]) * s;
+      vy(r[i]) = vx(r[i - 1]) * s + vy(r[i - 1]) * c;
+    }
+  }
+}
+
 real_t vec3_normalize(vec3_t v, real_t length) {
   real_t ls = vec3_len(v);
   if (!r_equal(ls, r_zero)) {
@@ -38,8 +56,9 @@ real_t vec3_normalize(vec3_t v, real_t length) {
 }
 
 void vec3_rotate_x(vec3_t r, const vec3_t v, real_t theta) {
-  real_t cos_theta = r_cos(theta);
-  real_t sin_theta = r_sin(theta);
+  real_t cos_theta, sin_theta;
+
+  r_sincos(theta, &sin_theta, &cos_theta);
 
   vx(r) = vx(v);
   vy(r) = vy(v) * cos_theta - vz(v) * sin_theta;
@@ -47,8 +66,9 @@ void vec3_rotate_x(vec3_t r, const vec3_t v, real_t theta) {
 }
 
 void vec3_rotate_y(vec3_t r, const vec3_t v, real_t theta) {
-  real_t cos_theta = r_cos(theta);
-  real_t sin_theta = r_sin(theta);
+  real_t cos_theta, sin_theta;
+
+  r_sincos(theta, &sin_theta, &cos_theta);
 
   vx(r) = vz(v) * sin_theta + vx(v) * cos_theta;
   vy(r) = vy(v);
@@ -56,8 +76,9 @@ void vec3_rotate_y(vec3_t r, const vec3_t v, real_t theta) {
 }
 
 void vec3_rotate_z(vec3_t r, const vec3_t v, real_t theta) {
-  real_t cos_theta = r_cos(theta);
-  real_t sin_theta = r_sin(theta);
+  real_t cos_theta, sin_theta;
+
+  r_sincos(theta, &sin_theta, &cos_theta);
 
   vx(r) = vx(v) * cos_theta - vy(v) * sin_theta;
   vy(r) = vx(v) * sin_theta + vy(v) * cos_theta;
@@ -72,3 +93,69 @@ real_t vec4_normalize(vec4_t v, real_t length) {
   }
   return ls;
 }
+
+realf_t vec2f_normalize(vec2f_t v, realf_t length) {
+  realf_t ls = vec2f_len(v);
+  if (!rf_equal(ls, rf_zero)) {
+    length = length / ls;
+    vec2_scale(v, v, length);
+  }
+  return ls;
+}
+
+void vec2f_rotate(vec2f_t r, const vec2f_t v, realf_t theta) {
+  realf_t cos_theta, sin_theta;
+
+  rf_sincos(theta, &sin_theta, &cos_theta);
+
+  vx(r) = vx(v) * cos_theta - vy(v) * sin_theta;
+  vy(r) = vx(v) * sin_theta + vy(v) * cos_theta;
+}
+
+realf_t vec3f_normalize(vec3f_t v, realf_t length) {
+  realf_t ls = vec3f_len(v);
+  if (!rf_equal(ls, rf_zero)) {
+    length = length / ls;
+    vec3_scale(v, v, length);
+  }
+  return ls;
+}
+
+void vec3f_rotate_x(vec3f_t r, const vec3f_t v, realf_t theta) {
+  realf_t cos_theta, sin_theta;
+
+  rf_sincos(theta, &sin_theta, &cos_theta);
+
+  vx(r) = vx(v);
+  vy(r) = vy(v) * cos_theta - vz(v) * sin_theta;
+  vz(r) = vy(v) * sin_theta + vz(v) * cos_theta;
+}
+
+void vec3f_rotate_y(vec3f_t r, const vec3f_t v, realf_t theta) {
+  realf_t cos_theta, sin_theta;
+
+  rf_sincos(theta, &sin_theta, &cos_theta);
+
+  vx(r) = vz(v) * sin_theta + vx(v) * cos_theta;
+  vy(r) = vy(v);
+  vz(r) = vz(v) * cos_theta - vx(v) * sin_theta;
+}
+
+void vec3f_rotate_z(vec3f_t r, const vec3f_t v, realf_t theta) {
+  realf_t cos_theta, sin_theta;
+
+  rf_sincos(theta, &sin_theta, &cos_theta);
+
+  vx(r) = vx(v) * cos_theta - vy(v) * sin_theta;
+  vy(r) = vx(v) * sin_theta + vy(v) * cos_theta;
+  vz(r) = vz(v);
+}
+
+realf_t vec4f_normalize(vec4f_t v, realf_t length) {
+  realf_t ls = vec4f_len(v);
+  if (!rf_equal(ls, rf_zero)) {
+    length = length / ls;
+    vec4_scale(v, v, length);
+  }
+  return ls;
+}
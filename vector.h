@@ -22,6 +22,10 @@ typedef real_t vec2_t[2];
 typedef real_t vec3_t[3];
 typedef real_t vec4_t[4];
 
+typedef realf_t vec2f_t[2];
+typedef realf_t vec3f_t[3];
+typedef realf_t vec4f_t[4];
+
 #define vx(v) v[0]
 #define vy(v) v[1]
 #define vz(v) v[2]
@@ -95,6 +99,17 @@ real_t vec2_normalize(vec2_t v, real_t length);
 /* rx,ry = x*cos(theta) - y*sin(theta), x*sin(theta) + y*cos(theta) */
 void vec2_rotate(vec2_t r, const vec2_t v, real_t theta);
 
+/**
+ * Rotation sweeps step the previous output by a fixed rotation instead of
+ * calling sin/cos per vector, and re-anchor on the exact rotation every
+ * rotate_sweep_anchor outputs so the drift stays bounded.
+ **/
+#define rotate_sweep_anchor 64
+
+/* r[i] = vec2_rotate(v, theta + i * step) */
+void vec2_rotate_sweep(vec2_t *r, const vec2_t v, real_t theta, real_t step,
+                       size_t count);
+
 /**
  *---------------------------------------------
  *  Vector3
@@ -257,6 +272,32 @@ void vec3_rotate_z(vec3_t r, const vec3_t v, real_t theta);
  * vw*(length/vlen) */
 real_t vec4_normalize(vec4_t v, real_t length);
 
+/**
+ *---------------------------------------------
+ *  Single Precision Vector
+ *---------------------------------------------
+ **/
+
+/**
+ * The arithmetic macros above are type-generic and also take vec2f_t,
+ * vec3f_t and vec4f_t; only the sqrt/trig based operations need a float
+ * flavour.
+ **/
+
+#define vec2f_len(v) rf_sqrt(vec2_lensq(v))
+#define vec3f_len(v) rf_sqrt(vec3_lensq(v))
+#define vec4f_len(v) rf_sqrt(vec4_lensq(v))
+
+realf_t vec2f_normalize(vec2f_t v, realf_t length);
+void vec2f_rotate(vec2f_t r, const vec2f_t v, realf_t theta);
+
+realf_t vec3f_normalize(vec3f_t v, realf_t length);
+void vec3f_rotate_x(vec3f_t r, const vec3f_t v, realf_t theta);
+void vec3f_rotate_y(vec3f_t r, const vec3f_t v, realf_t theta);
+void vec3f_rotate_z(vec3f_t r, const vec3f_t v, realf_t theta);
+
+realf_t vec4f_normalize(vec4f_t v, realf_t length);
+
 #ifdef __cplusplus
 };
 #endif